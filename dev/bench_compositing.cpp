@@ -0,0 +1,128 @@
+// Sort-last scaling on one machine: the volume is split across forked worker processes connected by socket pairs,
+// each ray marches its brick on the CPU and velm_render::composite_binary_swap merges the images on rank 0. The
+// composite time of rank 0 includes waiting for the slowest brick.
+//
+//   velm_bench_compositing [volume edge length] [max workers] [frames]
+
+#include "velm/compositing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// nested shells with some noise, in [0, 1]
+float field(float x, float y, float z, float edge) {
+    float u = x / edge - 0.5f;
+    float v = y / edge - 0.5f;
+    float w = z / edge - 0.5f;
+    float r = std::sqrt(u * u + v * v + w * w);
+    return 0.5f + 0.5f * std::sin(r * 40.0f + std::sin(u * 13.0f) * std::cos(w * 7.0f));
+}
+
+// orthographic rays along +z through the brick, front to back emission and absorption
+void render_brick(const velm_render::domain_decomposition::brick & b,
+                  std::size_t                                      edge,
+                  velm_render::composite_image &                   image) {
+    image.clear(std::uint32_t(edge), std::uint32_t(edge));
+    for (std::size_t y = b.lo[1]; y < b.hi[1]; ++y) {
+        for (std::size_t x = b.lo[0]; x < b.hi[0]; ++x) {
+            glm::vec4 color(0.0f);
+            float     depth = image.depth[y * edge + x];
+            for (std::size_t z = b.lo[2]; z < b.hi[2] && color.w < 0.99f; ++z) {
+                float value = field(float(x), float(y), float(z), float(edge));
+                float alpha = value > 0.6f ? (value - 0.6f) * 0.2f : 0.0f;
+                if (alpha == 0.0f) {
+                    continue;
+                }
+                depth = std::min(depth, float(z));
+                color += (1.0f - color.w) * glm::vec4(value * alpha, 0.5f * alpha, (1.0f - value) * alpha, alpha);
+            }
+            image.color[y * edge + x] = color;
+            image.depth[y * edge + x] = depth;
+        }
+    }
+}
+
+struct timings {
+    double render    = 0.0;
+    double composite = 0.0;
+    double bytes     = 0.0;
+};
+
+timings run_rank(std::size_t                               rank,
+                 velm_render::composite_transport &        transport,
+                 const velm_render::domain_decomposition & decomposition,
+                 std::size_t                               edge,
+                 std::size_t                               frames) {
+    // the camera looks along +z from below the volume
+    glm::vec3                      eye(0.5f * float(edge), 0.5f * float(edge), -1e6f);
+    std::vector<std::size_t>       order = decomposition.visibility_order(eye);
+    velm_render::composite_options options;
+    options.order = order;
+
+    timings                      t;
+    velm_render::composite_image image;
+    for (std::size_t f = 0; f < frames; ++f) {
+        auto start = clock_type::now();
+        render_brick(decomposition.bricks()[rank], edge, image);
+        auto                         rendered = clock_type::now();
+        velm_render::composite_stats stats    = velm_render::composite_binary_swap(image, transport, options);
+        auto                         done     = clock_type::now();
+        t.render += std::chrono::duration<double>(rendered - start).count();
+        t.composite += std::chrono::duration<double>(done - rendered).count();
+        t.bytes += double(stats.bytes_sent);
+    }
+    return t;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    std::size_t edge        = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::size_t max_workers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+    std::size_t frames      = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+    std::size_t dims[3]     = { edge, edge, edge };
+
+    std::printf("%zu^3 volume, %zux%zu image, %zu frames\n", edge, edge, edge, frames);
+    std::printf("workers  frame ms  render ms  composite ms  MB sent by rank 0\n");
+    for (std::size_t workers = 1; workers <= max_workers; workers *= 2) {
+        velm_render::domain_decomposition decomposition(dims, workers);
+        std::vector<std::vector<int>>     mesh = velm_render::socket_transport::connect_local(workers);
+
+        std::vector<pid_t> children;
+        for (std::size_t r = 1; r < workers; ++r) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                velm_render::socket_transport transport(r, mesh[r], &mesh);
+                (void) run_rank(r, transport, decomposition, edge, frames);
+                std::_Exit(0);
+            }
+            children.push_back(pid);
+        }
+
+        auto    start = clock_type::now();
+        timings t;
+        {
+            velm_render::socket_transport transport(0, mesh[0], &mesh);
+            t = run_rank(0, transport, decomposition, edge, frames);
+        }
+        double total = std::chrono::duration<double>(clock_type::now() - start).count();
+        for (pid_t pid : children) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        double n = double(frames);
+        std::printf("%7zu  %8.2f  %9.2f  %12.2f  %17.2f\n", workers, total / n * 1e3, t.render / n * 1e3,
+                    t.composite / n * 1e3, t.bytes / n / (1 << 20));
+    }
+    return 0;
+}
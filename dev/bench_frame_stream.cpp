@@ -0,0 +1,90 @@
+// Cost of velm_render::frame_server for a viewer on localhost: a disc moves over a static gradient, and each frame's
+// submit time (what the render loop pays), the encoder throughput and the bytes sent per frame are reported, lossless
+// and with the low bits dropped.
+//
+//   velm_bench_frame_stream [width] [height] [frames]
+
+#include "velm/frame_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// gradient with a little dither that changes every frame, like sampling noise, and a disc of radius r at (cx, cy)
+void draw(velm_render::rgba_frame & frame, std::size_t f, float cx, float cy, float r) {
+    for (std::size_t y = 0; y < frame.height; ++y) {
+        for (std::size_t x = 0; x < frame.width; ++x) {
+            std::uint8_t * p      = &frame.pixels[(y * frame.width + x) * 4];
+            float          dx     = float(x) - cx;
+            float          dy     = float(y) - cy;
+            bool           inside = dx * dx + dy * dy < r * r;
+            std::uint8_t   dither = std::uint8_t((x * 7 + y * 13 + f) % 3);
+            p[0]                  = inside ? 230 : std::uint8_t(x * 255 / frame.width + dither);
+            p[1]                  = inside ? 120 : std::uint8_t(y * 255 / frame.height + dither);
+            p[2]                  = inside ? 40 : 90;
+            p[3]                  = 255;
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    std::uint32_t width  = argc > 1 ? std::uint32_t(std::strtoul(argv[1], nullptr, 10)) : 1920;
+    std::uint32_t height = argc > 2 ? std::uint32_t(std::strtoul(argv[2], nullptr, 10)) : 1080;
+    std::size_t   frames = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 120;
+
+    velm_render::rgba_frame frame{ width, height, {} };
+    frame.pixels.resize(frame.pixel_count() * 4);
+    double raw = double(frame.pixels.size());
+    std::printf("%ux%u, %zu frames, %.2f MB per raw frame\n", width, height, frames, raw / (1 << 20));
+    std::printf("drop bits  submit ms  frames encoded  KB per frame  ratio  frame ms\n");
+    for (std::uint32_t bits : { 0u, 3u }) {
+        velm_render::frame_server_options options;
+        options.drop_bits = bits;
+        velm_render::frame_server server(options);
+
+        std::atomic<bool> done{ false };
+        std::thread       viewer([&] {
+            velm_render::frame_client client("127.0.0.1", server.port());
+            while (!done.load()) {
+                (void) client.receive(std::chrono::milliseconds(10));
+            }
+            while (client.receive(std::chrono::milliseconds(50))) {
+            }
+        });
+        while (server.stats().viewers == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        double submit = 0.0;
+        auto   start  = clock_type::now();
+        for (std::size_t f = 0; f < frames; ++f) {
+            float t = float(f) / float(frames) * 6.2832f;
+            draw(frame, f, float(width) * (0.5f + 0.3f * std::cos(t)), float(height) * (0.5f + 0.3f * std::sin(t)),
+                 float(height) * 0.1f);
+            auto before = clock_type::now();
+            server.submit(frame);
+            submit += std::chrono::duration<double>(clock_type::now() - before).count();
+        }
+        server.flush();
+        double total = std::chrono::duration<double>(clock_type::now() - start).count();
+        done.store(true);
+        viewer.join();
+
+        velm_render::frame_server_stats stats = server.stats();
+        double per_frame = double(stats.bytes_sent) / double(std::max<std::uint64_t>(stats.encoded, 1));
+        std::printf("%9u  %9.3f  %14llu  %12.1f  %5.1f  %8.2f\n", bits, submit / double(frames) * 1e3,
+                    static_cast<unsigned long long>(stats.encoded), per_frame / 1024.0, raw / per_frame,
+                    total / double(frames) * 1e3);
+    }
+    return 0;
+}
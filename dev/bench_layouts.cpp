@@ -0,0 +1,109 @@
+// Stencil throughput of row-major ndarray against the Morton and brick layouts, in million voxels per second.
+//
+//   velm_bench_layouts [volume edge length] [random neighbourhood count]
+
+#include "velm/layout.h"
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct position {
+    std::size_t i, j, k;
+};
+
+// best of three runs after one warm up, kernel returns a checksum so the work is not optimized away
+template <typename Kernel> double best_rate(std::size_t voxels, Kernel && kernel, double & checksum) {
+    checksum    = kernel();
+    double best = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        auto                          start   = std::chrono::steady_clock::now();
+        checksum                              = kernel();
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        best                                  = std::max(best, double(voxels) / seconds.count() * 1e-6);
+    }
+    return best;
+}
+
+// 7 point Laplacian over the interior, in storage order of the row-major array
+template <typename Array> double laplacian(const Array & a, std::size_t n) {
+    double sum = 0.0;
+    for (std::size_t i = 1; i + 1 < n; ++i) {
+        for (std::size_t j = 1; j + 1 < n; ++j) {
+            for (std::size_t k = 1; k + 1 < n; ++k) {
+                sum += a(i - 1, j, k) + a(i + 1, j, k) + a(i, j - 1, k) + a(i, j + 1, k) + a(i, j, k - 1) +
+                       a(i, j, k + 1) - 6.0f * a(i, j, k);
+            }
+        }
+    }
+    return sum;
+}
+
+// 3 x 3 x 3 neighbourhoods at random centres, the access pattern of probing and particle advection
+template <typename Array> double neighbourhoods(const Array & a, const std::vector<position> & centres) {
+    double sum = 0.0;
+    for (const position & c : centres) {
+        float box = 0.0f;
+        for (std::size_t i = c.i - 1; i <= c.i + 1; ++i) {
+            for (std::size_t j = c.j - 1; j <= c.j + 1; ++j) {
+                for (std::size_t k = c.k - 1; k <= c.k + 1; ++k) {
+                    box += a(i, j, k);
+                }
+            }
+        }
+        sum += box;
+    }
+    return sum;
+}
+
+template <typename Array>
+void report(const char *                  name,
+            const Array &                 a,
+            std::size_t                   n,
+            const std::vector<position> & centres) {
+    double      laplacian_sum = 0.0;
+    double      box_sum       = 0.0;
+    std::size_t interior      = (n - 2) * (n - 2) * (n - 2);
+    double      stencil       = best_rate(interior, [&] { return laplacian(a, n); }, laplacian_sum);
+    double      random        = best_rate(centres.size(), [&] { return neighbourhoods(a, centres); }, box_sum);
+    std::printf("%-10s %14.1f %14.1f   (%g %g)\n", name, stencil, random, laplacian_sum, box_sum);
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    std::size_t edge  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1 << 20;
+    edge              = std::max<std::size_t>(edge, 3);
+
+    velm_DR::ndarray<float, 3>            volume(edge, edge, edge);
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> value(0.0f, 1.0f);
+    for (float & v : volume) {
+        v = value(rng);
+    }
+    std::uniform_int_distribution<std::size_t> coordinate(1, edge - 2);
+    std::vector<position>                      centres(count);
+    for (position & c : centres) {
+        c = { coordinate(rng), coordinate(rng), coordinate(rng) };
+    }
+
+    auto                          start   = std::chrono::steady_clock::now();
+    auto                          morton  = velm_DR::morton_array<float>::from_row_major(volume);
+    auto                          brick   = velm_DR::brick_array<float>::from_row_major(volume);
+    std::chrono::duration<double> convert = std::chrono::steady_clock::now() - start;
+
+    std::printf("%zu^3 volume, %zu random neighbourhoods, conversion to both layouts %.1f ms\n", edge, count,
+                convert.count() * 1e3);
+    std::printf("%-10s %14s %14s\n", "layout", "7-point Mvox/s", "3x3x3 Mvox/s");
+    report("row-major", volume, edge, centres);
+    report("morton", morton, edge, centres);
+    report("brick", brick, edge, centres);
+    return 0;
+}
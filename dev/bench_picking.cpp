@@ -0,0 +1,64 @@
+// Latency of velm_render::pick_isovalue on a ball-shaped field, hover rays from a camera outside the grid.
+//
+//   velm_bench_picking [volume edge length] [ray count]
+
+#include "velm/picking.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+int main(int argc, char ** argv) {
+    std::size_t edge  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    std::size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+
+    // negative distance to the centre, the isovalue picks a ball of a third of the edge
+    velm_DR::ndarray<float, 3> volume(edge, edge, edge);
+    float                      centre = float(edge) * 0.5f;
+    for (std::size_t i = 0; i < edge; ++i) {
+        for (std::size_t j = 0; j < edge; ++j) {
+            float * row = &volume(i, j, std::size_t(0));
+            for (std::size_t k = 0; k < edge; ++k) {
+                float x = float(i) - centre;
+                float y = float(j) - centre;
+                float z = float(k) - centre;
+                row[k]  = -std::sqrt(x * x + y * y + z * z);
+            }
+        }
+    }
+
+    auto                          start  = std::chrono::steady_clock::now();
+    velm_render::minmax_bricks    bricks(volume);
+    std::chrono::duration<double> build  = std::chrono::steady_clock::now() - start;
+    velm_render::grid_probe       grid{ volume, bricks };
+    float                         radius = float(edge) / 3.0f;
+
+    glm::vec3   eye(-float(edge), centre * 1.2f, centre * 0.9f);
+    glm::mat4x4 view = glm::lookAt(eye, glm::vec3(centre), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4x4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 10.0f * float(edge));
+
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> pixel(0.0f, 1024.0f);
+    std::vector<double>                   latencies;
+    std::size_t                           hits = 0;
+    for (std::size_t n = 0; n < count; ++n) {
+        velm_render::ray r = velm_render::cursor_ray(view, proj, glm::vec2(pixel(rng), pixel(rng)),
+                                                     glm::vec2(1024.0f, 1024.0f), true);
+        auto                          t0      = std::chrono::steady_clock::now();
+        auto                          hit     = velm_render::pick_isovalue(grid, r, -radius);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - t0;
+        latencies.push_back(seconds.count() * 1e6);
+        hits += hit.hit;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("%zu^3 volume, brick ranges built in %.1f ms\n", edge, build.count() * 1e3);
+    std::printf("%zu rays, %zu hits: median %.1f us, p99 %.1f us, max %.1f us\n", count, hits,
+                latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+    return 0;
+}
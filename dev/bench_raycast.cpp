@@ -0,0 +1,78 @@
+// Frame time of velm_render::raycast_volume on a field of turbulent-looking shells, with and without empty space
+// skipping, on every worker of the global job system. Writes the last frame when given an output file.
+//
+//   velm_bench_raycast [volume edge length] [width] [height] [frames] [out.ppm]
+
+#include "velm/raycaster.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+int main(int argc, char ** argv) {
+    std::size_t   edge   = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    std::uint32_t width  = argc > 2 ? std::uint32_t(std::strtoul(argv[2], nullptr, 10)) : 1920;
+    std::uint32_t height = argc > 3 ? std::uint32_t(std::strtoul(argv[3], nullptr, 10)) : 1080;
+    std::size_t   frames = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 5;
+
+    // shells around the centre that fade out before the corners, which leaves empty bricks to skip
+    velm_DR::ndarray<float, 3> volume(edge, edge, edge);
+    float                      centre = float(edge) * 0.5f;
+    velm::parallel_for(0, edge, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+            for (std::size_t j = 0; j < edge; ++j) {
+                float * row = &volume(i, j, std::size_t(0));
+                for (std::size_t k = 0; k < edge; ++k) {
+                    float x = (float(i) - centre) / centre;
+                    float y = (float(j) - centre) / centre;
+                    float z = (float(k) - centre) / centre;
+                    float r = std::sqrt(x * x + y * y + z * z);
+                    row[k]  = r < 0.9f ? 0.5f + 0.5f * std::sin(r * 30.0f + std::sin(x * 9.0f) * std::cos(z * 7.0f))
+                                       : 0.0f;
+                }
+            }
+        }
+    });
+
+    auto                               start = std::chrono::steady_clock::now();
+    velm_render::minmax_bricks         bricks(volume);
+    std::chrono::duration<double>      build = std::chrono::steady_clock::now() - start;
+    velm_render::grid_probe            grid{ volume, bricks };
+    velm_render::transfer_function     tf(256);
+    std::vector<velm_render::tf_point> points = { { 0.0f, glm::vec4(0.0f) },
+                                                   { 0.55f, glm::vec4(0.0f) },
+                                                   { 0.7f, glm::vec4(0.9f, 0.4f, 0.1f, 0.02f) },
+                                                   { 1.0f, glm::vec4(1.0f, 1.0f, 0.8f, 0.2f) } };
+    tf.set_points(points);
+    tf.set_step(0.5f);
+    (void) tf.update();
+
+    glm::vec3   target(centre);
+    glm::vec3   eye  = target + glm::vec3(0.8f, 0.5f, -1.6f) * float(edge);
+    glm::mat4x4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4x4 proj = glm::perspective(glm::radians(35.0f), float(width) / float(height), 1.0f, 4.0f * float(edge));
+
+    std::printf("%zu^3 volume, %ux%u, %zu threads, bricks built in %.1f ms\n", edge, width, height,
+                velm::job_system::global().concurrency(), build.count() * 1e3);
+    velm_render::composite_image image;
+    image.clear(width, height);
+    for (bool skip : { false, true }) {
+        velm_render::raycast_options options;
+        options.skip_empty = skip;
+        velm_render::raycast_volume(view, proj, true, grid, tf, image, options);  // warm up
+        start = std::chrono::steady_clock::now();
+        for (std::size_t f = 0; f < frames; ++f) {
+            velm_render::raycast_volume(view, proj, true, grid, tf, image, options);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::printf("%-18s %8.1f ms per frame\n", skip ? "skipping empty" : "every step",
+                    elapsed.count() / double(frames) * 1e3);
+    }
+    if (argc > 5) {
+        velm_render::write_ppm(image, argv[5], glm::vec3(0.0f));
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Throughput of velm_DR::sample for every filter / boundary combination, in million samples per second.
+//
+//   velm_bench_sampling [volume edge length] [sample count]
+
+#include "velm/sampling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using velm_DR::sample_boundary;
+using velm_DR::sample_filter;
+
+namespace {
+
+const char * filter_name(sample_filter filter) {
+    switch (filter) {
+        case sample_filter::NEAREST:
+            return "nearest";
+        case sample_filter::TRILINEAR:
+            return "trilinear";
+        case sample_filter::TRICUBIC:
+            return "tricubic";
+    }
+    return "";
+}
+
+const char * boundary_name(sample_boundary boundary) {
+    switch (boundary) {
+        case sample_boundary::CLAMP:
+            return "clamp";
+        case sample_boundary::ZERO:
+            return "zero";
+        case sample_boundary::PERIODIC:
+            return "periodic";
+    }
+    return "";
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    std::size_t edge  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1 << 22;
+
+    velm_DR::ndarray<float, 3>            volume(edge, edge, edge);
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> value(0.0f, 1.0f);
+    for (float & v : volume) {
+        v = value(rng);
+    }
+    // random positions defeat the caches like probing or oblique resampling of a large volume does
+    std::uniform_real_distribution<float> coordinate(-2.0f, float(edge) + 1.0f);
+    std::vector<glm::vec3>                positions(count);
+    for (glm::vec3 & p : positions) {
+        p = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+    }
+    std::vector<float> out(count);
+
+    std::printf("%zu^3 volume, %zu random positions\n", edge, count);
+    std::printf("%-10s %-9s %-6s %12s\n", "filter", "boundary", "simd", "Msamples/s");
+    for (sample_filter filter : { sample_filter::NEAREST, sample_filter::TRILINEAR, sample_filter::TRICUBIC }) {
+        for (sample_boundary boundary :
+             { sample_boundary::CLAMP, sample_boundary::ZERO, sample_boundary::PERIODIC }) {
+            for (bool simd : { false, true }) {
+                velm_DR::sample_options options{ filter, boundary, simd };
+                // warm up once, then take the best of three runs
+                velm_DR::sample(volume, positions, out, options);
+                double best = 0.0;
+                for (int run = 0; run < 3; ++run) {
+                    auto start = std::chrono::steady_clock::now();
+                    velm_DR::sample(volume, positions, out, options);
+                    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+                    best                                  = std::max(best, double(count) / seconds.count() * 1e-6);
+                }
+                std::printf("%-10s %-9s %-6s %12.1f\n", filter_name(filter), boundary_name(boundary),
+                            simd ? "yes" : "no", best);
+            }
+        }
+    }
+    return 0;
+}
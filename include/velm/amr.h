@@ -0,0 +1,149 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/ndarray.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace velm {
+class hdf5_file;
+}
+
+namespace velm_DR {
+
+// half-open box of cells [lo, hi) in the index space of one level
+struct amr_box {
+    std::int64_t lo[3] = { 0, 0, 0 };
+    std::int64_t hi[3] = { 0, 0, 0 };
+
+    [[nodiscard]] bool empty() const { return hi[0] <= lo[0] || hi[1] <= lo[1] || hi[2] <= lo[2]; }
+
+    [[nodiscard]] std::int64_t cells() const {
+        return empty() ? 0 : (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+    }
+
+    [[nodiscard]] bool contains(std::int64_t i, std::int64_t j, std::int64_t k) const {
+        return i >= lo[0] && i < hi[0] && j >= lo[1] && j < hi[1] && k >= lo[2] && k < hi[2];
+    }
+
+    [[nodiscard]] amr_box intersection(const amr_box & other) const;
+    // the same region ratio times finer
+    [[nodiscard]] amr_box refined(std::int64_t ratio) const;
+    // coarse cells completely inside the box (inner), or touched by it (outer)
+    [[nodiscard]] amr_box coarsened_inner(std::int64_t ratio) const;
+    [[nodiscard]] amr_box coarsened_outer(std::int64_t ratio) const;
+};
+
+struct amr_patch {
+    std::string          dataset;
+    std::size_t          level = 0;
+    amr_box              box;  // cells of the patch in the index space of its level, one sample per cell
+    // parts of box completely covered by patches of the next finer level, disjoint
+    std::vector<amr_box> covered;
+};
+
+struct amr_level {
+    std::int64_t             ratio   = 1;  // refinement relative to the next coarser level
+    std::int64_t             to_base = 1;  // cells of this level per level 0 cell along each axis
+    std::vector<std::size_t> patches;
+};
+
+/*
+ * Block-structured AMR field: levels of non-overlapping patches, level l refining level l - 1 by an integer ratio.
+ * Positions are in level 0 cell units, cell (i, j, k) of level l spans [i, i + 1) / to_base. Patch samples are
+ * loaded on first use through the loader and kept until unloaded, or until the memory budget runs out and they are
+ * the least recently used ones nobody else holds; where levels overlap the finest one wins.
+ */
+class amr_hierarchy {
+  public:
+    static constexpr std::size_t npos = SIZE_MAX;
+
+    // fills out, already sized to the patch box, with the samples of a patch
+    using patch_loader = std::function<void(const amr_patch & patch, ndarray<float, 3> & out)>;
+
+    // ratios[l] refines level l - 1 into level l, ratios[0] is ignored; computes the coarse / fine coverage
+    amr_hierarchy(std::vector<amr_patch> patches, std::span<const std::int64_t> ratios, patch_loader loader);
+    ~amr_hierarchy();
+
+    amr_hierarchy(const amr_hierarchy &)             = delete;
+    amr_hierarchy & operator=(const amr_hierarchy &) = delete;
+
+    [[nodiscard]] std::size_t level_count() const { return levels_.size(); }
+
+    [[nodiscard]] const amr_level & level(std::size_t l) const { return levels_.at(l); }
+
+    [[nodiscard]] std::size_t patch_count() const { return patches_.size(); }
+
+    [[nodiscard]] const amr_patch & patch(std::size_t p) const { return patches_.at(p); }
+
+    // coarsest level whose cells are at most max_cell_size level 0 cells wide, the finest one when none is
+    [[nodiscard]] std::size_t level_for_cell_size(float max_cell_size) const;
+
+    // finest patch of a level up to max_level holding the position, npos outside all patches
+    [[nodiscard]] std::size_t find(const glm::vec3 & position, std::size_t max_level) const;
+
+    /*
+     * Patches up to max_level needed to show region (level 0 cells) with the finest available data, coarse to
+     * fine: a patch is left out when every cell it has inside the region is covered by the next level.
+     */
+    [[nodiscard]] std::vector<std::size_t> select(const amr_box & region, std::size_t max_level) const;
+
+    // samples of a patch, loaded on first use; loading is serialized, the returned array stays valid until unload
+    [[nodiscard]] std::shared_ptr<const ndarray<float, 3>> data(std::size_t p);
+    void                                                    unload(std::size_t p);
+    [[nodiscard]] std::size_t                               loaded_count() const;
+
+    // cell value of the finest patch up to max_level at the position, outside where no patch covers it
+    [[nodiscard]] float sample(const glm::vec3 & position, std::size_t max_level, float outside = 0.0f);
+
+    /*
+     * Composite of region (level 0 cells) on the grid of out, each sample taking the value at its cell centre from
+     * the finest selected patch. Only the selected patches are loaded; they are painted coarse to fine, every one
+     * split over the planes of out on the job system.
+     */
+    void resample(ndarray<float, 3> & out,
+                  const amr_box &     region,
+                  std::size_t         max_level,
+                  float               outside = 0.0f,
+                  velm::job_system &  jobs    = velm::job_system::global());
+
+  private:
+    std::vector<amr_patch>                                patches_;
+    std::vector<amr_level>                                levels_;
+    patch_loader                                          loader_;
+    std::vector<std::shared_ptr<const ndarray<float, 3>>> loaded_;
+    std::vector<std::uint64_t>                            last_use_;
+    std::uint64_t                                         use_clock_ = 0;
+    std::mutex                                            load_mutex_;   // serializes loading
+    mutable std::mutex                                    state_mutex_;  // guards loaded_ and last_use_
+    std::size_t                                           evictor_id_;
+
+    // memory budget evictor: drops unreferenced patches, least recently used first
+    std::size_t evict(std::size_t bytes);
+};
+
+#ifdef VELM_ENABLE_HDF5
+// where the levels, patch placement and refinement ratios are found in a file
+struct amr_layout {
+    // groups /<level_prefix><l> below the root hold the patches of level l, one dataset each
+    std::string level_prefix = "level_";
+    // first cell of a patch in the index space of its level, on the patch dataset
+    std::string offset_attribute = "offset";
+    // refinement ratio to the next coarser level, on the level group or else on its first patch
+    std::string refinement_attribute = "refinement";
+};
+
+/*
+ * Reads the patch hierarchy (names, boxes, ratios) but no samples; patches are read as float on first use, so the
+ * file must outlive the hierarchy. Throws std::runtime_error when the file does not follow the layout.
+ */
+[[nodiscard]] amr_hierarchy load_amr(const velm::hdf5_file & file, const amr_layout & layout = {});
+#endif
+}  // namespace velm_DR
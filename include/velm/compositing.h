@@ -0,0 +1,159 @@
+#pragma once
+#include "velm/memory_budget.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace velm_render {
+
+// one rank's rendering of its part of the domain: premultiplied color and the depth of the nearest contribution
+struct composite_image {
+    std::uint32_t          width  = 0;
+    std::uint32_t          height = 0;
+    std::vector<glm::vec4> color;  // row-major
+    std::vector<float>     depth;  // +inf where nothing was drawn
+    velm::memory_charge    memory{ velm::memory_category::IMAGES };  // color and depth, kept up to date by clear()
+
+    // transparent black at infinite depth
+    void clear(std::uint32_t w, std::uint32_t h);
+
+    [[nodiscard]] std::size_t pixel_count() const { return std::size_t(width) * height; }
+};
+
+// a premultiplied color over an opaque background, rounded to 8 bits per channel; the conversion of write_ppm and
+// to_rgba8
+inline void to_rgb8(const glm::vec4 & color, const glm::vec3 & background, std::uint8_t * rgb) {
+    for (int channel = 0; channel < 3; ++channel) {
+        float value  = color[channel] + (1.0f - color.w) * background[channel];
+        rgb[channel] = static_cast<std::uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+enum class composite_mode : std::uint8_t {
+    DEPTH,  // opaque surfaces, the nearest depth wins per pixel
+    OVER,   // semi-transparent layers, blended front to back in visibility order
+};
+
+/*
+ * Blocking point-to-point messages between the ranks of a compositing group. Every receive must be matched by a
+ * send of the same size from the peer; exchange() sends and receives at once so two peers swapping large buffers
+ * never wait on each other.
+ */
+class composite_transport {
+  public:
+    virtual ~composite_transport() = default;
+
+    [[nodiscard]] virtual std::size_t rank() const = 0;
+    [[nodiscard]] virtual std::size_t size() const = 0;
+
+    virtual void send(std::size_t peer, std::span<const std::byte> bytes) = 0;
+    virtual void receive(std::size_t peer, std::span<std::byte> bytes)    = 0;
+    virtual void exchange(std::size_t peer, std::span<const std::byte> out, std::span<std::byte> in);
+};
+
+// ranks as threads of one process, for tests and single machine runs without extra processes
+[[nodiscard]] std::vector<std::unique_ptr<composite_transport>> make_local_group(std::size_t ranks);
+
+#if defined(__unix__) || defined(__APPLE__)
+/*
+ * Ranks connected by stream sockets, one per peer; POSIX only, use make_local_group elsewhere. connect_local()
+ * creates the full mesh of socket pairs for ranks on one machine: fork the workers after it, and let rank r build its
+ * transport from row r (the other rows belong to the other workers and are closed by the constructor of each).
+ * Throws std::runtime_error on socket failures.
+ */
+class socket_transport final : public composite_transport {
+  public:
+    // fds[r][p] is the end held by rank r of the connection to rank p, -1 on the diagonal
+    [[nodiscard]] static std::vector<std::vector<int>> connect_local(std::size_t ranks);
+
+    // takes ownership of peers[p], closes every other descriptor of mesh when given
+    socket_transport(std::size_t rank, std::vector<int> peers, const std::vector<std::vector<int>> * mesh = nullptr);
+    ~socket_transport() override;
+
+    socket_transport(const socket_transport &)             = delete;
+    socket_transport & operator=(const socket_transport &) = delete;
+
+    [[nodiscard]] std::size_t rank() const override { return rank_; }
+
+    [[nodiscard]] std::size_t size() const override { return peers.size(); }
+
+    void send(std::size_t peer, std::span<const std::byte> bytes) override;
+    void receive(std::size_t peer, std::span<std::byte> bytes) override;
+    void exchange(std::size_t peer, std::span<const std::byte> out, std::span<std::byte> in) override;
+
+  private:
+    std::size_t      rank_;
+    std::vector<int> peers;
+};
+#endif
+
+struct composite_options {
+    composite_mode mode = composite_mode::OVER;
+    // ranks from front to back for OVER (see domain_decomposition::visibility_order), empty for rank order
+    std::span<const std::size_t> order;
+    // the rank that ends up with the whole image
+    std::size_t root = 0;
+};
+
+struct composite_stats {
+    std::size_t rounds     = 0;  // swap rounds, log2 of the largest power of two not above the rank count
+    std::size_t bytes_sent = 0;  // by this rank
+};
+
+/*
+ * Sort-last compositing by binary swap. Ranks are paired by their position in the visibility order; in every round
+ * the partners split the pixels they are responsible for in half, send away one half and blend the half they keep,
+ * so each rank sends about one image in total whatever the rank count. The root then gathers the 1 / N slices. With
+ * a rank count that is not a power of two, neighbouring positions are folded together first.
+ *
+ * Every rank of the transport must call this with the same options and image size. On the root image holds the
+ * composite afterwards, elsewhere its contents are unspecified.
+ */
+composite_stats composite_binary_swap(composite_image &         image,
+                                      composite_transport &     transport,
+                                      const composite_options & options = {});
+
+// front over back, premultiplied
+void blend_over(std::span<glm::vec4>       front_color,
+                std::span<float>           front_depth,
+                std::span<const glm::vec4> back_color,
+                std::span<const float>     back_depth);
+
+/*
+ * The domain of a dims[0] x dims[1] x dims[2] grid cut into ranks bricks by recursive bisection of the longest axis
+ * (sizes balanced to within a sample). A brick covers samples [lo, hi); neighbours share no samples, renderers that
+ * interpolate across brick faces read one more layer on the high side.
+ */
+class domain_decomposition {
+  public:
+    struct brick {
+        std::size_t lo[3];
+        std::size_t hi[3];
+    };
+
+    domain_decomposition(const std::size_t (&dims)[3], std::size_t ranks);
+
+    [[nodiscard]] std::span<const brick> bricks() const { return bricks_; }
+
+    // ranks front to back as seen from eye (grid index space), exact for the bisection tree and any eye position
+    [[nodiscard]] std::vector<std::size_t> visibility_order(const glm::vec3 & eye) const;
+
+  private:
+    struct split {
+        int         axis;      // -1 for a leaf
+        std::size_t position;  // first sample of the high child
+        std::size_t low;       // child indices into nodes, or the brick of a leaf in low
+        std::size_t high;
+    };
+
+    std::vector<brick> bricks_;
+    std::vector<split> nodes;
+
+    std::size_t build(const brick & box, std::size_t ranks);
+};
+}  // namespace velm_render
@@ -0,0 +1,101 @@
+#pragma once
+#include "velm/scene.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace velm_render {
+
+struct frustum {
+    // planes as (normal, distance), a point p is inside when dot(normal, p) + distance >= 0 for all planes
+    glm::vec4 planes[6];
+
+    // homogeneous_depth: clip space z in [-1, 1] (OpenGL) rather than [0, 1], see bgfx::Caps::homogeneousDepth
+    [[nodiscard]] static frustum from_view_proj(const glm::mat4x4 & view_proj, bool homogeneous_depth);
+};
+
+/*
+ * Coarse depth buffer for occlusion culling. Each texel stores the farthest window-space depth of the full
+ * resolution pixels it covers, so a box is only rejected when it lies behind everything in its screen rectangle.
+ *
+ * The renderer does not read depth back yet: view::occlusion_culling() has to be fed through load_depth() by the
+ * caller, typically from a readback of the previous frame. Until then the buffer stays clear and rejects nothing.
+ */
+class occlusion_buffer {
+  public:
+    occlusion_buffer(std::uint32_t width, std::uint32_t height);
+
+    void clear();
+    // depth holds width * height values, top row first; an empty source clears the buffer
+    void load_depth(std::span<const float> depth, std::uint32_t width, std::uint32_t height);
+
+    [[nodiscard]] bool is_occluded(const aabb & bounds, const glm::mat4x4 & view_proj, bool homogeneous_depth) const;
+
+    [[nodiscard]] std::uint32_t width() const { return width_; }
+
+    [[nodiscard]] std::uint32_t height() const { return height_; }
+
+  private:
+    std::uint32_t      width_;
+    std::uint32_t      height_;
+    std::vector<float> depth_;
+};
+
+/*
+ * Bounding volume hierarchy over scene objects with eight children per node. Child bounds are stored as
+ * structure of arrays so a frustum plane is tested against all eight boxes at once.
+ *
+ * refit() only walks from changed leaves towards the root, rebuild() is needed after objects were added or removed.
+ */
+class bvh {
+  public:
+    static constexpr std::uint32_t width     = 8;
+    static constexpr std::uint32_t empty     = UINT32_MAX;
+    static constexpr std::uint32_t leaf_flag = 0x80000000u;
+
+    struct alignas(32) node {
+        float         min_x[width];
+        float         min_y[width];
+        float         min_z[width];
+        float         max_x[width];
+        float         max_y[width];
+        float         max_z[width];
+        std::uint32_t child[width];  // node index, object slot | leaf_flag, or empty
+        std::uint32_t parent;
+        std::uint32_t parent_lane;
+    };
+
+    void rebuild(const velm::Scene & scene);
+    void refit(const velm::Scene & scene, std::span<const std::uint32_t> changed_slots);
+
+    // appends the visible object slots, only objects with RENDER_VISIBLE set are reported
+    void cull(const frustum &               view_frustum,
+              std::span<const std::uint8_t> render_flags,
+              std::vector<std::uint32_t> &  visible,
+              const occlusion_buffer *      occlusion         = nullptr,
+              const glm::mat4x4 *           view_proj         = nullptr,
+              bool                          homogeneous_depth = false) const;
+
+    [[nodiscard]] std::span<const node> nodes() const { return nodes_; }
+
+    [[nodiscard]] std::uint64_t built_version() const { return built_version_; }
+
+  private:
+    struct leaf_location {
+        std::uint32_t node;
+        std::uint32_t lane;
+    };
+
+    std::vector<node>          nodes_;
+    std::vector<leaf_location> leaf_of_slot_;
+    std::uint64_t              built_version_ = 0;
+
+    std::uint32_t      build_node(std::span<std::uint32_t> slots,
+                                  std::span<const aabb>    bounds,
+                                  std::uint32_t            parent,
+                                  std::uint32_t            parent_lane);
+    [[nodiscard]] aabb node_bounds(std::uint32_t index) const;
+};
+}  // namespace velm_render
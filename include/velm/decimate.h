@@ -0,0 +1,41 @@
+#pragma once
+#include "velm/mesh.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+namespace velm_dr {
+
+struct decimate_options {
+    // fraction of triangles to keep
+    float target_ratio = 0.25f;
+    // collapses whose error exceeds this distance (object space) are not performed
+    float max_error = FLT_MAX;
+    // the mesh is split into cells_per_axis^3 cells that are simplified in parallel, 0 derives it from the thread count
+    std::size_t cells_per_axis = 0;
+    // shifts the cell grid by this fraction of a cell so seams of a previous pass end up inside cells
+    float cell_offset = 0.0f;
+};
+
+/*
+ * Garland-Heckbert quadric error edge collapse.
+ *
+ * Vertices with identical positions are welded first. Triangles that straddle two cells and open mesh boundaries
+ * stay locked in this pass, every cell is then simplified independently on the job system. Collapses that would
+ * flip a triangle or make the surface non-manifold are rejected. The surviving vertex of a collapse keeps its
+ * attributes, only its position moves.
+ */
+[[nodiscard]] mesh_data decimate(const mesh & source, std::size_t vertex_stride, const decimate_options & options = {});
+
+struct lod_options {
+    float       ratio_per_level = 0.25f;
+    std::size_t min_triangles   = 256;
+    std::size_t max_levels      = 8;
+};
+
+// level 0 is the welded source, every further level is decimated from the previous one with an alternating grid
+[[nodiscard]] std::vector<mesh_data> build_lod_chain(const mesh &        source,
+                                                     std::size_t         vertex_stride,
+                                                     const lod_options & options = {});
+}  // namespace velm_dr
@@ -0,0 +1,57 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/mesh.h"
+#include "velm/ndarray.h"
+#include "velm/stencil.h"
+
+#include <cstdint>
+
+namespace velm_dr {
+
+// the three components of a vector field on one grid, u along dim 0, v along dim 1, w along dim 2
+struct velocity_field {
+    const velm_DR::ndarray<float, 3> & u;
+    const velm_DR::ndarray<float, 3> & v;
+    const velm_DR::ndarray<float, 3> & w;
+};
+
+/*
+ * Scalars derived from the velocity gradient tensor J (J[a][b] = d u_a / d x_b), split into its symmetric part S and
+ * antisymmetric part O:
+ *  VORTICITY_MAGNITUDE  |curl u|
+ *  DIVERGENCE           trace J
+ *  Q_CRITERION          (|O|^2 - |S|^2) / 2, positive where rotation dominates strain
+ *  LAMBDA2              middle eigenvalue of S^2 + O^2, negative inside vortex cores
+ */
+enum class derived_quantity : std::uint8_t { VORTICITY_MAGNITUDE, DIVERGENCE, Q_CRITERION, LAMBDA2 };
+
+/*
+ * All operators run on the stencil engine (for_each_gradient_row): the nine derivatives of a row segment are taken
+ * in cache sized tiles and reduced to the result before the next segment, so J is never stored. The components must
+ * have equal dims.
+ */
+
+// out must have dims (d0, d1, d2, 3) of the components, curl components are interleaved
+void compute_vorticity(const velocity_field &       velocity,
+                       velm_DR::ndarray<float, 4> & out,
+                       const stencil_options &      options = {},
+                       velm::job_system &           jobs    = velm::job_system::global());
+
+// out must have the dims of the components
+void compute_derived(const velocity_field &       velocity,
+                     derived_quantity             quantity,
+                     velm_DR::ndarray<float, 3> & out,
+                     const stencil_options &      options = {},
+                     velm::job_system &           jobs    = velm::job_system::global());
+
+/*
+ * The isosurface of a derived quantity without materializing it: the quantity is computed slab_planes planes at a
+ * time and each plane is handed to an isosurface_builder, so besides the mesh only one slab is held. Gives the same
+ * mesh as extract_isosurface() of the compute_derived() volume.
+ */
+[[nodiscard]] mesh_data extract_derived_isosurface(const velocity_field &  velocity,
+                                                   derived_quantity        quantity,
+                                                   float                   iso,
+                                                   const stencil_options & options = {},
+                                                   velm::job_system &      jobs    = velm::job_system::global());
+}  // namespace velm_dr
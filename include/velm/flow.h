@@ -0,0 +1,88 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/mesh.h"
+#include "velm/ndarray.h"
+#include "velm/timestep_prefetcher.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+
+namespace velm_dr {
+
+/*
+ * Velocity on a regular grid, one array per component. Sample (i, j, k) sits at origin + (i, j, k) * spacing in
+ * world space and component u points along dim 0, v along dim 1 and w along dim 2. The arrays may be views created
+ * with ndarray::wrap.
+ */
+struct vector_field {
+    velm_DR::ndarray<float, 3> u;
+    velm_DR::ndarray<float, 3> v;
+    velm_DR::ndarray<float, 3> w;
+    glm::vec3                  origin{ 0.0f };
+    glm::vec3                  spacing{ 1.0f };
+
+    // the three arrays must have the same dims
+    vector_field(velm_DR::ndarray<float, 3> u_, velm_DR::ndarray<float, 3> v_, velm_DR::ndarray<float, 3> w_);
+
+    // trilinear velocity at a world space position, false outside the grid; the eight corner offsets and weights
+    // are computed once and shared by the three components
+    [[nodiscard]] bool sample(const glm::vec3 & position, glm::vec3 & velocity) const;
+
+    // many positions at once through velm_DR::sample; inside[i] is 0 and velocities[i] zero for positions outside
+    // the grid, both outputs must hold positions.size() values
+    void sample(std::span<const glm::vec3> positions,
+                std::span<glm::vec3>       velocities,
+                std::span<std::uint8_t>    inside) const;
+};
+
+enum class integrator : std::uint8_t { RK4, RK45 };
+
+struct streamline_options {
+    integrator method = integrator::RK45;
+    // initial (RK45) or fixed (RK4) step, in world units of arc length for streamlines and time for pathlines
+    float step     = 0.5f;
+    float min_step = 0.01f;
+    float max_step = 2.0f;
+    // RK45 accepts a step when the embedded error estimate is below this distance
+    float tolerance = 1e-3f;
+
+    std::size_t max_steps  = 2000;
+    float       max_length = 1e30f;
+    // streamlines stop in stagnant regions
+    float min_speed = 1e-6f;
+    // streamlines only: also trace upstream from the seed
+    bool both_directions = false;
+    // seeds handed to one job; seeds finish after very different step counts, small batches keep stealing effective
+    std::size_t seeds_per_job = 8;
+};
+
+/*
+ * Polylines as mesh_data with vertex_stride 5: x, y, z, speed and the integration parameter (arc length for
+ * streamlines, time for pathlines). Indices are segment pairs for BGFX_STATE_PT_LINES, lines follow seed order and
+ * seeds whose line has fewer than two points are skipped.
+ */
+inline constexpr std::size_t line_vertex_stride = 5;
+
+[[nodiscard]] mesh_data trace_streamlines(const vector_field &       field,
+                                          std::span<const glm::vec3> seeds,
+                                          const streamline_options & options = {},
+                                          velm::job_system &         jobs    = velm::job_system::global());
+
+struct pathline_series {
+    // time of every step, increasing
+    std::span<const double> times;
+    // velocity of every step, the next one loads while the current interval is integrated
+    velm::timestep_prefetcher<vector_field> & steps;
+};
+
+/*
+ * Particles released at seed.w (a time inside the series) and advected through the linearly interpolated velocity
+ * until the last step. All particles are advanced one step interval at a time, while the next step loads.
+ */
+[[nodiscard]] mesh_data trace_pathlines(const pathline_series &    series,
+                                        std::span<const glm::vec4> seeds,
+                                        const streamline_options & options = {},
+                                        velm::job_system &         jobs    = velm::job_system::global());
+}  // namespace velm_dr
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+namespace velm {
+
+/*
+ * Trades image quality for frame time while the view is in motion. Frame cost is modelled as proportional to
+ * quality(), so after every moving frame quality becomes target / (smoothed cost of a full quality frame), clamped
+ * to [min_quality, 1]. Once motion stops quality grows by refine_factor per frame until it is back at 1; refining()
+ * tells the loop to keep drawing until then. Renderers map quality to their own knobs with the helpers below.
+ */
+class frame_governor {
+  public:
+    struct settings {
+        float target_ms     = 16.0f;
+        float min_quality   = 0.125f;
+        float smoothing     = 0.5f;  // weight of the newest frame in the running cost estimate
+        float refine_factor = 2.0f;
+    };
+
+    frame_governor();
+    explicit frame_governor(const settings & config);
+
+    // after each drawn frame: its duration and whether the scene or camera changed for it
+    void frame_done(float frame_ms, bool moving);
+    // forget the cost estimate and go back to full quality, e.g. after a resize
+    void reset();
+
+    [[nodiscard]] float quality() const { return quality_; }
+
+    [[nodiscard]] bool refining() const { return quality_ < 1.0f; }
+
+    [[nodiscard]] const settings & config() const { return config_; }
+
+    // linear in quality, never below min_steps
+    [[nodiscard]] std::uint32_t raymarch_steps(std::uint32_t full_steps, std::uint32_t min_steps = 8) const;
+    // resolution factor per axis, pixel count follows quality
+    [[nodiscard]] float render_scale() const;
+    // multiplier for the allowed lod pixel error, coarser meshes at lower quality
+    [[nodiscard]] float lod_error_scale() const { return 1.0f / quality_; }
+
+  private:
+    settings config_;
+    float    quality_   = 1.0f;
+    float    full_cost_ = 0.0f;  // estimated ms of a full quality frame, 0 until measured
+};
+}  // namespace velm
@@ -0,0 +1,210 @@
+#pragma once
+#include "velm/compositing.h"
+#include "velm/job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace velm_render {
+
+// 8 bit RGBA, row-major with the top row first
+struct rgba_frame {
+    std::uint32_t             width  = 0;
+    std::uint32_t             height = 0;
+    std::vector<std::uint8_t> pixels;  // 4 bytes per pixel
+
+    [[nodiscard]] std::size_t pixel_count() const { return std::size_t(width) * height; }
+};
+
+// premultiplied color over an opaque background (see to_rgb8) with opaque alpha; frame is resized to the image
+void to_rgba8(const composite_image & image,
+              const glm::vec3 &       background,
+              rgba_frame &            frame,
+              velm::job_system &      jobs = velm::job_system::global());
+
+enum class input_type : std::uint32_t {
+    POINTER_MOVE,
+    POINTER_BUTTON,
+    SCROLL,
+    KEY,
+    RESIZE,
+};
+
+// sent by viewers, fixed size on the wire
+struct input_event {
+    input_type   type      = input_type::POINTER_MOVE;
+    std::int32_t code      = 0;  // button or key code of the viewer's toolkit
+    std::int32_t action    = 0;  // 1 press, 0 release
+    std::int32_t modifiers = 0;
+    float        x         = 0.0f;  // pointer position in frame pixels, scroll offsets or the viewport size
+    float        y         = 0.0f;
+};
+
+static_assert(sizeof(input_event) == 24, "input_event is sent as is");
+
+inline constexpr std::uint32_t frame_magic = 0x4d415246;  // "FRAM"
+inline constexpr std::uint32_t frame_key   = 1;           // flag: decode against a cleared frame
+
+struct frame_message_header {
+    std::uint32_t magic;
+    std::uint32_t flags;
+    std::uint64_t number;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t tile;
+    std::uint32_t tile_count;
+    std::uint64_t payload_bytes;  // tile headers and tile bytes following this header
+};
+
+enum class tile_codec : std::uint32_t {
+    RAW,      // the tile's pixels, row by row
+    XOR_RLE,  // (varint unchanged bytes, varint literal count, literals) tokens of the tile XOR the previous one
+};
+
+struct tile_header {
+    std::uint32_t index;  // row-major among the tiles of the frame
+    tile_codec    codec;
+    std::uint32_t bytes;
+};
+
+struct frame_server_options {
+    // 0.0.0.0 to accept viewers from other machines, the default only takes ssh tunnels and local viewers
+    std::string   address = "127.0.0.1";
+    std::uint16_t port    = 0;  // 0 picks a free one, see frame_server::port()
+    // pixels per side of the tiles that are compared with the previous frame and sent when they changed
+    std::uint32_t tile = 32;
+    // low bits rounded away in every channel before comparing, 0 is lossless; noise below that no longer counts
+    // as a change
+    std::uint32_t drop_bits = 0;
+    // every frame goes to all viewers at once, viewers that have not taken it within this long fell behind and are
+    // disconnected; the others wait for at most this long per frame
+    std::chrono::milliseconds send_timeout{ 2000 };
+};
+
+struct frame_server_stats {
+    std::uint64_t submitted  = 0;
+    std::uint64_t encoded    = 0;
+    std::uint64_t dropped    = 0;  // replaced by a newer frame before the encoder got to them
+    std::uint64_t tiles_sent = 0;  // summed over viewers
+    std::uint64_t bytes_sent = 0;  // summed over viewers
+    std::size_t   viewers    = 0;
+};
+
+/*
+ * Streams rendered frames to remote viewers over TCP. submit() only copies the frame: comparing it tile by tile
+ * with the previous one, compressing the changed tiles and sending them happen on the server's encoder thread
+ * while the caller renders the next frame. When frames come faster than they can be sent, a frame still waiting
+ * for the encoder is replaced by the newer one, so viewers lag by at most one frame and rendering never waits.
+ *
+ * A viewer that connects gets a key frame of the last frame right away and deltas after that. Input events sent
+ * by viewers are queued for poll_input(). Throws std::runtime_error when the address cannot be bound.
+ *
+ * Messages are raw structs in host byte order (every platform velm runs on is little endian): the server sends
+ * a frame_message_header, then per tile a tile_header and its bytes; viewers send input_events.
+ *
+ * POSIX only: frame_server.cpp is not built on Windows.
+ */
+class frame_server {
+  public:
+    explicit frame_server(const frame_server_options & options = {});
+    ~frame_server();
+
+    frame_server(const frame_server &)             = delete;
+    frame_server & operator=(const frame_server &) = delete;
+
+    [[nodiscard]] std::uint16_t port() const { return port_; }
+
+    // rgba holds width * height pixels, see rgba_frame; submit is meant to be called from one rendering thread
+    void submit(std::uint32_t width, std::uint32_t height, std::span<const std::uint8_t> rgba);
+    void submit(const rgba_frame & frame) { submit(frame.width, frame.height, frame.pixels); }
+    // converted with to_rgba8 on the calling thread
+    void submit(const composite_image & image, const glm::vec3 & background);
+
+    // blocks until the encoder has sent everything submitted so far
+    void flush();
+
+    // input received since the last call, oldest first
+    [[nodiscard]] std::vector<input_event> poll_input();
+
+    [[nodiscard]] frame_server_stats stats() const;
+
+  private:
+    struct viewer;
+
+    frame_server_options options_;
+    std::uint16_t        port_     = 0;
+    int                  listener  = -1;
+    int                  wakeup[2] = { -1, -1 };  // pipe that interrupts the network thread's poll
+
+    mutable std::mutex                   mutex;
+    std::condition_variable              work;     // for the encoder: a frame, a new viewer or stop
+    std::condition_variable              idle;     // for flush()
+    rgba_frame                           staging;  // the submitting thread's, swapped with pending
+    rgba_frame                           pending;
+    bool                                 has_pending = false;
+    bool                                 encoding    = false;
+    bool                                 stop        = false;
+    std::uint64_t                        joined      = 0;  // viewers accepted so far
+    std::vector<std::shared_ptr<viewer>> viewers;
+    std::vector<input_event>             input;
+    frame_server_stats                   stats_;
+
+    std::thread encoder;
+    std::thread network;
+
+    void publish();
+    void encode_loop();
+    void network_loop();
+};
+
+/*
+ * The viewer side of a frame_server connection, for viewers written in C++ and for tests. Throws
+ * std::runtime_error on connection failures and on malformed messages.
+ */
+class frame_client {
+  public:
+    frame_client(const std::string & address, std::uint16_t port);
+    ~frame_client();
+
+    frame_client(const frame_client &)             = delete;
+    frame_client & operator=(const frame_client &) = delete;
+
+    // applies the next frame message, false if none arrived within timeout
+    bool receive(std::chrono::milliseconds timeout);
+
+    void send(const input_event & event);
+
+    // the frame as of the last receive(), with the server's drop_bits applied
+    [[nodiscard]] const rgba_frame & frame() const { return frame_; }
+
+    // server side number of the frame, counted from 1
+    [[nodiscard]] std::uint64_t frame_number() const { return number; }
+
+    // tiles and bytes in the last message
+    [[nodiscard]] std::size_t last_tiles() const { return tiles; }
+
+    [[nodiscard]] std::size_t last_bytes() const { return bytes; }
+
+    [[nodiscard]] bool last_was_key() const { return key; }
+
+  private:
+    int                       fd = -1;
+    rgba_frame                frame_;
+    std::vector<std::uint8_t> payload;
+    std::vector<std::uint8_t> scratch;
+    std::uint64_t             number = 0;
+    std::size_t               tiles  = 0;
+    std::size_t               bytes  = 0;
+    bool                      key    = false;
+};
+}  // namespace velm_render
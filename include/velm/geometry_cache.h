@@ -0,0 +1,134 @@
+#pragma once
+#include "velm/memory_budget.h"
+#include "velm/mesh.h"
+#include "velm/vertex_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace velm_render {
+
+// one extraction: the source file as of its modification time, the dataset and whatever else decides the result
+// (isovalue, lod chain settings, ...) folded into parameters by the caller
+struct geometry_key {
+    std::string  source;
+    std::int64_t source_mtime = 0;
+    std::string  dataset;
+    std::string  parameters;
+
+    // source_mtime read from the file system, 0 when the file does not exist
+    [[nodiscard]] static geometry_key of_file(const std::filesystem::path & source,
+                                              std::string                   dataset,
+                                              std::string                   parameters);
+
+    // all fields in one string, kept in the cache file so hash collisions are told apart
+    [[nodiscard]] std::string   text() const;
+    [[nodiscard]] std::uint64_t hash() const;
+};
+
+/*
+ * A geometry cache file mapped read-only: the encoded vertex and index buffers of every level of detail exactly as
+ * mesh::upload hands them to bgfx, so loading does not touch the geometry at all. The spans point into the mapping
+ * and stay valid for the lifetime of the object.
+ *
+ * File layout, host byte order (caches are local to a machine): a header, the key text, a table with one entry per
+ * level and the buffers, each starting on a 16 byte boundary.
+ */
+class cached_geometry {
+  public:
+    struct lod {
+        std::span<const std::byte> vertices;
+        std::span<const std::byte> indices;
+        bool                       index32         = false;
+        float                      geometric_error = 0.0f;
+
+        [[nodiscard]] std::uint32_t index_count() const {
+            return static_cast<std::uint32_t>(indices.size() / (index32 ? 4 : 2));
+        }
+    };
+
+    // nullptr unless file is a complete cache file written for key
+    [[nodiscard]] static std::shared_ptr<const cached_geometry> map(const std::filesystem::path & file,
+                                                                    std::string_view              key);
+
+    // writes the encoded levels to file, replacing it only once it is complete
+    static void write(const std::filesystem::path & file,
+                      std::string_view              key,
+                      vertex_format                 format,
+                      const quantization &          box,
+                      std::span<const gpu_geometry> levels,
+                      std::span<const float>        geometric_errors);
+
+    ~cached_geometry();
+
+    cached_geometry(const cached_geometry &)             = delete;
+    cached_geometry & operator=(const cached_geometry &) = delete;
+
+    [[nodiscard]] vertex_format format() const { return format_; }
+
+    [[nodiscard]] const quantization & box() const { return box_; }
+
+    // finest level first
+    [[nodiscard]] std::span<const lod> lods() const { return lods_; }
+
+    [[nodiscard]] std::size_t file_bytes() const { return size; }
+
+  private:
+    cached_geometry() = default;
+
+    void *              mapping = nullptr;
+    std::size_t         size    = 0;
+    velm::memory_charge memory{ velm::memory_category::CACHES };  // the mapping, for as long as it is open
+    vertex_format       format_ = vertex_format::FLOAT;
+    quantization        box_;
+    std::vector<lod>    lods_;
+};
+
+/*
+ * Extracted meshes kept on disk across sessions, one file per key named after its hash. The directory is capped at
+ * max_bytes: storing past the cap deletes the least recently used files, where use is a store or a load and is
+ * recorded in the file modification time so it survives restarts. Files still mapped by a cached_geometry stay
+ * readable after deletion. Safe to use from several threads.
+ */
+class geometry_cache {
+  public:
+    // creates directory if needed; max_bytes 0 means no cap
+    geometry_cache(std::filesystem::path directory, std::uint64_t max_bytes);
+
+    // the mapped entry, nullptr on a miss; entries that fail to map are deleted
+    [[nodiscard]] std::shared_ptr<const cached_geometry> load(const geometry_key & key);
+
+    // encodes the chain as mesh::upload would, writes it and returns it mapped
+    std::shared_ptr<const cached_geometry> store(const geometry_key &                key,
+                                                 std::span<const velm_dr::mesh_data> chain,
+                                                 const vertex_attributes &           attributes,
+                                                 vertex_format                       packing = vertex_format::PACKED);
+
+    void remove(const geometry_key & key);
+
+    // total size of the cache files
+    [[nodiscard]] std::uint64_t disk_bytes() const;
+
+    void                        set_max_bytes(std::uint64_t bytes);
+    [[nodiscard]] std::uint64_t max_bytes() const;
+
+    [[nodiscard]] const std::filesystem::path & directory() const { return dir; }
+
+    [[nodiscard]] std::filesystem::path file_of(const geometry_key & key) const;
+
+  private:
+    std::filesystem::path dir;
+    std::uint64_t         cap;
+    mutable std::mutex    mutex;
+
+    // deletes least recently used files until the directory fits the cap, never keep
+    void trim(const std::filesystem::path & keep);
+};
+}  // namespace velm_render
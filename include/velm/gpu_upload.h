@@ -0,0 +1,75 @@
+#pragma once
+#include "velm/ndarray.h"
+
+#include <bgfx/bgfx.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace velm_render {
+
+/*
+ * Counts uploads whose memory bgfx still references. Until idle() the CPU side must not write to or free storage
+ * handed over with make_ref. The fence has to outlive every upload counted on it.
+ */
+class upload_fence {
+  public:
+    upload_fence() = default;
+
+    upload_fence(const upload_fence &)             = delete;
+    upload_fence & operator=(const upload_fence &) = delete;
+
+    [[nodiscard]] std::uint32_t pending() const { return pending_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] bool idle() const { return pending() == 0; }
+
+    // blocks until every counted upload is released; needs a render thread, single threaded bgfx only releases
+    // inside bgfx::frame on the calling thread, so poll idle() between frames there instead
+    void wait() const;
+
+    void retain() { pending_.fetch_add(1, std::memory_order_relaxed); }
+    void release();
+
+  private:
+    std::atomic<std::uint32_t> pending_{ 0 };
+};
+
+// what the release callback of one referenced upload needs: the storage to keep alive and the fence to signal
+struct upload_pin {
+    std::shared_ptr<const void> owner;
+    upload_fence *              fence = nullptr;
+};
+
+// heap allocated pin, retains fence; handed to bgfx as the user data of release_upload
+[[nodiscard]] upload_pin * pin_upload(std::shared_ptr<const void> owner, upload_fence * fence);
+// bgfx::ReleaseFn for pins from pin_upload, called on the render thread once the memory has been consumed
+void release_upload(void * ptr, void * pin);
+
+/*
+ * bgfx memory referencing bytes without a copy. owner (whatever keeps bytes alive) is held and fence counted until
+ * the render thread is done with it, so the upload costs no second buffer and no memcpy on the api thread.
+ */
+[[nodiscard]] const bgfx::Memory * make_ref(std::shared_ptr<const void> owner,
+                                            std::span<const std::byte>  bytes,
+                                            upload_fence *              fence = nullptr);
+
+// the whole array; wrapped arrays (ndarray::wrap) must keep their external storage alive on their own
+template <typename T, std::size_t N>
+[[nodiscard]] const bgfx::Memory * make_ref(std::shared_ptr<const velm_DR::ndarray<T, N>> array,
+                                            upload_fence *                                fence = nullptr) {
+    std::span<const std::byte> bytes(reinterpret_cast<const std::byte *>(array->data),
+                                     array->total_elements() * sizeof(T));
+    return make_ref(std::move(array), bytes, fence);
+}
+
+/*
+ * R32F 3D texture holding the volume (x along the last axis), uploaded straight from the array storage. Aborts when
+ * an extent exceeds what bgfx can address.
+ */
+[[nodiscard]] bgfx::TextureHandle create_volume_texture(std::shared_ptr<const velm_DR::ndarray<float, 3>> volume,
+                                                        upload_fence * fence = nullptr,
+                                                        std::uint64_t  flags = BGFX_SAMPLER_UVW_CLAMP);
+}  // namespace velm_render
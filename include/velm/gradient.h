@@ -0,0 +1,30 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/ndarray.h"
+#include "velm/stencil.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace velm_dr {
+
+using gradient_options = stencil_options;
+
+// see for_each_gradient_row for the differences used; out must have dims (d0, d1, d2, 3) of field, gradient
+// components are interleaved
+void compute_gradient(const velm_DR::ndarray<float, 3> & field,
+                      velm_DR::ndarray<float, 4> &       out,
+                      const gradient_options &           options = {},
+                      velm::job_system &                 jobs    = velm::job_system::global());
+
+/*
+ * Normalized gradients packed for an RGBA8 3D texture, one 0xAABBGGRR texel per sample in field order:
+ * rgb = direction * 0.5 + 0.5, a = |gradient| / max_magnitude clamped to 1. Zero gradients pack to rgb 128.
+ */
+void compute_packed_normals(const velm_DR::ndarray<float, 3> & field,
+                            std::span<std::uint32_t>           out,
+                            float                              max_magnitude,
+                            const gradient_options &           options = {},
+                            velm::job_system &                 jobs    = velm::job_system::global());
+}  // namespace velm_dr
@@ -4,6 +4,7 @@
 
 #    include <cstddef>
 #    include <cstring>
+#    include <string>
 #    include <vector>
 
 namespace H5 {
@@ -26,13 +27,29 @@ class hdf5_file {
     hdf5_file(hdf5_file && other) noexcept;
     hdf5_file & operator=(hdf5_file && other) noexcept;
 
-    [[nodiscard]] std::vector<std::string_view> list_datasets() const;
-    [[nodiscard]] std::vector<std::size_t>      get_dataset_shape(const std::string_view & name) const;
+    // datasets directly below the root group
+    [[nodiscard]] std::vector<std::string> list_datasets() const;
+    // absolute paths of all datasets below group, descending into subgroups
+    [[nodiscard]] std::vector<std::string> list_datasets_recursive(const std::string_view & group = "/") const;
+    [[nodiscard]] std::vector<std::size_t> get_dataset_shape(const std::string_view & name) const;
+    // chunk extent of a chunked dataset, empty for contiguous ones
+    [[nodiscard]] std::vector<std::size_t> get_chunk_shape(const std::string_view & name) const;
 
     [[nodiscard]] std::string_view get_filename() const { return filename_; }
 
+    // numeric attribute of a group or dataset, converted to double (scalars give one value)
+    [[nodiscard]] bool has_attribute(const std::string_view & object, const std::string_view & name) const;
+    [[nodiscard]] std::vector<double> get_attribute(const std::string_view & object,
+                                                    const std::string_view & name) const;
+
     void load_dataset(void * buffer, const std::string_view & name) const;
 
+    // reads the box [offset, offset + count) of a dataset into a dense row-major buffer, converted to float
+    void load_hyperslab(float *                          buffer,
+                        const std::string_view &         name,
+                        const std::vector<std::size_t> & offset,
+                        const std::vector<std::size_t> & count) const;
+
   private:
     H5::H5File *     file_;
     std::string_view filename_;
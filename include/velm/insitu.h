@@ -0,0 +1,47 @@
+#pragma once
+#include "velm/insitu_protocol.h"
+#include "velm/ndarray.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace velm {
+
+struct insitu_frame {
+    velm_DR::ndarray<float, 3> field;  // non-owning view into the shared segment
+    std::uint64_t              sequence = 0;
+    std::uint64_t              step     = 0;
+    double                     time     = 0.0;
+};
+
+/*
+ * Read side of the velm_insitu shared memory ring. Frames are mapped, not copied: insitu_frame::field points into
+ * the producer's slot and is only guaranteed to hold that frame while still_valid() returns true.
+ */
+class insitu_source {
+  public:
+    // throws std::runtime_error if the segment does not exist or is not a velm_insitu segment
+    explicit insitu_source(const std::string & name);
+    ~insitu_source();
+
+    insitu_source(const insitu_source &)             = delete;
+    insitu_source & operator=(const insitu_source &) = delete;
+
+    // blocks until a frame newer than after_sequence is published, false on timeout
+    bool wait(std::uint64_t after_sequence, std::chrono::milliseconds timeout);
+
+    // newest complete frame, nullopt before the first publish
+    [[nodiscard]] std::optional<insitu_frame> latest() const;
+
+    // false once the producer started overwriting the frame's slot; check after reading the field
+    [[nodiscard]] bool still_valid(const insitu_frame & frame) const;
+
+    [[nodiscard]] std::uint64_t published() const;
+
+  private:
+    velm_insitu::segment_header * header = nullptr;
+    std::size_t                   size   = 0;
+};
+}  // namespace velm
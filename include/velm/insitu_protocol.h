@@ -0,0 +1,191 @@
+#pragma once
+/*
+ * Shared memory frame ring between a running simulation (producer) and velm (consumer).
+ *
+ * This header only depends on the standard library and POSIX so solvers can copy it into their own tree. A segment
+ * created with shm_open holds a segment_header, slot_count slot_headers and slot_count frames of
+ * dims[0] * dims[1] * dims[2] floats, each frame aligned to 64 bytes:
+ *
+ *   producer                                  consumer
+ *   float * f = ring.acquire();               velm::insitu_source source("/my_sim");
+ *   ... write the field into f ...            source.wait(last_sequence, timeout);
+ *   ring.publish(step, time);                 auto frame = source.latest();  // zero-copy ndarray view
+ *
+ * Frames are numbered from 1. A slot holding frame n carries sequence 2n once complete and 2n - 1 while the
+ * producer writes it (seqlock), so readers can detect that a slot was recycled under them. The producer never
+ * waits for readers; slot_count bounds how long a reader can hold on to a frame.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    ifdef __linux__
+#        include <linux/futex.h>
+#        include <sys/syscall.h>
+#    endif
+#endif
+
+namespace velm_insitu {
+
+inline constexpr std::uint32_t magic   = 0x4d4c4556;  // "VELM"
+inline constexpr std::uint32_t version = 1;
+
+struct slot_header {
+    std::atomic<std::uint64_t> sequence;
+    std::uint64_t              step;
+    double                     time;
+    std::uint64_t              reserved;
+};
+
+struct segment_header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slot_count;
+    std::uint32_t reserved;
+    std::uint64_t dims[3];
+    std::uint64_t frame_bytes;
+    std::uint64_t frames_offset;
+
+    std::atomic<std::uint64_t> published;  // newest complete frame number, 0 before the first publish
+    std::atomic<std::uint32_t> notify;     // bumped on every publish, consumers futex-wait on it
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+
+inline std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+inline std::size_t frames_offset(std::uint32_t slot_count) {
+    return align_up(sizeof(segment_header) + slot_count * sizeof(slot_header), 64);
+}
+
+inline slot_header * slots(segment_header * header) {
+    return reinterpret_cast<slot_header *>(header + 1);
+}
+
+inline float * frame_data(segment_header * header, std::uint32_t slot) {
+    return reinterpret_cast<float *>(reinterpret_cast<std::uint8_t *>(header) + header->frames_offset +
+                                     slot * header->frame_bytes);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// wakes every process blocked in wait_notify on this word; shared futexes, so no FUTEX_PRIVATE_FLAG
+inline void wake_all(std::atomic<std::uint32_t> & word) {
+#    ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#    else
+    (void) word;
+#    endif
+}
+
+// blocks while word still holds expected, for at most timeout_ns; spurious returns are possible
+inline void wait_notify(std::atomic<std::uint32_t> & word, std::uint32_t expected, std::int64_t timeout_ns) {
+#    ifdef __linux__
+    timespec timeout{ static_cast<time_t>(timeout_ns / 1000000000), static_cast<long>(timeout_ns % 1000000000) };
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#    else
+    // no cross-process futex, poll instead
+    (void) expected;
+    usleep(static_cast<useconds_t>(std::min<std::int64_t>(timeout_ns / 1000, 1000)));
+#    endif
+}
+
+/*
+ * Creates (or replaces) the named segment and owns it: the name is unlinked again on destruction. Consumers that
+ * still have it mapped keep their mapping until they close it.
+ */
+class producer {
+  public:
+    producer(const std::string & name, const std::uint64_t (&dims)[3], std::uint32_t slot_count = 3) :
+        name_(name) {
+        if (slot_count < 2) {
+            throw std::invalid_argument("velm_insitu: at least two slots are needed");
+        }
+        std::size_t frame_bytes = align_up(dims[0] * dims[1] * dims[2] * sizeof(float), 64);
+        size_                   = frames_offset(slot_count) + slot_count * frame_bytes;
+
+        shm_unlink(name_.c_str());
+        int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("velm_insitu: shm_open failed: " + std::string(std::strerror(errno)));
+        }
+        if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            close(fd);
+            shm_unlink(name_.c_str());
+            throw std::runtime_error("velm_insitu: ftruncate failed: " + std::string(std::strerror(errno)));
+        }
+        void * mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            shm_unlink(name_.c_str());
+            throw std::runtime_error("velm_insitu: mmap failed: " + std::string(std::strerror(errno)));
+        }
+
+        // the mapping is zero filled, so all atomics start at 0
+        header_                = static_cast<segment_header *>(mapping);
+        header_->slot_count    = slot_count;
+        header_->dims[0]       = dims[0];
+        header_->dims[1]       = dims[1];
+        header_->dims[2]       = dims[2];
+        header_->frame_bytes   = frame_bytes;
+        header_->frames_offset = frames_offset(slot_count);
+        header_->version       = version;
+        // magic last: consumers refuse segments that are not fully initialized
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = magic;
+    }
+
+    ~producer() {
+        munmap(header_, size_);
+        shm_unlink(name_.c_str());
+    }
+
+    producer(const producer &)             = delete;
+    producer & operator=(const producer &) = delete;
+
+    // memory for the next frame, stays valid until publish()
+    float * acquire() {
+        std::uint64_t frame = header_->published.load(std::memory_order_relaxed) + 1;
+        slot_header & slot  = slots(header_)[frame % header_->slot_count];
+        slot.sequence.store(2 * frame - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return frame_data(header_, static_cast<std::uint32_t>(frame % header_->slot_count));
+    }
+
+    void publish(std::uint64_t step, double time) {
+        std::uint64_t frame = header_->published.load(std::memory_order_relaxed) + 1;
+        slot_header & slot  = slots(header_)[frame % header_->slot_count];
+        slot.step           = step;
+        slot.time           = time;
+        slot.sequence.store(2 * frame, std::memory_order_release);
+        header_->published.store(frame, std::memory_order_release);
+        header_->notify.fetch_add(1, std::memory_order_release);
+        wake_all(header_->notify);
+    }
+
+    [[nodiscard]] std::uint64_t published() const { return header_->published.load(std::memory_order_relaxed); }
+
+  private:
+    std::string      name_;
+    std::size_t      size_   = 0;
+    segment_header * header_ = nullptr;
+};
+
+#endif
+}  // namespace velm_insitu
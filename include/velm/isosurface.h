@@ -0,0 +1,67 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/mesh.h"
+#include "velm/ndarray.h"
+#include "velm/sparse_grid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace velm_dr {
+
+/*
+ * Marching tetrahedra over a volume that arrives one dim 0 plane at a time, so a derived field can be contoured
+ * while it is computed without ever existing in full. Every cell is split into the six tetrahedra around its main
+ * diagonal, which tile the grid conformingly: no ambiguous cases and no cracks between cells.
+ *
+ * Vertices lie on tetrahedron edges and are shared between the triangles that cut the same edge; an edge is looked
+ * up by its lower corner and direction, and edges below the newest plane are forgotten, so the builder keeps two
+ * planes of samples and the edges of one plane besides the mesh. Triangles face towards lower values. Positions are
+ * sample indices times spacing.
+ */
+class isosurface_builder {
+  public:
+    // planes of rows x columns samples (dims 1 and 2), contoured at level
+    isosurface_builder(std::size_t rows, std::size_t columns, float level, glm::vec3 sample_spacing = glm::vec3(1.0f));
+
+    // the next plane in row-major order; the layer of cells between it and the one before is contoured in bands of
+    // rows on the job system
+    void add_plane(std::span<const float> plane, velm::job_system & jobs = velm::job_system::global());
+
+    [[nodiscard]] std::size_t planes() const { return plane_count; }
+
+    // the mesh so far, the builder is left empty
+    [[nodiscard]] mesh_data finish();
+
+  private:
+    std::size_t                                      n1;
+    std::size_t                                      n2;
+    float                                            iso;
+    glm::vec3                                        spacing;
+    std::size_t                                      plane_count = 0;
+    std::vector<float>                               previous;
+    std::unordered_map<std::uint64_t, std::uint32_t> edges;  // edge key to vertex index
+    mesh_data                                        result;
+};
+
+// contours a whole volume, feeding its planes to an isosurface_builder in place
+[[nodiscard]] mesh_data extract_isosurface(const velm_DR::ndarray<float, 3> & field,
+                                           float                              iso,
+                                           glm::vec3                          spacing = glm::vec3(1.0f),
+                                           velm::job_system &                 jobs    = velm::job_system::global());
+
+/*
+ * Same surface as extracting from the densified grid, without densifying it: only the cells of allocated leaves and
+ * of the blocks just below them (whose upper corners reach into a leaf) are visited, corners are read through an
+ * accessor and everything else is background on both sides of every edge. Sample (i, j, k) sits at (i, j, k) *
+ * spacing, negative indices included. Leaves are contoured in parallel and merged in origin order.
+ */
+[[nodiscard]] mesh_data extract_isosurface(const velm_DR::sparse_grid<float> & grid,
+                                           float                               iso,
+                                           glm::vec3                           spacing = glm::vec3(1.0f),
+                                           velm::job_system &                  jobs    = velm::job_system::global());
+}  // namespace velm_dr
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace velm {
+
+/*
+ * Work stealing thread pool. Every worker owns a deque, jobs submitted from a worker go to the back of its own
+ * deque and are popped LIFO, idle workers steal FIFO from the front of other deques. Threads waiting on a
+ * task_group execute pending jobs instead of blocking, so nested parallel loops can't deadlock.
+ */
+class job_system {
+  public:
+    // thread_count 0: one worker per hardware thread, minus the thread that waits on the results
+    explicit job_system(std::size_t thread_count = 0);
+    ~job_system();
+
+    job_system(const job_system &)             = delete;
+    job_system & operator=(const job_system &) = delete;
+
+    static job_system & global();
+
+    void submit(std::function<void()> job);
+
+    // runs one pending job on the calling thread, returns false when there was nothing to do
+    bool run_one();
+
+    [[nodiscard]] std::size_t thread_count() const { return threads.size(); }
+
+    // number of threads that can execute jobs concurrently, including a waiting caller
+    [[nodiscard]] std::size_t concurrency() const { return threads.size() + 1; }
+
+  private:
+    struct queue {
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues;  // one per worker plus one shared by outside threads
+    std::vector<std::thread>            threads;
+    std::mutex                          sleep_mutex;
+    std::condition_variable             wake;
+    std::atomic<std::size_t>            pending{ 0 };
+    std::atomic<std::size_t>            next_queue{ 0 };
+    std::atomic<bool>                   stopping{ false };
+
+    bool take(std::size_t self, std::function<void()> & job);
+    void worker_loop(std::size_t index);
+};
+
+/*
+ * Jobs that are waited on together. An exception thrown by a job is kept and rethrown by wait() once every job of
+ * the group finished; only the first one is kept. The destructor waits too but drops an exception nobody waited for.
+ */
+class task_group {
+  public:
+    explicit task_group(job_system & system = job_system::global()) : jobs(system) {}
+
+    ~task_group() { drain(); }
+
+    task_group(const task_group &)             = delete;
+    task_group & operator=(const task_group &) = delete;
+
+    template <typename Fn> void run(Fn && fn) {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        jobs.submit([this, f = std::forward<Fn>(fn)]() mutable {
+            // the count has to drop however f leaves, or wait() spins forever
+            struct done_guard {
+                std::atomic<std::size_t> & count;
+
+                ~done_guard() { count.fetch_sub(1, std::memory_order_release); }
+            } done{ outstanding };
+
+            try {
+                f();
+            } catch (...) {
+                const std::scoped_lock lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+    }
+
+    void wait() {
+        drain();
+        std::exception_ptr failed;
+        {
+            const std::scoped_lock lock(error_mutex);
+            failed = std::exchange(error, nullptr);
+        }
+        if (failed) {
+            std::rethrow_exception(failed);
+        }
+    }
+
+  private:
+    job_system &             jobs;
+    std::atomic<std::size_t> outstanding{ 0 };
+    std::mutex               error_mutex;
+    std::exception_ptr       error;
+
+    void drain() {
+        while (outstanding.load(std::memory_order_acquire) != 0) {
+            if (!jobs.run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+// calls fn(chunk_begin, chunk_end) for chunks of at most grain elements and returns once all chunks are done
+template <typename Fn>
+void parallel_for(std::size_t  begin,
+                  std::size_t  end,
+                  std::size_t  grain,
+                  Fn &&        fn,
+                  job_system & jobs = job_system::global()) {
+    if (begin >= end) {
+        return;
+    }
+    grain = grain == 0 ? 1 : grain;
+    if (end - begin <= grain || jobs.thread_count() == 0) {
+        for (std::size_t b = begin; b < end; b += grain) {
+            fn(b, std::min(end, b + grain));
+        }
+        return;
+    }
+    task_group group(jobs);
+    for (std::size_t b = begin; b < end; b += grain) {
+        std::size_t e = std::min(end, b + grain);
+        group.run([&fn, b, e] { fn(b, e); });
+    }
+    group.wait();
+}
+}  // namespace velm
@@ -0,0 +1,209 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+namespace velm_DR {
+
+/*
+ * Storage orders for layout_array. A layout maps (i, j, k) to table[0][i] + table[1][j] + table[2][k]; it provides
+ * the size of the storage and fills the three per-axis offset tables, so element access costs three table loads
+ * whatever the order.
+ */
+
+// same order as ndarray, for comparisons
+struct row_major_layout {
+    static std::size_t storage_size(const std::size_t (&dims)[3]) { return dims[0] * dims[1] * dims[2]; }
+
+    static void build_tables(const std::size_t (&dims)[3], std::vector<std::size_t> (&tables)[3]) {
+        std::size_t stride[3] = { dims[1] * dims[2], dims[2], 1 };
+        for (int a = 0; a < 3; ++a) {
+            for (std::size_t x = 0; x < dims[a]; ++x) {
+                tables[a][x] = x * stride[a];
+            }
+        }
+    }
+};
+
+/*
+ * Z-order: the bits of i, j and k are interleaved, k in the lowest bit, so every aligned 2^n cube is contiguous.
+ * Each axis is padded to a power of two; once the shorter axes run out of bits the remaining ones take over.
+ */
+struct morton_layout {
+    static std::size_t padded(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    static std::size_t storage_size(const std::size_t (&dims)[3]) {
+        return padded(dims[0]) * padded(dims[1]) * padded(dims[2]);
+    }
+
+    static void build_tables(const std::size_t (&dims)[3], std::vector<std::size_t> (&tables)[3]) {
+        int bits[3] = { 0, 0, 0 };
+        for (int a = 0; a < 3; ++a) {
+            while ((std::size_t(1) << bits[a]) < dims[a]) {
+                ++bits[a];
+            }
+        }
+        // bit_position[a][b]: where bit b of the axis a index ends up
+        int bit_position[3][64] = {};
+        int next                = 0;
+        for (int b = 0; b < std::max({ bits[0], bits[1], bits[2] }); ++b) {
+            for (int a = 2; a >= 0; --a) {
+                if (b < bits[a]) {
+                    bit_position[a][b] = next++;
+                }
+            }
+        }
+        for (int a = 0; a < 3; ++a) {
+            for (std::size_t x = 0; x < dims[a]; ++x) {
+                std::size_t offset = 0;
+                for (int b = 0; b < bits[a]; ++b) {
+                    offset |= (x >> b & 1) << bit_position[a][b];
+                }
+                tables[a][x] = offset;
+            }
+        }
+    }
+};
+
+// bricks of edge^3 contiguous elements (row-major inside), bricks themselves in row-major order
+template <std::size_t edge = 8> struct brick_layout {
+    static_assert(edge > 0 && (edge & (edge - 1)) == 0, "brick edge must be a power of two");
+    static constexpr std::size_t brick_size = edge * edge * edge;
+
+    static std::size_t bricks(std::size_t n) { return (n + edge - 1) / edge; }
+
+    static std::size_t storage_size(const std::size_t (&dims)[3]) {
+        return bricks(dims[0]) * bricks(dims[1]) * bricks(dims[2]) * brick_size;
+    }
+
+    static void build_tables(const std::size_t (&dims)[3], std::vector<std::size_t> (&tables)[3]) {
+        std::size_t brick_stride[3] = { bricks(dims[1]) * bricks(dims[2]) * brick_size, bricks(dims[2]) * brick_size,
+                                        brick_size };
+        std::size_t inner_stride[3] = { edge * edge, edge, 1 };
+        for (int a = 0; a < 3; ++a) {
+            for (std::size_t x = 0; x < dims[a]; ++x) {
+                tables[a][x] = x / edge * brick_stride[a] + x % edge * inner_stride[a];
+            }
+        }
+    }
+};
+
+/*
+ * 3D array with the element order chosen by a layout policy, for neighbourhood heavy access (stencils, ray
+ * marching, marching cubes) where row-major order spreads a small cube over many cache lines. Element access has
+ * the ndarray interface; padding elements of the storage are never visible through it.
+ */
+template <typename T, typename Layout> class layout_array {
+  public:
+    std::size_t dims[3];
+
+    layout_array(std::size_t n0, std::size_t n1, std::size_t n2) : dims{ n0, n1, n2 } {
+        for (int a = 0; a < 3; ++a) {
+            tables[a].resize(dims[a]);
+        }
+        Layout::build_tables(dims, tables);
+        storage.assign(Layout::storage_size(dims), T{});
+    }
+
+    [[nodiscard]] T & operator()(std::size_t i, std::size_t j, std::size_t k) {
+        return storage[tables[0][i] + tables[1][j] + tables[2][k]];
+    }
+
+    [[nodiscard]] const T & operator()(std::size_t i, std::size_t j, std::size_t k) const {
+        return storage[tables[0][i] + tables[1][j] + tables[2][k]];
+    }
+
+    [[nodiscard]] T & at(std::size_t i, std::size_t j, std::size_t k) {
+        if (i >= dims[0] || j >= dims[1] || k >= dims[2]) {
+            abort();
+        }
+        return (*this)(i, j, k);
+    }
+
+    [[nodiscard]] const T & at(std::size_t i, std::size_t j, std::size_t k) const {
+        if (i >= dims[0] || j >= dims[1] || k >= dims[2]) {
+            abort();
+        }
+        return (*this)(i, j, k);
+    }
+
+    [[nodiscard]] std::size_t offset_of_index(std::size_t i, std::size_t j, std::size_t k) const {
+        return tables[0][i] + tables[1][j] + tables[2][k];
+    }
+
+    [[nodiscard]] std::size_t total_elements() const { return dims[0] * dims[1] * dims[2]; }
+
+    // elements in storage including padding
+    [[nodiscard]] std::size_t storage_size() const { return storage.size(); }
+
+    [[nodiscard]] T * data() { return storage.data(); }
+
+    [[nodiscard]] const T * data() const { return storage.data(); }
+
+    // offsets of the indices along one axis, added up to address an element
+    [[nodiscard]] const std::vector<std::size_t> & axis_offsets(int axis) const { return tables[axis]; }
+
+    void fill(T value) { std::fill(storage.begin(), storage.end(), value); }
+
+    // both conversions walk the row-major side in order and are split over dim 0 planes on the job system
+    [[nodiscard]] static layout_array from_row_major(const ndarray<T, 3> & source,
+                                                     velm::job_system &    jobs = velm::job_system::global()) {
+        layout_array result(source.dims[0], source.dims[1], source.dims[2]);
+        velm::parallel_for(
+            0, source.dims[0], 1,
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i) {
+                    for (std::size_t j = 0; j < source.dims[1]; ++j) {
+                        const T *           src = source.data + i * source.strides[0] + j * source.strides[1];
+                        T *                 dst = result.storage.data() + result.tables[0][i] + result.tables[1][j];
+                        const std::size_t * k2  = result.tables[2].data();
+                        for (std::size_t k = 0; k < source.dims[2]; ++k) {
+                            dst[k2[k]] = src[k];
+                        }
+                    }
+                }
+            },
+            jobs);
+        return result;
+    }
+
+    // out must have the dims of this array
+    void to_row_major(ndarray<T, 3> & out, velm::job_system & jobs = velm::job_system::global()) const {
+        if (out.dims[0] != dims[0] || out.dims[1] != dims[1] || out.dims[2] != dims[2]) {
+            abort();
+        }
+        velm::parallel_for(
+            0, dims[0], 1,
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i) {
+                    for (std::size_t j = 0; j < dims[1]; ++j) {
+                        T *                 dst = out.data + i * out.strides[0] + j * out.strides[1];
+                        const T *           src = storage.data() + tables[0][i] + tables[1][j];
+                        const std::size_t * k2  = tables[2].data();
+                        for (std::size_t k = 0; k < dims[2]; ++k) {
+                            dst[k] = src[k2[k]];
+                        }
+                    }
+                }
+            },
+            jobs);
+    }
+
+  private:
+    std::vector<std::size_t> tables[3];
+    std::vector<T>           storage;
+};
+
+template <typename T> using morton_array = layout_array<T, morton_layout>;
+template <typename T> using brick_array  = layout_array<T, brick_layout<8>>;
+}  // namespace velm_DR
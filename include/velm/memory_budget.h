@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace velm {
+
+enum class memory_category : std::uint8_t {
+    ARRAYS,        // ndarray storage
+    IO_BUFFERS,    // staging buffers of file reads
+    MESHES,        // cpu side geometry kept for reuse
+    GPU_TEXTURES,  // estimated from extent and format
+    GPU_BUFFERS,   // vertex and index buffers
+    CACHES,        // anything else held only to avoid recomputation
+    IMAGES,        // cpu rendered and composited frames
+    COUNT
+};
+
+[[nodiscard]] const char * category_name(memory_category category);
+
+struct memory_stats {
+    std::size_t bytes[std::size_t(memory_category::COUNT)] = {};
+    std::size_t total         = 0;
+    std::size_t peak          = 0;  // highest total so far
+    std::size_t limit         = 0;  // 0 when unlimited
+    std::size_t overruns      = 0;  // allocations that pushed the total past the limit
+    std::size_t evicted_bytes = 0;  // as reported by the evictors
+};
+
+/*
+ * Accounting of the memory velm holds, by category. Owners report what they allocate and free; an allocation that
+ * takes the total past the limit runs the registered evictors, lowest priority value first, on the allocating
+ * thread until enough was freed. Only one thread evicts at a time, allocations racing with it go on without
+ * waiting, so the limit is a target rather than a hard cap.
+ *
+ * Evictors may be called while their owner's own locks are held by the allocating thread: they should try_lock
+ * and free nothing when that fails. They must not add or remove evictors.
+ */
+class memory_budget {
+  public:
+    // asked to free about bytes, returns how many it did free
+    using evictor = std::function<std::size_t(std::size_t bytes)>;
+
+    memory_budget() = default;
+
+    memory_budget(const memory_budget &)             = delete;
+    memory_budget & operator=(const memory_budget &) = delete;
+
+    static memory_budget & global();
+
+    void allocated(memory_category category, std::size_t bytes);
+    void freed(memory_category category, std::size_t bytes);
+
+    // 0 removes the limit; lowering it below the current total evicts right away
+    void                      set_limit(std::size_t bytes);
+    [[nodiscard]] std::size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] std::size_t used() const { return total_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] std::size_t used(memory_category category) const {
+        return bytes_[std::size_t(category)].load(std::memory_order_relaxed);
+    }
+
+    // counters are read one by one, a snapshot taken while others allocate is only approximately consistent
+    [[nodiscard]] memory_stats stats() const;
+
+    // returns an id for remove_evictor(), which waits for a running eviction so the callback is never used after
+    std::size_t add_evictor(std::string name, evictor fn, int priority = 0);
+    void        remove_evictor(std::size_t id);
+
+    // runs the evictors until bytes were freed or every one had its turn, returns the bytes freed; 0 right away
+    // when another thread is already evicting
+    std::size_t reclaim(std::size_t bytes);
+
+  private:
+    struct registered_evictor {
+        std::size_t id;
+        std::string name;
+        int         priority;
+        evictor     fn;
+    };
+
+    std::atomic<std::size_t> bytes_[std::size_t(memory_category::COUNT)] = {};
+    std::atomic<std::size_t> total_{ 0 };
+    std::atomic<std::size_t> peak_{ 0 };
+    std::atomic<std::size_t> limit_{ 0 };
+    std::atomic<std::size_t> overruns_{ 0 };
+    std::atomic<std::size_t> evicted_{ 0 };
+
+    std::mutex                      evictor_mutex;
+    std::vector<registered_evictor> evictors;  // sorted by priority, then registration
+    std::size_t                     next_id = 0;
+};
+
+/*
+ * Reports bytes to a budget for as long as it lives; resize() reports the difference. Copies report the same bytes
+ * again and moves hand them over, so a charge can sit next to the buffers it accounts for in a value type.
+ */
+class memory_charge {
+  public:
+    explicit memory_charge(memory_category category,
+                           std::size_t     bytes  = 0,
+                           memory_budget & budget = memory_budget::global());
+    ~memory_charge();
+
+    memory_charge(const memory_charge & other);
+    memory_charge(memory_charge && other) noexcept;
+    memory_charge & operator=(const memory_charge & other);
+    memory_charge & operator=(memory_charge && other) noexcept;
+
+    void resize(std::size_t bytes);
+
+    [[nodiscard]] std::size_t bytes() const { return bytes_; }
+
+  private:
+    memory_budget * budget_;
+    memory_category category_;
+    std::size_t     bytes_ = 0;
+};
+}  // namespace velm
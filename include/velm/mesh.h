@@ -1,12 +1,40 @@
 #pragma once
+#include "velm/memory_budget.h"
+
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <span>
 #include <vector>
 
 namespace velm_dr {
 
 struct mesh {
-    std::span<float> vertices;
-    std::span<float> indices;
+    std::span<float>         vertices;
+    std::span<std::uint32_t> indices;
+};
+
+// owning counterpart of mesh, vertices are vertex_stride floats each with the position first
+struct mesh_data {
+    std::vector<float>         vertices;
+    std::vector<std::uint32_t> indices;
+    std::size_t                vertex_stride = 3;
+
+    // largest deviation from the source surface, in object space units (0 for the full resolution mesh)
+    float geometric_error = 0.0f;
+
+    [[nodiscard]] mesh view() { return { vertices, indices }; }
+
+    [[nodiscard]] std::size_t vertex_count() const { return vertices.size() / vertex_stride; }
+
+    [[nodiscard]] std::size_t triangle_count() const { return indices.size() / 3; }
+
+    // reports the vector storage to the memory budget as MESHES; producers call it once the vectors are filled,
+    // code that grows them afterwards calls it again
+    void charge_memory() {
+        memory.resize(vertices.capacity() * sizeof(float) + indices.capacity() * sizeof(std::uint32_t));
+    }
+
+    velm::memory_charge memory{ velm::memory_category::MESHES };
 };
 }  // namespace velm_dr
@@ -1,4 +1,6 @@
 #pragma once
+#include "velm/memory_budget.h"
+
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
@@ -19,9 +21,15 @@ template <typename T, std::size_t N> class ndarray {
     std::size_t dims[N];
     std::size_t strides[N];
 
+    // false for views created by wrap(), their memory is never freed or reallocated by the array
+    bool owns_data = true;
+
     template <typename... Idx> ndarray(Idx... idx);
     ~ndarray();
 
+    // non-owning view of external row-major memory (e.g. a shared memory mapping), no copy is made
+    template <typename... Idx> [[nodiscard]] static ndarray wrap(T * external, Idx... idx);
+
     template <typename... Idx> [[nodiscard]] T &       at(Idx... idx);
     template <typename... Idx> [[nodiscard]] const T & at(Idx... idx) const;
 
@@ -42,6 +50,19 @@ template <typename T, std::size_t N> class ndarray {
     [[nodiscard]] ndarray &                            operator=(ndarray && B) noexcept;
     ndarray(const ndarray & B);
     ndarray(ndarray && B) noexcept;
+
+  private:
+    struct wrap_tag {};
+
+    // owned storage is reported to the global memory budget as ARRAYS
+    [[nodiscard]] std::size_t owned_bytes() const {
+        return owns_data && data != nullptr ? total_elements() * sizeof(T) : 0;
+    }
+
+    static void track_allocation(std::size_t bytes);
+    static void track_free(std::size_t bytes);
+
+    template <typename... Idx> ndarray(wrap_tag, T * external, Idx... idx);
 };
 
 template <typename T, std::size_t N> template <typename... Idx> ndarray<T, N>::ndarray(Idx... idx) {
@@ -64,10 +85,45 @@ template <typename T, std::size_t N> template <typename... Idx> ndarray<T, N>::n
     } else {
         abort();
     }
+    track_allocation(owned_bytes());
+}
+
+template <typename T, std::size_t N> template <typename... Idx>
+ndarray<T, N>::ndarray(wrap_tag, T * external, Idx... idx) : data(external), owns_data(false) {
+    static_assert(sizeof...(Idx) == N, "Number of indices must match grid dimension");
+    std::size_t indices[N] = { static_cast<std::size_t>(idx)... };
+    for (std::size_t i = 0; i < N; ++i) {
+        dims[i] = indices[i];
+    }
+
+    strides[N - 1] = 1;
+    for (std::size_t i = N - 1; i > 0; --i) {
+        strides[i - 1] = strides[i] * dims[i];
+    }
+}
+
+template <typename T, std::size_t N> template <typename... Idx>
+ndarray<T, N> ndarray<T, N>::wrap(T * external, Idx... idx) {
+    return ndarray(wrap_tag{}, external, idx...);
 }
 
 template <typename T, std::size_t N> ndarray<T, N>::~ndarray() {
-    free(data);
+    track_free(owned_bytes());
+    if (owns_data) {
+        free(data);
+    }
+}
+
+template <typename T, std::size_t N> void ndarray<T, N>::track_allocation(std::size_t bytes) {
+    if (bytes != 0) {
+        velm::memory_budget::global().allocated(velm::memory_category::ARRAYS, bytes);
+    }
+}
+
+template <typename T, std::size_t N> void ndarray<T, N>::track_free(std::size_t bytes) {
+    if (bytes != 0) {
+        velm::memory_budget::global().freed(velm::memory_category::ARRAYS, bytes);
+    }
 }
 
 template <typename T, std::size_t N> template <typename... Idx> [[nodiscard]] T & ndarray<T, N>::at(Idx... idx) {
@@ -193,15 +249,20 @@ template <typename T, std::size_t N> template <typename... Idx> void ndarray<T,
         }
 
         // Delete old data
-        free(data);
+        track_free(owned_bytes());
+        if (owns_data) {
+            free(data);
+        }
     }
 
     // Update member variables
-    data = new_mem;
+    data      = new_mem;
+    owns_data = true;
     for (std::size_t i = 0; i < N; ++i) {
         dims[i]    = new_dims[i];
         strides[i] = new_strides[i];
     }
+    track_allocation(owned_bytes());
 }
 
 template <typename T, std::size_t N> template <typename... Idx> T & ndarray<T, N>::operator()(Idx... idx) {
@@ -222,9 +283,13 @@ template <typename T, std::size_t N> ndarray<T, N> & ndarray<T, N>::operator=(co
             }
         }
 
-        // if dimensions are different, deallocate and reallocate
+        // if dimensions are different, deallocate and reallocate; a view detaches from its external memory
         if (!same_dims) {
-            free(data);
+            track_free(owned_bytes());
+            if (owns_data) {
+                free(data);
+            }
+            owns_data = true;
             for (std::size_t i = 0; i < N; ++i) {
                 dims[i]    = B.dims[i];
                 strides[i] = B.strides[i];
@@ -233,6 +298,7 @@ template <typename T, std::size_t N> ndarray<T, N> & ndarray<T, N>::operator=(co
             if (!data) {
                 abort();
             }
+            track_allocation(owned_bytes());
         }
 
         // copy the data
@@ -245,7 +311,10 @@ template <typename T, std::size_t N> ndarray<T, N> & ndarray<T, N>::operator=(co
 
 template <typename T, std::size_t N> ndarray<T, N> & ndarray<T, N>::operator=(ndarray && B) noexcept {
     if (this != &B) {
-        free(data);
+        track_free(owned_bytes());
+        if (owns_data) {
+            free(data);
+        }
 
         for (std::size_t i = 0; i < N; ++i) {
             dims[i]    = B.dims[i];
@@ -253,8 +322,10 @@ template <typename T, std::size_t N> ndarray<T, N> & ndarray<T, N>::operator=(nd
         }
 
         // transfer ownership of data
-        data   = B.data;
-        B.data = nullptr;
+        data        = B.data;
+        owns_data   = B.owns_data;
+        B.data      = nullptr;
+        B.owns_data = true;
     }
     return *this;
 }
@@ -268,6 +339,7 @@ template <typename T, std::size_t N> ndarray<T, N>::ndarray(const ndarray & grid
     if (!data) {
         abort();
     }
+    track_allocation(owned_bytes());
     for (std::size_t i = 0; i < total_elements(); ++i) {
         data[i] = grid_b.data[i];
     }
@@ -278,8 +350,10 @@ template <typename T, std::size_t N> ndarray<T, N>::ndarray(ndarray && grid_b) n
         dims[i]    = grid_b.dims[i];
         strides[i] = grid_b.strides[i];
     }
-    data        = grid_b.data;
-    grid_b.data = nullptr;
+    data             = grid_b.data;
+    owns_data        = grid_b.owns_data;
+    grid_b.data      = nullptr;
+    grid_b.owns_data = true;
 }
 
 };  // namespace velm_DR
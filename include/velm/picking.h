@@ -0,0 +1,129 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/mesh.h"
+#include "velm/ndarray.h"
+#include "velm/scene.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+namespace velm_render {
+
+// origin + t * direction; direction is not normalized, so t keeps its meaning when the ray is transformed
+struct ray {
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 direction{ 0.0f, 0.0f, -1.0f };
+
+    [[nodiscard]] glm::vec3 at(float t) const { return origin + t * direction; }
+
+    [[nodiscard]] ray transformed(const glm::mat4x4 & m) const;
+};
+
+/*
+ * Ray through a window position (pixels, origin top left) from the near plane (t = 0) to the far plane (t = 1).
+ * homogeneous_depth: clip space z in [-1, 1], see frustum::from_view_proj.
+ */
+[[nodiscard]] ray cursor_ray(const glm::mat4x4 & view_mat,
+                             const glm::mat4x4 & proj_mat,
+                             const glm::vec2 &   cursor,
+                             const glm::vec2 &   viewport,
+                             bool                homogeneous_depth);
+
+// same, with the camera the view renders with
+[[nodiscard]] ray cursor_ray(const view & v, const glm::vec2 & cursor, const glm::vec2 & viewport);
+
+// world position under a window position, depth in [0, 1] as read back from the depth buffer
+[[nodiscard]] glm::vec3 unproject(const glm::mat4x4 & view_mat,
+                                  const glm::mat4x4 & proj_mat,
+                                  const glm::vec2 &   cursor,
+                                  const glm::vec2 &   viewport,
+                                  float               depth,
+                                  bool                homogeneous_depth);
+
+/*
+ * Value range of every brick of edge^3 cells of a scalar grid. A brick covers the sample corners of its cells, so
+ * every trilinear value inside it is within its range and rays can step over bricks that cannot reach a value.
+ */
+class minmax_bricks {
+  public:
+    static constexpr std::size_t edge = 8;
+
+    explicit minmax_bricks(const velm_DR::ndarray<float, 3> & volume,
+                           velm::job_system &                 jobs = velm::job_system::global());
+
+    // bricks per axis
+    std::size_t dims[3];
+
+    [[nodiscard]] float min(std::size_t i, std::size_t j, std::size_t k) const { return mins[index(i, j, k)]; }
+
+    [[nodiscard]] float max(std::size_t i, std::size_t j, std::size_t k) const { return maxs[index(i, j, k)]; }
+
+  private:
+    std::vector<float> mins;
+    std::vector<float> maxs;
+
+    [[nodiscard]] std::size_t index(std::size_t i, std::size_t j, std::size_t k) const {
+        return (i * dims[1] + j) * dims[2] + k;
+    }
+};
+
+// a scalar grid placed in the world, bricks must have been built from volume
+struct grid_probe {
+    const velm_DR::ndarray<float, 3> & volume;
+    const minmax_bricks &              bricks;
+    // sample (i, j, k) sits at index_to_world * (i, j, k, 1)
+    glm::mat4x4 index_to_world{ 1.0f };
+};
+
+struct grid_hit {
+    bool        hit = false;
+    float       t   = 0.0f;  // ray parameter of the hit
+    glm::vec3   position{ 0.0f };
+    std::size_t cell[3] = { 0, 0, 0 };
+    float       value   = 0.0f;
+};
+
+/*
+ * First point along the ray where the trilinear field reaches threshold (the front of the region value >=
+ * threshold), by an Amanatides-Woo walk over the bricks and, inside bricks whose range reaches the threshold, over
+ * the cells. In a candidate cell the value is checked at four points of the ray segment and the first rise is
+ * refined by bisection, so excursions narrower than a third of a cell can be missed.
+ */
+[[nodiscard]] grid_hit pick_isovalue(const grid_probe & grid,
+                                     const ray &        world_ray,
+                                     float              threshold,
+                                     float              t_max = std::numeric_limits<float>::infinity());
+
+// value at a world position (for example from unproject), no hit outside the grid
+[[nodiscard]] grid_hit probe_position(const grid_probe & grid, const glm::vec3 & position);
+
+struct object_hit {
+    bool               hit = false;
+    velm::scene_handle handle;
+    float              t = 0.0f;
+    glm::vec3          position{ 0.0f };
+};
+
+/*
+ * Refines a bounding box hit of object slot against its geometry; local_ray is in the object's local space and t
+ * holds the best hit so far on entry. Returns true and lowers t when the geometry is hit closer.
+ */
+using object_test = std::function<bool(std::uint32_t slot, const ray & local_ray, float & t)>;
+
+/*
+ * Closest object with RENDER_PICKABLE set along the ray, through the scene's bvh (closest lanes first, subtrees
+ * behind the best hit are skipped). Without an exact test the world bounds are the pick shape. Runs
+ * update_transforms() first like view::render, so objects moved since the last frame are picked where they are now.
+ */
+[[nodiscard]] object_hit pick_object(velm::Scene &       scene,
+                                     const ray &         world_ray,
+                                     const object_test & exact = {},
+                                     float               t_max = std::numeric_limits<float>::infinity());
+
+// closest triangle hit (Moller-Trumbore) with 0 <= hit < t, lowers t and returns true when there is one
+[[nodiscard]] bool intersect_triangles(const velm_dr::mesh_data & mesh, const ray & r, float & t);
+}  // namespace velm_render
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+ * Frame profiler
+ *
+ * Zones are recorded into per-thread single-producer ring buffers and drained once per frame by end_frame().
+ * Everything below is compiled out unless VELM_ENABLE_PROFILER is defined, the macros then expand to nothing.
+ *
+ *  VELM_PROFILE_ZONE("name");   // scoped CPU zone, name must outlive the profiler (string literal)
+ *  VELM_PROFILE_FUNCTION();     // zone named after the enclosing function
+ *  VELM_PROFILE_FRAME();        // after bgfx::frame(): sample bgfx stats and close the frame
+ */
+
+namespace velm_profiler {
+
+struct zone_event {
+    const char *  name;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+    std::uint32_t thread_id;
+};
+
+struct zone_summary {
+    const char *  name;
+    std::uint64_t total_ns;
+    std::uint32_t count;
+};
+
+struct frame_stats {
+    std::uint64_t frame_index;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+
+    // filled from bgfx::getStats(), zero when sample_bgfx_stats() was not called for the frame
+    double        cpu_frame_ms;
+    double        cpu_submit_ms;
+    double        gpu_ms;
+    double        wait_render_ms;
+    double        wait_submit_ms;
+    std::uint32_t draw_calls;
+    std::uint32_t compute_calls;
+    std::uint32_t blit_calls;
+    std::int64_t  gpu_memory_used;
+
+    std::uint64_t dropped_zones;
+};
+
+#ifdef VELM_ENABLE_PROFILER
+
+class scoped_zone {
+  public:
+    explicit scoped_zone(const char * name) noexcept;
+    ~scoped_zone() noexcept;
+
+    scoped_zone(const scoped_zone &)             = delete;
+    scoped_zone & operator=(const scoped_zone &) = delete;
+  private:
+    const char *  name_;
+    std::uint64_t begin_ns_;
+};
+
+[[nodiscard]] std::uint64_t now_ns() noexcept;
+
+void sample_bgfx_stats();
+void end_frame();
+
+// zone history is capped, the oldest events are discarded first
+void set_history_limit(std::size_t max_events, std::size_t max_frames);
+void clear();
+
+[[nodiscard]] std::vector<zone_event>   recorded_zones();
+[[nodiscard]] std::vector<frame_stats>  recorded_frames();
+[[nodiscard]] std::vector<zone_summary> last_frame_summary();
+
+bool write_chrome_trace(std::string_view path);
+
+// prints a live summary with bgfx::dbgTextPrintf, requires BGFX_DEBUG_TEXT
+void draw_overlay(std::uint16_t x, std::uint16_t y);
+
+#    define VELM_PROFILE_CONCAT_IMPL(a, b) a##b
+#    define VELM_PROFILE_CONCAT(a, b)      VELM_PROFILE_CONCAT_IMPL(a, b)
+#    define VELM_PROFILE_ZONE(name) \
+        const ::velm_profiler::scoped_zone VELM_PROFILE_CONCAT(velm_zone_, __LINE__)(name)
+#    define VELM_PROFILE_FUNCTION()        VELM_PROFILE_ZONE(__func__)
+#    define VELM_PROFILE_FRAME()                  \
+        do {                                      \
+            ::velm_profiler::sample_bgfx_stats(); \
+            ::velm_profiler::end_frame();         \
+        } while (0)
+#    define VELM_PROFILE_OVERLAY(x, y) ::velm_profiler::draw_overlay(x, y)
+
+#else
+
+#    define VELM_PROFILE_ZONE(name)    static_cast<void>(0)
+#    define VELM_PROFILE_FUNCTION()    static_cast<void>(0)
+#    define VELM_PROFILE_FRAME()       static_cast<void>(0)
+#    define VELM_PROFILE_OVERLAY(x, y) static_cast<void>(0)
+
+#endif
+
+}  // namespace velm_profiler
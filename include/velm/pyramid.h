@@ -0,0 +1,283 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/memory_budget.h"
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace velm {
+class hdf5_file;
+}
+
+namespace velm_dr {
+
+// how the up to 2 x 2 x 2 children of a coarse sample are combined; BOX averages them
+enum class pyramid_filter : std::uint8_t { BOX, MIN, MAX };
+
+struct pyramid_options {
+    pyramid_filter filter     = pyramid_filter::BOX;
+    std::size_t    max_levels = 32;
+    // the source is cut into blocks of 2^block_levels samples per axis and each block is reduced through that many
+    // levels while it is in cache, coarser levels are built from the last in-block level afterwards
+    std::size_t block_levels = 4;
+};
+
+struct pyramid_level {
+    std::size_t dims[3];
+    std::size_t offset;  // first element of the level in pyramid::values
+};
+
+/*
+ * Progressively halved copies of a 3D array, stored back to back. Level 0 is the source halved once, every level
+ * has ceil(dims / 2) samples of the one before, down to 1 x 1 x 1 or max_levels.
+ */
+template <typename T> struct pyramid {
+    std::vector<T>             values;
+    std::vector<pyramid_level> levels;
+
+    // non-owning view of one level, valid until values is modified
+    [[nodiscard]] velm_DR::ndarray<T, 3> level(std::size_t index) {
+        const pyramid_level & l = levels.at(index);
+        return velm_DR::ndarray<T, 3>::wrap(values.data() + l.offset, l.dims[0], l.dims[1], l.dims[2]);
+    }
+};
+
+namespace detail {
+
+// a run of dim 0 planes [first_plane, first_plane + planes) of an array with dims
+template <typename T> struct plane_range {
+    T *         data;
+    std::size_t dims[3];
+    std::size_t first_plane;
+
+    T & at(std::size_t i, std::size_t j, std::size_t k) const {
+        return data[((i - first_plane) * dims[1] + j) * dims[2] + k];
+    }
+};
+
+template <pyramid_filter filter, typename T>
+T combine(const plane_range<const T> & src, const std::size_t (&lo)[3], const std::size_t (&hi)[3]) {
+    using accumulator = std::conditional_t<std::is_floating_point_v<T>, double, long double>;
+    accumulator sum   = 0;
+    T           best  = src.at(lo[0], lo[1], lo[2]);
+    for (std::size_t i = lo[0]; i < hi[0]; ++i) {
+        for (std::size_t j = lo[1]; j < hi[1]; ++j) {
+            const T * row = &src.at(i, j, 0);
+            for (std::size_t k = lo[2]; k < hi[2]; ++k) {
+                if constexpr (filter == pyramid_filter::BOX) {
+                    sum += row[k];
+                } else if constexpr (filter == pyramid_filter::MIN) {
+                    best = std::min(best, row[k]);
+                } else {
+                    best = std::max(best, row[k]);
+                }
+            }
+        }
+    }
+    if constexpr (filter != pyramid_filter::BOX) {
+        return best;
+    } else {
+        accumulator mean = sum / accumulator((hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]));
+        if constexpr (std::is_integral_v<T>) {
+            mean += mean < 0 ? -0.5 : 0.5;
+        }
+        return static_cast<T>(mean);
+    }
+}
+
+// fills dst cells [lo, hi) from their children in src, children past the end of src are left out
+template <pyramid_filter filter, typename T>
+void reduce_cells(const plane_range<const T> & src,
+                  const plane_range<T> &       dst,
+                  const std::size_t (&lo)[3],
+                  const std::size_t (&hi)[3]) {
+    for (std::size_t i = lo[0]; i < hi[0]; ++i) {
+        for (std::size_t j = lo[1]; j < hi[1]; ++j) {
+            T * row = &dst.at(i, j, 0);
+            for (std::size_t k = lo[2]; k < hi[2]; ++k) {
+                std::size_t child_lo[3] = { 2 * i, 2 * j, 2 * k };
+                std::size_t child_hi[3] = { std::min(2 * i + 2, src.dims[0]), std::min(2 * j + 2, src.dims[1]),
+                                            std::min(2 * k + 2, src.dims[2]) };
+                row[k]                  = combine<filter>(src, child_lo, child_hi);
+            }
+        }
+    }
+}
+
+template <typename T>
+void reduce_region(pyramid_filter               filter,
+                   const plane_range<const T> & src,
+                   const plane_range<T> &       dst,
+                   const std::size_t (&lo)[3],
+                   const std::size_t (&hi)[3]) {
+    switch (filter) {
+        case pyramid_filter::BOX:
+            reduce_cells<pyramid_filter::BOX>(src, dst, lo, hi);
+            break;
+        case pyramid_filter::MIN:
+            reduce_cells<pyramid_filter::MIN>(src, dst, lo, hi);
+            break;
+        case pyramid_filter::MAX:
+            reduce_cells<pyramid_filter::MAX>(src, dst, lo, hi);
+            break;
+    }
+}
+
+template <typename T> pyramid<T> allocate_pyramid(const std::size_t (&dims)[3], const pyramid_options & options) {
+    pyramid<T>  result;
+    std::size_t d[3]   = { dims[0], dims[1], dims[2] };
+    std::size_t offset = 0;
+    while ((d[0] > 1 || d[1] > 1 || d[2] > 1) && result.levels.size() < options.max_levels) {
+        pyramid_level l{ { (d[0] + 1) / 2, (d[1] + 1) / 2, (d[2] + 1) / 2 }, offset };
+        result.levels.push_back(l);
+        offset += l.dims[0] * l.dims[1] * l.dims[2];
+        std::copy(l.dims, l.dims + 3, d);
+    }
+    result.values.resize(offset);
+    return result;
+}
+
+// planes per block along dim 0 for a source of these dims, slabs of a streamed build start at multiples of it
+inline std::size_t slab_block(const std::size_t (&dims)[3], const pyramid_options & options) {
+    std::size_t d[3]   = { dims[0], dims[1], dims[2] };
+    std::size_t levels = 0;
+    for (; (d[0] > 1 || d[1] > 1 || d[2] > 1) && levels < options.max_levels; ++levels) {
+        for (std::size_t & extent : d) {
+            extent = (extent + 1) / 2;
+        }
+    }
+    return std::size_t(1) << std::min(std::max<std::size_t>(options.block_levels, 1), levels);
+}
+
+template <typename T> plane_range<T> level_range(pyramid<T> & p, std::size_t index) {
+    const pyramid_level & l = p.levels[index];
+    return { p.values.data() + l.offset, { l.dims[0], l.dims[1], l.dims[2] }, 0 };
+}
+
+// reduces one slab of source planes (first_plane a multiple of the block size) through the in-block levels
+template <typename T>
+void reduce_slab(const plane_range<const T> & slab,
+                 std::size_t                  planes,
+                 pyramid<T> &                 out,
+                 const pyramid_options &      options,
+                 velm::job_system &           jobs) {
+    const std::size_t in_block  = std::min(std::max<std::size_t>(options.block_levels, 1), out.levels.size());
+    const std::size_t block     = std::size_t(1) << in_block;
+    const std::size_t blocks[3] = { (planes + block - 1) / block, (slab.dims[1] + block - 1) / block,
+                                    (slab.dims[2] + block - 1) / block };
+
+    velm::parallel_for(
+        0, blocks[0] * blocks[1] * blocks[2], 1,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t b = first; b < last; ++b) {
+                std::size_t origin[3] = { slab.first_plane + b / (blocks[1] * blocks[2]) * block,
+                                          b / blocks[2] % blocks[1] * block, b % blocks[2] * block };
+
+                plane_range<const T> src = slab;
+                for (std::size_t l = 0; l < in_block; ++l) {
+                    plane_range<T> dst = level_range(out, l);
+                    std::size_t    lo[3];
+                    std::size_t    hi[3];
+                    for (int a = 0; a < 3; ++a) {
+                        lo[a] = origin[a] >> (l + 1);
+                        hi[a] = std::min(dst.dims[a], (origin[a] + block) >> (l + 1));
+                    }
+                    reduce_region(options.filter, src, dst, lo, hi);
+                    src = { dst.data, { dst.dims[0], dst.dims[1], dst.dims[2] }, 0 };
+                }
+            }
+        },
+        jobs);
+}
+
+// levels past the in-block ones, each from the previous level, split over dim 0 planes
+template <typename T>
+void reduce_remaining(pyramid<T> & out, const pyramid_options & options, velm::job_system & jobs) {
+    const std::size_t in_block = std::min(std::max<std::size_t>(options.block_levels, 1), out.levels.size());
+    for (std::size_t l = in_block; l < out.levels.size(); ++l) {
+        plane_range<T>       dst  = level_range(out, l);
+        plane_range<T>       prev = level_range(out, l - 1);
+        plane_range<const T> src{ prev.data, { prev.dims[0], prev.dims[1], prev.dims[2] }, 0 };
+        velm::parallel_for(
+            0, dst.dims[0], 1,
+            [&](std::size_t first, std::size_t last) {
+                std::size_t lo[3] = { first, 0, 0 };
+                std::size_t hi[3] = { last, dst.dims[1], dst.dims[2] };
+                reduce_region(options.filter, src, dst, lo, hi);
+            },
+            jobs);
+    }
+}
+
+}  // namespace detail
+
+/*
+ * All levels in one pass over the source: it is cut into cubes that are reduced through the first
+ * options.block_levels levels on the job system while they are in cache, only the small remaining levels are
+ * computed level by level.
+ */
+template <typename T>
+[[nodiscard]] pyramid<T> build_pyramid(const velm_DR::ndarray<T, 3> & source,
+                                       const pyramid_options &        options = {},
+                                       velm::job_system &             jobs    = velm::job_system::global()) {
+    pyramid<T> result = detail::allocate_pyramid<T>(source.dims, options);
+    if (result.levels.empty()) {
+        return result;
+    }
+    detail::plane_range<const T> whole{ source.data, { source.dims[0], source.dims[1], source.dims[2] }, 0 };
+    detail::reduce_slab(whole, source.dims[0], result, options, jobs);
+    detail::reduce_remaining(result, options, jobs);
+    return result;
+}
+
+// read(first, count, out) fills out with the count dim 0 planes starting at first, count * dims[1] * dims[2] values
+template <typename T> using plane_reader = std::function<void(std::size_t first, std::size_t count, T * out)>;
+
+/*
+ * Same result as build_pyramid for sources that do not fit in memory: the source is read slab by slab of
+ * slab_planes planes (rounded up to the block size), only one slab and the pyramid itself are resident.
+ */
+template <typename T>
+[[nodiscard]] pyramid<T> build_pyramid(const std::size_t (&dims)[3],
+                                       const plane_reader<T> & read,
+                                       std::size_t             slab_planes,
+                                       const pyramid_options & options = {},
+                                       velm::job_system &      jobs    = velm::job_system::global()) {
+    pyramid<T> result = detail::allocate_pyramid<T>(dims, options);
+    if (result.levels.empty()) {
+        return result;
+    }
+    const std::size_t block = detail::slab_block(dims, options);
+    slab_planes             = std::max<std::size_t>((slab_planes + block - 1) / block, 1) * block;
+
+    std::vector<T>      slab(std::min(slab_planes, dims[0]) * dims[1] * dims[2]);
+    velm::memory_charge slab_memory(velm::memory_category::IO_BUFFERS, slab.size() * sizeof(T));
+    for (std::size_t first = 0; first < dims[0]; first += slab_planes) {
+        std::size_t planes = std::min(slab_planes, dims[0] - first);
+        read(first, planes, slab.data());
+        detail::plane_range<const T> range{ slab.data(), { dims[0], dims[1], dims[2] }, first };
+        detail::reduce_slab(range, planes, result, options, jobs);
+    }
+    detail::reduce_remaining(result, options, jobs);
+    return result;
+}
+
+#ifdef VELM_ENABLE_HDF5
+/*
+ * Streams a 3D dataset through hyperslab reads, converted to float. slab_planes is rounded up to a multiple of
+ * both the dataset's chunk extent along dim 0 and the block size, so slabs start on chunk boundaries and every
+ * chunk is read once.
+ */
+[[nodiscard]] pyramid<float> build_pyramid(const velm::hdf5_file & file,
+                                           std::string_view        dataset,
+                                           std::size_t             slab_planes = 64,
+                                           const pyramid_options & options     = {},
+                                           velm::job_system &      jobs        = velm::job_system::global());
+#endif
+}  // namespace velm_dr
@@ -0,0 +1,56 @@
+#pragma once
+#include "velm/compositing.h"
+#include "velm/job_system.h"
+#include "velm/picking.h"
+#include "velm/scene.h"
+#include "velm/transfer_function.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+
+namespace velm_render {
+
+struct raycast_options {
+    // scalar values mapped to the transfer function's [0, 1]
+    float value_lo = 0.0f;
+    float value_hi = 1.0f;
+    // rays stop once they are this opaque
+    float opacity_cutoff = 0.99f;
+    // pixels per side of the tiles handed to the job system
+    std::uint32_t tile = 16;
+    // step over minmax bricks the transfer function leaves fully transparent
+    bool skip_empty = true;
+};
+
+/*
+ * CPU volume rendering for machines without a GPU: front to back emission and absorption through the pre-integrated
+ * table of tf (which must be up to date, see transfer_function::update) with a world space step of tf.step(). The
+ * camera takes the matrices of view::set_camera, so the volume lines up with the scene meshes a view draws. The
+ * image is cut into tiles that the job system's workers steal from each other; inside a tile, rays march in
+ * packets of eight whose samples are gathered together (AVX2 when compiled with it). Each ray skips bricks that
+ * cannot contribute and stops at opacity_cutoff.
+ *
+ * image keeps its size and is overwritten: premultiplied color and, where anything was hit, the world distance from
+ * the near plane to the first contribution, so images of several bricks can go through composite_binary_swap.
+ */
+void raycast_volume(const glm::mat4x4 &       view_mat,
+                    const glm::mat4x4 &       proj_mat,
+                    bool                      homogeneous_depth,
+                    const grid_probe &        grid,
+                    const transfer_function & tf,
+                    composite_image &         image,
+                    const raycast_options &   options = {},
+                    velm::job_system &        jobs    = velm::job_system::global());
+
+// same, with the camera the view renders with
+void raycast_volume(const view &              v,
+                    const grid_probe &        grid,
+                    const transfer_function & tf,
+                    composite_image &         image,
+                    const raycast_options &   options = {},
+                    velm::job_system &        jobs    = velm::job_system::global());
+
+// 8 bit binary PPM of the image over an opaque background, top row first; throws std::runtime_error on failure
+void write_ppm(const composite_image & image, const std::filesystem::path & file, const glm::vec3 & background);
+}  // namespace velm_render
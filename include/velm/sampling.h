@@ -0,0 +1,148 @@
+#pragma once
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+
+namespace velm_DR {
+
+enum class sample_filter : std::uint8_t { NEAREST, TRILINEAR, TRICUBIC };
+
+// how taps outside the array are read: the edge value, zero, or wrapped around
+enum class sample_boundary : std::uint8_t { CLAMP, ZERO, PERIODIC };
+
+struct sample_options {
+    sample_filter   filter   = sample_filter::TRILINEAR;
+    sample_boundary boundary = sample_boundary::CLAMP;
+    // the float overload uses AVX2 gathers for trilinear clamp/zero sampling when compiled with them
+    bool allow_simd = true;
+};
+
+namespace detail {
+
+// up to four taps along one axis, index already resolved by the boundary mode (weight 0 for ZERO taps outside)
+struct axis_taps {
+    std::size_t index[4];
+    float       weight[4];
+    int         count;
+};
+
+inline std::size_t resolve_tap(std::ptrdiff_t i, std::size_t n, sample_boundary boundary, float & weight) {
+    auto size = static_cast<std::ptrdiff_t>(n);
+    if (i >= 0 && i < size) {
+        return static_cast<std::size_t>(i);
+    }
+    switch (boundary) {
+        case sample_boundary::CLAMP:
+            return i < 0 ? 0 : n - 1;
+        case sample_boundary::ZERO:
+            weight = 0.0f;
+            return 0;
+        case sample_boundary::PERIODIC:
+            return static_cast<std::size_t>((i % size + size) % size);
+    }
+    return 0;
+}
+
+inline axis_taps taps_along(float x, std::size_t n, const sample_options & options) {
+    axis_taps taps{};
+    float     base = std::floor(x);
+    float     t    = x - base;
+    auto      i    = static_cast<std::ptrdiff_t>(base);
+    switch (options.filter) {
+        case sample_filter::NEAREST:
+            taps.count     = 1;
+            taps.weight[0] = 1.0f;
+            i              = static_cast<std::ptrdiff_t>(std::floor(x + 0.5f));
+            break;
+        case sample_filter::TRILINEAR:
+            taps.count     = 2;
+            taps.weight[0] = 1.0f - t;
+            taps.weight[1] = t;
+            break;
+        case sample_filter::TRICUBIC:
+            // Catmull-Rom: interpolating, reproduces quadratics
+            taps.count     = 4;
+            taps.weight[0] = 0.5f * t * (-1.0f + t * (2.0f - t));
+            taps.weight[1] = 0.5f * (2.0f + t * t * (-5.0f + 3.0f * t));
+            taps.weight[2] = 0.5f * t * (1.0f + t * (4.0f - 3.0f * t));
+            taps.weight[3] = 0.5f * t * t * (t - 1.0f);
+            i -= 1;
+            break;
+    }
+    for (int k = 0; k < taps.count; ++k) {
+        taps.index[k] = resolve_tap(i + k, n, options.boundary, taps.weight[k]);
+    }
+    return taps;
+}
+
+}  // namespace detail
+
+// one sample at an index space position, (0, 0, 0) is the first element; non-finite positions and empty volumes
+// give 0
+template <typename T>
+float sample_at(const ndarray<T, 3> & volume, const glm::vec3 & position, const sample_options & options = {}) {
+    // no tap to clamp or wrap to
+    if (volume.total_elements() == 0) {
+        return 0.0f;
+    }
+    glm::vec3 p;
+    for (int a = 0; a < 3; ++a) {
+        if (!std::isfinite(position[a])) {
+            return 0.0f;
+        }
+        // keeps the float to index conversion in range, clamp and zero results are unchanged that far out
+        p[a] = std::fmin(std::fmax(position[a], -1e9f), 1e9f);
+    }
+    detail::axis_taps t0 = detail::taps_along(p.x, volume.dims[0], options);
+    detail::axis_taps t1 = detail::taps_along(p.y, volume.dims[1], options);
+    detail::axis_taps t2 = detail::taps_along(p.z, volume.dims[2], options);
+
+    float result = 0.0f;
+    for (int a = 0; a < t0.count; ++a) {
+        const T * plane = volume.data + t0.index[a] * volume.strides[0];
+        float     row   = 0.0f;
+        for (int b = 0; b < t1.count; ++b) {
+            const T * line = plane + t1.index[b] * volume.strides[1];
+            float     sum  = 0.0f;
+            for (int c = 0; c < t2.count; ++c) {
+                sum += t2.weight[c] * static_cast<float>(line[t2.index[c]]);
+            }
+            row += t1.weight[b] * sum;
+        }
+        result += t0.weight[a] * row;
+    }
+    return result;
+}
+
+/*
+ * Samples the array at many index space positions: out[i] = sample_at(volume, positions[i]). out must hold
+ * positions.size() values.
+ */
+template <typename T>
+void sample(const ndarray<T, 3> &      volume,
+            std::span<const glm::vec3> positions,
+            std::span<float>           out,
+            const sample_options &     options = {}) {
+    if (out.size() < positions.size()) {
+        abort();
+    }
+    if (volume.total_elements() == 0) {
+        std::fill_n(out.begin(), positions.size(), 0.0f);
+        return;
+    }
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        out[i] = sample_at(volume, positions[i], options);
+    }
+}
+
+// float volumes: eight positions per step with AVX2 gathers where the options allow it (see sampling.cpp)
+void sample(const ndarray<float, 3> &  volume,
+            std::span<const glm::vec3> positions,
+            std::span<float>           out,
+            const sample_options &     options = {});
+}  // namespace velm_DR
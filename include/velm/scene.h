@@ -1,13 +1,40 @@
 #pragma once
+#include "velm/mesh.h"
+#include "velm/vertex_format.h"
+
 #include <bgfx/bgfx.h>
 
+#include <cstdint>
+#include <deque>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/glm.hpp>
+#include <memory>
+#include <span>
 #include <vector>
 
+namespace velm {
+class Scene;
+}
+
 namespace velm_render {
 
-class view_component {};
+class bvh;
+class cached_geometry;
+class occlusion_buffer;
+
+// something a view draws besides scene meshes
+class view_component {
+  public:
+    virtual ~view_component() = default;
+
+    // api thread, before recording: create and update gpu resources here
+    virtual void prepare() {}
+    // may run on any thread, only records draw calls into the encoder
+    virtual void submit(bgfx::Encoder &, bgfx::ViewId) {}
+
+    // something visible changed since the last prepare(); on-demand rendering only draws when a frame would differ
+    [[nodiscard]] virtual bool needs_redraw() const { return false; }
+};
 
 class opaque_mesh : view_component {};
 
@@ -16,33 +43,224 @@ class transparent_mesh : view_component {};
 class transparent_effect : view_component {};
 
 class view {
-    std::vector<view_component *> view_components;
-    glm::mat4x4                   view_mat;
-    bgfx::TextureHandle           render_target;
-    bgfx::TextureHandle           depth_buffer_target;
+    std::vector<view_component *>     view_components;
+    glm::mat4x4                       view_mat;
+    glm::mat4x4                       proj_mat;
+    bgfx::ViewId                      view_id;
+    bgfx::TextureHandle               render_target;
+    bgfx::TextureHandle               depth_buffer_target;
+    bgfx::ProgramHandle               programs[2];       // indexed by vertex_format, set_program() overrides
+    bgfx::ProgramHandle               draw_programs[2];  // what record() uses: the override or the library default
+    bgfx::UniformHandle               dequantize;
+    bool                              homogeneous_depth = false;
+    std::uint16_t                     viewport_height = 0;
+    float                             lod_pixel_error = 1.0f;
+    float                             lod_error_scale = 1.0f;
+    std::uint64_t                     revision_       = 0;
+    std::unique_ptr<occlusion_buffer> occlusion;
+    std::vector<std::uint32_t>        visible_slots;
 
   public:
     view();
     ~view();
-    void render();
-    void add_component();
+    view(view &&) noexcept;
+    view & operator=(view &&) noexcept;
+
+    // single threaded convenience: updates the scene, prepares the view and records it into the api thread encoder
+    void render(velm::Scene & scene);
+
+    // api thread, once per frame before record(): view transform and component resources
+    void prepare();
+    // culls and records draw calls; views of the same scene can record concurrently on separate encoders as long
+    // as the scene is not modified meanwhile
+    void record(const velm::Scene & scene, bgfx::Encoder & encoder);
+    // components are not owned, they are submitted after the scene meshes in the order they were added
+    void add_component(view_component & component);
+    void remove_component(view_component & component);
+
+    void set_camera(const glm::mat4x4 & view_matrix, const glm::mat4x4 & projection);
+    void set_view_id(bgfx::ViewId id);
+    // meshes draw with the library's vs_mesh / vs_mesh_packed and fs_mesh programs unless one is set here
+    void set_program(bgfx::ProgramHandle handle, vertex_format format = vertex_format::FLOAT);
+
+    // meshes pick the coarsest lod whose geometric error stays below max_pixel_error on a viewport of this height
+    void set_lod_error(std::uint16_t height, float max_pixel_error);
+    // multiplies max_pixel_error without counting as a change, for the frame governor of the render loop
+    void set_lod_error_scale(float scale) { lod_error_scale = scale; }
+
+    // bumped by every setter above, so a render loop can tell whether the view changed since its last frame
+    [[nodiscard]] std::uint64_t revision() const { return revision_; }
+    // a component has changes that only show after the next prepare()
+    [[nodiscard]] bool needs_redraw() const;
+
+    // coarse occlusion culling against a depth buffer of the given resolution, 0 disables it. The renderer does not
+    // fill the buffer: call occlusion_culling()->load_depth() every frame, or it stays clear and rejects nothing
+    void               enable_occlusion_culling(std::uint32_t width, std::uint32_t height);
+    occlusion_buffer * occlusion_culling() { return occlusion.get(); }
+
+    // object slots that survived culling in the last render()
+    [[nodiscard]] std::span<const std::uint32_t> visible() const { return visible_slots; }
+
+    [[nodiscard]] const glm::mat4x4 & view_matrix() const { return view_mat; }
+
+    [[nodiscard]] const glm::mat4x4 & projection() const { return proj_mat; }
+
+    // clip space depth convention of the renderer, known after the first prepare()
+    [[nodiscard]] bool homogeneous_clip_depth() const { return homogeneous_depth; }
+};
+
+struct aabb {
+    glm::vec3 min{ 0.0f };
+    glm::vec3 max{ 0.0f };
+
+    // bounds of the box after an affine transform
+    [[nodiscard]] aabb transformed(const glm::mat4x4 & m) const;
 };
 
 struct mesh {
     enum class type : char { OPAQUE, TRANSPARENT };
     enum class buffer_type : char { STATIC, DYNAMIC };
-    glm::mat4x4 transform;
+
+    struct lod {
+        bgfx::VertexBufferHandle vertex_buffer   = BGFX_INVALID_HANDLE;
+        bgfx::IndexBufferHandle  index_buffer    = BGFX_INVALID_HANDLE;
+        std::uint32_t            index_count     = 0;
+        float                    geometric_error = 0.0f;
+    };
+
+    // finest level first, see velm_dr::build_lod_chain
+    std::vector<lod> lods;
+    vertex_format    format = vertex_format::FLOAT;
+    quantization     box;            // shared by all levels, decimation never leaves the bounds of the finest one
+    std::size_t      gpu_bytes = 0;  // of all levels, reported to the memory budget as GPU_BUFFERS
+
+    mesh() = default;
+    // destroys the buffers, so meshes have to go before bgfx shuts down
+    ~mesh();
+    // the buffers move along, the source is left empty
+    mesh(mesh && other) noexcept;
+    mesh & operator=(mesh && other) noexcept;
+
+    mesh(const mesh &)             = delete;
+    mesh & operator=(const mesh &) = delete;
+
+    // the chain is quantized against the bounds of its first level when format is PACKED
+    void upload(std::span<const velm_dr::mesh_data> chain,
+                const vertex_attributes &           attributes,
+                vertex_format                       packing = vertex_format::PACKED);
+    // a chain read back from a geometry_cache, uploaded without a copy
+    void upload(std::shared_ptr<const cached_geometry> geometry);
+    void destroy();
+
+    // coarsest level whose error projects to at most max_pixel_error pixels, pixels_per_unit is measured at
+    // distance 1 (proj[1][1] * viewport_height / 2)
+    [[nodiscard]] std::size_t select_lod(float distance, float pixels_per_unit, float max_pixel_error) const;
+};
+
+// per-object flags, kept in their own array so visibility passes only touch one byte per object
+enum render_flags : std::uint8_t {
+    RENDER_VISIBLE     = 1 << 0,
+    RENDER_TRANSPARENT = 1 << 1,
+    RENDER_PICKABLE    = 1 << 2,
 };
 }  // namespace velm_render
 
 namespace velm {
+
+// slot index plus the generation the slot had when the handle was issued, stale handles never alias new objects
+struct scene_handle {
+    static constexpr std::uint32_t invalid_index = UINT32_MAX;
+
+    std::uint32_t index      = invalid_index;
+    std::uint32_t generation = 0;
+
+    [[nodiscard]] bool valid() const { return index != invalid_index; }
+
+    bool operator==(const scene_handle &) const = default;
+};
+
+/*
+ * Scene objects live in structure-of-arrays pools indexed by slot. Freed slots are recycled through a free list,
+ * the generation counter of a slot is bumped on removal so outstanding handles become invalid.
+ *
+ * World transforms are only recomputed for objects marked dirty and their descendants. update_order keeps alive
+ * slots sorted by hierarchy depth so a single linear pass sees every parent before its children. Children of a slot
+ * are threaded through first_children / next_siblings / prev_siblings, so hierarchy edits only touch the slots
+ * involved.
+ */
 class Scene {
-    std::vector<velm_render::view>   views;
+    std::deque<velm_render::view> views;
+
+    std::vector<glm::mat4x4>         local_transforms;
+    std::vector<glm::mat4x4>         world_transforms;
+    std::vector<velm_render::aabb>   local_bounds;
+    std::vector<velm_render::aabb>   world_bounds;
+    std::vector<std::uint8_t>        flags;
+    std::vector<std::uint8_t>        dirty;
+    std::vector<std::uint8_t>        alive;
+    std::vector<std::uint32_t>       parents;
+    std::vector<std::uint32_t>       first_children;
+    std::vector<std::uint32_t>       next_siblings;
+    std::vector<std::uint32_t>       prev_siblings;
+    std::vector<std::uint32_t>       generations;
     std::vector<velm_render::mesh *> meshes;
+
+    std::vector<std::uint32_t>        free_slots;
+    std::vector<std::uint32_t>        update_order;
+    std::vector<std::uint32_t>        changed;
+    bool                              order_dirty       = false;
+    std::uint64_t                     topology_version_ = 0;
+    std::uint64_t                     revision_         = 0;
+    std::unique_ptr<velm_render::bvh> accel;
+
+    void rebuild_update_order();
+    // insert slot at the head of the child list of parent / take it out of its parent's list; parents is updated
+    void link_child(std::uint32_t slot, std::uint32_t parent);
+    void unlink_child(std::uint32_t slot);
+    // world transform from the current local transforms, also when update_transforms() has not seen them yet
+    [[nodiscard]] glm::mat4x4 resolve_world(std::uint32_t slot) const;
+
   public:
     Scene();
     ~Scene();
-    void add_mesh();
-    void add_view();
+
+    scene_handle       add_mesh(velm_render::mesh *       mesh,
+                                const velm_render::aabb & bounds,
+                                scene_handle              parent       = {},
+                                std::uint8_t              object_flags = velm_render::RENDER_VISIBLE);
+    void               remove(scene_handle handle);
+    [[nodiscard]] bool is_valid(scene_handle handle) const;
+
+    // the view stays at the same address for the lifetime of the scene
+    velm_render::view & add_view();
+
+    void set_parent(scene_handle handle, scene_handle parent);
+    void set_transform(scene_handle handle, const glm::mat4x4 & transform);
+    void set_bounds(scene_handle handle, const velm_render::aabb & bounds);
+    void set_render_flags(scene_handle handle, std::uint8_t object_flags);
+
+    [[nodiscard]] const glm::mat4x4 &       local_transform(scene_handle handle) const;
+    [[nodiscard]] const glm::mat4x4 &       world_transform(scene_handle handle) const;
+    [[nodiscard]] const velm_render::aabb & world_bound(scene_handle handle) const;
+    [[nodiscard]] std::uint8_t              render_flags(scene_handle handle) const;
+    [[nodiscard]] velm_render::mesh *       mesh_of(scene_handle handle) const;
+    [[nodiscard]] scene_handle              handle_of(std::uint32_t slot) const;
+
+    // recomputes world transforms and bounds of dirty objects and refits the bvh, returns the slots that changed
+    std::span<const std::uint32_t> update_transforms();
+
+    // bumped whenever objects are added or removed
+    [[nodiscard]] std::uint64_t            topology_version() const { return topology_version_; }
+    // grows with every change to objects, views or their cameras; equal values mean an identical frame
+    [[nodiscard]] std::uint64_t            revision() const;
+    [[nodiscard]] const velm_render::bvh & acceleration() const { return *accel; }
+
+    // raw pools for per-frame passes, indexed by slot; dead slots have no render flags set
+    [[nodiscard]] std::size_t                          slot_count() const { return alive.size(); }
+    [[nodiscard]] std::span<const glm::mat4x4>         world_transform_pool() const { return world_transforms; }
+    [[nodiscard]] std::span<const velm_render::aabb>   world_bound_pool() const { return world_bounds; }
+    [[nodiscard]] std::span<const std::uint8_t>        render_flag_pool() const { return flags; }
+    [[nodiscard]] std::span<velm_render::mesh * const> mesh_pool() const { return meshes; }
+    [[nodiscard]] std::deque<velm_render::view> &      view_pool() { return views; }
 };
 }  // namespace velm
@@ -0,0 +1,205 @@
+#pragma once
+#include "velm/memory_budget.h"
+#include "velm/ndarray.h"
+#include "velm/scene.h"
+
+#include <bgfx/bgfx.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace velm_render {
+
+struct slice_extent {
+    std::size_t width  = 0;
+    std::size_t height = 0;
+};
+
+// size of the axis-aligned slice orthogonal to axis: the higher remaining axis runs along a row
+template <typename T> slice_extent slice_extent_of(const velm_DR::ndarray<T, 3> & volume, std::size_t axis) {
+    std::size_t row = axis == 0 ? 1 : 0;
+    std::size_t col = axis == 2 ? 1 : 2;
+    return { volume.dims[col], volume.dims[row] };
+}
+
+/*
+ * Copies the plane at index along axis into out with a strided walk, touching only the elements of that plane.
+ * out must hold slice_extent_of(volume, axis) elements and is filled row by row.
+ */
+template <typename T>
+slice_extent extract_slice(const velm_DR::ndarray<T, 3> & volume,
+                           std::size_t                     axis,
+                           std::size_t                     index,
+                           std::span<float>                out) {
+    std::size_t  row    = axis == 0 ? 1 : 0;
+    std::size_t  col    = axis == 2 ? 1 : 2;
+    slice_extent extent = slice_extent_of(volume, axis);
+    if (axis > 2 || index >= volume.dims[axis] || out.size() < extent.width * extent.height) {
+        abort();
+    }
+
+    const T *   base       = volume.data + index * volume.strides[axis];
+    std::size_t row_stride = volume.strides[row];
+    std::size_t col_stride = volume.strides[col];
+    for (std::size_t y = 0; y < extent.height; ++y) {
+        const T * src = base + y * row_stride;
+        float *   dst = out.data() + y * extent.width;
+        if (col_stride == 1) {
+            for (std::size_t x = 0; x < extent.width; ++x) {
+                dst[x] = static_cast<float>(src[x]);
+            }
+        } else {
+            for (std::size_t x = 0; x < extent.width; ++x) {
+                dst[x] = static_cast<float>(src[x * col_stride]);
+            }
+        }
+    }
+    return extent;
+}
+
+/*
+ * Trilinearly resamples an arbitrary plane: texel (x, y) lies at origin + x * u + y * v in index space.
+ * Samples outside the volume are set to outside.
+ */
+template <typename T>
+void extract_oblique_slice(const velm_DR::ndarray<T, 3> & volume,
+                           const glm::vec3 &               origin,
+                           const glm::vec3 &               u,
+                           const glm::vec3 &               v,
+                           std::size_t                     width,
+                           std::size_t                     height,
+                           std::span<float>                out,
+                           float                           outside = 0.0f) {
+    if (out.size() < width * height) {
+        abort();
+    }
+    const float limit[3] = { float(volume.dims[0]) - 1.0f, float(volume.dims[1]) - 1.0f,
+                             float(volume.dims[2]) - 1.0f };
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            glm::vec3 p = origin + float(x) * u + float(y) * v;
+            float &   d = out[y * width + x];
+            if (p.x < 0.0f || p.y < 0.0f || p.z < 0.0f || p.x > limit[0] || p.y > limit[1] || p.z > limit[2]) {
+                d = outside;
+                continue;
+            }
+
+            std::size_t i[3];
+            float       f[3];
+            for (int a = 0; a < 3; ++a) {
+                float c = std::floor(p[a]);
+                i[a]    = std::min(static_cast<std::size_t>(c), volume.dims[a] > 1 ? volume.dims[a] - 2 : 0);
+                f[a]    = volume.dims[a] > 1 ? p[a] - float(i[a]) : 0.0f;
+            }
+            // neighbour offsets collapse to 0 along axes of size 1
+            std::size_t s0   = volume.dims[0] > 1 ? volume.strides[0] : 0;
+            std::size_t s1   = volume.dims[1] > 1 ? volume.strides[1] : 0;
+            std::size_t s2   = volume.dims[2] > 1 ? 1 : 0;
+            const T *   c000 = volume.data + i[0] * volume.strides[0] + i[1] * volume.strides[1] + i[2];
+
+            float c00 = float(c000[0]) * (1.0f - f[2]) + float(c000[s2]) * f[2];
+            float c01 = float(c000[s1]) * (1.0f - f[2]) + float(c000[s1 + s2]) * f[2];
+            float c10 = float(c000[s0]) * (1.0f - f[2]) + float(c000[s0 + s2]) * f[2];
+            float c11 = float(c000[s0 + s1]) * (1.0f - f[2]) + float(c000[s0 + s1 + s2]) * f[2];
+            float c0  = c00 * (1.0f - f[1]) + c01 * f[1];
+            float c1  = c10 * (1.0f - f[1]) + c11 * f[1];
+            d         = c0 * (1.0f - f[0]) + c1 * f[0];
+        }
+    }
+}
+
+/*
+ * Draws one plane through a 3D float volume. Only the plane is uploaded, as a single channel R32F texture; the
+ * fragment shader (fs_slice.sc) maps values through a 256 entry colormap texture. Moving an axis-aligned slice costs
+ * one strided extraction and a width * height * 4 byte texture update, colormap and range changes upload nothing
+ * but the lut or a uniform.
+ */
+class slice_plane : public view_component {
+  public:
+    slice_plane();
+    ~slice_plane() override;
+
+    slice_plane(const slice_plane &)             = delete;
+    slice_plane & operator=(const slice_plane &) = delete;
+
+    // the volume is not owned and must outlive the plane; call mark_dirty() after modifying its contents
+    void set_volume(const velm_DR::ndarray<float, 3> * source);
+    void set_axis_slice(std::size_t slice_axis, std::size_t slice_index);
+    // texel (x, y) of the slice samples corner + x * step_u + y * step_v, in index space
+    void set_oblique_slice(const glm::vec3 & corner,
+                           const glm::vec3 & step_u,
+                           const glm::vec3 & step_v,
+                           std::size_t       texels_u,
+                           std::size_t       texels_v);
+    void mark_dirty() { data_dirty = true; }
+
+    // values in [lo, hi] span the colormap, everything else clamps to its ends
+    void set_value_range(float lo, float hi);
+    // packed 0xAABBGGRR colors, resampled to 256 entries
+    void set_colormap(std::span<const std::uint32_t> colors);
+    // maps volume index space to world space
+    void set_transform(const glm::mat4x4 & index_to_world) {
+        transform      = index_to_world;
+        uniforms_dirty = true;
+    }
+    // overrides the library's vs_slice / fs_slice program, BGFX_INVALID_HANDLE goes back to it
+    void set_program(bgfx::ProgramHandle handle) {
+        program        = handle;
+        uniforms_dirty = true;
+    }
+
+    void prepare() override;
+    void submit(bgfx::Encoder & encoder, bgfx::ViewId view_id) override;
+
+    [[nodiscard]] bool needs_redraw() const override {
+        return uniforms_dirty || (volume != nullptr && (data_dirty || geometry_dirty || lut_dirty));
+    }
+
+    // size of the slice texture upload done by the last prepare(), 0 if nothing changed
+    [[nodiscard]] std::size_t last_upload_bytes() const { return upload_bytes; }
+
+  private:
+    const velm_DR::ndarray<float, 3> * volume = nullptr;
+
+    bool        oblique = false;
+    std::size_t axis    = 2;
+    std::size_t index   = 0;
+    glm::vec3   origin{ 0.0f };
+    glm::vec3   u{ 1.0f, 0.0f, 0.0f };
+    glm::vec3   v{ 0.0f, 1.0f, 0.0f };
+    std::size_t width   = 0;
+    std::size_t height  = 0;
+
+    glm::mat4x4                transform{ 1.0f };
+    glm::vec4                  range{ 0.0f, 1.0f, 0.0f, 0.0f };  // lo, 1 / (hi - lo)
+    std::vector<float>         staging;
+    std::vector<std::uint32_t> lut;
+    bool                       data_dirty     = true;
+    bool                       geometry_dirty = true;
+    bool                       lut_dirty      = true;
+    bool                       uniforms_dirty = true;  // transform, range, program or volume, nothing to upload
+    std::size_t                upload_bytes   = 0;
+
+    bgfx::ProgramHandle             program        = BGFX_INVALID_HANDLE;
+    bgfx::ProgramHandle             draw_program   = BGFX_INVALID_HANDLE;  // program or the default, from prepare()
+    bgfx::TextureHandle             slice_texture  = BGFX_INVALID_HANDLE;
+    bgfx::TextureHandle             lut_texture    = BGFX_INVALID_HANDLE;
+    bgfx::DynamicVertexBufferHandle quad           = BGFX_INVALID_HANDLE;
+    bgfx::UniformHandle             slice_sampler  = BGFX_INVALID_HANDLE;
+    bgfx::UniformHandle             lut_sampler    = BGFX_INVALID_HANDLE;
+    bgfx::UniformHandle             range_uniform  = BGFX_INVALID_HANDLE;
+    std::uint16_t                   texture_width  = 0;
+    std::uint16_t                   texture_height = 0;
+    velm::memory_charge             slice_memory{ velm::memory_category::GPU_TEXTURES };
+    velm::memory_charge             lut_memory{ velm::memory_category::GPU_TEXTURES };
+
+    void upload_slice();
+    void upload_quad();
+    void upload_lut();
+};
+}  // namespace velm_render
@@ -0,0 +1,413 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace velm {
+class hdf5_file;
+}
+
+namespace velm_DR {
+
+/*
+ * Sparse 3D grid for fields that are mostly one background value (masks, shock fronts): a hash map of internal
+ * nodes, each covering 128^3 voxels as 16^3 slots for leaves of 8^3 voxels. Only leaves holding an active voxel are
+ * allocated and a voxel without a leaf reads the background. Indices are signed, anywhere in the int32 range.
+ */
+template <typename T> class sparse_grid {
+  public:
+    static constexpr int leaf_edge = 8;
+    static constexpr int leaf_size = leaf_edge * leaf_edge * leaf_edge;
+    static constexpr int node_edge = 16;  // in leaves
+    static constexpr int node_size = node_edge * node_edge * node_edge;
+
+    struct leaf_node {
+        std::int32_t  origin[3];  // first voxel, multiples of leaf_edge
+        std::uint64_t active[leaf_size / 64] = {};
+        T             values[leaf_size];  // inactive voxels hold the background
+
+        // position of voxel (i, j, k) in values, row-major inside the leaf
+        static int index(std::int32_t i, std::int32_t j, std::int32_t k) {
+            return (i & 7) << 6 | (j & 7) << 3 | (k & 7);
+        }
+
+        [[nodiscard]] bool is_active(int n) const { return active[n >> 6] >> (n & 63) & 1; }
+
+        [[nodiscard]] std::size_t active_count() const {
+            std::size_t count = 0;
+            for (std::uint64_t word : active) {
+                count += std::popcount(word);
+            }
+            return count;
+        }
+    };
+
+    // read access caching the last leaf, so runs of nearby lookups skip the hash map; not shared between threads
+    class accessor {
+      public:
+        explicit accessor(const sparse_grid & grid) : owner(&grid) {}
+
+        [[nodiscard]] const T & get(std::int32_t i, std::int32_t j, std::int32_t k) {
+            const leaf_node * found = find(i, j, k);
+            return found ? found->values[leaf_node::index(i, j, k)] : owner->background_value;
+        }
+
+        [[nodiscard]] bool is_active(std::int32_t i, std::int32_t j, std::int32_t k) {
+            const leaf_node * found = find(i, j, k);
+            return found && found->is_active(leaf_node::index(i, j, k));
+        }
+
+      private:
+        const leaf_node * find(std::int32_t i, std::int32_t j, std::int32_t k) {
+            if (!cached || (i & -leaf_edge) != origin[0] || (j & -leaf_edge) != origin[1] ||
+                (k & -leaf_edge) != origin[2]) {
+                origin[0] = i & -leaf_edge;
+                origin[1] = j & -leaf_edge;
+                origin[2] = k & -leaf_edge;
+                leaf      = owner->find_leaf(i, j, k);
+                cached    = true;
+            }
+            return leaf;
+        }
+
+        const sparse_grid * owner;
+        const leaf_node *   leaf      = nullptr;
+        std::int32_t        origin[3] = {};
+        bool                cached    = false;
+    };
+
+    explicit sparse_grid(T background = T{}) : background_value(background) {}
+
+    // leaves are owned through unique_ptr, copies would be deep and are never needed
+    sparse_grid(const sparse_grid &)             = delete;
+    sparse_grid & operator=(const sparse_grid &) = delete;
+    sparse_grid(sparse_grid &&) noexcept         = default;
+    sparse_grid & operator=(sparse_grid &&)      = default;
+
+    [[nodiscard]] T background() const { return background_value; }
+
+    [[nodiscard]] const T & get(std::int32_t i, std::int32_t j, std::int32_t k) const {
+        const leaf_node * leaf = find_leaf(i, j, k);
+        return leaf ? leaf->values[leaf_node::index(i, j, k)] : background_value;
+    }
+
+    [[nodiscard]] bool is_active(std::int32_t i, std::int32_t j, std::int32_t k) const {
+        const leaf_node * leaf = find_leaf(i, j, k);
+        return leaf && leaf->is_active(leaf_node::index(i, j, k));
+    }
+
+    // stores the value and marks the voxel active, allocating its leaf if needed
+    void set(std::int32_t i, std::int32_t j, std::int32_t k, T value) {
+        leaf_node * leaf = touch_leaf(i, j, k);
+        int         n    = leaf_node::index(i, j, k);
+        leaf->values[n]  = value;
+        leaf->active[n >> 6] |= std::uint64_t(1) << (n & 63);
+    }
+
+    // back to the background value; the leaf stays allocated
+    void deactivate(std::int32_t i, std::int32_t j, std::int32_t k) {
+        auto node = nodes.find(key_of(i, j, k));
+        if (node == nodes.end()) {
+            return;
+        }
+        leaf_node * leaf = node->second->children[child_index(i, j, k)].get();
+        if (leaf) {
+            int n           = leaf_node::index(i, j, k);
+            leaf->values[n] = background_value;
+            leaf->active[n >> 6] &= ~(std::uint64_t(1) << (n & 63));
+        }
+    }
+
+    [[nodiscard]] const leaf_node * find_leaf(std::int32_t i, std::int32_t j, std::int32_t k) const {
+        auto node = nodes.find(key_of(i, j, k));
+        return node == nodes.end() ? nullptr : node->second->children[child_index(i, j, k)].get();
+    }
+
+    [[nodiscard]] std::size_t leaf_count() const {
+        std::size_t count = 0;
+        for (const auto & [key, node] : nodes) {
+            count += node->leaf_count;
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::size_t active_count() const {
+        std::size_t count = 0;
+        for (const leaf_node * leaf : leaves()) {
+            count += leaf->active_count();
+        }
+        return count;
+    }
+
+    // bytes held by nodes and leaves, hash map overhead not included
+    [[nodiscard]] std::size_t memory_bytes() const {
+        return nodes.size() * sizeof(internal_node) + leaf_count() * sizeof(leaf_node);
+    }
+
+    // all leaves ordered by origin (dim 0 first), so iteration does not depend on hashing
+    [[nodiscard]] std::vector<const leaf_node *> leaves() const {
+        std::vector<const leaf_node *> result;
+        for (const auto & [key, node] : nodes) {
+            for (const std::unique_ptr<leaf_node> & child : node->children) {
+                if (child) {
+                    result.push_back(child.get());
+                }
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const leaf_node * a, const leaf_node * b) {
+            return std::lexicographical_compare(a->origin, a->origin + 3, b->origin, b->origin + 3);
+        });
+        return result;
+    }
+
+    // f(i, j, k, value) for every active voxel, leaf by leaf in origin order
+    template <typename Fn> void for_each_active(Fn && f) const {
+        for (const leaf_node * leaf : leaves()) {
+            for (int n = 0; n < leaf_size; ++n) {
+                if (leaf->is_active(n)) {
+                    f(leaf->origin[0] + (n >> 6), leaf->origin[1] + (n >> 3 & 7), leaf->origin[2] + (n & 7),
+                      leaf->values[n]);
+                }
+            }
+        }
+    }
+
+    // f(leaf) for every leaf, in parallel on the job system
+    template <typename Fn>
+    void for_each_leaf(Fn && f, velm::job_system & jobs = velm::job_system::global()) const {
+        std::vector<const leaf_node *> all = leaves();
+        velm::parallel_for(
+            0, all.size(), 1,
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t l = first; l < last; ++l) {
+                    f(*all[l]);
+                }
+            },
+            jobs);
+    }
+
+    /*
+     * Activates the voxels of a dense block placed at origin that differ from the background by more than
+     * tolerance; voxels within tolerance leave the grid unchanged. Leaves are built in parallel and only linked
+     * into the tree afterwards.
+     */
+    void insert_dense(const ndarray<T, 3> & dense,
+                      const std::int32_t (&origin)[3],
+                      T                     tolerance = T{},
+                      velm::job_system &    jobs      = velm::job_system::global()) {
+        if (dense.total_elements() == 0) {
+            return;
+        }
+        std::int32_t first[3];
+        std::size_t  blocks[3];
+        for (int a = 0; a < 3; ++a) {
+            first[a]  = origin[a] & -leaf_edge;
+            std::int32_t last = (origin[a] + std::int32_t(dense.dims[a]) - 1) & -leaf_edge;
+            blocks[a]         = std::size_t(last - first[a]) / leaf_edge + 1;
+        }
+
+        std::vector<std::unique_ptr<leaf_node>> built(blocks[0] * blocks[1] * blocks[2]);
+        velm::parallel_for(
+            0, built.size(), 1,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t b = begin; b < end; ++b) {
+                    std::int32_t leaf_origin[3] = { first[0] + std::int32_t(b / (blocks[1] * blocks[2])) * leaf_edge,
+                                                    first[1] + std::int32_t(b / blocks[2] % blocks[1]) * leaf_edge,
+                                                    first[2] + std::int32_t(b % blocks[2]) * leaf_edge };
+                    built[b] = build_leaf(dense, origin, leaf_origin, tolerance);
+                }
+            },
+            jobs);
+
+        for (std::unique_ptr<leaf_node> & leaf : built) {
+            if (leaf) {
+                link_leaf(std::move(leaf));
+            }
+        }
+    }
+
+    [[nodiscard]] static sparse_grid from_dense(const ndarray<T, 3> & dense,
+                                                T                     background = T{},
+                                                T                     tolerance  = T{},
+                                                velm::job_system &    jobs       = velm::job_system::global()) {
+        sparse_grid        result(background);
+        const std::int32_t origin[3] = { 0, 0, 0 };
+        result.insert_dense(dense, origin, tolerance, jobs);
+        return result;
+    }
+
+    // the box [0, out.dims) of the grid, background where no leaf is allocated
+    void to_dense(ndarray<T, 3> & out, velm::job_system & jobs = velm::job_system::global()) const {
+        out.fill(background_value);
+        for_each_leaf(
+            [&](const leaf_node & leaf) {
+                for (int n = 0; n < leaf_size; ++n) {
+                    std::int64_t p[3] = { leaf.origin[0] + (n >> 6), leaf.origin[1] + (n >> 3 & 7),
+                                          leaf.origin[2] + (n & 7) };
+                    if (p[0] >= 0 && p[1] >= 0 && p[2] >= 0 && p[0] < std::int64_t(out.dims[0]) &&
+                        p[1] < std::int64_t(out.dims[1]) && p[2] < std::int64_t(out.dims[2])) {
+                        out(std::size_t(p[0]), std::size_t(p[1]), std::size_t(p[2])) = leaf.values[n];
+                    }
+                }
+            },
+            jobs);
+    }
+
+  private:
+    struct internal_node {
+        std::unique_ptr<leaf_node> children[node_size];
+        std::size_t                leaf_count = 0;
+    };
+
+    struct node_key {
+        std::int32_t x, y, z;
+
+        bool operator==(const node_key &) const = default;
+    };
+
+    struct node_key_hash {
+        std::size_t operator()(const node_key & key) const {
+            return std::size_t(std::uint32_t(key.x)) * 73856093u ^ std::size_t(std::uint32_t(key.y)) * 19349663u ^
+                   std::size_t(std::uint32_t(key.z)) * 83492791u;
+        }
+    };
+
+    static node_key key_of(std::int32_t i, std::int32_t j, std::int32_t k) { return { i >> 7, j >> 7, k >> 7 }; }
+
+    static int child_index(std::int32_t i, std::int32_t j, std::int32_t k) {
+        return (i >> 3 & 15) << 8 | (j >> 3 & 15) << 4 | (k >> 3 & 15);
+    }
+
+    std::unique_ptr<leaf_node> make_leaf(const std::int32_t (&origin)[3]) const {
+        auto leaf = std::make_unique<leaf_node>();
+        std::copy(origin, origin + 3, leaf->origin);
+        std::fill(leaf->values, leaf->values + leaf_size, background_value);
+        return leaf;
+    }
+
+    leaf_node * touch_leaf(std::int32_t i, std::int32_t j, std::int32_t k) {
+        std::unique_ptr<internal_node> & node = nodes[key_of(i, j, k)];
+        if (!node) {
+            node = std::make_unique<internal_node>();
+        }
+        std::unique_ptr<leaf_node> & child = node->children[child_index(i, j, k)];
+        if (!child) {
+            const std::int32_t origin[3] = { i & -leaf_edge, j & -leaf_edge, k & -leaf_edge };
+            child                        = make_leaf(origin);
+            ++node->leaf_count;
+        }
+        return child.get();
+    }
+
+    // leaf for the part of dense (placed at dense_origin) inside the leaf at leaf_origin, null without active voxels
+    std::unique_ptr<leaf_node> build_leaf(const ndarray<T, 3> & dense,
+                                          const std::int32_t (&dense_origin)[3],
+                                          const std::int32_t (&leaf_origin)[3],
+                                          T tolerance) const {
+        std::int32_t lo[3];
+        std::int32_t hi[3];
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::max(leaf_origin[a], dense_origin[a]);
+            hi[a] = std::min(leaf_origin[a] + leaf_edge, dense_origin[a] + std::int32_t(dense.dims[a]));
+        }
+        std::unique_ptr<leaf_node> leaf;
+        for (std::int32_t i = lo[0]; i < hi[0]; ++i) {
+            for (std::int32_t j = lo[1]; j < hi[1]; ++j) {
+                const T * row = &dense(std::size_t(i - dense_origin[0]), std::size_t(j - dense_origin[1]), 0);
+                for (std::int32_t k = lo[2]; k < hi[2]; ++k) {
+                    T value = row[k - dense_origin[2]];
+                    // written so unsigned types do not wrap
+                    T difference = value < background_value ? background_value - value : value - background_value;
+                    if (difference > tolerance) {
+                        if (!leaf) {
+                            leaf = make_leaf(leaf_origin);
+                        }
+                        int n           = leaf_node::index(i, j, k);
+                        leaf->values[n] = value;
+                        leaf->active[n >> 6] |= std::uint64_t(1) << (n & 63);
+                    }
+                }
+            }
+        }
+        return leaf;
+    }
+
+    // takes over a built leaf, or copies its active voxels into the leaf already at its place
+    void link_leaf(std::unique_ptr<leaf_node> leaf) {
+        const std::int32_t *             o    = leaf->origin;
+        std::unique_ptr<internal_node> & node = nodes[key_of(o[0], o[1], o[2])];
+        if (!node) {
+            node = std::make_unique<internal_node>();
+        }
+        std::unique_ptr<leaf_node> & child = node->children[child_index(o[0], o[1], o[2])];
+        if (!child) {
+            child = std::move(leaf);
+            ++node->leaf_count;
+            return;
+        }
+        for (int n = 0; n < leaf_size; ++n) {
+            if (leaf->is_active(n)) {
+                child->values[n] = leaf->values[n];
+                child->active[n >> 6] |= std::uint64_t(1) << (n & 63);
+            }
+        }
+    }
+
+    T                                                                           background_value;
+    std::unordered_map<node_key, std::unique_ptr<internal_node>, node_key_hash> nodes;
+};
+
+/*
+ * fold(accumulator, value) over the active voxels, one accumulator per leaf starting from identity and computed in
+ * parallel; merge(a, b) then combines them in leaf order, so floating point results do not depend on scheduling.
+ */
+template <typename T, typename Acc, typename Fold, typename Merge>
+[[nodiscard]] Acc reduce_active(const sparse_grid<T> & grid,
+                                Acc                    identity,
+                                Fold                   fold,
+                                Merge                  merge,
+                                velm::job_system &     jobs = velm::job_system::global()) {
+    using leaf_node = typename sparse_grid<T>::leaf_node;
+
+    std::vector<const leaf_node *> all = grid.leaves();
+    std::vector<Acc>               part(all.size(), identity);
+    velm::parallel_for(
+        0, all.size(), 1,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t l = first; l < last; ++l) {
+                for (int n = 0; n < sparse_grid<T>::leaf_size; ++n) {
+                    if (all[l]->is_active(n)) {
+                        part[l] = fold(part[l], all[l]->values[n]);
+                    }
+                }
+            }
+        },
+        jobs);
+    Acc result = identity;
+    for (const Acc & p : part) {
+        result = merge(result, p);
+    }
+    return result;
+}
+
+#ifdef VELM_ENABLE_HDF5
+/*
+ * Reads a 3D dataset slab by slab of hyperslabs (whole leaves and whole chunks along dim 0, at least slab_planes
+ * planes), so the dense field is never resident. Voxels within tolerance of the background stay inactive.
+ */
+[[nodiscard]] sparse_grid<float> load_sparse_grid(const velm::hdf5_file & file,
+                                                  std::string_view        dataset,
+                                                  float                   background  = 0.0f,
+                                                  float                   tolerance   = 0.0f,
+                                                  std::size_t             slab_planes = 64,
+                                                  velm::job_system &      jobs        = velm::job_system::global());
+#endif
+}  // namespace velm_DR
@@ -0,0 +1,199 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/ndarray.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <vector>
+
+#ifdef __AVX__
+#    include <immintrin.h>
+#endif
+
+namespace velm_dr {
+
+struct stencil_options {
+    // distance between samples along dims 0, 1 and 2
+    glm::vec3 spacing{ 1.0f };
+    // the volume is processed in tiles of tile_rows x tile_width samples of dims 1 and 2, each swept along dim 0, so
+    // the three planes a tile reads from stay in cache
+    std::size_t tile_rows  = 16;
+    std::size_t tile_width = 1024;
+    // dim 0 planes that fused operators (derive, then consume) keep at once instead of a whole derived volume
+    std::size_t slab_planes = 8;
+};
+
+// first derivatives of F fields along one row segment, d[f][axis][k] for the k-th sample of the segment
+template <std::size_t F> struct gradient_rows {
+    const float * d[F][3];
+};
+
+namespace detail {
+
+// neighbours of index i along an axis of length n and the weight turning their difference into a derivative
+struct stencil {
+    std::size_t lo;
+    std::size_t hi;
+    float       weight;
+};
+
+inline stencil stencil_at(std::size_t i, std::size_t n, float spacing) {
+    stencil s{ i > 0 ? i - 1 : i, i + 1 < n ? i + 1 : i, 0.0f };
+    if (s.hi > s.lo) {
+        s.weight = 1.0f / (float(s.hi - s.lo) * spacing);
+    }
+    return s;
+}
+
+// the rows a row of derivatives reads from
+struct row_input {
+    const float * center;
+    const float * x_lo;
+    const float * x_hi;
+    const float * y_lo;
+    const float * y_hi;
+    float         wx;
+    float         wy;
+};
+
+// derivatives of one row segment [k0, k1) into gx, gy, gz (indexed from k0)
+inline void differentiate_row(const row_input & row,
+                              std::size_t       k0,
+                              std::size_t       k1,
+                              std::size_t       n,
+                              float             spacing,
+                              float *           gx,
+                              float *           gy,
+                              float *           gz) {
+    // derivatives across rows are the same for every k
+    auto across = [&](std::size_t k) {
+        gx[k - k0] = (row.x_hi[k] - row.x_lo[k]) * row.wx;
+        gy[k - k0] = (row.y_hi[k] - row.y_lo[k]) * row.wy;
+    };
+    auto along_face = [&](std::size_t k) {
+        stencil s  = stencil_at(k, n, spacing);
+        gz[k - k0] = (row.center[s.hi] - row.center[s.lo]) * s.weight;
+        across(k);
+    };
+
+    // peel the faces of the row, everything in between has both neighbours
+    std::size_t begin = std::max<std::size_t>(k0, 1);
+    std::size_t end   = std::min(k1, n > 0 ? n - 1 : 0);
+    if (k0 == 0) {
+        along_face(0);
+    }
+    if (k1 == n && n > 1) {
+        along_face(n - 1);
+    }
+    if (begin >= end) {
+        return;
+    }
+
+    const float   wz = 0.5f / spacing;
+    std::size_t   k  = begin;
+    const float * c  = row.center;
+#ifdef __AVX__
+    __m256 vx = _mm256_set1_ps(row.wx);
+    __m256 vy = _mm256_set1_ps(row.wy);
+    __m256 vz = _mm256_set1_ps(wz);
+    for (; k + 8 <= end; k += 8) {
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(c + k + 1), _mm256_loadu_ps(c + k - 1));
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(row.y_hi + k), _mm256_loadu_ps(row.y_lo + k));
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(row.x_hi + k), _mm256_loadu_ps(row.x_lo + k));
+        _mm256_storeu_ps(gz + (k - k0), _mm256_mul_ps(dz, vz));
+        _mm256_storeu_ps(gy + (k - k0), _mm256_mul_ps(dy, vy));
+        _mm256_storeu_ps(gx + (k - k0), _mm256_mul_ps(dx, vx));
+    }
+#endif
+    for (; k < end; ++k) {
+        gz[k - k0] = (c[k + 1] - c[k - 1]) * wz;
+        gx[k - k0] = (row.x_hi[k] - row.x_lo[k]) * row.wx;
+        gy[k - k0] = (row.y_hi[k] - row.y_lo[k]) * row.wy;
+    }
+}
+
+}  // namespace detail
+
+/*
+ * The stencil engine shared by the derivative based operators: central differences inside the volume, one-sided
+ * differences on its faces, zero along axes of size 1, for F fields of equal dims at once.
+ *
+ * Sweeps every tile over dim 0 planes [first_plane, last_plane) and hands each differentiated row segment to
+ * sink(offset of the first sample, count, const gradient_rows<F> &). Neighbour rows and weights are picked once per
+ * row and the faces of the row are peeled off, so the inner loop is a branch free stream over contiguous memory
+ * (explicit AVX when compiled with it). Tiles run in parallel on the job system, sink must be safe to call from
+ * several threads for disjoint segments.
+ */
+template <std::size_t F, typename Sink>
+void for_each_gradient_row(const std::array<const velm_DR::ndarray<float, 3> *, F> & fields,
+                           std::size_t                                              first_plane,
+                           std::size_t                                              last_plane,
+                           const stencil_options &                                  options,
+                           velm::job_system &                                       jobs,
+                           Sink &&                                                  sink) {
+    const velm_DR::ndarray<float, 3> & shape = *fields[0];
+    for (const velm_DR::ndarray<float, 3> * field : fields) {
+        if (field->dims[0] != shape.dims[0] || field->dims[1] != shape.dims[1] || field->dims[2] != shape.dims[2]) {
+            abort();
+        }
+    }
+    const std::size_t n0 = shape.dims[0];
+    const std::size_t n1 = shape.dims[1];
+    const std::size_t n2 = shape.dims[2];
+    last_plane           = std::min(last_plane, n0);
+    if (first_plane >= last_plane || n1 == 0 || n2 == 0) {
+        return;
+    }
+
+    const std::size_t rows       = std::max<std::size_t>(options.tile_rows, 1);
+    const std::size_t width      = std::max<std::size_t>(options.tile_width, 8);
+    const std::size_t tiles_row  = (n1 + rows - 1) / rows;
+    const std::size_t tiles_wide = (n2 + width - 1) / width;
+    const std::size_t s0         = shape.strides[0];
+    const std::size_t s1         = shape.strides[1];
+
+    velm::parallel_for(
+        0, tiles_row * tiles_wide, 1,
+        [&](std::size_t first, std::size_t last) {
+            std::vector<float> scratch(F * 3 * width);
+            gradient_rows<F>   out;
+            for (std::size_t f = 0; f < F; ++f) {
+                for (std::size_t a = 0; a < 3; ++a) {
+                    out.d[f][a] = scratch.data() + (3 * f + a) * width;
+                }
+            }
+
+            for (std::size_t tile = first; tile < last; ++tile) {
+                std::size_t j0 = tile / tiles_wide * rows;
+                std::size_t j1 = std::min(n1, j0 + rows);
+                std::size_t k0 = tile % tiles_wide * width;
+                std::size_t k1 = std::min(n2, k0 + width);
+
+                for (std::size_t i = first_plane; i < last_plane; ++i) {
+                    detail::stencil sx = detail::stencil_at(i, n0, options.spacing.x);
+                    for (std::size_t j = j0; j < j1; ++j) {
+                        detail::stencil sy     = detail::stencil_at(j, n1, options.spacing.y);
+                        std::size_t     offset = i * s0 + j * s1;
+                        for (std::size_t f = 0; f < F; ++f) {
+                            const float *     base = fields[f]->data;
+                            detail::row_input row{ base + offset,
+                                                   base + sx.lo * s0 + j * s1,
+                                                   base + sx.hi * s0 + j * s1,
+                                                   base + i * s0 + sy.lo * s1,
+                                                   base + i * s0 + sy.hi * s1,
+                                                   sx.weight,
+                                                   sy.weight };
+                            float *           g = scratch.data() + 3 * f * width;
+                            detail::differentiate_row(row, k0, k1, n2, options.spacing.z, g, g + width, g + 2 * width);
+                        }
+                        sink(offset + k0, k1 - k0, out);
+                    }
+                }
+            }
+        },
+        jobs);
+}
+}  // namespace velm_dr
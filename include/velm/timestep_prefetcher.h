@@ -0,0 +1,109 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/memory_budget.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace velm {
+
+/*
+ * Loads the steps of a time series ahead of their use on the job system. get(n) returns step n (helping with
+ * pending jobs while it is not ready) and queues the loads of steps n + 1 .. n + lookahead, so reading the next
+ * step overlaps with processing the current one. Steps before n - 1 are dropped from the cache; returned pointers
+ * keep their data alive on their own.
+ *
+ * get() is meant to be called from one driving thread. When the memory budget runs out the next get() keeps only
+ * the requested step and skips its lookahead.
+ */
+template <typename T> class timestep_prefetcher {
+  public:
+    using loader = std::function<T(std::size_t step)>;
+
+    timestep_prefetcher(std::size_t  step_count,
+                        loader       load,
+                        std::size_t  lookahead = 1,
+                        job_system & jobs      = job_system::global()) :
+        count(step_count), load_step(std::move(load)), ahead(lookahead), jobs_(jobs) {
+        // the cache belongs to the driving thread, so eviction only asks it to trim itself
+        evictor_id = memory_budget::global().add_evictor("timestep prefetch", [this](std::size_t) {
+            over_budget.store(true, std::memory_order_relaxed);
+            return std::size_t(0);
+        });
+    }
+
+    ~timestep_prefetcher() {
+        memory_budget::global().remove_evictor(evictor_id);
+        while (in_flight.load(std::memory_order_acquire) != 0) {
+            if (!jobs_.run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    timestep_prefetcher(const timestep_prefetcher &)             = delete;
+    timestep_prefetcher & operator=(const timestep_prefetcher &) = delete;
+
+    [[nodiscard]] std::shared_ptr<const T> get(std::size_t step) {
+        bool trim = over_budget.exchange(false, std::memory_order_relaxed);
+        for (std::size_t s = step; s <= (trim ? step : step + ahead) && s < count; ++s) {
+            request(s);
+        }
+        if (trim) {
+            std::erase_if(cache, [step](const auto & entry) { return entry.first != step; });
+        }
+        while (!cache.empty() && cache.begin()->first + 1 < step) {
+            cache.erase(cache.begin());
+        }
+
+        const std::shared_ptr<slot> & wanted = cache.at(step);
+        while (!wanted->ready.load(std::memory_order_acquire)) {
+            if (!jobs_.run_one()) {
+                std::this_thread::yield();
+            }
+        }
+        return wanted->value;
+    }
+
+    [[nodiscard]] std::size_t step_count() const { return count; }
+
+    // number of loads started so far, for tests and statistics
+    [[nodiscard]] std::size_t loads() const { return started; }
+
+  private:
+    struct slot {
+        std::atomic<bool>        ready{ false };
+        std::shared_ptr<const T> value;
+    };
+
+    std::size_t                                  count;
+    loader                                       load_step;
+    std::size_t                                  ahead;
+    job_system &                                 jobs_;
+    std::map<std::size_t, std::shared_ptr<slot>> cache;
+    std::atomic<std::size_t>                     in_flight{ 0 };
+    std::size_t                                  started = 0;
+    std::atomic<bool>                            over_budget{ false };
+    std::size_t                                  evictor_id = 0;
+
+    void request(std::size_t step) {
+        if (cache.contains(step)) {
+            return;
+        }
+        auto target = std::make_shared<slot>();
+        cache.emplace(step, target);
+        ++started;
+        in_flight.fetch_add(1, std::memory_order_relaxed);
+        jobs_.submit([this, target, step] {
+            target->value = std::make_shared<const T>(load_step(step));
+            target->ready.store(true, std::memory_order_release);
+            in_flight.fetch_sub(1, std::memory_order_release);
+        });
+    }
+};
+}  // namespace velm
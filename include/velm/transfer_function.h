@@ -0,0 +1,102 @@
+#pragma once
+#include "velm/job_system.h"
+#include "velm/memory_budget.h"
+
+#include <bgfx/bgfx.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace velm_render {
+
+// rgb color and extinction (opacity per unit of ray length) at a normalized scalar value in [0, 1]
+struct tf_point {
+    float     value = 0.0f;
+    glm::vec4 rgba{ 0.0f };
+};
+
+/*
+ * Transfer function given by control points, linearly interpolated and clamped to the outermost points, with its
+ * pre-integrated table: entry (front, back) holds the premultiplied color and opacity of a ray segment of length
+ * step() along which the normalized scalar goes linearly from front to back. Rays sampling the table instead of the
+ * 1D classification keep thin features at large step sizes without banding.
+ *
+ * The table is built from prefix integrals of extinction and extinction weighted color, so an edit of the scalar
+ * range [a, b] only changes segments that cross it; update() recomputes those rows on the job system and upload()
+ * sends just the changed rectangles.
+ */
+class transfer_function {
+  public:
+    // resolution entries along each table axis, at least 2 and small enough for a 16 bit texture row pitch
+    explicit transfer_function(std::size_t resolution = 256);
+    ~transfer_function();
+
+    transfer_function(const transfer_function &)             = delete;
+    transfer_function & operator=(const transfer_function &) = delete;
+
+    // points sorted by value; marks the whole table
+    void set_points(std::span<const tf_point> points);
+    // replaces points [first, first + points.size()), which must stay between their unchanged neighbours
+    void edit_points(std::size_t first, std::span<const tf_point> points);
+    // ray step in the length unit of the extinction values; marks the whole table
+    void set_step(float length);
+
+    [[nodiscard]] std::span<const tf_point> points() const { return points_; }
+
+    [[nodiscard]] float step() const { return step_; }
+
+    [[nodiscard]] std::size_t resolution() const { return size; }
+
+    // recomputes the entries marked since the last update, returns how many that were
+    std::size_t update(velm::job_system & jobs = velm::job_system::global());
+
+    // control point interpolation without pre-integration
+    [[nodiscard]] glm::vec4 classify(float value) const;
+    // nearest table entry, valid after update()
+    [[nodiscard]] glm::vec4 lookup(float front, float back) const;
+
+    // row front, column back
+    [[nodiscard]] std::span<const glm::vec4> table() const { return table_; }
+
+    // api thread: creates the RGBA32F texture (x back, y front) or updates the part changed since the last upload,
+    // running a pending update() first
+    void upload(std::uint64_t flags = BGFX_SAMPLER_UVW_CLAMP);
+
+    [[nodiscard]] bgfx::TextureHandle texture() const { return texture_; }
+
+    // bytes sent by the last upload(), 0 if nothing changed
+    [[nodiscard]] std::size_t last_upload_bytes() const { return upload_bytes; }
+
+  private:
+    // entries [lo, hi] of the 1D sampling, empty when lo > hi
+    struct entry_range {
+        std::size_t lo = 1;
+        std::size_t hi = 0;
+
+        [[nodiscard]] bool empty() const { return lo > hi; }
+
+        void merge(const entry_range & other);
+    };
+
+    std::size_t                        size;
+    std::vector<tf_point>              points_;
+    float                              step_ = 1.0f;
+    std::vector<glm::vec4>             samples;  // classification at value i / (size - 1)
+    // prefix integrals over the samples of extinction and of extinction weighted r, g, b
+    std::vector<std::array<double, 4>> integrals;
+    std::vector<glm::vec4>             table_;
+    entry_range                        compute_range;
+    entry_range                        upload_range;
+    bgfx::TextureHandle                texture_     = BGFX_INVALID_HANDLE;
+    velm::memory_charge                texture_memory{ velm::memory_category::GPU_TEXTURES };
+    std::size_t                        upload_bytes = 0;
+
+    // the 1D samples between two values changed
+    void      mark(float lo, float hi);
+    glm::vec4 integrate(std::size_t front, std::size_t back) const;
+};
+}  // namespace velm_render
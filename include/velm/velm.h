@@ -1,18 +1,88 @@
 #pragma once
 
+#include "velm/frame_governor.h"
+#include "velm/job_system.h"
 #include "velm/scene.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace velm {
+
+enum class render_mode : std::uint8_t {
+    CONTINUOUS,  // a frame per loop iteration
+    ON_DEMAND,   // frames only when a scene, view or component changed or a redraw was requested
+};
+
+/*
+ * The thread that calls run() owns the window and becomes the bgfx render thread; bgfx is initialized on a
+ * separate api thread that runs the per-frame update and records every view of every live scene in parallel, each
+ * job on its own bgfx::Encoder.
+ *
+ * In ON_DEMAND mode the api thread sleeps while nothing changes; input events, resizes and request_redraw() wake it
+ * to run update once more. Frames drawn while things move go through the frame governor, which lowers quality to
+ * hold its target frame time, and are followed by refinement frames until full quality is reached again.
+ */
 class Velm {
   public:
     Velm();
     ~Velm();
 
+    // any thread, also while run() is drawing; the scene is drawn until the last shared_ptr to it goes away
     [[nodiscard]] std::shared_ptr<Scene> create_scene();
+
+    // returns once the window is closed, update runs on the api thread before the views of a frame are recorded
+    void run(const std::function<void(Velm &)> & update = {});
+
+    // api thread: updates all scenes, records their views on the job system and submits the frame
+    void render_frame();
+
+    // any thread; wakes an idle api thread so a switch to CONTINUOUS takes effect right away
+    void set_render_mode(render_mode mode) {
+        mode_ = mode;
+        wake();
+    }
+
+    [[nodiscard]] render_mode get_render_mode() const { return mode_; }
+
+    // any thread: draw at least one more frame, for changes scenes can't see such as volume data edited in place
+    void request_redraw();
+
+    // quality of the frame being prepared; components read it for their step counts and render scale
+    [[nodiscard]] frame_governor & governor() { return governor_; }
+
   private:
+    std::mutex                        scenes_mutex;  // create_scene() may run on any thread
     std::vector<std::weak_ptr<Scene>> scenes;
+
+    void *            window = nullptr;
+    std::uint32_t     width  = 800;
+    std::uint32_t     height = 600;
+    std::thread::id   api_thread;
+    std::atomic<bool> quit{ false };
+    job_system &      jobs = job_system::global();
+
+    std::atomic<render_mode> mode_{ render_mode::ON_DEMAND };
+    frame_governor           governor_;
+    std::atomic<bool>        redraw{ true };
+    std::atomic<bool>        api_idle{ false };
+    std::mutex               wake_mutex;
+    std::condition_variable  wake_cv;
+    bool                     woken = false;
+
+    bool init_bgfx();
+    // the scenes still alive, forgetting the expired ones; dropped is set when there were any
+    std::vector<std::shared_ptr<Scene>> live_scenes(bool & dropped);
+    void                                render_frame(const std::vector<std::shared_ptr<Scene>> & live);
+    // sum of the revisions of the live scenes; sets pending for changes the sum can't show (component updates)
+    std::uint64_t scene_revision(const std::vector<std::shared_ptr<Scene>> & live, bool & pending);
+    void          wake();
+    void          wait_for_wake();
 };
 
 }  // namespace velm
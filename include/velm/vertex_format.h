@@ -0,0 +1,82 @@
+#pragma once
+#include "velm/mesh.h"
+
+#include <bgfx/bgfx.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace velm_render {
+
+struct aabb;
+
+enum class vertex_format : std::uint8_t { FLOAT, PACKED };
+
+// where the optional attributes sit inside a velm_dr::mesh_data vertex, in floats after the position; -1 if absent
+struct vertex_attributes {
+    int   normal_offset = -1;
+    int   scalar_offset = -1;
+    float scalar_min    = 0.0f;
+    float scalar_max    = 1.0f;
+};
+
+/*
+ * 16 byte vertex, decoded by vs_mesh_packed.sc:
+ *   position  int16x4 snorm, xyz relative to the quantization box, w unused
+ *   normal    int16x2 snorm, octahedral encoding
+ *   colormap  uint8x4 unorm, x is the normalized scalar used for the colormap lookup
+ */
+struct packed_vertex {
+    std::int16_t position[4];
+    std::int16_t normal[2];
+    std::uint8_t colormap[4];
+};
+
+static_assert(sizeof(packed_vertex) == 16);
+
+// maps [-1, 1] snorm positions back to object space: p = center + q * scale
+struct quantization {
+    glm::vec3 center{ 0.0f };
+    glm::vec3 scale{ 1.0f };
+
+    [[nodiscard]] static quantization from_bounds(const aabb & bounds);
+    // bounds of the vertex positions
+    [[nodiscard]] static quantization from_vertices(const velm_dr::mesh_data & data);
+
+    [[nodiscard]] glm::vec3 decode(const std::int16_t position[3]) const;
+};
+
+[[nodiscard]] glm::vec2 octahedral_encode(const glm::vec3 & normal);
+[[nodiscard]] glm::vec3 octahedral_decode(const glm::vec2 & encoded);
+
+// float3 position, float3 normal, float1 colormap coordinate, decoded by vs_mesh.sc
+struct float_vertex {
+    float position[3];
+    float normal[3];
+    float colormap;
+};
+
+[[nodiscard]] const bgfx::VertexLayout & float_layout();
+[[nodiscard]] const bgfx::VertexLayout & packed_layout();
+
+// vertex and index data in the layout of one vertex_format, ready for upload (see make_ref)
+struct gpu_geometry {
+    std::vector<std::uint8_t> vertices;
+    std::vector<std::uint8_t> indices;
+    bool                      index32 = false;  // 16 bit indices whenever the vertex count allows it
+
+    [[nodiscard]] std::uint32_t index_count() const {
+        return static_cast<std::uint32_t>(indices.size() / (index32 ? 4 : 2));
+    }
+};
+
+[[nodiscard]] gpu_geometry encode(const velm_dr::mesh_data & data,
+                                  const vertex_attributes &  attributes,
+                                  vertex_format              format,
+                                  const quantization &       box = {});
+
+// uniform holding quantization::center and quantization::scale for vs_mesh_packed.sc, created on first use
+[[nodiscard]] bgfx::UniformHandle dequantize_uniform();
+void                              destroy_vertex_formats();
+}  // namespace velm_render
@@ -0,0 +1,10 @@
+$input v_normal, v_texcoord0
+
+#include "common.sh"
+
+void main()
+{
+    // headlight shading from the view space normal, the colormap coordinate is shown as grey
+    float shade = 0.3 + 0.7 * abs(normalize(v_normal).z);
+    gl_FragColor = vec4(vec3_splat(v_texcoord0.x) * shade, 1.0);
+}
@@ -0,0 +1,17 @@
+$input v_texcoord0
+
+#include "common.sh"
+
+SAMPLER2D(s_slice, 0);
+SAMPLER2D(s_colormap, 1);
+
+// x: lowest value of the colormap range, y: 1 / (highest - lowest)
+uniform vec4 u_sliceRange;
+
+void main()
+{
+    float value = texture2D(s_slice, v_texcoord0).x;
+    float t = clamp( (value - u_sliceRange.x) * u_sliceRange.y, 0.0, 1.0);
+    // sample the centers of the first and last lut texels at the ends of the range
+    gl_FragColor = texture2D(s_colormap, vec2(t * (255.0 / 256.0) + 0.5 / 256.0, 0.5) );
+}
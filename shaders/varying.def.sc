@@ -1,4 +1,9 @@
-vec4 v_color0 : COLOR0;
+vec4 v_color0    : COLOR0;
+vec3 v_normal    : NORMAL;
+vec2 v_texcoord0 : TEXCOORD0;
 
-vec3 a_position : POSITION;
-vec4 a_color0 : COLOR0;
+vec3 a_position  : POSITION;
+vec3 a_normal    : NORMAL;
+vec4 a_color0    : COLOR0;
+vec4 a_texcoord0 : TEXCOORD0;
+vec2 a_texcoord1 : TEXCOORD1;
@@ -0,0 +1,11 @@
+$input a_position, a_normal, a_texcoord0
+$output v_normal, v_texcoord0
+
+#include "common.sh"
+
+void main()
+{
+    gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0) );
+    v_normal = normalize(mul(u_modelView, vec4(a_normal, 0.0) ).xyz);
+    v_texcoord0 = vec2(a_texcoord0.x, 0.5);
+}
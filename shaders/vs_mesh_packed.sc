@@ -0,0 +1,24 @@
+$input a_position, a_texcoord0, a_texcoord1
+$output v_normal, v_texcoord0
+
+#include "common.sh"
+
+// xyz: center of the quantization box, xyz of [1]: half extent
+uniform vec4 u_dequantize[2];
+
+vec3 octahedral_decode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y) );
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = u_dequantize[0].xyz + max(a_position.xyz, vec3_splat(-1.0) ) * u_dequantize[1].xyz;
+    gl_Position = mul(u_modelViewProj, vec4(position, 1.0) );
+    v_normal = normalize(mul(u_modelView, vec4(octahedral_decode(a_texcoord1), 0.0) ).xyz);
+    v_texcoord0 = vec2(a_texcoord0.x, 0.5);
+}
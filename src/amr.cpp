@@ -0,0 +1,344 @@
+#include "velm/amr.h"
+
+#include "velm/memory_budget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef VELM_ENABLE_HDF5
+#    include "velm/hdf5.h"
+
+#    include <map>
+#    include <stdexcept>
+#endif
+
+namespace velm_DR {
+
+namespace {
+
+std::int64_t floor_div(std::int64_t a, std::int64_t b) {
+    return a / b - (a % b != 0 && a < 0);
+}
+
+std::int64_t ceil_div(std::int64_t a, std::int64_t b) {
+    return a / b + (a % b != 0 && a > 0);
+}
+
+// level cell of every sample centre of out along one axis, non-decreasing
+std::vector<std::int64_t> cell_of_samples(std::size_t samples, std::int64_t lo, std::int64_t hi, std::int64_t to_base) {
+    std::vector<std::int64_t> cells(samples);
+    double                    width = double(hi - lo) / double(samples);
+    for (std::size_t s = 0; s < samples; ++s) {
+        cells[s] = std::int64_t(std::floor((double(lo) + (double(s) + 0.5) * width) * double(to_base)));
+    }
+    return cells;
+}
+
+}  // namespace
+
+amr_box amr_box::intersection(const amr_box & other) const {
+    amr_box result;
+    for (int a = 0; a < 3; ++a) {
+        result.lo[a] = std::max(lo[a], other.lo[a]);
+        result.hi[a] = std::min(hi[a], other.hi[a]);
+    }
+    return result;
+}
+
+amr_box amr_box::refined(std::int64_t ratio) const {
+    return { { lo[0] * ratio, lo[1] * ratio, lo[2] * ratio }, { hi[0] * ratio, hi[1] * ratio, hi[2] * ratio } };
+}
+
+amr_box amr_box::coarsened_inner(std::int64_t ratio) const {
+    return { { ceil_div(lo[0], ratio), ceil_div(lo[1], ratio), ceil_div(lo[2], ratio) },
+             { floor_div(hi[0], ratio), floor_div(hi[1], ratio), floor_div(hi[2], ratio) } };
+}
+
+amr_box amr_box::coarsened_outer(std::int64_t ratio) const {
+    return { { floor_div(lo[0], ratio), floor_div(lo[1], ratio), floor_div(lo[2], ratio) },
+             { ceil_div(hi[0], ratio), ceil_div(hi[1], ratio), ceil_div(hi[2], ratio) } };
+}
+
+amr_hierarchy::amr_hierarchy(std::vector<amr_patch>        patches,
+                             std::span<const std::int64_t> ratios,
+                             patch_loader                  loader) :
+    patches_(std::move(patches)), loader_(std::move(loader)), loaded_(patches_.size()), last_use_(patches_.size()) {
+    std::size_t level_count = 0;
+    for (const amr_patch & p : patches_) {
+        level_count = std::max(level_count, p.level + 1);
+    }
+    if (ratios.size() < level_count) {
+        abort();
+    }
+
+    levels_.resize(level_count);
+    for (std::size_t l = 1; l < level_count; ++l) {
+        if (ratios[l] < 1) {
+            abort();
+        }
+        levels_[l].ratio   = ratios[l];
+        levels_[l].to_base = levels_[l - 1].to_base * ratios[l];
+    }
+    for (std::size_t p = 0; p < patches_.size(); ++p) {
+        patches_[p].covered.clear();
+        levels_[patches_[p].level].patches.push_back(p);
+    }
+
+    // coarse cells lying completely under a finer patch
+    for (std::size_t l = 1; l < level_count; ++l) {
+        for (std::size_t fine : levels_[l].patches) {
+            amr_box shadow = patches_[fine].box.coarsened_inner(levels_[l].ratio);
+            for (std::size_t coarse : levels_[l - 1].patches) {
+                amr_box overlap = patches_[coarse].box.intersection(shadow);
+                if (!overlap.empty()) {
+                    patches_[coarse].covered.push_back(overlap);
+                }
+            }
+        }
+    }
+
+    evictor_id_ = velm::memory_budget::global().add_evictor("amr patches",
+                                                            [this](std::size_t bytes) { return evict(bytes); });
+}
+
+amr_hierarchy::~amr_hierarchy() {
+    velm::memory_budget::global().remove_evictor(evictor_id_);
+}
+
+std::size_t amr_hierarchy::evict(std::size_t bytes) {
+    // per the evictor contract: another amr call of the allocating thread may hold the lock, then free nothing
+    std::unique_lock<std::mutex> lock(state_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    std::vector<std::size_t> unused;
+    for (std::size_t p = 0; p < loaded_.size(); ++p) {
+        if (loaded_[p] && loaded_[p].use_count() == 1) {
+            unused.push_back(p);
+        }
+    }
+    std::sort(unused.begin(), unused.end(),
+              [this](std::size_t a, std::size_t b) { return last_use_[a] < last_use_[b]; });
+
+    std::size_t released = 0;
+    for (std::size_t p : unused) {
+        if (released >= bytes) {
+            break;
+        }
+        released += loaded_[p]->total_elements() * sizeof(float);
+        loaded_[p].reset();
+    }
+    return released;
+}
+
+std::size_t amr_hierarchy::level_for_cell_size(float max_cell_size) const {
+    for (std::size_t l = 0; l < levels_.size(); ++l) {
+        if (1.0f / float(levels_[l].to_base) <= max_cell_size) {
+            return l;
+        }
+    }
+    return levels_.empty() ? 0 : levels_.size() - 1;
+}
+
+std::size_t amr_hierarchy::find(const glm::vec3 & position, std::size_t max_level) const {
+    // a linear scan per level, patch counts are small next to the samples they hold
+    for (std::size_t l = std::min(max_level + 1, levels_.size()); l-- > 0;) {
+        auto         to_base = float(levels_[l].to_base);
+        std::int64_t i       = std::int64_t(std::floor(position.x * to_base));
+        std::int64_t j       = std::int64_t(std::floor(position.y * to_base));
+        std::int64_t k       = std::int64_t(std::floor(position.z * to_base));
+        for (std::size_t p : levels_[l].patches) {
+            if (patches_[p].box.contains(i, j, k)) {
+                return p;
+            }
+        }
+    }
+    return npos;
+}
+
+std::vector<std::size_t> amr_hierarchy::select(const amr_box & region, std::size_t max_level) const {
+    std::vector<std::size_t> result;
+    std::size_t              top = std::min(max_level + 1, levels_.size());
+    for (std::size_t l = 0; l < top; ++l) {
+        amr_box area = region.refined(levels_[l].to_base);
+        for (std::size_t p : levels_[l].patches) {
+            amr_box inside = patches_[p].box.intersection(area);
+            if (inside.empty()) {
+                continue;
+            }
+            // covered boxes are disjoint, so comparing cell counts tells whether anything is left uncovered
+            std::int64_t covered = 0;
+            if (l + 1 < top) {
+                for (const amr_box & c : patches_[p].covered) {
+                    covered += c.intersection(inside).cells();
+                }
+            }
+            if (covered < inside.cells()) {
+                result.push_back(p);
+            }
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<const ndarray<float, 3>> amr_hierarchy::data(std::size_t p) {
+    std::lock_guard<std::mutex> load(load_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (loaded_.at(p)) {
+            last_use_[p] = ++use_clock_;
+            return loaded_[p];
+        }
+    }
+    // the allocation may go over the memory budget and run evict(), which takes the state lock
+    const amr_box & box   = patches_[p].box;
+    auto            array = std::make_shared<ndarray<float, 3>>(
+        std::size_t(box.hi[0] - box.lo[0]), std::size_t(box.hi[1] - box.lo[1]), std::size_t(box.hi[2] - box.lo[2]));
+    loader_(patches_[p], *array);
+
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    loaded_[p]   = std::move(array);
+    last_use_[p] = ++use_clock_;
+    return loaded_[p];
+}
+
+void amr_hierarchy::unload(std::size_t p) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    loaded_.at(p).reset();
+}
+
+std::size_t amr_hierarchy::loaded_count() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return std::size_t(std::count_if(loaded_.begin(), loaded_.end(), [](const auto & a) { return a != nullptr; }));
+}
+
+float amr_hierarchy::sample(const glm::vec3 & position, std::size_t max_level, float outside) {
+    std::size_t p = find(position, max_level);
+    if (p == npos) {
+        return outside;
+    }
+    std::shared_ptr<const ndarray<float, 3>> samples = data(p);
+    const amr_patch &                        patch   = patches_[p];
+    auto                                     to_base = float(levels_[patch.level].to_base);
+    std::size_t                              cell[3];
+    for (int a = 0; a < 3; ++a) {
+        cell[a] = std::size_t(std::int64_t(std::floor(position[a] * to_base)) - patch.box.lo[a]);
+    }
+    return (*samples)(cell[0], cell[1], cell[2]);
+}
+
+void amr_hierarchy::resample(ndarray<float, 3> & out,
+                             const amr_box &     region,
+                             std::size_t         max_level,
+                             float               outside,
+                             velm::job_system &  jobs) {
+    out.fill(outside);
+    if (region.empty() || out.total_elements() == 0) {
+        return;
+    }
+    std::vector<std::size_t> selected = select(region, max_level);
+
+    std::size_t               mapped_level = npos;
+    std::vector<std::int64_t> cells[3];
+    for (std::size_t p : selected) {
+        const amr_patch & patch = patches_[p];
+        if (patch.level != mapped_level) {
+            for (int a = 0; a < 3; ++a) {
+                cells[a] = cell_of_samples(out.dims[a], region.lo[a], region.hi[a], levels_[patch.level].to_base);
+            }
+            mapped_level = patch.level;
+        }
+        // the samples whose cell lies in the patch form one run per axis
+        std::size_t first[3];
+        std::size_t last[3];
+        bool        empty = false;
+        for (int a = 0; a < 3; ++a) {
+            auto lo  = std::lower_bound(cells[a].begin(), cells[a].end(), patch.box.lo[a]);
+            auto hi  = std::lower_bound(lo, cells[a].end(), patch.box.hi[a]);
+            first[a] = std::size_t(lo - cells[a].begin());
+            last[a]  = std::size_t(hi - cells[a].begin());
+            empty    = empty || first[a] >= last[a];
+        }
+        if (empty) {
+            continue;
+        }
+
+        std::shared_ptr<const ndarray<float, 3>> samples = data(p);
+        velm::parallel_for(
+            first[0], last[0], 1,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    for (std::size_t j = first[1]; j < last[1]; ++j) {
+                        const float * src = &(*samples)(std::size_t(cells[0][i] - patch.box.lo[0]),
+                                                        std::size_t(cells[1][j] - patch.box.lo[1]), std::size_t(0));
+                        float *       dst = &out(i, j, std::size_t(0));
+                        for (std::size_t k = first[2]; k < last[2]; ++k) {
+                            dst[k] = src[cells[2][k] - patch.box.lo[2]];
+                        }
+                    }
+                }
+            },
+            jobs);
+    }
+}
+
+#ifdef VELM_ENABLE_HDF5
+amr_hierarchy load_amr(const velm::hdf5_file & file, const amr_layout & layout) {
+    const std::string prefix = "/" + layout.level_prefix;
+
+    // /<prefix><l>/<patch>, grouped by level
+    std::map<std::size_t, std::vector<std::string>> by_level;
+    for (std::string & name : file.list_datasets_recursive("/")) {
+        std::size_t slash = name.find('/', prefix.size());
+        if (name.compare(0, prefix.size(), prefix) != 0 || slash == std::string::npos) {
+            continue;
+        }
+        std::string number = name.substr(prefix.size(), slash - prefix.size());
+        if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        by_level[std::stoul(number)].push_back(std::move(name));
+    }
+    if (by_level.empty() || by_level.rbegin()->first + 1 != by_level.size()) {
+        throw std::runtime_error("load_amr: " + std::string(file.get_filename()) + " has no contiguous " +
+                                 layout.level_prefix + "<n> groups");
+    }
+
+    std::vector<amr_patch>    patches;
+    std::vector<std::int64_t> ratios(by_level.size(), 1);
+    for (const auto & [level, names] : by_level) {
+        std::string group = prefix + std::to_string(level);
+        if (level > 0) {
+            const std::string & holder = file.has_attribute(group, layout.refinement_attribute) ? group : names.front();
+            std::vector<double> ratio  = file.get_attribute(holder, layout.refinement_attribute);
+            if (ratio.empty() || ratio[0] < 1.0) {
+                throw std::runtime_error("load_amr: no valid " + layout.refinement_attribute + " for " + group);
+            }
+            ratios[level] = std::int64_t(ratio[0]);
+        }
+        for (const std::string & name : names) {
+            std::vector<std::size_t> shape  = file.get_dataset_shape(name);
+            std::vector<double>      offset = file.get_attribute(name, layout.offset_attribute);
+            if (shape.size() != 3 || offset.size() != 3) {
+                throw std::runtime_error("load_amr: " + name + " needs a 3D shape and a 3 value " +
+                                         layout.offset_attribute);
+            }
+            amr_patch patch;
+            patch.dataset = name;
+            patch.level   = level;
+            for (int a = 0; a < 3; ++a) {
+                patch.box.lo[a] = std::int64_t(offset[a]);
+                patch.box.hi[a] = patch.box.lo[a] + std::int64_t(shape[a]);
+            }
+            patches.push_back(std::move(patch));
+        }
+    }
+
+    amr_hierarchy::patch_loader loader = [&file](const amr_patch & patch, ndarray<float, 3> & out) {
+        file.load_hyperslab(out.data, patch.dataset, { 0, 0, 0 }, { out.dims[0], out.dims[1], out.dims[2] });
+    };
+    return amr_hierarchy(std::move(patches), ratios, std::move(loader));
+}
+#endif
+}  // namespace velm_DR
@@ -0,0 +1,425 @@
+#include "velm/compositing.h"
+
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+namespace velm_render {
+
+namespace {
+
+constexpr std::size_t pixel_bytes = sizeof(glm::vec4) + sizeof(float);
+
+// messages of one group, by (from, to), in send order
+struct local_mailboxes {
+    std::mutex                                                                        mutex;
+    std::condition_variable                                                           arrived;
+    std::map<std::pair<std::size_t, std::size_t>, std::deque<std::vector<std::byte>>> queues;
+};
+
+class local_transport final : public composite_transport {
+  public:
+    local_transport(std::size_t rank, std::size_t size, std::shared_ptr<local_mailboxes> mailboxes) :
+        rank_(rank), size_(size), boxes(std::move(mailboxes)) {}
+
+    [[nodiscard]] std::size_t rank() const override { return rank_; }
+
+    [[nodiscard]] std::size_t size() const override { return size_; }
+
+    void send(std::size_t peer, std::span<const std::byte> bytes) override {
+        {
+            std::lock_guard<std::mutex> lock(boxes->mutex);
+            boxes->queues[{ rank_, peer }].emplace_back(bytes.begin(), bytes.end());
+        }
+        boxes->arrived.notify_all();
+    }
+
+    void receive(std::size_t peer, std::span<std::byte> bytes) override {
+        std::unique_lock<std::mutex>         lock(boxes->mutex);
+        std::deque<std::vector<std::byte>> & queue = boxes->queues[{ peer, rank_ }];
+        boxes->arrived.wait(lock, [&] { return !queue.empty(); });
+        std::vector<std::byte> message = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        if (message.size() != bytes.size()) {
+            throw std::runtime_error("local_transport: message size does not match the receive");
+        }
+        std::copy(message.begin(), message.end(), bytes.begin());
+    }
+
+  private:
+    std::size_t                      rank_;
+    std::size_t                      size_;
+    std::shared_ptr<local_mailboxes> boxes;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+[[noreturn]] void socket_error(const char * what) {
+    throw std::runtime_error(std::string("socket_transport: ") + what + ": " + std::strerror(errno));
+}
+#endif
+
+// pixels [begin, end) of an image, color then depth
+void pack(const composite_image & image, std::size_t begin, std::size_t end, std::vector<std::byte> & out) {
+    std::size_t count = end - begin;
+    out.resize(count * pixel_bytes);
+    std::memcpy(out.data(), image.color.data() + begin, count * sizeof(glm::vec4));
+    std::memcpy(out.data() + count * sizeof(glm::vec4), image.depth.data() + begin, count * sizeof(float));
+}
+
+// blends the packed pixels of another rank into [begin, end) of image, which is in front when mine_in_front
+void merge(composite_image &          image,
+           std::size_t                begin,
+           std::size_t                end,
+           std::span<const std::byte> packed,
+           composite_mode             mode,
+           bool                       mine_in_front) {
+    std::size_t            count = end - begin;
+    std::vector<glm::vec4> color(count);
+    std::vector<float>     depth(count);
+    std::memcpy(color.data(), packed.data(), count * sizeof(glm::vec4));
+    std::memcpy(depth.data(), packed.data() + count * sizeof(glm::vec4), count * sizeof(float));
+
+    std::span<glm::vec4> my_color(image.color.data() + begin, count);
+    std::span<float>     my_depth(image.depth.data() + begin, count);
+    if (mode == composite_mode::DEPTH) {
+        for (std::size_t i = 0; i < count; ++i) {
+            // ties go to the front rank so the result does not depend on who receives
+            bool take = mine_in_front ? depth[i] < my_depth[i] : depth[i] <= my_depth[i];
+            if (take) {
+                my_color[i] = color[i];
+                my_depth[i] = depth[i];
+            }
+        }
+    } else if (mine_in_front) {
+        blend_over(my_color, my_depth, color, depth);
+    } else {
+        blend_over(color, depth, my_color, my_depth);
+        std::copy(color.begin(), color.end(), my_color.begin());
+        std::copy(depth.begin(), depth.end(), my_depth.begin());
+    }
+}
+
+// the pixels a virtual position is left with after the swap rounds
+std::pair<std::size_t, std::size_t> final_range(std::size_t position, std::size_t rounds, std::size_t pixels) {
+    std::size_t begin = 0;
+    std::size_t end   = pixels;
+    for (std::size_t k = 0; k < rounds; ++k) {
+        std::size_t half = begin + (end - begin) / 2;
+        if (position >> k & 1u) {
+            begin = half;
+        } else {
+            end = half;
+        }
+    }
+    return { begin, end };
+}
+
+}  // namespace
+
+void composite_image::clear(std::uint32_t w, std::uint32_t h) {
+    width  = w;
+    height = h;
+    color.assign(pixel_count(), glm::vec4(0.0f));
+    depth.assign(pixel_count(), std::numeric_limits<float>::infinity());
+    memory.resize(color.capacity() * sizeof(glm::vec4) + depth.capacity() * sizeof(float));
+}
+
+void composite_transport::exchange(std::size_t peer, std::span<const std::byte> out, std::span<std::byte> in) {
+    // correct for transports whose send does not wait for the receiver
+    send(peer, out);
+    receive(peer, in);
+}
+
+std::vector<std::unique_ptr<composite_transport>> make_local_group(std::size_t ranks) {
+    auto                                              boxes = std::make_shared<local_mailboxes>();
+    std::vector<std::unique_ptr<composite_transport>> group;
+    for (std::size_t r = 0; r < ranks; ++r) {
+        group.push_back(std::make_unique<local_transport>(r, ranks, boxes));
+    }
+    return group;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+std::vector<std::vector<int>> socket_transport::connect_local(std::size_t ranks) {
+    std::vector<std::vector<int>> fds(ranks, std::vector<int>(ranks, -1));
+    for (std::size_t a = 0; a < ranks; ++a) {
+        for (std::size_t b = a + 1; b < ranks; ++b) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                for (const std::vector<int> & row : fds) {
+                    for (int fd : row) {
+                        if (fd >= 0) {
+                            close(fd);
+                        }
+                    }
+                }
+                socket_error("socketpair failed");
+            }
+            fds[a][b] = pair[0];
+            fds[b][a] = pair[1];
+        }
+    }
+    return fds;
+}
+
+socket_transport::socket_transport(std::size_t                           rank,
+                                   std::vector<int>                      peer_fds,
+                                   const std::vector<std::vector<int>> * mesh) :
+    rank_(rank), peers(std::move(peer_fds)) {
+    if (mesh == nullptr) {
+        return;
+    }
+    for (std::size_t r = 0; r < mesh->size(); ++r) {
+        for (int fd : (*mesh)[r]) {
+            if (r != rank && fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+}
+
+socket_transport::~socket_transport() {
+    for (int fd : peers) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void socket_transport::send(std::size_t peer, std::span<const std::byte> bytes) {
+    while (!bytes.empty()) {
+        ssize_t sent = ::send(peers.at(peer), bytes.data(), bytes.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            socket_error("send failed");
+        }
+        bytes = bytes.subspan(std::size_t(sent));
+    }
+}
+
+void socket_transport::receive(std::size_t peer, std::span<std::byte> bytes) {
+    while (!bytes.empty()) {
+        ssize_t got = ::recv(peers.at(peer), bytes.data(), bytes.size(), 0);
+        if (got == 0) {
+            errno = ECONNRESET;
+            socket_error("peer closed the connection");
+        }
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            socket_error("recv failed");
+        }
+        bytes = bytes.subspan(std::size_t(got));
+    }
+}
+
+void socket_transport::exchange(std::size_t peer, std::span<const std::byte> out, std::span<std::byte> in) {
+    // both directions at once: two peers blocking in send on full socket buffers would never get to their receives
+    int fd = peers.at(peer);
+    while (!out.empty() || !in.empty()) {
+        pollfd p{ fd, short((out.empty() ? 0 : POLLOUT) | (in.empty() ? 0 : POLLIN)), 0 };
+        if (poll(&p, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            socket_error("poll failed");
+        }
+        if (p.revents & (POLLERR | POLLNVAL)) {
+            errno = EPIPE;
+            socket_error("connection failed");
+        }
+        if (!out.empty() && (p.revents & POLLOUT)) {
+            ssize_t sent = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                socket_error("send failed");
+            }
+            out = out.subspan(std::size_t(std::max<ssize_t>(sent, 0)));
+        }
+        if (!in.empty() && (p.revents & (POLLIN | POLLHUP))) {
+            ssize_t got = ::recv(fd, in.data(), in.size(), MSG_DONTWAIT);
+            if (got == 0) {
+                errno = ECONNRESET;
+                socket_error("peer closed the connection");
+            }
+            if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                socket_error("recv failed");
+            }
+            in = in.subspan(std::size_t(std::max<ssize_t>(got, 0)));
+        }
+    }
+}
+#endif
+
+void blend_over(std::span<glm::vec4>       front_color,
+                std::span<float>           front_depth,
+                std::span<const glm::vec4> back_color,
+                std::span<const float>     back_depth) {
+    for (std::size_t i = 0; i < front_color.size(); ++i) {
+        front_color[i] += (1.0f - front_color[i].w) * back_color[i];
+        front_depth[i] = std::min(front_depth[i], back_depth[i]);
+    }
+}
+
+composite_stats composite_binary_swap(composite_image &         image,
+                                      composite_transport &     transport,
+                                      const composite_options & options) {
+    VELM_PROFILE_FUNCTION();
+    const std::size_t ranks = transport.size();
+    const std::size_t me    = transport.rank();
+    if ((!options.order.empty() && options.order.size() != ranks) || options.root >= ranks ||
+        image.color.size() != image.pixel_count() || image.depth.size() != image.pixel_count()) {
+        throw std::invalid_argument("composite_binary_swap: order, root or image do not match the group");
+    }
+
+    // position in the visibility order per rank and back
+    std::vector<std::size_t> rank_at(ranks);
+    std::vector<std::size_t> position_of(ranks);
+    for (std::size_t p = 0; p < ranks; ++p) {
+        rank_at[p]              = options.order.empty() ? p : options.order[p];
+        position_of[rank_at[p]] = p;
+    }
+
+    // positions 2i and 2i + 1 are folded into virtual position i for the first ranks - 2^rounds pairs
+    composite_stats stats;
+    std::size_t     swapping = 1;
+    while (swapping * 2 <= ranks) {
+        swapping *= 2;
+        ++stats.rounds;
+    }
+    const std::size_t folded   = ranks - swapping;
+    const std::size_t position = position_of[me];
+    const std::size_t pixels   = image.pixel_count();
+    auto              owner    = [&](std::size_t v) { return v < folded ? rank_at[2 * v] : rank_at[v + folded]; };
+
+    std::vector<std::byte> outgoing;
+    std::vector<std::byte> incoming;
+    bool                   active = true;
+    if (position < 2 * folded) {
+        if (position % 2 == 1) {
+            pack(image, 0, pixels, outgoing);
+            transport.send(rank_at[position - 1], outgoing);
+            stats.bytes_sent += outgoing.size();
+            active = false;
+        } else {
+            incoming.resize(pixels * pixel_bytes);
+            transport.receive(rank_at[position + 1], incoming);
+            merge(image, 0, pixels, incoming, options.mode, true);
+        }
+    }
+
+    std::size_t virtual_position = position < 2 * folded ? position / 2 : position - folded;
+    std::size_t begin            = 0;
+    std::size_t end              = pixels;
+    for (std::size_t k = 0; active && k < stats.rounds; ++k) {
+        std::size_t bit     = std::size_t(1) << k;
+        std::size_t partner = owner(virtual_position ^ bit);
+        std::size_t half    = begin + (end - begin) / 2;
+        bool        front   = (virtual_position & bit) == 0;
+        std::size_t keep_lo = front ? begin : half;
+        std::size_t keep_hi = front ? half : end;
+
+        pack(image, front ? half : begin, front ? end : half, outgoing);
+        incoming.resize((keep_hi - keep_lo) * pixel_bytes);
+        transport.exchange(partner, outgoing, incoming);
+        stats.bytes_sent += outgoing.size();
+        merge(image, keep_lo, keep_hi, incoming, options.mode, front);
+        begin = keep_lo;
+        end   = keep_hi;
+    }
+
+    // gather the slices on the root
+    if (me == options.root) {
+        for (std::size_t v = 0; v < swapping; ++v) {
+            std::size_t from = owner(v);
+            if (from == me) {
+                continue;
+            }
+            auto [lo, hi] = final_range(v, stats.rounds, pixels);
+            incoming.resize((hi - lo) * pixel_bytes);
+            transport.receive(from, incoming);
+            std::memcpy(image.color.data() + lo, incoming.data(), (hi - lo) * sizeof(glm::vec4));
+            std::memcpy(image.depth.data() + lo, incoming.data() + (hi - lo) * sizeof(glm::vec4),
+                        (hi - lo) * sizeof(float));
+        }
+    } else if (active) {
+        pack(image, begin, end, outgoing);
+        transport.send(options.root, outgoing);
+        stats.bytes_sent += outgoing.size();
+    }
+    return stats;
+}
+
+domain_decomposition::domain_decomposition(const std::size_t (&dims)[3], std::size_t ranks) {
+    if (ranks == 0) {
+        throw std::invalid_argument("domain_decomposition: at least one rank is needed");
+    }
+    brick whole{ { 0, 0, 0 }, { dims[0], dims[1], dims[2] } };
+    (void) build(whole, ranks);
+}
+
+std::size_t domain_decomposition::build(const brick & box, std::size_t ranks) {
+    std::size_t index = nodes.size();
+    nodes.push_back({ -1, 0, bricks_.size(), 0 });
+    if (ranks == 1) {
+        bricks_.push_back(box);
+        return index;
+    }
+
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+        if (box.hi[a] - box.lo[a] > box.hi[axis] - box.lo[axis]) {
+            axis = a;
+        }
+    }
+    // samples in proportion to the ranks on each side, so uneven rank counts still get equal bricks
+    std::size_t low_ranks = ranks / 2;
+    std::size_t position  = box.lo[axis] + (box.hi[axis] - box.lo[axis]) * low_ranks / ranks;
+    brick       low       = box;
+    brick       high      = box;
+    low.hi[axis]          = position;
+    high.lo[axis]         = position;
+
+    std::size_t low_node  = build(low, low_ranks);
+    std::size_t high_node = build(high, ranks - low_ranks);
+    nodes[index]          = { axis, position, low_node, high_node };
+    return index;
+}
+
+std::vector<std::size_t> domain_decomposition::visibility_order(const glm::vec3 & eye) const {
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> stack = { 0 };
+    while (!stack.empty()) {
+        const split & node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.axis < 0) {
+            order.push_back(node.low);
+            continue;
+        }
+        // the low child reads one more layer up to position, so that is where the two bricks meet
+        bool eye_low = eye[node.axis] < float(node.position);
+        stack.push_back(eye_low ? node.high : node.low);
+        stack.push_back(eye_low ? node.low : node.high);
+    }
+    return order;
+}
+}  // namespace velm_render
@@ -0,0 +1,340 @@
+#include "velm/culling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef __AVX__
+#    include <immintrin.h>
+#endif
+
+namespace velm_render {
+
+frustum frustum::from_view_proj(const glm::mat4x4 & m, bool homogeneous_depth) {
+    // Gribb/Hartmann, glm matrices are column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+    frustum f{};
+    f.planes[0] = row(3) + row(0);
+    f.planes[1] = row(3) - row(0);
+    f.planes[2] = row(3) + row(1);
+    f.planes[3] = row(3) - row(1);
+    f.planes[4] = homogeneous_depth ? row(3) + row(2) : row(2);
+    f.planes[5] = row(3) - row(2);
+    for (auto & p : f.planes) {
+        float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        p         = p * (1.0f / len);
+    }
+    return f;
+}
+
+occlusion_buffer::occlusion_buffer(std::uint32_t width, std::uint32_t height) :
+    width_(width), height_(height), depth_(std::size_t(width) * height, 1.0f) {}
+
+void occlusion_buffer::clear() {
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+}
+
+void occlusion_buffer::load_depth(std::span<const float> depth, std::uint32_t width, std::uint32_t height) {
+    // rows top to bottom, window space depth in [0, 1]
+    if (depth.size() < std::size_t(width) * height) {
+        abort();
+    }
+    if (width == 0 || height == 0) {
+        clear();
+        return;
+    }
+    for (std::uint32_t y = 0; y < height_; ++y) {
+        std::uint32_t y0 = y * height / height_;
+        std::uint32_t y1 = std::max(y0 + 1, ((y + 1) * height + height_ - 1) / height_);
+        for (std::uint32_t x = 0; x < width_; ++x) {
+            std::uint32_t x0       = x * width / width_;
+            std::uint32_t x1       = std::max(x0 + 1, ((x + 1) * width + width_ - 1) / width_);
+            float         farthest = 0.0f;
+            for (std::uint32_t sy = y0; sy < std::min(y1, height); ++sy) {
+                const float * src = depth.data() + std::size_t(sy) * width;
+                for (std::uint32_t sx = x0; sx < std::min(x1, width); ++sx) {
+                    farthest = std::max(farthest, src[sx]);
+                }
+            }
+            depth_[std::size_t(y) * width_ + x] = farthest;
+        }
+    }
+}
+
+bool occlusion_buffer::is_occluded(const aabb & bounds, const glm::mat4x4 & view_proj, bool homogeneous_depth) const {
+    float min_x = FLT_MAX;
+    float min_y = FLT_MAX;
+    float max_x = -FLT_MAX;
+    float max_y = -FLT_MAX;
+    float min_z = FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec4 p(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y,
+                    corner & 4 ? bounds.max.z : bounds.min.z, 1.0f);
+        glm::vec4 clip = view_proj * p;
+        if (clip.w <= 1e-6f) {
+            // crosses the near plane, the projected rectangle is meaningless
+            return false;
+        }
+        float inv_w = 1.0f / clip.w;
+        float z     = clip.z * inv_w;
+        min_x       = std::min(min_x, clip.x * inv_w);
+        max_x       = std::max(max_x, clip.x * inv_w);
+        min_y       = std::min(min_y, clip.y * inv_w);
+        max_y       = std::max(max_y, clip.y * inv_w);
+        min_z       = std::min(min_z, homogeneous_depth ? z * 0.5f + 0.5f : z);
+    }
+
+    auto to_x = [this](float ndc) { return (ndc * 0.5f + 0.5f) * float(width_); };
+    auto to_y = [this](float ndc) { return (0.5f - ndc * 0.5f) * float(height_); };
+    int  x0   = std::max(0, int(std::floor(to_x(min_x))));
+    int  x1   = std::min(int(width_) - 1, int(std::floor(to_x(max_x))));
+    int  y0   = std::max(0, int(std::floor(to_y(max_y))));
+    int  y1   = std::min(int(height_) - 1, int(std::floor(to_y(min_y))));
+    if (x0 > x1 || y0 > y1) {
+        return false;
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+        const float * row = depth_.data() + std::size_t(y) * width_;
+        for (int x = x0; x <= x1; ++x) {
+            if (row[x] > min_z) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+namespace {
+
+void set_lane(bvh::node & n, std::uint32_t lane, const aabb & b) {
+    n.min_x[lane] = b.min.x;
+    n.min_y[lane] = b.min.y;
+    n.min_z[lane] = b.min.z;
+    n.max_x[lane] = b.max.x;
+    n.max_y[lane] = b.max.y;
+    n.max_z[lane] = b.max.z;
+}
+
+bool same_lane(const bvh::node & n, std::uint32_t lane, const aabb & b) {
+    return n.min_x[lane] == b.min.x && n.min_y[lane] == b.min.y && n.min_z[lane] == b.min.z &&
+           n.max_x[lane] == b.max.x && n.max_y[lane] == b.max.y && n.max_z[lane] == b.max.z;
+}
+
+bvh::node empty_node(std::uint32_t parent, std::uint32_t parent_lane) {
+    bvh::node n{};
+    for (std::uint32_t lane = 0; lane < bvh::width; ++lane) {
+        set_lane(n, lane, { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) });
+        n.child[lane] = bvh::empty;
+    }
+    n.parent      = parent;
+    n.parent_lane = parent_lane;
+    return n;
+}
+
+// bit l of outside: lane l is completely behind a plane, bit l of inside: lane l is in front of every plane
+void classify_lanes(const bvh::node & n, const frustum & f, std::uint32_t & outside, std::uint32_t & inside) {
+    outside = 0;
+    inside  = (1u << bvh::width) - 1;
+    for (const glm::vec4 & p : f.planes) {
+        // the box corner farthest along the plane normal decides rejection, the nearest one containment
+        const float * far_x  = p.x > 0.0f ? n.max_x : n.min_x;
+        const float * far_y  = p.y > 0.0f ? n.max_y : n.min_y;
+        const float * far_z  = p.z > 0.0f ? n.max_z : n.min_z;
+        const float * near_x = p.x > 0.0f ? n.min_x : n.max_x;
+        const float * near_y = p.y > 0.0f ? n.min_y : n.max_y;
+        const float * near_z = p.z > 0.0f ? n.min_z : n.max_z;
+#ifdef __AVX__
+        __m256 a      = _mm256_set1_ps(p.x);
+        __m256 b      = _mm256_set1_ps(p.y);
+        __m256 c      = _mm256_set1_ps(p.z);
+        __m256 d      = _mm256_set1_ps(p.w);
+        __m256 zero   = _mm256_setzero_ps();
+        __m256 d_far  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_load_ps(far_x)),
+                                                    _mm256_mul_ps(b, _mm256_load_ps(far_y))),
+                                      _mm256_add_ps(_mm256_mul_ps(c, _mm256_load_ps(far_z)), d));
+        __m256 d_near = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_load_ps(near_x)),
+                                                    _mm256_mul_ps(b, _mm256_load_ps(near_y))),
+                                      _mm256_add_ps(_mm256_mul_ps(c, _mm256_load_ps(near_z)), d));
+        outside |= std::uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(d_far, zero, _CMP_LT_OQ)));
+        inside &= ~std::uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(d_near, zero, _CMP_LT_OQ)));
+#else
+        for (std::uint32_t lane = 0; lane < bvh::width; ++lane) {
+            float d_far  = p.x * far_x[lane] + p.y * far_y[lane] + p.z * far_z[lane] + p.w;
+            float d_near = p.x * near_x[lane] + p.y * near_y[lane] + p.z * near_z[lane] + p.w;
+            outside |= std::uint32_t(d_far < 0.0f) << lane;
+            inside &= ~(std::uint32_t(d_near < 0.0f) << lane);
+        }
+#endif
+    }
+}
+
+}  // namespace
+
+aabb bvh::node_bounds(std::uint32_t index) const {
+    const node & n = nodes_[index];
+    aabb         b{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (std::uint32_t lane = 0; lane < width; ++lane) {
+        if (n.child[lane] == empty) {
+            continue;
+        }
+        b.min = glm::min(b.min, glm::vec3(n.min_x[lane], n.min_y[lane], n.min_z[lane]));
+        b.max = glm::max(b.max, glm::vec3(n.max_x[lane], n.max_y[lane], n.max_z[lane]));
+    }
+    return b;
+}
+
+std::uint32_t bvh::build_node(std::span<std::uint32_t> slots,
+                              std::span<const aabb>    bounds,
+                              std::uint32_t            parent,
+                              std::uint32_t            parent_lane) {
+    auto index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back(empty_node(parent, parent_lane));
+
+    // split the largest group at the centroid median of its widest axis until there are `width` groups
+    std::vector<std::span<std::uint32_t>> groups{ slots };
+    while (groups.size() < width) {
+        auto largest = std::max_element(groups.begin(), groups.end(),
+                                        [](const auto & a, const auto & b) { return a.size() < b.size(); });
+        if (largest->size() <= 1) {
+            break;
+        }
+        std::span<std::uint32_t> group = *largest;
+
+        glm::vec3 lo(FLT_MAX);
+        glm::vec3 hi(-FLT_MAX);
+        for (std::uint32_t slot : group) {
+            glm::vec3 c = (bounds[slot].min + bounds[slot].max) * 0.5f;
+            lo          = glm::min(lo, c);
+            hi          = glm::max(hi, c);
+        }
+        glm::vec3 extent = hi - lo;
+        int       axis   = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        std::size_t half = group.size() / 2;
+        std::nth_element(group.begin(), group.begin() + half, group.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return bounds[a].min[axis] + bounds[a].max[axis] < bounds[b].min[axis] + bounds[b].max[axis];
+        });
+        *largest = group.first(half);
+        groups.push_back(group.subspan(half));
+    }
+
+    for (std::uint32_t lane = 0; lane < groups.size(); ++lane) {
+        std::span<std::uint32_t> group = groups[lane];
+        if (group.size() == 1) {
+            std::uint32_t slot        = group[0];
+            nodes_[index].child[lane] = slot | leaf_flag;
+            leaf_of_slot_[slot]       = { index, lane };
+            set_lane(nodes_[index], lane, bounds[slot]);
+        } else {
+            std::uint32_t child       = build_node(group, bounds, index, lane);
+            nodes_[index].child[lane] = child;
+            set_lane(nodes_[index], lane, node_bounds(child));
+        }
+    }
+    return index;
+}
+
+void bvh::rebuild(const velm::Scene & scene) {
+    nodes_.clear();
+    leaf_of_slot_.assign(scene.slot_count(), { empty, 0 });
+    built_version_ = scene.topology_version();
+
+    std::vector<std::uint32_t> slots;
+    for (std::uint32_t slot = 0; slot < scene.slot_count(); ++slot) {
+        if (scene.handle_of(slot).valid()) {
+            slots.push_back(slot);
+        }
+    }
+    if (slots.empty()) {
+        return;
+    }
+    if (slots.size() == 1) {
+        // the root always is an inner node
+        nodes_.push_back(empty_node(empty, 0));
+        nodes_[0].child[0]      = slots[0] | leaf_flag;
+        leaf_of_slot_[slots[0]] = { 0, 0 };
+        set_lane(nodes_[0], 0, scene.world_bound_pool()[slots[0]]);
+        return;
+    }
+    build_node(slots, scene.world_bound_pool(), empty, 0);
+}
+
+void bvh::refit(const velm::Scene & scene, std::span<const std::uint32_t> changed_slots) {
+    if (built_version_ != scene.topology_version()) {
+        rebuild(scene);
+        return;
+    }
+    std::span<const aabb> bounds = scene.world_bound_pool();
+    for (std::uint32_t slot : changed_slots) {
+        leaf_location loc = leaf_of_slot_[slot];
+        set_lane(nodes_[loc.node], loc.lane, bounds[slot]);
+
+        // propagate towards the root until a parent lane already matches
+        for (std::uint32_t n = loc.node; nodes_[n].parent != empty; n = nodes_[n].parent) {
+            aabb          b      = node_bounds(n);
+            std::uint32_t parent = nodes_[n].parent;
+            std::uint32_t lane   = nodes_[n].parent_lane;
+            if (same_lane(nodes_[parent], lane, b)) {
+                break;
+            }
+            set_lane(nodes_[parent], lane, b);
+        }
+    }
+}
+
+void bvh::cull(const frustum &               view_frustum,
+               std::span<const std::uint8_t> render_flags,
+               std::vector<std::uint32_t> &  visible,
+               const occlusion_buffer *      occlusion,
+               const glm::mat4x4 *           view_proj,
+               bool                          homogeneous_depth) const {
+    if (nodes_.empty()) {
+        return;
+    }
+    bool use_occlusion = occlusion != nullptr && view_proj != nullptr;
+
+    struct entry {
+        std::uint32_t node;
+        bool          inside;
+    };
+
+    std::vector<entry> stack{ { 0, false } };
+    while (!stack.empty()) {
+        entry        e = stack.back();
+        const node & n = nodes_[e.node];
+        stack.pop_back();
+
+        std::uint32_t outside = 0;
+        std::uint32_t inside  = (1u << width) - 1;
+        if (!e.inside) {
+            classify_lanes(n, view_frustum, outside, inside);
+        }
+
+        for (std::uint32_t lane = 0; lane < width; ++lane) {
+            std::uint32_t child = n.child[lane];
+            if (child == empty || (outside >> lane) & 1u) {
+                continue;
+            }
+            if (use_occlusion) {
+                aabb b{ { n.min_x[lane], n.min_y[lane], n.min_z[lane] },
+                         { n.max_x[lane], n.max_y[lane], n.max_z[lane] } };
+                if (occlusion->is_occluded(b, *view_proj, homogeneous_depth)) {
+                    continue;
+                }
+            }
+            if (child & leaf_flag) {
+                std::uint32_t slot = child & ~leaf_flag;
+                if (render_flags[slot] & RENDER_VISIBLE) {
+                    visible.push_back(slot);
+                }
+            } else {
+                stack.push_back({ child, bool((inside >> lane) & 1u) });
+            }
+        }
+    }
+}
+
+}  // namespace velm_render
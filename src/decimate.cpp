@@ -0,0 +1,521 @@
+#include "velm/decimate.h"
+
+#include "velm/job_system.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace velm_dr {
+
+namespace {
+
+struct vec3d {
+    double x, y, z;
+};
+
+vec3d operator-(const vec3d & a, const vec3d & b) {
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+vec3d cross(const vec3d & a, const vec3d & b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+double dot(const vec3d & a, const vec3d & b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// symmetric 4x4 plane quadric, upper triangle
+struct quadric {
+    std::array<double, 10> q{};
+
+    static quadric from_plane(double a, double b, double c, double d) {
+        return { { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d } };
+    }
+
+    quadric & operator+=(const quadric & o) {
+        for (std::size_t i = 0; i < q.size(); ++i) {
+            q[i] += o.q[i];
+        }
+        return *this;
+    }
+
+    [[nodiscard]] double error(const vec3d & p) const {
+        return q[0] * p.x * p.x + 2 * q[1] * p.x * p.y + 2 * q[2] * p.x * p.z + 2 * q[3] * p.x + q[4] * p.y * p.y +
+               2 * q[5] * p.y * p.z + 2 * q[6] * p.y + q[7] * p.z * p.z + 2 * q[8] * p.z + q[9];
+    }
+};
+
+struct welded_mesh {
+    std::vector<float>         vertices;  // stride floats per vertex
+    std::vector<std::uint32_t> indices;
+    std::size_t                stride;
+
+    [[nodiscard]] vec3d position(std::uint32_t v) const {
+        const float * p = vertices.data() + std::size_t(v) * stride;
+        return { p[0], p[1], p[2] };
+    }
+};
+
+welded_mesh weld(const mesh & source, std::size_t stride) {
+    welded_mesh out{ {}, {}, stride };
+    std::size_t vertex_count = source.vertices.size() / stride;
+
+    struct key_hash {
+        std::size_t operator()(const std::array<std::uint32_t, 3> & k) const {
+            return (std::size_t(k[0]) * 73856093u) ^ (std::size_t(k[1]) * 19349663u) ^ (std::size_t(k[2]) * 83492791u);
+        }
+    };
+
+    std::unordered_map<std::array<std::uint32_t, 3>, std::uint32_t, key_hash> unique;
+    unique.reserve(vertex_count);
+    std::vector<std::uint32_t> remap(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        const float *                p = source.vertices.data() + v * stride;
+        std::array<std::uint32_t, 3> key{};
+        std::memcpy(key.data(), p, sizeof(key));
+        auto [it, inserted] = unique.try_emplace(key, static_cast<std::uint32_t>(out.vertices.size() / stride));
+        if (inserted) {
+            out.vertices.insert(out.vertices.end(), p, p + stride);
+        }
+        remap[v] = it->second;
+    }
+
+    out.indices.reserve(source.indices.size());
+    for (std::size_t t = 0; t + 2 < source.indices.size(); t += 3) {
+        std::uint32_t a = remap[source.indices[t]];
+        std::uint32_t b = remap[source.indices[t + 1]];
+        std::uint32_t c = remap[source.indices[t + 2]];
+        if (a != b && b != c && a != c) {
+            out.indices.insert(out.indices.end(), { a, b, c });
+        }
+    }
+    return out;
+}
+
+// simplifies the triangles of one cell, locked vertices never move
+class cell_simplifier {
+  public:
+    cell_simplifier(const welded_mesh &               mesh,
+                    std::span<const std::uint32_t>    triangles,
+                    const std::vector<std::uint8_t> & locked_global,
+                    std::span<vec3d>                  positions_out) :
+        positions_out_(positions_out) {
+        // local numbering of the vertices referenced by this cell
+        for (std::uint32_t t : triangles) {
+            for (int k = 0; k < 3; ++k) {
+                global_.push_back(mesh.indices[std::size_t(t) * 3 + k]);
+            }
+        }
+        std::sort(global_.begin(), global_.end());
+        global_.erase(std::unique(global_.begin(), global_.end()), global_.end());
+
+        std::size_t n = global_.size();
+        position_.resize(n);
+        quadric_.resize(n);
+        locked_.resize(n);
+        alive_.assign(n, 1);
+        stamp_.assign(n, 0);
+        tris_of_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            position_[i] = mesh.position(global_[i]);
+            locked_[i]   = locked_global[global_[i]];
+        }
+
+        tris_.reserve(triangles.size());
+        for (std::uint32_t t : triangles) {
+            std::array<std::uint32_t, 3> tri{};
+            for (int k = 0; k < 3; ++k) {
+                tri[k] = local(mesh.indices[std::size_t(t) * 3 + k]);
+            }
+            auto index = static_cast<std::uint32_t>(tris_.size());
+            tris_.push_back(tri);
+            removed_.push_back(0);
+            for (std::uint32_t v : tri) {
+                tris_of_[v].push_back(index);
+            }
+
+            vec3d  n3  = cross(position_[tri[1]] - position_[tri[0]], position_[tri[2]] - position_[tri[0]]);
+            double len = std::sqrt(dot(n3, n3));
+            if (len > 0.0) {
+                n3 = { n3.x / len, n3.y / len, n3.z / len };
+                quadric q = quadric::from_plane(n3.x, n3.y, n3.z, -dot(n3, position_[tri[0]]));
+                for (std::uint32_t v : tri) {
+                    quadric_[v] += q;
+                }
+            }
+        }
+        live_triangles_ = tris_.size();
+    }
+
+    // returns the largest accepted quadric error
+    double run(std::size_t target_triangles, double max_error) {
+        for (std::uint32_t t = 0; t < tris_.size(); ++t) {
+            for (int k = 0; k < 3; ++k) {
+                push_edge(tris_[t][k], tris_[t][(k + 1) % 3]);
+            }
+        }
+
+        double worst = 0.0;
+        while (live_triangles_ > target_triangles && !heap_.empty()) {
+            candidate c = heap_.top();
+            heap_.pop();
+            if (!alive_[c.from] || !alive_[c.to] || stamp_[c.from] != c.stamp_from || stamp_[c.to] != c.stamp_to) {
+                continue;
+            }
+            if (c.cost > max_error) {
+                break;
+            }
+            if (collapse(c.from, c.to, c.target)) {
+                worst = std::max(worst, c.cost);
+            }
+        }
+
+        for (std::size_t i = 0; i < global_.size(); ++i) {
+            if (!locked_[i]) {
+                positions_out_[global_[i]] = position_[i];
+            }
+        }
+        return worst;
+    }
+
+    void emit(std::vector<std::uint32_t> & indices) const {
+        for (std::size_t t = 0; t < tris_.size(); ++t) {
+            if (!removed_[t]) {
+                for (std::uint32_t v : tris_[t]) {
+                    indices.push_back(global_[v]);
+                }
+            }
+        }
+    }
+
+  private:
+    struct candidate {
+        double        cost;
+        std::uint32_t from;
+        std::uint32_t to;
+        std::uint32_t stamp_from;
+        std::uint32_t stamp_to;
+        vec3d         target;
+
+        bool operator<(const candidate & o) const { return cost > o.cost; }
+    };
+
+    std::span<vec3d>                          positions_out_;
+    std::vector<std::uint32_t>                global_;
+    std::vector<vec3d>                        position_;
+    std::vector<quadric>                      quadric_;
+    std::vector<std::uint8_t>                 locked_;
+    std::vector<std::uint8_t>                 alive_;
+    std::vector<std::uint32_t>                stamp_;
+    std::vector<std::vector<std::uint32_t>>   tris_of_;
+    std::vector<std::array<std::uint32_t, 3>> tris_;
+    std::vector<std::uint8_t>                 removed_;
+    std::priority_queue<candidate>            heap_;
+    std::size_t                               live_triangles_ = 0;
+
+    [[nodiscard]] std::uint32_t local(std::uint32_t global) const {
+        return static_cast<std::uint32_t>(std::lower_bound(global_.begin(), global_.end(), global) - global_.begin());
+    }
+
+    void push_edge(std::uint32_t a, std::uint32_t b) {
+        if (locked_[a] && locked_[b]) {
+            return;
+        }
+        if (locked_[a]) {
+            std::swap(a, b);
+        }
+        // a moves, b survives
+        quadric q = quadric_[a];
+        q += quadric_[b];
+
+        vec3d target = position_[b];
+        if (!locked_[b]) {
+            vec3d mid = { (position_[a].x + position_[b].x) * 0.5, (position_[a].y + position_[b].y) * 0.5,
+                          (position_[a].z + position_[b].z) * 0.5 };
+            for (const vec3d & p : { position_[a], mid }) {
+                if (q.error(p) < q.error(target)) {
+                    target = p;
+                }
+            }
+        }
+        heap_.push({ std::max(0.0, q.error(target)), a, b, stamp_[a], stamp_[b], target });
+    }
+
+    void neighbours(std::uint32_t v, std::vector<std::uint32_t> & out) const {
+        out.clear();
+        for (std::uint32_t t : tris_of_[v]) {
+            if (removed_[t]) {
+                continue;
+            }
+            for (std::uint32_t w : tris_[t]) {
+                if (w != v) {
+                    out.push_back(w);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    [[nodiscard]] bool flips(std::uint32_t moved, std::uint32_t other, const vec3d & target) const {
+        for (std::uint32_t t : tris_of_[moved]) {
+            const auto & tri = tris_[t];
+            if (removed_[t] || tri[0] == other || tri[1] == other || tri[2] == other) {
+                continue;
+            }
+            std::array<vec3d, 3> before{ position_[tri[0]], position_[tri[1]], position_[tri[2]] };
+            std::array<vec3d, 3> after = before;
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == moved) {
+                    after[k] = target;
+                }
+            }
+            vec3d n0 = cross(before[1] - before[0], before[2] - before[0]);
+            vec3d n1 = cross(after[1] - after[0], after[2] - after[0]);
+            if (dot(n0, n1) <= 0.0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool collapse(std::uint32_t from, std::uint32_t to, const vec3d & target) {
+        // link condition: an interior edge shares exactly two neighbours, more would pinch the surface
+        std::vector<std::uint32_t> nf;
+        std::vector<std::uint32_t> nt;
+        neighbours(from, nf);
+        neighbours(to, nt);
+        std::size_t shared = 0;
+        for (std::uint32_t v : nf) {
+            shared += std::binary_search(nt.begin(), nt.end(), v) ? 1 : 0;
+        }
+        if (shared != 2 || flips(from, to, target) || flips(to, from, target)) {
+            return false;
+        }
+
+        position_[to] = target;
+        quadric_[to] += quadric_[from];
+        for (std::uint32_t t : tris_of_[from]) {
+            if (removed_[t]) {
+                continue;
+            }
+            auto & tri = tris_[t];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                removed_[t] = 1;
+                live_triangles_--;
+                continue;
+            }
+            for (auto & v : tri) {
+                if (v == from) {
+                    v = to;
+                }
+            }
+            tris_of_[to].push_back(t);
+        }
+        std::erase_if(tris_of_[to], [this](std::uint32_t t) { return removed_[t] != 0; });
+        tris_of_[from].clear();
+        alive_[from] = 0;
+        stamp_[to]++;
+
+        neighbours(to, nt);
+        for (std::uint32_t w : nt) {
+            stamp_[w]++;
+        }
+        for (std::uint32_t w : nt) {
+            for (std::uint32_t t : tris_of_[w]) {
+                if (removed_[t]) {
+                    continue;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    if (tris_[t][k] == w) {
+                        push_edge(w, tris_[t][(k + 1) % 3]);
+                        push_edge(tris_[t][(k + 2) % 3], w);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+mesh_data decimate(const mesh & source, std::size_t vertex_stride, const decimate_options & options) {
+    welded_mesh welded         = weld(source, vertex_stride);
+    std::size_t vertex_count   = welded.vertices.size() / vertex_stride;
+    std::size_t triangle_count = welded.indices.size() / 3;
+
+    mesh_data result;
+    result.vertex_stride = vertex_stride;
+    if (triangle_count == 0) {
+        return result;
+    }
+
+    // cell grid over the vertex bounds
+    vec3d lo = welded.position(0);
+    vec3d hi = lo;
+    for (std::uint32_t v = 0; v < vertex_count; ++v) {
+        vec3d p = welded.position(v);
+        lo      = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+        hi      = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+    }
+    std::size_t cells = options.cells_per_axis;
+    if (cells == 0) {
+        // a few cells per thread so uneven cells still balance
+        double threads = double(velm::job_system::global().concurrency());
+        cells          = std::max<std::size_t>(1, std::size_t(std::ceil(std::cbrt(4.0 * threads))));
+    }
+    vec3d extent = hi - lo;
+    vec3d cell_size{ std::max(extent.x, 1e-12) / double(cells), std::max(extent.y, 1e-12) / double(cells),
+                     std::max(extent.z, 1e-12) / double(cells) };
+    auto  axis_cell = [&](double p, double origin, double size) {
+        double c = std::floor((p - origin) / size + double(options.cell_offset));
+        return std::min<std::size_t>(cells, std::size_t(std::max(0.0, c)));
+    };
+    std::size_t grid = cells + 1;  // the offset can push vertices into one extra cell per axis
+
+    std::vector<std::uint32_t> vertex_cell(vertex_count);
+    for (std::uint32_t v = 0; v < vertex_count; ++v) {
+        vec3d       p  = welded.position(v);
+        std::size_t x  = axis_cell(p.x, lo.x, cell_size.x);
+        std::size_t y  = axis_cell(p.y, lo.y, cell_size.y);
+        std::size_t z  = axis_cell(p.z, lo.z, cell_size.z);
+        vertex_cell[v] = static_cast<std::uint32_t>((z * grid + y) * grid + x);
+    }
+
+    // triangles straddling cells, open boundaries and non-manifold edges lock their vertices
+    std::vector<std::uint8_t>  locked(vertex_count, 0);
+    std::vector<std::uint64_t> edges;
+    std::vector<std::uint32_t> triangle_cell(triangle_count);
+    constexpr std::uint32_t    seam = UINT32_MAX;
+    edges.reserve(triangle_count * 3);
+    for (std::size_t t = 0; t < triangle_count; ++t) {
+        const std::uint32_t * tri  = welded.indices.data() + t * 3;
+        std::uint32_t         c    = vertex_cell[tri[0]];
+        bool                  same = vertex_cell[tri[1]] == c && vertex_cell[tri[2]] == c;
+        triangle_cell[t]           = same ? c : seam;
+        for (int k = 0; k < 3; ++k) {
+            std::uint32_t a = tri[k];
+            std::uint32_t b = tri[(k + 1) % 3];
+            if (!same) {
+                locked[a] = 1;
+            }
+            edges.push_back((std::uint64_t(std::min(a, b)) << 32) | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (std::size_t i = 0; i < edges.size();) {
+        std::size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) {
+            ++j;
+        }
+        if (j - i != 2) {
+            locked[edges[i] >> 32]         = 1;
+            locked[edges[i] & 0xffffffffu] = 1;
+        }
+        i = j;
+    }
+
+    // bucket triangles by cell
+    std::size_t                cell_count = grid * grid * grid;
+    std::vector<std::uint32_t> cell_start(cell_count + 1, 0);
+    std::vector<std::uint32_t> seam_triangles;
+    for (std::size_t t = 0; t < triangle_count; ++t) {
+        if (triangle_cell[t] == seam) {
+            seam_triangles.push_back(static_cast<std::uint32_t>(t));
+        } else {
+            cell_start[triangle_cell[t] + 1]++;
+        }
+    }
+    for (std::size_t c = 0; c < cell_count; ++c) {
+        cell_start[c + 1] += cell_start[c];
+    }
+    std::vector<std::uint32_t> cell_triangles(cell_start[cell_count]);
+    {
+        std::vector<std::uint32_t> cursor(cell_start.begin(), cell_start.end() - 1);
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            if (triangle_cell[t] != seam) {
+                cell_triangles[cursor[triangle_cell[t]]++] = static_cast<std::uint32_t>(t);
+            }
+        }
+    }
+
+    // every cell only writes the positions of its own unlocked vertices and its own index list
+    std::vector<vec3d> positions(vertex_count);
+    for (std::uint32_t v = 0; v < vertex_count; ++v) {
+        positions[v] = welded.position(v);
+    }
+    std::vector<std::vector<std::uint32_t>> cell_indices(cell_count);
+    std::vector<double>                     cell_error(cell_count, 0.0);
+    double                                  max_quadric = double(options.max_error) * double(options.max_error);
+    velm::parallel_for(0, cell_count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::span<const std::uint32_t> tris(cell_triangles.data() + cell_start[c],
+                                                cell_start[c + 1] - cell_start[c]);
+            if (tris.empty()) {
+                continue;
+            }
+            cell_simplifier simplifier(welded, tris, locked, positions);
+            auto            target = std::size_t(double(tris.size()) * double(options.target_ratio));
+            cell_error[c]          = simplifier.run(target, max_quadric);
+            simplifier.emit(cell_indices[c]);
+        }
+    });
+
+    // compact the vertices that are still referenced
+    std::vector<std::uint32_t> indices;
+    for (std::uint32_t t : seam_triangles) {
+        indices.insert(indices.end(), welded.indices.begin() + t * 3, welded.indices.begin() + t * 3 + 3);
+    }
+    for (const auto & ci : cell_indices) {
+        indices.insert(indices.end(), ci.begin(), ci.end());
+    }
+    std::vector<std::uint32_t> remap(vertex_count, UINT32_MAX);
+    result.indices.reserve(indices.size());
+    for (std::uint32_t v : indices) {
+        if (remap[v] == UINT32_MAX) {
+            remap[v]          = static_cast<std::uint32_t>(result.vertices.size() / vertex_stride);
+            const float * src = welded.vertices.data() + std::size_t(v) * vertex_stride;
+            result.vertices.insert(result.vertices.end(), src, src + vertex_stride);
+            float * dst = result.vertices.data() + std::size_t(remap[v]) * vertex_stride;
+            dst[0]      = static_cast<float>(positions[v].x);
+            dst[1]      = static_cast<float>(positions[v].y);
+            dst[2]      = static_cast<float>(positions[v].z);
+        }
+        result.indices.push_back(remap[v]);
+    }
+    result.geometric_error = static_cast<float>(std::sqrt(*std::max_element(cell_error.begin(), cell_error.end())));
+    result.charge_memory();
+    return result;
+}
+
+std::vector<mesh_data> build_lod_chain(const mesh & source, std::size_t vertex_stride, const lod_options & options) {
+    std::vector<mesh_data> chain;
+
+    // level 0 only welds and compacts the source
+    decimate_options keep_all;
+    keep_all.target_ratio = 1.0f;
+    chain.push_back(decimate(source, vertex_stride, keep_all));
+
+    while (chain.size() < options.max_levels && chain.back().triangle_count() > options.min_triangles) {
+        decimate_options level;
+        level.target_ratio = options.ratio_per_level;
+        level.cell_offset  = chain.size() % 2 == 1 ? 0.0f : 0.5f;
+
+        mesh_data next = decimate(chain.back().view(), vertex_stride, level);
+        next.geometric_error += chain.back().geometric_error;
+        if (next.triangle_count() >= chain.back().triangle_count()) {
+            break;
+        }
+        chain.push_back(std::move(next));
+    }
+    return chain;
+}
+
+}  // namespace velm_dr
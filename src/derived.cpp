@@ -0,0 +1,184 @@
+#include "velm/derived.h"
+
+#include "velm/isosurface.h"
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace velm_dr {
+
+namespace {
+
+std::array<const velm_DR::ndarray<float, 3> *, 3> components(const velocity_field & velocity) {
+    return { &velocity.u, &velocity.v, &velocity.w };
+}
+
+// the loops below read d[component][axis][k] straight from the stencil rows and vectorize as plain loops
+void vorticity_magnitude(const gradient_rows<3> & g, std::size_t count, float * out) {
+    const auto & d = g.d;
+    for (std::size_t k = 0; k < count; ++k) {
+        float x = d[2][1][k] - d[1][2][k];
+        float y = d[0][2][k] - d[2][0][k];
+        float z = d[1][0][k] - d[0][1][k];
+        out[k]  = std::sqrt(x * x + y * y + z * z);
+    }
+}
+
+void divergence(const gradient_rows<3> & g, std::size_t count, float * out) {
+    const auto & d = g.d;
+    for (std::size_t k = 0; k < count; ++k) {
+        out[k] = d[0][0][k] + d[1][1][k] + d[2][2][k];
+    }
+}
+
+void q_criterion(const gradient_rows<3> & g, std::size_t count, float * out) {
+    // |O|^2 - |S|^2 = -sum J[a][b] J[b][a]
+    const auto & d = g.d;
+    for (std::size_t k = 0; k < count; ++k) {
+        float diagonal = d[0][0][k] * d[0][0][k] + d[1][1][k] * d[1][1][k] + d[2][2][k] * d[2][2][k];
+        float cross    = d[0][1][k] * d[1][0][k] + d[0][2][k] * d[2][0][k] + d[1][2][k] * d[2][1][k];
+        out[k]         = -0.5f * (diagonal + 2.0f * cross);
+    }
+}
+
+// closed form for symmetric 3 x 3 matrices, eigenvalues from the angle of the scaled deviatoric part
+double middle_eigenvalue(const double (&m)[3][3]) {
+    double off   = m[0][1] * m[0][1] + m[0][2] * m[0][2] + m[1][2] * m[1][2];
+    double mean  = (m[0][0] + m[1][1] + m[2][2]) / 3.0;
+    double a     = m[0][0] - mean;
+    double b     = m[1][1] - mean;
+    double c     = m[2][2] - mean;
+    double width = a * a + b * b + c * c + 2.0 * off;
+    if (width <= 0.0) {
+        return mean;
+    }
+    double p   = std::sqrt(width / 6.0);
+    double det = a * (b * c - m[1][2] * m[1][2]) - m[0][1] * (m[0][1] * c - m[1][2] * m[0][2]) +
+                 m[0][2] * (m[0][1] * m[1][2] - b * m[0][2]);
+    double r       = std::clamp(det / (2.0 * p * p * p), -1.0, 1.0);
+    double phi     = std::acos(r) / 3.0;
+    double largest = mean + 2.0 * p * std::cos(phi);
+    double least   = mean + 2.0 * p * std::cos(phi + 2.0 * std::numbers::pi / 3.0);
+    return 3.0 * mean - largest - least;
+}
+
+void lambda2(const gradient_rows<3> & g, std::size_t count, float * out) {
+    // S^2 + O^2 is the symmetric part of J^2
+    const auto & d = g.d;
+    for (std::size_t k = 0; k < count; ++k) {
+        double j[3][3];
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) {
+                j[a][b] = d[a][b][k];
+            }
+        }
+        double jj[3][3];
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) {
+                jj[a][b] = j[a][0] * j[0][b] + j[a][1] * j[1][b] + j[a][2] * j[2][b];
+            }
+        }
+        double m[3][3];
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) {
+                m[a][b] = 0.5 * (jj[a][b] + jj[b][a]);
+            }
+        }
+        out[k] = float(middle_eigenvalue(m));
+    }
+}
+
+void evaluate(derived_quantity quantity, const gradient_rows<3> & g, std::size_t count, float * out) {
+    switch (quantity) {
+        case derived_quantity::VORTICITY_MAGNITUDE:
+            vorticity_magnitude(g, count, out);
+            break;
+        case derived_quantity::DIVERGENCE:
+            divergence(g, count, out);
+            break;
+        case derived_quantity::Q_CRITERION:
+            q_criterion(g, count, out);
+            break;
+        case derived_quantity::LAMBDA2:
+            lambda2(g, count, out);
+            break;
+    }
+}
+
+bool has_dims_of(const velm_DR::ndarray<float, 3> & shape, const std::size_t * dims) {
+    return dims[0] == shape.dims[0] && dims[1] == shape.dims[1] && dims[2] == shape.dims[2];
+}
+
+}  // namespace
+
+void compute_vorticity(const velocity_field &       velocity,
+                       velm_DR::ndarray<float, 4> & out,
+                       const stencil_options &      options,
+                       velm::job_system &           jobs) {
+    VELM_PROFILE_FUNCTION();
+    if (!has_dims_of(velocity.u, out.dims) || out.dims[3] != 3) {
+        abort();
+    }
+
+    float * dst = out.data;
+    for_each_gradient_row<3>(components(velocity), 0, velocity.u.dims[0], options, jobs,
+                             [dst](std::size_t offset, std::size_t count, const gradient_rows<3> & g) {
+                                 const auto & d = g.d;
+                                 float *      o = dst + 3 * offset;
+                                 for (std::size_t k = 0; k < count; ++k) {
+                                     o[3 * k]     = d[2][1][k] - d[1][2][k];
+                                     o[3 * k + 1] = d[0][2][k] - d[2][0][k];
+                                     o[3 * k + 2] = d[1][0][k] - d[0][1][k];
+                                 }
+                             });
+}
+
+void compute_derived(const velocity_field &       velocity,
+                     derived_quantity             quantity,
+                     velm_DR::ndarray<float, 3> & out,
+                     const stencil_options &      options,
+                     velm::job_system &           jobs) {
+    VELM_PROFILE_FUNCTION();
+    if (!has_dims_of(velocity.u, out.dims)) {
+        abort();
+    }
+
+    float * dst = out.data;
+    for_each_gradient_row<3>(components(velocity), 0, velocity.u.dims[0], options, jobs,
+                             [dst, quantity](std::size_t offset, std::size_t count, const gradient_rows<3> & g) {
+                                 evaluate(quantity, g, count, dst + offset);
+                             });
+}
+
+mesh_data extract_derived_isosurface(const velocity_field &  velocity,
+                                     derived_quantity        quantity,
+                                     float                   iso,
+                                     const stencil_options & options,
+                                     velm::job_system &      jobs) {
+    VELM_PROFILE_FUNCTION();
+    const velm_DR::ndarray<float, 3> & shape      = velocity.u;
+    const std::size_t                  plane_size = shape.dims[1] * shape.dims[2];
+    const std::size_t                  planes     = std::max<std::size_t>(options.slab_planes, 1);
+
+    isosurface_builder builder(shape.dims[1], shape.dims[2], iso, options.spacing);
+    std::vector<float> slab(planes * plane_size);
+    for (std::size_t first = 0; first < shape.dims[0]; first += planes) {
+        std::size_t last = std::min(shape.dims[0], first + planes);
+        std::size_t base = first * shape.strides[0];
+        float *     dst  = slab.data();
+        for_each_gradient_row<3>(
+            components(velocity), first, last, options, jobs,
+            [dst, base, quantity](std::size_t offset, std::size_t count, const gradient_rows<3> & g) {
+                evaluate(quantity, g, count, dst + (offset - base));
+            });
+        for (std::size_t i = first; i < last; ++i) {
+            builder.add_plane({ slab.data() + (i - first) * plane_size, plane_size }, jobs);
+        }
+    }
+    return builder.finish();
+}
+}  // namespace velm_dr
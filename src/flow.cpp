@@ -0,0 +1,443 @@
+#include "velm/flow.h"
+
+#include "velm/sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace velm_dr {
+
+vector_field::vector_field(velm_DR::ndarray<float, 3> u_,
+                           velm_DR::ndarray<float, 3> v_,
+                           velm_DR::ndarray<float, 3> w_) :
+    u(std::move(u_)), v(std::move(v_)), w(std::move(w_)) {
+    for (std::size_t a = 0; a < 3; ++a) {
+        if (v.dims[a] != u.dims[a] || w.dims[a] != u.dims[a]) {
+            abort();
+        }
+    }
+}
+
+bool vector_field::sample(const glm::vec3 & position, glm::vec3 & velocity) const {
+    glm::vec3   g = (position - origin) / spacing;
+    std::size_t i[3];
+    float       f[3];
+    for (int a = 0; a < 3; ++a) {
+        float limit = float(u.dims[a]) - 1.0f;
+        // written so that NaN positions count as outside
+        if (!(g[a] >= 0.0f && g[a] <= limit)) {
+            return false;
+        }
+        i[a] = std::min(static_cast<std::size_t>(g[a]), u.dims[a] > 1 ? u.dims[a] - 2 : 0);
+        f[a] = u.dims[a] > 1 ? g[a] - float(i[a]) : 0.0f;
+    }
+
+    // neighbour offsets collapse to 0 along axes of size 1
+    std::size_t s0   = u.dims[0] > 1 ? u.strides[0] : 0;
+    std::size_t s1   = u.dims[1] > 1 ? u.strides[1] : 0;
+    std::size_t s2   = u.dims[2] > 1 ? 1 : 0;
+    std::size_t base = i[0] * u.strides[0] + i[1] * u.strides[1] + i[2];
+
+    velocity = glm::vec3(0.0f);
+    for (int c = 0; c < 8; ++c) {
+        std::size_t at     = base + (c & 4 ? s0 : 0) + (c & 2 ? s1 : 0) + (c & 1 ? s2 : 0);
+        float       weight = (c & 4 ? f[0] : 1.0f - f[0]) * (c & 2 ? f[1] : 1.0f - f[1]) * (c & 1 ? f[2] : 1.0f - f[2]);
+        velocity += weight * glm::vec3(u.data[at], v.data[at], w.data[at]);
+    }
+    return true;
+}
+
+void vector_field::sample(std::span<const glm::vec3> positions,
+                          std::span<glm::vec3>       velocities,
+                          std::span<std::uint8_t>    inside) const {
+    if (velocities.size() < positions.size() || inside.size() < positions.size()) {
+        abort();
+    }
+    // small enough for the stack, large enough to keep the gathers busy
+    constexpr std::size_t chunk = 64;
+    glm::vec3             index[chunk];
+    float                 component[3][chunk];
+    for (std::size_t first = 0; first < positions.size(); first += chunk) {
+        std::size_t count = std::min(chunk, positions.size() - first);
+        for (std::size_t i = 0; i < count; ++i) {
+            glm::vec3 g  = (positions[first + i] - origin) / spacing;
+            bool      in = true;
+            for (int a = 0; a < 3; ++a) {
+                in = in && g[a] >= 0.0f && g[a] <= float(u.dims[a]) - 1.0f;
+            }
+            inside[first + i] = in ? 1 : 0;
+            index[i]          = in ? g : glm::vec3(0.0f);
+        }
+        std::span<const glm::vec3> batch(index, count);
+        velm_DR::sample(u, batch, std::span<float>(component[0], count));
+        velm_DR::sample(v, batch, std::span<float>(component[1], count));
+        velm_DR::sample(w, batch, std::span<float>(component[2], count));
+        for (std::size_t i = 0; i < count; ++i) {
+            velocities[first + i] =
+                inside[first + i] ? glm::vec3(component[0][i], component[1][i], component[2][i]) : glm::vec3(0.0f);
+        }
+    }
+}
+
+namespace {
+
+/*
+ * Butcher tableaus. Stage s samples at p + h * sum(a[s][j] * k[j]) and t + c[s] * h; the step goes to
+ * p + h * sum(b[j] * k[j]). Dormand-Prince samples once more at the new point (its last row of a equals b), and the
+ * error is the distance between the fifth and the embedded fourth order solution, h * sum(e[j] * k[j]).
+ */
+struct tableau {
+    int    stages;
+    double c[7];
+    float  a[7][6];
+    float  b[7];
+    float  e[7];
+};
+
+constexpr tableau rk4_tableau{ 4,
+                               { 0.0, 0.5, 0.5, 1.0 },
+                               { {}, { 0.5f }, { 0.0f, 0.5f }, { 0.0f, 0.0f, 1.0f } },
+                               { 1.0f / 6.0f, 1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 6.0f },
+                               {} };
+
+constexpr tableau rk45_tableau{
+    7,
+    { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 },
+    { {},
+      { 1.0f / 5.0f },
+      { 3.0f / 40.0f, 9.0f / 40.0f },
+      { 44.0f / 45.0f, -56.0f / 15.0f, 32.0f / 9.0f },
+      { 19372.0f / 6561.0f, -25360.0f / 2187.0f, 64448.0f / 6561.0f, -212.0f / 729.0f },
+      { 9017.0f / 3168.0f, -355.0f / 33.0f, 46732.0f / 5247.0f, 49.0f / 176.0f, -5103.0f / 18656.0f },
+      { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f } },
+    { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f },
+    { 71.0f / 57600.0f, 0.0f, -71.0f / 16695.0f, 71.0f / 1920.0f, -17253.0f / 339200.0f, 22.0f / 525.0f,
+      -1.0f / 40.0f }
+};
+
+struct tracer {
+    glm::vec3   position;
+    double      t;
+    float       h;
+    std::size_t steps = 0;
+};
+
+// per lane stage positions and times, the sampled directions and whether every sample so far was inside
+struct stage_buffers {
+    std::vector<glm::vec3>    points;
+    std::vector<double>       times;
+    std::vector<glm::vec3>    k[7];
+    std::vector<std::uint8_t> inside;
+    std::vector<std::uint8_t> ok;
+    std::vector<std::uint8_t> pending;
+    std::vector<float>        h;
+    std::vector<std::uint8_t> clipped;
+
+    explicit stage_buffers(std::size_t lanes) :
+        points(lanes), times(lanes), inside(lanes), ok(lanes), pending(lanes), h(lanes), clipped(lanes) {
+        for (std::vector<glm::vec3> & stage : k) {
+            stage.resize(lanes);
+        }
+    }
+};
+
+/*
+ * Integrates the lanes whose running flag is set in lockstep, so every Runge-Kutta stage samples the field for all
+ * of them with one call: sample(points, times, directions, inside) fills a direction per point and clears inside
+ * for points outside the field. On return running is still set for lanes that reached t_end and cleared for lanes
+ * whose line ended: they left the field (after shrinking the step down to min_step to get close to the boundary),
+ * ran out of steps or emit(lane, tracer) refused the new point.
+ */
+template <typename Sample, typename Emit>
+void advance(const Sample &             sample,
+             std::span<tracer>          lanes,
+             std::span<std::uint8_t>    running,
+             double                     t_end,
+             const streamline_options & options,
+             Emit &&                    emit) {
+    const float     min_step = std::min(options.min_step, options.max_step);
+    const bool      adaptive = options.method == integrator::RK45;
+    const tableau & scheme   = adaptive ? rk45_tableau : rk4_tableau;
+    // the stages that lead up to the new point, Dormand-Prince's last one samples at it
+    const int     to_next = adaptive ? scheme.stages - 1 : scheme.stages;
+    std::size_t   n       = lanes.size();
+    stage_buffers buffers(n);
+
+    for (;;) {
+        bool any = false;
+        for (std::size_t l = 0; l < n; ++l) {
+            tracer & s         = lanes[l];
+            buffers.pending[l] = 0;
+            if (!running[l] || s.t >= t_end) {
+                continue;
+            }
+            if (s.steps >= options.max_steps) {
+                running[l] = 0;
+                continue;
+            }
+            double remaining   = t_end - s.t;
+            buffers.clipped[l] = remaining <= double(s.h) * 1.0001 ? 1 : 0;
+            buffers.h[l]       = buffers.clipped[l] ? float(remaining) : s.h;
+            buffers.pending[l] = 1;
+            buffers.ok[l]      = 1;
+            any                = true;
+        }
+        if (!any) {
+            return;
+        }
+
+        for (int stage = 0; stage < scheme.stages; ++stage) {
+            for (std::size_t l = 0; l < n; ++l) {
+                glm::vec3 offset(0.0f);
+                for (int j = 0; j < stage && buffers.pending[l]; ++j) {
+                    offset += scheme.a[stage][j] * buffers.k[j][l];
+                }
+                // lanes that sit this round out sample where they are, the result is ignored
+                buffers.points[l] = lanes[l].position + buffers.h[l] * offset;
+                buffers.times[l]  = lanes[l].t + scheme.c[stage] * double(buffers.h[l]);
+            }
+            sample(std::span<const glm::vec3>(buffers.points), std::span<const double>(buffers.times),
+                   std::span<glm::vec3>(buffers.k[stage]), std::span<std::uint8_t>(buffers.inside));
+            for (std::size_t l = 0; l < n; ++l) {
+                buffers.ok[l] = buffers.ok[l] && buffers.inside[l];
+            }
+        }
+
+        for (std::size_t l = 0; l < n; ++l) {
+            if (!buffers.pending[l]) {
+                continue;
+            }
+            tracer &  s = lanes[l];
+            float     h = buffers.h[l];
+            glm::vec3 next(0.0f);
+            glm::vec3 error_vector(0.0f);
+            for (int j = 0; j < to_next; ++j) {
+                next += scheme.b[j] * buffers.k[j][l];
+            }
+            next = s.position + h * next;
+
+            if (!buffers.ok[l]) {
+                if (h <= min_step) {
+                    running[l] = 0;
+                    continue;
+                }
+                s.h = std::max(0.5f * h, min_step);
+                continue;
+            }
+            float factor = 1.0f;
+            if (adaptive) {
+                for (int j = 0; j < scheme.stages; ++j) {
+                    error_vector += scheme.e[j] * buffers.k[j][l];
+                }
+                float error = glm::length(h * error_vector);
+                factor      = error > 0.0f ? 0.9f * std::pow(options.tolerance / error, 0.2f) : 5.0f;
+                factor      = std::clamp(factor, 0.2f, 5.0f);
+                if (error > options.tolerance && h > min_step) {
+                    s.h = std::max(h * factor, min_step);
+                    continue;
+                }
+            }
+
+            s.position = next;
+            s.t        = buffers.clipped[l] ? t_end : s.t + h;
+            s.steps++;
+            if (adaptive && !buffers.clipped[l]) {
+                s.h = std::clamp(h * factor, min_step, std::max(options.max_step, min_step));
+            }
+            if (!emit(l, s)) {
+                running[l] = 0;
+            }
+        }
+    }
+}
+
+void append_point(std::vector<float> & line, const glm::vec3 & p, float speed, double t) {
+    line.insert(line.end(), { p.x, p.y, p.z, speed, float(t) });
+}
+
+mesh_data assemble(std::vector<std::vector<float>> & lines) {
+    mesh_data out;
+    out.vertex_stride = line_vertex_stride;
+    for (const std::vector<float> & line : lines) {
+        std::size_t points = line.size() / line_vertex_stride;
+        if (points < 2) {
+            continue;
+        }
+        auto first = static_cast<std::uint32_t>(out.vertex_count());
+        out.vertices.insert(out.vertices.end(), line.begin(), line.end());
+        for (std::uint32_t p = 1; p < points; ++p) {
+            out.indices.push_back(first + p - 1);
+            out.indices.push_back(first + p);
+        }
+    }
+    out.charge_memory();
+    return out;
+}
+
+// streamlines follow the normalized velocity, so t is arc length and the step a distance; lines[i] gets the line
+// of seeds[i] in one direction
+void trace_batch(const vector_field &              field,
+                 std::span<const glm::vec3>        seeds,
+                 float                             direction,
+                 const streamline_options &        options,
+                 std::span<std::vector<float>>     lines) {
+    std::vector<tracer>       lanes(seeds.size());
+    std::vector<std::uint8_t> running(seeds.size(), 0);
+    for (std::size_t l = 0; l < seeds.size(); ++l) {
+        glm::vec3 velocity;
+        if (!field.sample(seeds[l], velocity) || glm::length(velocity) < options.min_speed) {
+            continue;
+        }
+        append_point(lines[l], seeds[l], glm::length(velocity), 0.0);
+        lanes[l]   = tracer{ seeds[l], 0.0, options.step };
+        running[l] = 1;
+    }
+
+    auto sample = [&field, direction, &options](std::span<const glm::vec3> points,
+                                                std::span<const double>,
+                                                std::span<glm::vec3>    directions,
+                                                std::span<std::uint8_t> inside) {
+        field.sample(points, directions, inside);
+        for (glm::vec3 & d : directions) {
+            float speed = glm::length(d);
+            d           = speed >= options.min_speed ? d * (direction / speed) : glm::vec3(0.0f);
+        }
+    };
+    auto emit = [&field, direction, &options, lines](std::size_t l, const tracer & s) {
+        glm::vec3 vel;
+        if (!field.sample(s.position, vel)) {
+            return false;
+        }
+        float speed = glm::length(vel);
+        append_point(lines[l], s.position, speed, direction * s.t);
+        return speed >= options.min_speed;
+    };
+    advance(sample, std::span<tracer>(lanes), std::span<std::uint8_t>(running), double(options.max_length), options,
+            emit);
+}
+
+}  // namespace
+
+mesh_data trace_streamlines(const vector_field &       field,
+                            std::span<const glm::vec3> seeds,
+                            const streamline_options & options,
+                            velm::job_system &         jobs) {
+    std::vector<std::vector<float>> lines(seeds.size());
+    velm::parallel_for(
+        0, seeds.size(), options.seeds_per_job,
+        [&](std::size_t first, std::size_t last) {
+            std::span<std::vector<float>> downstream(lines.data() + first, last - first);
+            trace_batch(field, seeds.subspan(first, last - first), 1.0f, options, downstream);
+            if (!options.both_directions) {
+                return;
+            }
+            std::vector<std::vector<float>> upstream(last - first);
+            trace_batch(field, seeds.subspan(first, last - first), -1.0f, options, upstream);
+            for (std::size_t l = 0; l < upstream.size(); ++l) {
+                if (downstream[l].empty()) {
+                    continue;
+                }
+                // upstream part reversed in front of the seed, which both halves share
+                std::vector<float> joined;
+                joined.reserve(upstream[l].size() + downstream[l].size());
+                for (std::size_t p = upstream[l].size() / line_vertex_stride; p > 1; --p) {
+                    auto point = upstream[l].begin() + std::ptrdiff_t((p - 1) * line_vertex_stride);
+                    joined.insert(joined.end(), point, point + line_vertex_stride);
+                }
+                joined.insert(joined.end(), downstream[l].begin(), downstream[l].end());
+                downstream[l] = std::move(joined);
+            }
+        },
+        jobs);
+    return assemble(lines);
+}
+
+mesh_data trace_pathlines(const pathline_series &    series,
+                          std::span<const glm::vec4> seeds,
+                          const streamline_options & options,
+                          velm::job_system &         jobs) {
+    std::vector<std::vector<float>> lines(seeds.size());
+    std::vector<tracer>             particles(seeds.size());
+    // 0 waiting for its release time, 1 moving, 2 finished
+    std::vector<std::uint8_t> phase(seeds.size(), 0);
+
+    std::span<const double> times = series.times;
+    for (std::size_t seed = 0; seed < seeds.size(); ++seed) {
+        if (times.size() < 2 || seeds[seed].w < times.front() || seeds[seed].w >= times.back()) {
+            phase[seed] = 2;
+        }
+    }
+
+    for (std::size_t step = 0; step + 1 < times.size(); ++step) {
+        std::shared_ptr<const vector_field> f0 = series.steps.get(step);
+        std::shared_ptr<const vector_field> f1 = series.steps.get(step + 1);
+        double                              t0 = times[step];
+        double                              t1 = times[step + 1];
+
+        auto blend = [t0, t1](double t) { return static_cast<float>(std::clamp((t - t0) / (t1 - t0), 0.0, 1.0)); };
+        auto sample_one = [&f0, &f1, &blend](const glm::vec3 & p, double t, glm::vec3 & vel) {
+            glm::vec3 a, b;
+            if (!f0->sample(p, a) || !f1->sample(p, b)) {
+                return false;
+            }
+            vel = glm::mix(a, b, blend(t));
+            return true;
+        };
+
+        velm::parallel_for(
+            0, seeds.size(), options.seeds_per_job,
+            [&](std::size_t first, std::size_t last) {
+                std::size_t               n = last - first;
+                std::vector<std::uint8_t> running(n, 0);
+                for (std::size_t s = first; s < last; ++s) {
+                    if (phase[s] == 2 || (phase[s] == 0 && seeds[s].w >= t1)) {
+                        continue;
+                    }
+                    if (phase[s] == 0) {
+                        glm::vec3 p(seeds[s]);
+                        glm::vec3 vel;
+                        if (!sample_one(p, seeds[s].w, vel)) {
+                            phase[s] = 2;
+                            continue;
+                        }
+                        particles[s] = tracer{ p, double(seeds[s].w), options.step };
+                        append_point(lines[s], p, glm::length(vel), seeds[s].w);
+                        phase[s] = 1;
+                    }
+                    running[s - first] = 1;
+                }
+
+                std::vector<glm::vec3>    later(n);
+                std::vector<std::uint8_t> later_inside(n);
+                auto sample = [&](std::span<const glm::vec3> points,
+                                  std::span<const double>    at,
+                                  std::span<glm::vec3>       vel,
+                                  std::span<std::uint8_t>    inside) {
+                    f0->sample(points, vel, inside);
+                    f1->sample(points, later, later_inside);
+                    for (std::size_t l = 0; l < points.size(); ++l) {
+                        inside[l] = inside[l] && later_inside[l];
+                        vel[l]    = glm::mix(vel[l], later[l], blend(at[l]));
+                    }
+                };
+                // particles at rest may get moving again later, only streamlines stop on stagnation
+                auto emit = [&](std::size_t l, const tracer & state) {
+                    glm::vec3 vel;
+                    sample_one(state.position, state.t, vel);
+                    append_point(lines[first + l], state.position, glm::length(vel), state.t);
+                    return true;
+                };
+                advance(sample, std::span<tracer>(particles.data() + first, n), std::span<std::uint8_t>(running), t1,
+                        options, emit);
+                for (std::size_t l = 0; l < n; ++l) {
+                    if (phase[first + l] == 1 && !running[l]) {
+                        phase[first + l] = 2;
+                    }
+                }
+            },
+            jobs);
+    }
+    return assemble(lines);
+}
+}  // namespace velm_dr
@@ -0,0 +1,35 @@
+#include "velm/frame_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace velm {
+
+frame_governor::frame_governor() = default;
+
+frame_governor::frame_governor(const settings & config) : config_(config) {}
+
+void frame_governor::frame_done(float frame_ms, bool moving) {
+    float cost = frame_ms / quality_;
+    full_cost_ = full_cost_ <= 0.0f ? cost : full_cost_ + config_.smoothing * (cost - full_cost_);
+    if (moving) {
+        quality_ = std::clamp(config_.target_ms / std::max(full_cost_, 1e-3f), config_.min_quality, 1.0f);
+    } else {
+        quality_ = std::min(1.0f, quality_ * config_.refine_factor);
+    }
+}
+
+void frame_governor::reset() {
+    quality_   = 1.0f;
+    full_cost_ = 0.0f;
+}
+
+std::uint32_t frame_governor::raymarch_steps(std::uint32_t full_steps, std::uint32_t min_steps) const {
+    auto steps = static_cast<std::uint32_t>(std::lround(float(full_steps) * quality_));
+    return std::min(full_steps, std::max(steps, min_steps));
+}
+
+float frame_governor::render_scale() const {
+    return std::sqrt(quality_);
+}
+}  // namespace velm
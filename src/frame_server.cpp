@@ -0,0 +1,724 @@
+#include "velm/frame_server.h"
+
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <arpa/inet.h>
+#    include <fcntl.h>
+#    include <netinet/in.h>
+#    include <netinet/tcp.h>
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <unistd.h>
+#endif
+
+namespace velm_render {
+
+struct frame_server::viewer {
+    int               fd;
+    bool              keyed = false;  // encoder thread: has a key frame of the current size
+    std::atomic<bool> closed{ false };
+    // network thread: received bytes short of a whole input_event
+    std::vector<std::uint8_t> partial;
+
+    explicit viewer(int socket) : fd(socket) {}
+
+    ~viewer() { close(fd); }
+};
+
+namespace {
+
+[[noreturn]] void socket_error(const char * who, const char * what) {
+    throw std::runtime_error(std::string(who) + ": " + what + ": " + std::strerror(errno));
+}
+
+sockaddr_in make_address(const std::string & address, std::uint16_t port, const char * who) {
+    sockaddr_in result{};
+    result.sin_family = AF_INET;
+    result.sin_port   = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &result.sin_addr) != 1) {
+        throw std::invalid_argument(std::string(who) + ": not an IPv4 address: " + address);
+    }
+    return result;
+}
+
+void set_no_delay(int fd) {
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+}
+
+// blocking, false when the peer is gone
+bool send_all(int fd, std::span<const std::uint8_t> bytes) {
+    while (!bytes.empty()) {
+        ssize_t sent = ::send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes = bytes.subspan(std::size_t(sent));
+    }
+    return true;
+}
+
+// a message on its way to a viewer's non-blocking socket
+struct outgoing {
+    int                           fd;
+    std::span<const std::uint8_t> rest;  // not taken by the socket yet
+    bool                          failed = false;
+};
+
+/*
+ * Writes all messages at once, polling the sockets that are full, so a slow viewer delays the others by no more
+ * than the deadline. Messages that failed or were not taken completely by the deadline are marked failed.
+ */
+void send_until(std::span<outgoing> messages, std::chrono::steady_clock::time_point deadline) {
+    std::vector<pollfd> full;
+    for (;;) {
+        full.clear();
+        for (outgoing & m : messages) {
+            while (!m.failed && !m.rest.empty()) {
+                ssize_t sent = ::send(m.fd, m.rest.data(), m.rest.size(), MSG_NOSIGNAL);
+                if (sent > 0) {
+                    m.rest = m.rest.subspan(std::size_t(sent));
+                } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    full.push_back({ m.fd, POLLOUT, 0 });
+                    break;
+                } else if (sent == 0 || errno != EINTR) {
+                    m.failed = true;
+                }
+            }
+        }
+        if (full.empty()) {
+            return;
+        }
+        auto left  = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        int  ready = left.count() > 0 ? poll(full.data(), nfds_t(full.size()), int(left.count())) : 0;
+        if (ready == 0 || (ready < 0 && errno != EINTR)) {
+            for (outgoing & m : messages) {
+                m.failed = m.failed || !m.rest.empty();
+            }
+            return;
+        }
+    }
+}
+
+void receive_all(int fd, void * data, std::size_t size) {
+    auto * bytes = static_cast<std::uint8_t *>(data);
+    while (size > 0) {
+        ssize_t got = ::recv(fd, bytes, size, 0);
+        if (got == 0) {
+            errno = ECONNRESET;
+            socket_error("frame_client", "server closed the connection");
+        }
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            socket_error("frame_client", "recv failed");
+        }
+        bytes += got;
+        size -= std::size_t(got);
+    }
+}
+
+[[noreturn]] void corrupt() {
+    throw std::runtime_error("frame_client: malformed frame message");
+}
+
+void put_varint(std::vector<std::uint8_t> & out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(std::uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(std::uint8_t(value));
+}
+
+bool get_varint(const std::uint8_t *& in, const std::uint8_t * end, std::size_t & value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        std::uint8_t byte = *in++;
+        value |= std::size_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// shorter runs of unchanged bytes stay inside the literals, a token costs at least two bytes
+constexpr std::size_t min_zero_run = 4;
+
+std::size_t skip_zeros(std::span<const std::uint8_t> bytes, std::size_t at) {
+    for (std::uint64_t word = 0; at + sizeof(word) <= bytes.size(); at += sizeof(word)) {
+        std::memcpy(&word, bytes.data() + at, sizeof(word));
+        if (word != 0) {
+            break;
+        }
+    }
+    while (at < bytes.size() && bytes[at] == 0) {
+        ++at;
+    }
+    return at;
+}
+
+// delta is the tile XOR the previous one, unchanged bytes at the end are left out
+void encode_xor_rle(std::span<const std::uint8_t> delta, std::vector<std::uint8_t> & out) {
+    std::size_t n = delta.size();
+    for (std::size_t at = 0; at < n;) {
+        std::size_t literal = skip_zeros(delta, at);
+        if (literal == n) {
+            return;
+        }
+        std::size_t end = literal;
+        while (end < n) {
+            if (delta[end] != 0) {
+                ++end;
+                continue;
+            }
+            std::size_t zeros = end;
+            while (zeros < n && zeros - end < min_zero_run && delta[zeros] == 0) {
+                ++zeros;
+            }
+            if (zeros == n || zeros - end == min_zero_run) {
+                break;
+            }
+            end = zeros;
+        }
+        put_varint(out, literal - at);
+        put_varint(out, end - literal);
+        out.insert(out.end(), delta.begin() + std::ptrdiff_t(literal), delta.begin() + std::ptrdiff_t(end));
+        at = end;
+    }
+}
+
+// false when the tokens do not fit the tile
+bool decode_xor_rle(const std::uint8_t * in, const std::uint8_t * end, std::span<std::uint8_t> tile) {
+    std::size_t at = 0;
+    while (in < end) {
+        std::size_t skip  = 0;
+        std::size_t count = 0;
+        if (!get_varint(in, end, skip) || !get_varint(in, end, count)) {
+            return false;
+        }
+        if (skip > tile.size() - at || count > tile.size() - at - skip || count > std::size_t(end - in)) {
+            return false;
+        }
+        at += skip;
+        for (std::size_t i = 0; i < count; ++i) {
+            tile[at + i] ^= in[i];
+        }
+        in += count;
+        at += count;
+    }
+    return true;
+}
+
+struct tile_rect {
+    std::size_t x;
+    std::size_t y;
+    std::size_t width;
+    std::size_t height;
+};
+
+std::size_t tiles_across(std::uint32_t size, std::uint32_t tile) {
+    return (std::size_t(size) + tile - 1) / tile;
+}
+
+tile_rect tile_at(std::uint32_t width, std::uint32_t height, std::uint32_t tile, std::size_t index) {
+    std::size_t across = tiles_across(width, tile);
+    std::size_t x      = index % across * tile;
+    std::size_t y      = index / across * tile;
+    return { x, y, std::min<std::size_t>(tile, width - x), std::min<std::size_t>(tile, height - y) };
+}
+
+// rounds every channel to a multiple of 2^bits, saturating at the largest one
+void drop_low_bits(std::vector<std::uint8_t> & pixels, std::uint32_t bits) {
+    if (bits == 0) {
+        return;
+    }
+    bits              = std::min(bits, 7u);
+    unsigned     half = 1u << (bits - 1);
+    std::uint8_t mask = std::uint8_t(0xffu << bits);
+    for (std::uint8_t & value : pixels) {
+        value = std::uint8_t(std::min(value + half, 255u) & mask);
+    }
+}
+
+/*
+ * Replaces out with a frame message of the tiles of current that differ from reference, or when reference is null
+ * a key frame of every tile that is not all zero. Returns the number of tiles in the message.
+ */
+std::size_t encode_frame(const rgba_frame &          current,
+                         const rgba_frame *          reference,
+                         std::uint32_t               tile,
+                         std::uint64_t               number,
+                         std::vector<std::uint8_t> & out,
+                         std::vector<std::uint8_t> & delta) {
+    VELM_PROFILE_FUNCTION();
+    out.resize(sizeof(frame_message_header));
+    std::size_t count = 0;
+    std::size_t total = tiles_across(current.width, tile) * tiles_across(current.height, tile);
+    for (std::size_t index = 0; index < total; ++index) {
+        tile_rect   rect      = tile_at(current.width, current.height, tile, index);
+        std::size_t row_bytes = rect.width * 4;
+        auto        row_of    = [&](const rgba_frame & frame, std::size_t row) {
+            return frame.pixels.data() + ((rect.y + row) * frame.width + rect.x) * 4;
+        };
+
+        bool changed = reference == nullptr;
+        for (std::size_t row = 0; row < rect.height && !changed; ++row) {
+            changed = std::memcmp(row_of(current, row), row_of(*reference, row), row_bytes) != 0;
+        }
+        if (!changed) {
+            continue;
+        }
+        delta.resize(row_bytes * rect.height);
+        for (std::size_t row = 0; row < rect.height; ++row) {
+            const std::uint8_t * now = row_of(current, row);
+            std::uint8_t *       d   = delta.data() + row * row_bytes;
+            if (reference == nullptr) {
+                std::memcpy(d, now, row_bytes);
+                continue;
+            }
+            const std::uint8_t * before = row_of(*reference, row);
+            for (std::size_t b = 0; b < row_bytes; ++b) {
+                d[b] = now[b] ^ before[b];
+            }
+        }
+
+        std::size_t at = out.size();
+        out.resize(at + sizeof(tile_header));
+        encode_xor_rle(delta, out);
+        std::size_t encoded = out.size() - at - sizeof(tile_header);
+        tile_header header{ std::uint32_t(index), tile_codec::XOR_RLE, std::uint32_t(encoded) };
+        if (header.bytes == 0) {
+            // all zero in a key frame, the viewer clears the frame anyway
+            out.resize(at);
+            continue;
+        }
+        if (header.bytes >= delta.size()) {
+            // noise does not compress, send the pixels as they are
+            out.resize(at + sizeof(tile_header));
+            for (std::size_t row = 0; row < rect.height; ++row) {
+                out.insert(out.end(), row_of(current, row), row_of(current, row) + row_bytes);
+            }
+            header.codec = tile_codec::RAW;
+            header.bytes = std::uint32_t(delta.size());
+        }
+        std::memcpy(out.data() + at, &header, sizeof(header));
+        ++count;
+    }
+
+    frame_message_header header{};
+    header.magic         = frame_magic;
+    header.flags         = reference == nullptr ? frame_key : 0;
+    header.number        = number;
+    header.width         = current.width;
+    header.height        = current.height;
+    header.tile          = tile;
+    header.tile_count    = std::uint32_t(count);
+    header.payload_bytes = out.size() - sizeof(header);
+    std::memcpy(out.data(), &header, sizeof(header));
+    return count;
+}
+
+}  // namespace
+
+void to_rgba8(const composite_image & image,
+              const glm::vec3 &       background,
+              rgba_frame &            frame,
+              velm::job_system &      jobs) {
+    frame.width  = image.width;
+    frame.height = image.height;
+    frame.pixels.resize(image.pixel_count() * 4);
+    velm::parallel_for(
+        0, image.height, 16,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t p = first * image.width; p < last * image.width; ++p) {
+                to_rgb8(image.color[p], background, &frame.pixels[p * 4]);
+                frame.pixels[p * 4 + 3] = 255;
+            }
+        },
+        jobs);
+}
+
+frame_server::frame_server(const frame_server_options & options) : options_(options) {
+    if (options_.tile == 0) {
+        throw std::invalid_argument("frame_server: tile must not be 0");
+    }
+    sockaddr_in address = make_address(options_.address, options_.port, "frame_server");
+    listener            = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        socket_error("frame_server", "socket failed");
+    }
+    auto fail = [this](const char * what) {
+        int error = errno;
+        close(listener);
+        for (int fd : wakeup) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        errno = error;
+        socket_error("frame_server", what);
+    };
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        fail("bind failed");
+    }
+    if (listen(listener, 8) != 0) {
+        fail("listen failed");
+    }
+    socklen_t length = sizeof(address);
+    if (getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        fail("getsockname failed");
+    }
+    port_ = ntohs(address.sin_port);
+    if (pipe(wakeup) != 0) {
+        fail("pipe failed");
+    }
+
+    encoder = std::thread([this] { encode_loop(); });
+    network = std::thread([this] { network_loop(); });
+}
+
+frame_server::~frame_server() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work.notify_all();
+    char                     byte    = 0;
+    [[maybe_unused]] ssize_t written = write(wakeup[1], &byte, 1);
+    encoder.join();
+    network.join();
+    viewers.clear();
+    close(listener);
+    close(wakeup[0]);
+    close(wakeup[1]);
+}
+
+void frame_server::submit(std::uint32_t width, std::uint32_t height, std::span<const std::uint8_t> rgba) {
+    if (rgba.size() != std::size_t(width) * height * 4) {
+        throw std::invalid_argument("frame_server: frame size does not match its pixels");
+    }
+    staging.width  = width;
+    staging.height = height;
+    staging.pixels.assign(rgba.begin(), rgba.end());
+    publish();
+}
+
+void frame_server::submit(const composite_image & image, const glm::vec3 & background) {
+    to_rgba8(image, background, staging);
+    publish();
+}
+
+void frame_server::publish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (has_pending) {
+            ++stats_.dropped;
+        }
+        // the buffer of the replaced or already encoded frame is reused by the next submit
+        std::swap(staging, pending);
+        has_pending = true;
+        ++stats_.submitted;
+    }
+    work.notify_one();
+}
+
+void frame_server::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !has_pending && !encoding; });
+}
+
+std::vector<input_event> frame_server::poll_input() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::exchange(input, {});
+}
+
+frame_server_stats frame_server::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame_server_stats          result = stats_;
+    result.viewers                     = viewers.size();
+    return result;
+}
+
+void frame_server::encode_loop() {
+    rgba_frame                           current;
+    rgba_frame                           reference;  // what keyed viewers show
+    std::vector<std::uint8_t>            delta_message;
+    std::vector<std::uint8_t>            key_message;
+    std::vector<std::uint8_t>            scratch;
+    std::vector<std::shared_ptr<viewer>> targets;
+    std::vector<outgoing>                messages;
+    std::vector<viewer *>                receivers;  // of messages
+    std::uint64_t                        number = 0;
+    std::uint64_t                        seen   = 0;  // joined as of the last round
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        work.wait(lock, [&] { return stop || has_pending || joined != seen; });
+        if (stop) {
+            return;
+        }
+        bool fresh = has_pending;
+        if (fresh) {
+            std::swap(current, pending);
+            has_pending = false;
+        }
+        seen     = joined;
+        encoding = true;
+        targets  = viewers;
+        lock.unlock();
+
+        std::size_t delta_tiles = 0;
+        std::size_t key_tiles   = 0;
+        delta_message.clear();
+        key_message.clear();
+        if (fresh) {
+            drop_low_bits(current.pixels, options_.drop_bits);
+            if (current.width != reference.width || current.height != reference.height) {
+                // deltas need the previous frame at the same size
+                for (const std::shared_ptr<viewer> & v : targets) {
+                    v->keyed = false;
+                }
+            } else {
+                delta_tiles = encode_frame(current, &reference, options_.tile, number + 1, delta_message, scratch);
+            }
+            std::swap(current, reference);
+            ++number;
+        }
+
+        messages.clear();
+        receivers.clear();
+        for (const std::shared_ptr<viewer> & v : targets) {
+            if (v->closed.load(std::memory_order_relaxed) || number == 0) {
+                continue;
+            }
+            const std::vector<std::uint8_t> * message = &delta_message;
+            if (!v->keyed) {
+                if (key_message.empty()) {
+                    key_tiles = encode_frame(reference, nullptr, options_.tile, number, key_message, scratch);
+                }
+                message = &key_message;
+            } else if (delta_tiles == 0) {
+                // nothing changed
+                continue;
+            }
+            messages.push_back({ v->fd, *message });
+            receivers.push_back(v.get());
+        }
+        send_until(messages, std::chrono::steady_clock::now() + options_.send_timeout);
+
+        std::uint64_t tiles = 0;
+        std::uint64_t bytes = 0;
+        for (std::size_t m = 0; m < messages.size(); ++m) {
+            viewer & v = *receivers[m];
+            if (messages[m].failed) {
+                // fell behind or went away, the network thread drops it once the shutdown wakes its poll
+                v.closed.store(true, std::memory_order_relaxed);
+                shutdown(v.fd, SHUT_RDWR);
+                continue;
+            }
+            tiles += v.keyed ? delta_tiles : key_tiles;
+            bytes += v.keyed ? delta_message.size() : key_message.size();
+            v.keyed = true;
+        }
+        targets.clear();
+
+        lock.lock();
+        stats_.encoded += fresh ? 1 : 0;
+        stats_.tiles_sent += tiles;
+        stats_.bytes_sent += bytes;
+        encoding = false;
+        lock.unlock();
+        idle.notify_all();
+    }
+}
+
+void frame_server::network_loop() {
+    std::vector<pollfd>                  fds;
+    std::vector<std::shared_ptr<viewer>> watched;
+    std::vector<input_event>             events;
+    std::uint8_t                         buffer[4096];
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::erase_if(viewers, [](const std::shared_ptr<viewer> & v) { return v->closed.load(); });
+            watched = viewers;
+        }
+        fds.clear();
+        fds.push_back({ wakeup[0], POLLIN, 0 });
+        fds.push_back({ listener, POLLIN, 0 });
+        for (const std::shared_ptr<viewer> & v : watched) {
+            fds.push_back({ v->fd, POLLIN, 0 });
+        }
+        if (poll(fds.data(), nfds_t(fds.size()), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                set_no_delay(fd);
+                // the encoder writes to all viewers at once, see send_until
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    viewers.push_back(std::make_shared<viewer>(fd));
+                    ++joined;
+                }
+                work.notify_one();
+            }
+        }
+
+        events.clear();
+        for (std::size_t i = 0; i < watched.size(); ++i) {
+            if (fds[i + 2].revents == 0) {
+                continue;
+            }
+            viewer & v   = *watched[i];
+            ssize_t  got = recv(v.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+            if (got <= 0) {
+                v.closed.store(true);
+                continue;
+            }
+            v.partial.insert(v.partial.end(), buffer, buffer + got);
+            std::size_t whole = v.partial.size() / sizeof(input_event) * sizeof(input_event);
+            for (std::size_t at = 0; at < whole; at += sizeof(input_event)) {
+                input_event event;
+                std::memcpy(&event, v.partial.data() + at, sizeof(event));
+                // unknown types come from newer viewers
+                if (event.type <= input_type::RESIZE) {
+                    events.push_back(event);
+                }
+            }
+            v.partial.erase(v.partial.begin(), v.partial.begin() + std::ptrdiff_t(whole));
+        }
+        if (!events.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            input.insert(input.end(), events.begin(), events.end());
+        }
+    }
+}
+
+frame_client::frame_client(const std::string & address, std::uint16_t port) {
+    sockaddr_in server = make_address(address, port, "frame_client");
+    fd                 = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        socket_error("frame_client", "socket failed");
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&server), sizeof(server)) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        socket_error("frame_client", "connect failed");
+    }
+    set_no_delay(fd);
+}
+
+frame_client::~frame_client() {
+    close(fd);
+}
+
+bool frame_client::receive(std::chrono::milliseconds timeout) {
+    pollfd p{ fd, POLLIN, 0 };
+    int    ready = poll(&p, 1, int(timeout.count()));
+    if (ready < 0 && errno != EINTR) {
+        socket_error("frame_client", "poll failed");
+    }
+    if (ready <= 0) {
+        return false;
+    }
+
+    frame_message_header header;
+    receive_all(fd, &header, sizeof(header));
+    if (header.magic != frame_magic || header.tile == 0) {
+        corrupt();
+    }
+    payload.resize(header.payload_bytes);
+    receive_all(fd, payload.data(), payload.size());
+
+    if (header.flags & frame_key) {
+        frame_.width  = header.width;
+        frame_.height = header.height;
+        frame_.pixels.assign(frame_.pixel_count() * 4, 0);
+    } else if (header.width != frame_.width || header.height != frame_.height) {
+        corrupt();
+    }
+    std::size_t          total = tiles_across(header.width, header.tile) * tiles_across(header.height, header.tile);
+    const std::uint8_t * in    = payload.data();
+    const std::uint8_t * end   = in + payload.size();
+    for (std::uint32_t t = 0; t < header.tile_count; ++t) {
+        tile_header th;
+        if (std::size_t(end - in) < sizeof(th)) {
+            corrupt();
+        }
+        std::memcpy(&th, in, sizeof(th));
+        in += sizeof(th);
+        if (th.bytes > std::size_t(end - in) || th.index >= total) {
+            corrupt();
+        }
+        tile_rect   rect      = tile_at(header.width, header.height, header.tile, th.index);
+        std::size_t row_bytes = rect.width * 4;
+        auto        row_of    = [&](std::size_t row) {
+            return frame_.pixels.data() + ((rect.y + row) * frame_.width + rect.x) * 4;
+        };
+        if (th.codec == tile_codec::RAW) {
+            if (th.bytes != row_bytes * rect.height) {
+                corrupt();
+            }
+            for (std::size_t row = 0; row < rect.height; ++row) {
+                std::memcpy(row_of(row), in + row * row_bytes, row_bytes);
+            }
+        } else if (th.codec == tile_codec::XOR_RLE) {
+            scratch.resize(row_bytes * rect.height);
+            for (std::size_t row = 0; row < rect.height; ++row) {
+                std::memcpy(scratch.data() + row * row_bytes, row_of(row), row_bytes);
+            }
+            if (!decode_xor_rle(in, in + th.bytes, scratch)) {
+                corrupt();
+            }
+            for (std::size_t row = 0; row < rect.height; ++row) {
+                std::memcpy(row_of(row), scratch.data() + row * row_bytes, row_bytes);
+            }
+        } else {
+            corrupt();
+        }
+        in += th.bytes;
+    }
+
+    number = header.number;
+    tiles  = header.tile_count;
+    bytes  = sizeof(header) + payload.size();
+    key    = (header.flags & frame_key) != 0;
+    return true;
+}
+
+void frame_client::send(const input_event & event) {
+    if (!send_all(fd, { reinterpret_cast<const std::uint8_t *>(&event), sizeof(event) })) {
+        socket_error("frame_client", "send failed");
+    }
+}
+}  // namespace velm_render
@@ -0,0 +1,370 @@
+#include "velm/geometry_cache.h"
+
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace velm_render {
+
+namespace {
+
+constexpr char          file_magic[8] = { 'V', 'E', 'L', 'M', 'G', 'E', 'O', '\0' };
+constexpr std::uint32_t file_version  = 1;
+constexpr std::size_t   block_align   = 16;
+
+struct file_header {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t key_bytes;  // the key text follows the header
+    std::uint32_t lod_count;
+    std::uint32_t format;
+    float         center[3];
+    float         scale[3];
+    std::uint64_t table_offset;
+    std::uint64_t file_bytes;
+};
+
+struct file_lod {
+    std::uint64_t vertex_offset;
+    std::uint64_t vertex_bytes;
+    std::uint64_t index_offset;
+    std::uint64_t index_bytes;
+    std::uint32_t index32;
+    float         geometric_error;
+};
+
+std::uint64_t align_up(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool within(std::uint64_t offset, std::uint64_t bytes, std::uint64_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// the whole file, read only; nullptr when it cannot be opened or is shorter than a header
+void * map_file(const std::filesystem::path & file, std::size_t & size) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(file_header)) {
+        close(fd);
+        return nullptr;
+    }
+    size           = std::size_t(info.st_size);
+    void * mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return mapping == MAP_FAILED ? nullptr : mapping;
+}
+
+void unmap_file(void * mapping, std::size_t size) {
+    munmap(mapping, size);
+}
+
+#else
+
+// no mmap: read the file into a buffer aligned like the blocks in it. Unlike a mapping this keeps entries readable
+// when the cache deletes their file on platforms that refuse to delete mapped files.
+void * map_file(const std::filesystem::path & file, std::size_t & size) {
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return nullptr;
+    }
+    std::streamoff end = in.tellg();
+    if (end < 0 || std::size_t(end) < sizeof(file_header)) {
+        return nullptr;
+    }
+    size          = std::size_t(end);
+    void * buffer = ::operator new(size, std::align_val_t(block_align));
+    in.seekg(0);
+    if (!in.read(static_cast<char *>(buffer), std::streamsize(size))) {
+        ::operator delete(buffer, std::align_val_t(block_align));
+        return nullptr;
+    }
+    return buffer;
+}
+
+void unmap_file(void * mapping, std::size_t) {
+    ::operator delete(mapping, std::align_val_t(block_align));
+}
+
+#endif
+
+}  // namespace
+
+geometry_key geometry_key::of_file(const std::filesystem::path & source, std::string dataset, std::string parameters) {
+    geometry_key    key;
+    std::error_code error;
+    auto            time = std::filesystem::last_write_time(source, error);
+    key.source           = std::filesystem::absolute(source, error).lexically_normal().string();
+    key.source_mtime     = error ? 0 : std::int64_t(time.time_since_epoch().count());
+    key.dataset          = std::move(dataset);
+    key.parameters       = std::move(parameters);
+    return key;
+}
+
+std::string geometry_key::text() const {
+    return source + '\n' + std::to_string(source_mtime) + '\n' + dataset + '\n' + parameters;
+}
+
+std::uint64_t geometry_key::hash() const {
+    // FNV-1a, stable across runs and platforms unlike std::hash
+    std::uint64_t h = 14695981039346656037ull;
+    for (char c : text()) {
+        h = (h ^ std::uint8_t(c)) * 1099511628211ull;
+    }
+    return h;
+}
+
+std::shared_ptr<const cached_geometry> cached_geometry::map(const std::filesystem::path & file, std::string_view key) {
+    std::size_t size    = 0;
+    void *      mapping = map_file(file, size);
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+
+    std::shared_ptr<cached_geometry> geometry(new cached_geometry());
+    geometry->mapping = mapping;
+    geometry->size    = size;
+    geometry->memory.resize(size);
+
+    // everything is validated against the mapped size, a torn or foreign file is a miss and never read past its end
+    const auto *        bytes  = static_cast<const std::byte *>(mapping);
+    const file_header & header = *reinterpret_cast<const file_header *>(bytes);
+    std::uint64_t       table  = header.table_offset;
+    if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 || header.version != file_version ||
+        header.file_bytes != size || header.format > std::uint32_t(vertex_format::PACKED) ||
+        !within(sizeof(file_header), header.key_bytes, size) || table % alignof(file_lod) != 0 ||
+        !within(table, std::uint64_t(header.lod_count) * sizeof(file_lod), size)) {
+        return nullptr;
+    }
+    std::string_view stored(reinterpret_cast<const char *>(bytes + sizeof(file_header)), header.key_bytes);
+    if (stored != key) {
+        return nullptr;
+    }
+
+    geometry->format_     = vertex_format(header.format);
+    geometry->box_.center = glm::vec3(header.center[0], header.center[1], header.center[2]);
+    geometry->box_.scale  = glm::vec3(header.scale[0], header.scale[1], header.scale[2]);
+    const auto * entries  = reinterpret_cast<const file_lod *>(bytes + table);
+    geometry->lods_.reserve(header.lod_count);
+    for (std::uint32_t l = 0; l < header.lod_count; ++l) {
+        const file_lod & entry = entries[l];
+        if (!within(entry.vertex_offset, entry.vertex_bytes, size) ||
+            !within(entry.index_offset, entry.index_bytes, size)) {
+            return nullptr;
+        }
+        lod level;
+        level.vertices        = { bytes + entry.vertex_offset, std::size_t(entry.vertex_bytes) };
+        level.indices         = { bytes + entry.index_offset, std::size_t(entry.index_bytes) };
+        level.index32         = entry.index32 != 0;
+        level.geometric_error = entry.geometric_error;
+        geometry->lods_.push_back(level);
+    }
+    return geometry;
+}
+
+void cached_geometry::write(const std::filesystem::path & file,
+                            std::string_view              key,
+                            vertex_format                 format,
+                            const quantization &          box,
+                            std::span<const gpu_geometry> levels,
+                            std::span<const float>        geometric_errors) {
+    if (geometric_errors.size() != levels.size()) {
+        throw std::invalid_argument("cached_geometry: one geometric error per level is needed");
+    }
+
+    file_header header{};
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version      = file_version;
+    header.key_bytes    = static_cast<std::uint32_t>(key.size());
+    header.lod_count    = static_cast<std::uint32_t>(levels.size());
+    header.format       = std::uint32_t(format);
+    header.table_offset = align_up(sizeof(file_header) + key.size(), block_align);
+    for (int c = 0; c < 3; ++c) {
+        header.center[c] = box.center[c];
+        header.scale[c]  = box.scale[c];
+    }
+
+    std::vector<file_lod> table(levels.size());
+    std::uint64_t         offset = align_up(header.table_offset + table.size() * sizeof(file_lod), block_align);
+    for (std::size_t l = 0; l < levels.size(); ++l) {
+        table[l].vertex_offset   = offset;
+        table[l].vertex_bytes    = levels[l].vertices.size();
+        table[l].index_offset    = align_up(offset + table[l].vertex_bytes, block_align);
+        table[l].index_bytes     = levels[l].indices.size();
+        table[l].index32         = levels[l].index32 ? 1 : 0;
+        table[l].geometric_error = geometric_errors[l];
+        offset                   = align_up(table[l].index_offset + table[l].index_bytes, block_align);
+    }
+    header.file_bytes = offset;
+
+    // written next to the target and renamed over it, so readers only ever see complete files
+    std::filesystem::path partial = file;
+    partial += ".partial";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        auto          pad_to = [&](std::uint64_t position) {
+            static constexpr char zeros[block_align] = {};
+            auto                  at                 = std::uint64_t(out.tellp());
+            out.write(zeros, std::streamsize(position - at));
+        };
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(key.data(), std::streamsize(key.size()));
+        pad_to(header.table_offset);
+        out.write(reinterpret_cast<const char *>(table.data()), std::streamsize(table.size() * sizeof(file_lod)));
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            pad_to(table[l].vertex_offset);
+            out.write(reinterpret_cast<const char *>(levels[l].vertices.data()),
+                      std::streamsize(levels[l].vertices.size()));
+            pad_to(table[l].index_offset);
+            out.write(reinterpret_cast<const char *>(levels[l].indices.data()),
+                      std::streamsize(levels[l].indices.size()));
+        }
+        pad_to(header.file_bytes);
+        if (!out) {
+            std::filesystem::remove(partial);
+            throw std::runtime_error("cached_geometry: cannot write " + partial.string());
+        }
+    }
+    std::filesystem::rename(partial, file);
+}
+
+cached_geometry::~cached_geometry() {
+    if (mapping != nullptr) {
+        unmap_file(mapping, size);
+    }
+}
+
+geometry_cache::geometry_cache(std::filesystem::path directory, std::uint64_t max_bytes) :
+    dir(std::move(directory)), cap(max_bytes) {
+    std::filesystem::create_directories(dir);
+}
+
+std::filesystem::path geometry_cache::file_of(const geometry_key & key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vgeo", static_cast<unsigned long long>(key.hash()));
+    return dir / name;
+}
+
+std::shared_ptr<const cached_geometry> geometry_cache::load(const geometry_key & key) {
+    VELM_PROFILE_FUNCTION();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::filesystem::path       file = file_of(key);
+    std::error_code             error;
+    if (!std::filesystem::exists(file, error)) {
+        return nullptr;
+    }
+    std::shared_ptr<const cached_geometry> geometry = cached_geometry::map(file, key.text());
+    if (!geometry) {
+        // stale version, torn write or a hash collision with another key: the slot is reused by the next store
+        std::filesystem::remove(file, error);
+        return nullptr;
+    }
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+    return geometry;
+}
+
+std::shared_ptr<const cached_geometry> geometry_cache::store(const geometry_key &                key,
+                                                             std::span<const velm_dr::mesh_data> chain,
+                                                             const vertex_attributes &           attributes,
+                                                             vertex_format                       packing) {
+    VELM_PROFILE_FUNCTION();
+    quantization box;
+    if (packing == vertex_format::PACKED && !chain.empty()) {
+        box = quantization::from_vertices(chain[0]);
+    }
+    std::vector<gpu_geometry> levels;
+    std::vector<float>        errors;
+    levels.reserve(chain.size());
+    for (const velm_dr::mesh_data & level : chain) {
+        levels.push_back(encode(level, attributes, packing, box));
+        errors.push_back(level.geometric_error);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::filesystem::path       file = file_of(key);
+    std::string                 text = key.text();
+    cached_geometry::write(file, text, packing, box, levels, errors);
+    trim(file);
+    return cached_geometry::map(file, text);
+}
+
+void geometry_cache::remove(const geometry_key & key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code             error;
+    std::filesystem::remove(file_of(key), error);
+}
+
+std::uint64_t geometry_cache::disk_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::uint64_t               total = 0;
+    std::error_code             error;
+    for (const auto & entry : std::filesystem::directory_iterator(dir, error)) {
+        if (entry.path().extension() == ".vgeo") {
+            total += entry.file_size(error);
+        }
+    }
+    return total;
+}
+
+void geometry_cache::set_max_bytes(std::uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cap = bytes;
+    trim({});
+}
+
+std::uint64_t geometry_cache::max_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cap;
+}
+
+void geometry_cache::trim(const std::filesystem::path & keep) {
+    if (cap == 0) {
+        return;
+    }
+    struct cache_file {
+        std::filesystem::path           path;
+        std::filesystem::file_time_type used;
+        std::uint64_t                   bytes;
+    };
+    std::vector<cache_file> files;
+    std::uint64_t           total = 0;
+    std::error_code         error;
+    for (const auto & entry : std::filesystem::directory_iterator(dir, error)) {
+        if (entry.path().extension() != ".vgeo") {
+            continue;
+        }
+        cache_file f{ entry.path(), entry.last_write_time(error), entry.file_size(error) };
+        total += f.bytes;
+        if (f.path != keep) {
+            files.push_back(std::move(f));
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const cache_file & a, const cache_file & b) { return a.used < b.used; });
+    for (const cache_file & f : files) {
+        if (total <= cap) {
+            break;
+        }
+        if (std::filesystem::remove(f.path, error)) {
+            total -= f.bytes;
+        }
+    }
+}
+}  // namespace velm_render
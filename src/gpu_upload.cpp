@@ -0,0 +1,60 @@
+#include "velm/gpu_upload.h"
+
+#include <cstdlib>
+
+namespace velm_render {
+
+void upload_fence::wait() const {
+    for (std::uint32_t n = pending(); n != 0; n = pending()) {
+        pending_.wait(n, std::memory_order_acquire);
+    }
+}
+
+void upload_fence::release() {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pending_.notify_all();
+    }
+}
+
+upload_pin * pin_upload(std::shared_ptr<const void> owner, upload_fence * fence) {
+    if (fence != nullptr) {
+        fence->retain();
+    }
+    return new upload_pin{ std::move(owner), fence };
+}
+
+void release_upload(void * /*ptr*/, void * pin) {
+    auto * p = static_cast<upload_pin *>(pin);
+    // drop the storage before signalling, a waiter may free or reuse it right away
+    upload_fence * fence = p->fence;
+    delete p;
+    if (fence != nullptr) {
+        fence->release();
+    }
+}
+
+const bgfx::Memory * make_ref(std::shared_ptr<const void> owner,
+                              std::span<const std::byte>  bytes,
+                              upload_fence *              fence) {
+    if (bytes.size() > UINT32_MAX) {
+        abort();
+    }
+    return bgfx::makeRef(bytes.data(), static_cast<std::uint32_t>(bytes.size()), release_upload,
+                         pin_upload(std::move(owner), fence));
+}
+
+bgfx::TextureHandle create_volume_texture(std::shared_ptr<const velm_DR::ndarray<float, 3>> volume,
+                                          upload_fence *                                    fence,
+                                          std::uint64_t                                     flags) {
+    for (std::size_t d : volume->dims) {
+        if (d == 0 || d > UINT16_MAX) {
+            abort();
+        }
+    }
+    auto width  = static_cast<std::uint16_t>(volume->dims[2]);
+    auto height = static_cast<std::uint16_t>(volume->dims[1]);
+    auto depth  = static_cast<std::uint16_t>(volume->dims[0]);
+    return bgfx::createTexture3D(width, height, depth, false, bgfx::TextureFormat::R32F, flags,
+                                 make_ref(std::move(volume), fence));
+}
+}  // namespace velm_render
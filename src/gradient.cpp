@@ -0,0 +1,62 @@
+#include "velm/gradient.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace velm_dr {
+
+namespace {
+
+std::uint32_t to_unorm8(float v) {
+    return static_cast<std::uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+}  // namespace
+
+void compute_gradient(const velm_DR::ndarray<float, 3> & field,
+                      velm_DR::ndarray<float, 4> &       out,
+                      const gradient_options &           options,
+                      velm::job_system &                 jobs) {
+    if (out.dims[0] != field.dims[0] || out.dims[1] != field.dims[1] || out.dims[2] != field.dims[2] ||
+        out.dims[3] != 3) {
+        abort();
+    }
+
+    float * dst = out.data;
+    for_each_gradient_row<1>({ &field }, 0, field.dims[0], options, jobs,
+                             [dst](std::size_t offset, std::size_t count, const gradient_rows<1> & g) {
+                                 float * d = dst + 3 * offset;
+                                 for (std::size_t k = 0; k < count; ++k) {
+                                     d[3 * k]     = g.d[0][0][k];
+                                     d[3 * k + 1] = g.d[0][1][k];
+                                     d[3 * k + 2] = g.d[0][2][k];
+                                 }
+                             });
+}
+
+void compute_packed_normals(const velm_DR::ndarray<float, 3> & field,
+                            std::span<std::uint32_t>           out,
+                            float                              max_magnitude,
+                            const gradient_options &           options,
+                            velm::job_system &                 jobs) {
+    if (out.size() < field.total_elements()) {
+        abort();
+    }
+
+    std::uint32_t * dst       = out.data();
+    float           inv_range = max_magnitude > 0.0f ? 1.0f / max_magnitude : 0.0f;
+    for_each_gradient_row<1>(
+        { &field }, 0, field.dims[0], options, jobs,
+        [dst, inv_range](std::size_t offset, std::size_t count, const gradient_rows<1> & g) {
+            const float * gx = g.d[0][0];
+            const float * gy = g.d[0][1];
+            const float * gz = g.d[0][2];
+            for (std::size_t k = 0; k < count; ++k) {
+                float length    = std::sqrt(gx[k] * gx[k] + gy[k] * gy[k] + gz[k] * gz[k]);
+                float scale     = length > 0.0f ? 0.5f / length : 0.0f;
+                dst[offset + k] = to_unorm8(gx[k] * scale + 0.5f) | to_unorm8(gy[k] * scale + 0.5f) << 8 |
+                                  to_unorm8(gz[k] * scale + 0.5f) << 16 | to_unorm8(length * inv_range) << 24;
+            }
+        });
+}
+}  // namespace velm_dr
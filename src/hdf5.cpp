@@ -1,3 +1,4 @@
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #if 1
@@ -36,9 +37,9 @@ hdf5_file & hdf5_file::operator=(hdf5_file && other) noexcept {
     return *this;
 }
 
-std::vector<std::string_view> hdf5_file::list_datasets() const {
-    std::vector<std::string_view> dataset_names;
-    H5::Group                     root = file_->openGroup("/");
+std::vector<std::string> hdf5_file::list_datasets() const {
+    std::vector<std::string> dataset_names;
+    H5::Group                root = file_->openGroup("/");
 
     for (hsize_t i = 0; i < root.getNumObjs(); i++) {
         std::string obj_name = root.getObjnameByIdx(i);
@@ -50,6 +51,51 @@ std::vector<std::string_view> hdf5_file::list_datasets() const {
     return dataset_names;
 }
 
+namespace {
+
+void collect_datasets(const H5::Group & group, const std::string & path, std::vector<std::string> & names) {
+    for (hsize_t i = 0; i < group.getNumObjs(); i++) {
+        std::string obj_name  = group.getObjnameByIdx(i);
+        std::string full_name = path == "/" ? "/" + obj_name : path + "/" + obj_name;
+        H5O_type_t  obj_type  = group.childObjType(obj_name);
+        if (obj_type == H5O_TYPE_DATASET) {
+            names.push_back(full_name);
+        } else if (obj_type == H5O_TYPE_GROUP) {
+            collect_datasets(group.openGroup(obj_name), full_name, names);
+        }
+    }
+}
+
+}  // namespace
+
+std::vector<std::string> hdf5_file::list_datasets_recursive(const std::string_view & group) const {
+    std::vector<std::string> dataset_names;
+    std::string              path(group);
+    if (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+    collect_datasets(file_->openGroup(path), path, dataset_names);
+    return dataset_names;
+}
+
+bool hdf5_file::has_attribute(const std::string_view & object, const std::string_view & name) const {
+    std::string path(object);
+    if (file_->childObjType(path) == H5O_TYPE_DATASET) {
+        return file_->openDataSet(path).attrExists(std::string(name));
+    }
+    return file_->openGroup(path).attrExists(std::string(name));
+}
+
+std::vector<double> hdf5_file::get_attribute(const std::string_view & object, const std::string_view & name) const {
+    std::string   path(object);
+    H5::Attribute attribute = file_->childObjType(path) == H5O_TYPE_DATASET
+                                  ? file_->openDataSet(path).openAttribute(std::string(name))
+                                  : file_->openGroup(path).openAttribute(std::string(name));
+    std::vector<double> values(attribute.getSpace().getSimpleExtentNpoints());
+    attribute.read(H5::PredType::NATIVE_DOUBLE, values.data());
+    return values;
+}
+
 std::vector<std::size_t> hdf5_file::get_dataset_shape(const std::string_view & name) const {
     auto dataset = file_->openDataSet(std::string(name));
     dataset.getSpace();
@@ -67,6 +113,38 @@ std::vector<std::size_t> hdf5_file::get_dataset_shape(const std::string_view & n
     return shape;
 }
 
+std::vector<std::size_t> hdf5_file::get_chunk_shape(const std::string_view & name) const {
+    auto                     dataset = file_->openDataSet(std::string(name));
+    H5::DSetCreatPropList    plist   = dataset.getCreatePlist();
+    std::vector<std::size_t> shape;
+    if (plist.getLayout() != H5D_CHUNKED) {
+        return shape;
+    }
+
+    int                  rank = dataset.getSpace().getSimpleExtentNdims();
+    std::vector<hsize_t> h5_chunk(rank);
+    plist.getChunk(rank, h5_chunk.data());
+    shape.assign(h5_chunk.begin(), h5_chunk.end());
+    return shape;
+}
+
+void hdf5_file::load_hyperslab(float *                          buffer,
+                               const std::string_view &         name,
+                               const std::vector<std::size_t> & offset,
+                               const std::vector<std::size_t> & count) const {
+    auto dataset   = file_->openDataSet(std::string(name));
+    auto filespace = dataset.getSpace();
+    if (offset.size() != std::size_t(filespace.getSimpleExtentNdims()) || count.size() != offset.size()) {
+        throw std::invalid_argument("load_hyperslab: offset and count must match the dataset rank");
+    }
+
+    std::vector<hsize_t> h5_offset(offset.begin(), offset.end());
+    std::vector<hsize_t> h5_count(count.begin(), count.end());
+    filespace.selectHyperslab(H5S_SELECT_SET, h5_count.data(), h5_offset.data());
+    H5::DataSpace memspace(int(h5_count.size()), h5_count.data());
+    dataset.read(buffer, H5::PredType::NATIVE_FLOAT, memspace, filespace);
+}
+
 void hdf5_file::load_dataset(void * buffer, const std::string_view & name) const {
     auto dataset = file_->openDataSet(std::string(name));
 
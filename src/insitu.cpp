@@ -0,0 +1,106 @@
+#include "velm/insitu.h"
+
+#include <stdexcept>
+
+namespace velm {
+
+#if defined(__unix__) || defined(__APPLE__)
+
+insitu_source::insitu_source(const std::string & name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("insitu_source: cannot open shared memory segment " + name);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(velm_insitu::segment_header)) {
+        close(fd);
+        throw std::runtime_error("insitu_source: segment " + name + " is too small");
+    }
+    size = std::size_t(info.st_size);
+
+    // mapped writable because futex waits and the atomics live in the segment, the consumer never writes frames
+    void * mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("insitu_source: cannot map segment " + name);
+    }
+    header = static_cast<velm_insitu::segment_header *>(mapping);
+
+    std::uint32_t magic = header->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != velm_insitu::magic || header->version != velm_insitu::version ||
+        header->frames_offset + header->slot_count * header->frame_bytes > size) {
+        munmap(mapping, size);
+        throw std::runtime_error("insitu_source: " + name + " is not a compatible velm_insitu segment");
+    }
+}
+
+insitu_source::~insitu_source() {
+    munmap(header, size);
+}
+
+#else
+
+// the ring relies on shm_open and futexes; there is no producer on other platforms, so fail loudly instead
+insitu_source::insitu_source(const std::string & name) {
+    throw std::runtime_error("insitu_source: shared memory ingestion is not supported on this platform (" + name + ")");
+}
+
+insitu_source::~insitu_source() = default;
+
+#endif
+
+bool insitu_source::wait(std::uint64_t after_sequence, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        // read the notify word before checking so a publish in between wakes the futex wait immediately
+        std::uint32_t seen = header->notify.load(std::memory_order_acquire);
+        if (2 * published() > after_sequence) {
+            return true;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        velm_insitu::wait_notify(header->notify, seen, left.count());
+#else
+        (void) seen;
+#endif
+    }
+}
+
+std::optional<insitu_frame> insitu_source::latest() const {
+    while (true) {
+        std::uint64_t frame = published();
+        if (frame == 0) {
+            return std::nullopt;
+        }
+        auto                       slot_index = static_cast<std::uint32_t>(frame % header->slot_count);
+        velm_insitu::slot_header & slot       = velm_insitu::slots(header)[slot_index];
+        std::uint64_t              sequence   = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * frame) {
+            // the producer lapped us between the two loads, retry with the newer frame
+            continue;
+        }
+
+        insitu_frame result{ velm_DR::ndarray<float, 3>::wrap(velm_insitu::frame_data(header, slot_index),
+                                                              header->dims[0], header->dims[1], header->dims[2]),
+                             sequence, slot.step, slot.time };
+        if (still_valid(result)) {
+            return result;
+        }
+    }
+}
+
+bool insitu_source::still_valid(const insitu_frame & frame) const {
+    auto                       slot_index = static_cast<std::uint32_t>((frame.sequence / 2) % header->slot_count);
+    velm_insitu::slot_header & slot       = velm_insitu::slots(header)[slot_index];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+std::uint64_t insitu_source::published() const {
+    return header->published.load(std::memory_order_acquire);
+}
+}  // namespace velm
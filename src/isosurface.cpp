@@ -0,0 +1,314 @@
+#include "velm/isosurface.h"
+
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <initializer_list>
+#include <limits>
+#include <utility>
+
+namespace velm_dr {
+
+namespace {
+
+// corners of a cell by mask: bit 2 steps along dim 0, bit 1 along dim 1, bit 0 along dim 2
+glm::vec3 corner_offset(unsigned mask) {
+    return { float(mask >> 2 & 1u), float(mask >> 1 & 1u), float(mask & 1u) };
+}
+
+// the six tetrahedra around the diagonal from corner 0 to corner 7, one per order of stepping along the three
+// axes; every corner mask contains the ones before it, so every edge runs from a corner to one of its supersets
+constexpr unsigned tetrahedra[6][4] = { { 0, 4, 6, 7 }, { 0, 4, 5, 7 }, { 0, 2, 6, 7 },
+                                        { 0, 2, 3, 7 }, { 0, 1, 5, 7 }, { 0, 1, 3, 7 } };
+
+// cells per row band contoured as one job
+constexpr std::size_t band_rows = 8;
+
+// a triangle of edge vertices, as edge keys and positions, before the vertices are shared
+struct loose_triangle {
+    std::uint64_t key[3];
+    glm::vec3     position[3];
+};
+
+/*
+ * Triangles of the cell with lower corner origin (sample indices) whose corner values are given by mask. Edge keys
+ * are the key of the edge's lower corner, base + the strides of the steps to it, shifted left by three and tagged
+ * with the steps to the upper corner.
+ */
+void contour_cell(const float (&values)[8],
+                  float                         iso,
+                  const glm::vec3 &             origin,
+                  const glm::vec3 &             spacing,
+                  std::uint64_t                 base,
+                  const std::uint64_t (&strides)[3],
+                  std::vector<loose_triangle> & out) {
+    auto position = [&](unsigned c) { return (origin + corner_offset(c)) * spacing; };
+    auto index    = [&](unsigned c) -> std::uint64_t {
+        return base + (c >> 2 & 1u) * strides[0] + (c >> 1 & 1u) * strides[1] + (c & 1u) * strides[2];
+    };
+
+    for (const unsigned (&tet)[4] : tetrahedra) {
+        // the vertex on edge (a, b) of the tetrahedron, a < b so the edge is always seen from the same end
+        auto edge = [&](unsigned a, unsigned b, std::uint64_t & edge_key, glm::vec3 & p) {
+            if (a > b) {
+                std::swap(a, b);
+            }
+            unsigned lo = tet[a];
+            unsigned hi = tet[b];
+            edge_key    = index(lo) << 3 | (lo ^ hi);
+            float t     = (iso - values[lo]) / (values[hi] - values[lo]);
+            p           = glm::mix(position(lo), position(hi), t);
+        };
+        auto emit = [&](std::initializer_list<std::pair<unsigned, unsigned>> corners, glm::vec3 downhill) {
+            loose_triangle triangle;
+            std::size_t    n = 0;
+            for (auto [a, b] : corners) {
+                edge(a, b, triangle.key[n], triangle.position[n]);
+                ++n;
+            }
+            glm::vec3 normal = glm::cross(triangle.position[1] - triangle.position[0],
+                                          triangle.position[2] - triangle.position[0]);
+            if (glm::dot(normal, downhill) < 0.0f) {
+                std::swap(triangle.key[1], triangle.key[2]);
+                std::swap(triangle.position[1], triangle.position[2]);
+            }
+            out.push_back(triangle);
+        };
+
+        unsigned above[4];
+        unsigned below[4];
+        unsigned na = 0;
+        unsigned nb = 0;
+        for (unsigned v = 0; v < 4; ++v) {
+            if (values[tet[v]] > iso) {
+                above[na++] = v;
+            } else {
+                below[nb++] = v;
+            }
+        }
+        if (na == 0 || nb == 0) {
+            continue;
+        }
+        glm::vec3 downhill = position(tet[below[0]]) - position(tet[above[0]]);
+        if (na == 1) {
+            emit({ { above[0], below[0] }, { above[0], below[1] }, { above[0], below[2] } }, downhill);
+        } else if (nb == 1) {
+            emit({ { below[0], above[0] }, { below[0], above[1] }, { below[0], above[2] } }, downhill);
+        } else {
+            // the cut is a quad around the tetrahedron
+            emit({ { above[0], below[0] }, { above[0], below[1] }, { above[1], below[1] } }, downhill);
+            emit({ { above[0], below[0] }, { above[1], below[1] }, { above[1], below[0] } }, downhill);
+        }
+    }
+}
+
+// false when all eight corners are on the same side of iso
+bool crosses(const float (&values)[8], float iso) {
+    bool any_above = false;
+    bool any_below = false;
+    for (float value : values) {
+        any_above |= value > iso;
+        any_below |= value <= iso;
+    }
+    return any_above && any_below;
+}
+
+// appends the triangles in order, a vertex per edge key seen for the first time
+void share_vertices(std::span<const loose_triangle>                    triangles,
+                    std::unordered_map<std::uint64_t, std::uint32_t> & edges,
+                    mesh_data &                                        result) {
+    for (const loose_triangle & triangle : triangles) {
+        for (int c = 0; c < 3; ++c) {
+            auto next         = static_cast<std::uint32_t>(result.vertex_count());
+            auto [at, is_new] = edges.try_emplace(triangle.key[c], next);
+            if (is_new) {
+                const glm::vec3 & p = triangle.position[c];
+                result.vertices.insert(result.vertices.end(), { p.x, p.y, p.z });
+            }
+            result.indices.push_back(at->second);
+        }
+    }
+}
+
+// the layer of cells between planes i (lower) and i + 1 (upper), rows [j0, j1)
+void contour_rows(const float *                 lower,
+                  const float *                 upper,
+                  std::size_t                   i,
+                  std::size_t                   n1,
+                  std::size_t                   n2,
+                  float                         iso,
+                  const glm::vec3 &             spacing,
+                  std::size_t                   j0,
+                  std::size_t                   j1,
+                  std::vector<loose_triangle> & out) {
+    const std::uint64_t strides[3] = { n1 * n2, n2, 1 };
+    for (std::size_t j = j0; j < j1; ++j) {
+        for (std::size_t k = 0; k + 1 < n2; ++k) {
+            float values[8];
+            for (unsigned c = 0; c < 8; ++c) {
+                const float * source = c & 4u ? upper : lower;
+                values[c]            = source[(j + (c >> 1 & 1u)) * n2 + k + (c & 1u)];
+            }
+            if (crosses(values, iso)) {
+                contour_cell(values, iso, glm::vec3(float(i), float(j), float(k)), spacing, (i * n1 + j) * n2 + k,
+                             strides, out);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+isosurface_builder::isosurface_builder(std::size_t rows, std::size_t columns, float level, glm::vec3 sample_spacing) :
+    n1(rows), n2(columns), iso(level), spacing(sample_spacing) {}
+
+void isosurface_builder::add_plane(std::span<const float> plane, velm::job_system & jobs) {
+    VELM_PROFILE_FUNCTION();
+    if (plane.size() != n1 * n2) {
+        abort();
+    }
+    if (plane_count > 0 && n1 > 1 && n2 > 1) {
+        // bands are contoured in parallel and merged in order, so the mesh does not depend on the thread count
+        std::vector<std::vector<loose_triangle>> bands((n1 - 1 + band_rows - 1) / band_rows);
+        velm::parallel_for(
+            0, n1 - 1, band_rows,
+            [&](std::size_t j0, std::size_t j1) {
+                contour_rows(previous.data(), plane.data(), plane_count - 1, n1, n2, iso, spacing, j0, j1,
+                             bands[j0 / band_rows]);
+            },
+            jobs);
+
+        for (const std::vector<loose_triangle> & band : bands) {
+            share_vertices(band, edges, result);
+        }
+
+        // later layers only reach edges starting on this plane or above
+        const std::size_t plane_size = n1 * n2;
+        const std::size_t current    = plane_count;
+        std::erase_if(edges, [&](const auto & entry) { return (entry.first >> 3) / plane_size < current; });
+    }
+    previous.assign(plane.begin(), plane.end());
+    ++plane_count;
+}
+
+mesh_data isosurface_builder::finish() {
+    mesh_data mesh = std::move(result);
+    mesh.charge_memory();
+    result = {};
+    edges.clear();
+    previous.clear();
+    plane_count = 0;
+    return mesh;
+}
+
+mesh_data extract_isosurface(const velm_DR::ndarray<float, 3> & field,
+                             float                              iso,
+                             glm::vec3                          spacing,
+                             velm::job_system &                 jobs) {
+    const std::size_t  plane_size = field.dims[1] * field.dims[2];
+    isosurface_builder builder(field.dims[1], field.dims[2], iso, spacing);
+    for (std::size_t i = 0; i < field.dims[0]; ++i) {
+        builder.add_plane({ field.data + i * field.strides[0], plane_size }, jobs);
+    }
+    return builder.finish();
+}
+
+mesh_data extract_isosurface(const velm_DR::sparse_grid<float> & grid,
+                             float                               iso,
+                             glm::vec3                           spacing,
+                             velm::job_system &                  jobs) {
+    VELM_PROFILE_FUNCTION();
+    using grid_type             = velm_DR::sparse_grid<float>;
+    constexpr std::int32_t edge = grid_type::leaf_edge;
+
+    // every leaf block and the seven blocks below it, whose cells on the shared faces have corners in the leaf
+    using block = std::array<std::int32_t, 3>;
+    std::vector<block> blocks;
+    for (const grid_type::leaf_node * leaf : grid.leaves()) {
+        for (unsigned below = 0; below < 8; ++below) {
+            block b  = { leaf->origin[0], leaf->origin[1], leaf->origin[2] };
+            bool  ok = true;
+            for (int a = 0; a < 3; ++a) {
+                if (below >> (2 - a) & 1u) {
+                    ok = ok && b[a] >= std::numeric_limits<std::int32_t>::min() + edge;
+                    b[a] -= ok ? edge : 0;
+                }
+            }
+            if (ok) {
+                blocks.push_back(b);
+            }
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    if (blocks.empty()) {
+        return {};
+    }
+
+    // edge keys index the samples of the box around all blocks, which has to fit the 61 bits left of the tag
+    std::int64_t lo[3];
+    std::int64_t hi[3];
+    for (int a = 0; a < 3; ++a) {
+        lo[a] = blocks.front()[a];
+        hi[a] = blocks.front()[a];
+        for (const block & b : blocks) {
+            lo[a] = std::min<std::int64_t>(lo[a], b[a]);
+            hi[a] = std::max<std::int64_t>(hi[a], b[a] + edge);
+        }
+    }
+    const std::uint64_t extent[3] = { std::uint64_t(hi[0] - lo[0] + 1), std::uint64_t(hi[1] - lo[1] + 1),
+                                      std::uint64_t(hi[2] - lo[2] + 1) };
+    const std::uint64_t limit     = std::uint64_t(1) << 61;
+    if (extent[1] > limit / extent[2] || extent[0] > limit / (extent[1] * extent[2])) {
+        abort();
+    }
+    const std::uint64_t strides[3] = { extent[1] * extent[2], extent[2], 1 };
+
+    std::vector<std::vector<loose_triangle>> parts(blocks.size());
+    velm::parallel_for(
+        0, blocks.size(), 1,
+        [&](std::size_t first, std::size_t last) {
+            grid_type::accessor read(grid);
+            for (std::size_t n = first; n < last; ++n) {
+                const block & b = blocks[n];
+                // blocks without a leaf only have corners in a leaf along their upper faces
+                bool allocated = grid.find_leaf(b[0], b[1], b[2]) != nullptr;
+                for (std::int32_t di = 0; di < edge; ++di) {
+                    for (std::int32_t dj = 0; dj < edge; ++dj) {
+                        for (std::int32_t dk = 0; dk < edge; ++dk) {
+                            if (!allocated && di < edge - 1 && dj < edge - 1 && dk < edge - 1) {
+                                continue;
+                            }
+                            std::int32_t i = b[0] + di;
+                            std::int32_t j = b[1] + dj;
+                            std::int32_t k = b[2] + dk;
+                            float        values[8];
+                            for (unsigned c = 0; c < 8; ++c) {
+                                values[c] = read.get(i + std::int32_t(c >> 2 & 1u), j + std::int32_t(c >> 1 & 1u),
+                                                     k + std::int32_t(c & 1u));
+                            }
+                            if (!crosses(values, iso)) {
+                                continue;
+                            }
+                            std::uint64_t base = std::uint64_t(i - lo[0]) * strides[0] +
+                                                 std::uint64_t(j - lo[1]) * strides[1] + std::uint64_t(k - lo[2]);
+                            contour_cell(values, iso, glm::vec3(float(i), float(j), float(k)), spacing, base, strides,
+                                         parts[n]);
+                        }
+                    }
+                }
+            }
+        },
+        jobs);
+
+    mesh_data                                        result;
+    std::unordered_map<std::uint64_t, std::uint32_t> edges;
+    for (const std::vector<loose_triangle> & part : parts) {
+        share_vertices(part, edges, result);
+    }
+    result.charge_memory();
+    return result;
+}
+}  // namespace velm_dr
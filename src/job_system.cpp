@@ -0,0 +1,112 @@
+#include "velm/job_system.h"
+
+namespace velm {
+
+namespace {
+thread_local const job_system * current_system = nullptr;
+thread_local std::size_t        current_index  = 0;
+}  // namespace
+
+job_system::job_system(std::size_t thread_count) {
+    if (thread_count == 0) {
+        std::size_t hardware = std::thread::hardware_concurrency();
+        thread_count         = hardware > 1 ? hardware - 1 : 0;
+    }
+    for (std::size_t i = 0; i <= thread_count; ++i) {
+        queues.push_back(std::make_unique<queue>());
+    }
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+job_system::~job_system() {
+    {
+        const std::scoped_lock lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+job_system & job_system::global() {
+    static job_system system;
+    return system;
+}
+
+void job_system::submit(std::function<void()> job) {
+    std::size_t target = threads.size();
+    if (current_system == this) {
+        target = current_index;
+    } else if (!threads.empty()) {
+        target = next_queue.fetch_add(1, std::memory_order_relaxed) % threads.size();
+    }
+    {
+        const std::scoped_lock lock(queues[target]->mutex);
+        queues[target]->jobs.push_back(std::move(job));
+    }
+    pending.fetch_add(1, std::memory_order_release);
+    {
+        // pairs with the predicate check in worker_loop so the wakeup can't be lost
+        const std::scoped_lock lock(sleep_mutex);
+    }
+    wake.notify_one();
+}
+
+bool job_system::take(std::size_t self, std::function<void()> & job) {
+    if (pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    {
+        queue &                q = *queues[self];
+        const std::scoped_lock lock(q.mutex);
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        queue &                q = *queues[(self + i) % queues.size()];
+        const std::scoped_lock lock(q.mutex);
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool job_system::run_one() {
+    std::size_t           self = current_system == this ? current_index : threads.size();
+    std::function<void()> job;
+    if (!take(self, job)) {
+        return false;
+    }
+    job();
+    return true;
+}
+
+void job_system::worker_loop(std::size_t index) {
+    current_system = this;
+    current_index  = index;
+    std::function<void()> job;
+    while (true) {
+        if (take(index, job)) {
+            job();
+            job = nullptr;
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping.load() || pending.load() != 0; });
+        if (stopping && pending.load() == 0) {
+            return;
+        }
+    }
+}
+}  // namespace velm
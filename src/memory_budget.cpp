@@ -0,0 +1,162 @@
+#include "velm/memory_budget.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace velm {
+
+namespace {
+
+// set while the calling thread runs evictors, allocations they make must not start another eviction
+thread_local bool evicting = false;
+
+}  // namespace
+
+const char * category_name(memory_category category) {
+    switch (category) {
+        case memory_category::ARRAYS:
+            return "arrays";
+        case memory_category::IO_BUFFERS:
+            return "io buffers";
+        case memory_category::MESHES:
+            return "meshes";
+        case memory_category::GPU_TEXTURES:
+            return "gpu textures";
+        case memory_category::GPU_BUFFERS:
+            return "gpu buffers";
+        case memory_category::CACHES:
+            return "caches";
+        case memory_category::IMAGES:
+            return "images";
+        case memory_category::COUNT:
+            break;
+    }
+    return "unknown";
+}
+
+memory_budget & memory_budget::global() {
+    static memory_budget budget;
+    return budget;
+}
+
+void memory_budget::allocated(memory_category category, std::size_t bytes) {
+    bytes_[std::size_t(category)].fetch_add(bytes, std::memory_order_relaxed);
+    std::size_t total = total_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    std::size_t peak = peak_.load(std::memory_order_relaxed);
+    while (total > peak && !peak_.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+
+    std::size_t cap = limit_.load(std::memory_order_relaxed);
+    if (cap != 0 && total > cap) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        (void) reclaim(total - cap);
+    }
+}
+
+void memory_budget::freed(memory_category category, std::size_t bytes) {
+    bytes_[std::size_t(category)].fetch_sub(bytes, std::memory_order_relaxed);
+    total_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void memory_budget::set_limit(std::size_t bytes) {
+    limit_.store(bytes, std::memory_order_relaxed);
+    std::size_t total = used();
+    if (bytes != 0 && total > bytes) {
+        (void) reclaim(total - bytes);
+    }
+}
+
+memory_stats memory_budget::stats() const {
+    memory_stats s;
+    for (std::size_t c = 0; c < std::size_t(memory_category::COUNT); ++c) {
+        s.bytes[c] = bytes_[c].load(std::memory_order_relaxed);
+    }
+    s.total         = used();
+    s.peak          = peak_.load(std::memory_order_relaxed);
+    s.limit         = limit();
+    s.overruns      = overruns_.load(std::memory_order_relaxed);
+    s.evicted_bytes = evicted_.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::size_t memory_budget::add_evictor(std::string name, evictor fn, int priority) {
+    std::lock_guard<std::mutex> lock(evictor_mutex);
+    std::size_t                 id = next_id++;
+    auto at = std::upper_bound(evictors.begin(), evictors.end(), priority,
+                               [](int p, const registered_evictor & e) { return p < e.priority; });
+    evictors.insert(at, { id, std::move(name), priority, std::move(fn) });
+    return id;
+}
+
+void memory_budget::remove_evictor(std::size_t id) {
+    std::lock_guard<std::mutex> lock(evictor_mutex);
+    std::erase_if(evictors, [id](const registered_evictor & e) { return e.id == id; });
+}
+
+std::size_t memory_budget::reclaim(std::size_t bytes) {
+    if (evicting) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(evictor_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+    evicting             = true;
+    std::size_t released = 0;
+    for (registered_evictor & e : evictors) {
+        if (released >= bytes) {
+            break;
+        }
+        released += e.fn(bytes - released);
+    }
+    evicting = false;
+    evicted_.fetch_add(released, std::memory_order_relaxed);
+    return released;
+}
+
+memory_charge::memory_charge(memory_category category, std::size_t bytes, memory_budget & budget) :
+    budget_(&budget), category_(category) {
+    resize(bytes);
+}
+
+memory_charge::~memory_charge() {
+    resize(0);
+}
+
+memory_charge::memory_charge(const memory_charge & other) : budget_(other.budget_), category_(other.category_) {
+    resize(other.bytes_);
+}
+
+memory_charge::memory_charge(memory_charge && other) noexcept :
+    budget_(other.budget_), category_(other.category_), bytes_(std::exchange(other.bytes_, 0)) {}
+
+memory_charge & memory_charge::operator=(const memory_charge & other) {
+    if (this != &other) {
+        resize(0);
+        budget_   = other.budget_;
+        category_ = other.category_;
+        resize(other.bytes_);
+    }
+    return *this;
+}
+
+memory_charge & memory_charge::operator=(memory_charge && other) noexcept {
+    if (this != &other) {
+        resize(0);
+        budget_   = other.budget_;
+        category_ = other.category_;
+        bytes_    = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+}
+
+void memory_charge::resize(std::size_t bytes) {
+    if (bytes > bytes_) {
+        budget_->allocated(category_, bytes - bytes_);
+    } else if (bytes < bytes_) {
+        budget_->freed(category_, bytes_ - bytes);
+    }
+    bytes_ = bytes;
+}
+}  // namespace velm
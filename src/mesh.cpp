@@ -0,0 +1,112 @@
+#include "velm/geometry_cache.h"
+#include "velm/gpu_upload.h"
+#include "velm/memory_budget.h"
+#include "velm/scene.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+velm_render::mesh::~mesh() {
+    destroy();
+}
+
+velm_render::mesh::mesh(mesh && other) noexcept :
+    lods(std::move(other.lods)), format(other.format), box(other.box), gpu_bytes(std::exchange(other.gpu_bytes, 0)) {
+    other.lods.clear();
+}
+
+velm_render::mesh & velm_render::mesh::operator=(mesh && other) noexcept {
+    if (this != &other) {
+        destroy();
+        lods      = std::move(other.lods);
+        format    = other.format;
+        box       = other.box;
+        gpu_bytes = std::exchange(other.gpu_bytes, 0);
+        other.lods.clear();
+    }
+    return *this;
+}
+
+void velm_render::mesh::upload(std::span<const velm_dr::mesh_data> chain,
+                               const vertex_attributes &           attributes,
+                               vertex_format                       packing) {
+    destroy();
+    if (chain.empty()) {
+        return;
+    }
+    format = packing;
+    box    = {};
+    if (format == vertex_format::PACKED) {
+        box = quantization::from_vertices(chain[0]);
+    }
+
+    const bgfx::VertexLayout & layout = format == vertex_format::PACKED ? packed_layout() : float_layout();
+    lods.reserve(chain.size());
+    for (const velm_dr::mesh_data & level : chain) {
+        // bgfx reads the encoded buffers in place and frees them once the render thread has created the buffers
+        auto geometry = std::make_shared<const gpu_geometry>(encode(level, attributes, format, box));
+        auto vertices = std::as_bytes(std::span(geometry->vertices));
+        auto indices  = std::as_bytes(std::span(geometry->indices));
+
+        lod l;
+        l.vertex_buffer   = bgfx::createVertexBuffer(make_ref(geometry, vertices), layout);
+        l.index_buffer    = bgfx::createIndexBuffer(make_ref(geometry, indices),
+                                                    geometry->index32 ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE);
+        l.index_count     = geometry->index_count();
+        l.geometric_error = level.geometric_error;
+        lods.push_back(l);
+        gpu_bytes += vertices.size() + indices.size();
+    }
+    velm::memory_budget::global().allocated(velm::memory_category::GPU_BUFFERS, gpu_bytes);
+}
+
+void velm_render::mesh::upload(std::shared_ptr<const cached_geometry> geometry) {
+    destroy();
+    if (!geometry) {
+        return;
+    }
+    format = geometry->format();
+    box    = geometry->box();
+
+    // the buffers go to bgfx straight from the mapping, which stays open until the render thread has read them
+    const bgfx::VertexLayout & layout = format == vertex_format::PACKED ? packed_layout() : float_layout();
+    lods.reserve(geometry->lods().size());
+    for (const cached_geometry::lod & level : geometry->lods()) {
+        lod l;
+        l.vertex_buffer   = bgfx::createVertexBuffer(make_ref(geometry, level.vertices), layout);
+        l.index_buffer    = bgfx::createIndexBuffer(make_ref(geometry, level.indices),
+                                                    level.index32 ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE);
+        l.index_count     = level.index_count();
+        l.geometric_error = level.geometric_error;
+        lods.push_back(l);
+        gpu_bytes += level.vertices.size() + level.indices.size();
+    }
+    velm::memory_budget::global().allocated(velm::memory_category::GPU_BUFFERS, gpu_bytes);
+}
+
+void velm_render::mesh::destroy() {
+    for (const lod & l : lods) {
+        if (bgfx::isValid(l.vertex_buffer)) {
+            bgfx::destroy(l.vertex_buffer);
+        }
+        if (bgfx::isValid(l.index_buffer)) {
+            bgfx::destroy(l.index_buffer);
+        }
+    }
+    lods.clear();
+    velm::memory_budget::global().freed(velm::memory_category::GPU_BUFFERS, gpu_bytes);
+    gpu_bytes = 0;
+}
+
+std::size_t velm_render::mesh::select_lod(float distance, float pixels_per_unit, float max_pixel_error) const {
+    // projected size of the error shrinks linearly with distance, errors only grow along the chain
+    std::size_t level = 0;
+    for (std::size_t i = 1; i < lods.size(); ++i) {
+        if (lods[i].geometric_error * pixels_per_unit > max_pixel_error * distance) {
+            break;
+        }
+        level = i;
+    }
+    return level;
+}
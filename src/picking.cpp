@@ -0,0 +1,388 @@
+#include "velm/picking.h"
+
+#include "velm/culling.h"
+#include "velm/sampling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace velm_render {
+
+namespace {
+
+/*
+ * Amanatides-Woo walk of the ray over a grid of cells of the given size, restricted to cells [lo, hi] (inclusive)
+ * and ray parameters [t_begin, t_end]. visit(cell, t0, t1) gets the part of the ray inside each cell in order and
+ * returns true to stop the walk.
+ */
+template <typename Visit>
+bool walk_cells(const ray & r,
+                float       size,
+                const std::int64_t (&lo)[3],
+                const std::int64_t (&hi)[3],
+                float    t_begin,
+                float    t_end,
+                Visit && visit) {
+    glm::vec3    p = r.at(t_begin);
+    std::int64_t cell[3];
+    std::int64_t step[3];
+    float        t_next[3];
+    float        t_delta[3];
+    for (int a = 0; a < 3; ++a) {
+        cell[a] = std::clamp(std::int64_t(std::floor(p[a] / size)), lo[a], hi[a]);
+        if (r.direction[a] > 0.0f) {
+            step[a]    = 1;
+            t_next[a]  = (float(cell[a] + 1) * size - r.origin[a]) / r.direction[a];
+            t_delta[a] = size / r.direction[a];
+        } else if (r.direction[a] < 0.0f) {
+            step[a]    = -1;
+            t_next[a]  = (float(cell[a]) * size - r.origin[a]) / r.direction[a];
+            t_delta[a] = -size / r.direction[a];
+        } else {
+            step[a]    = 0;
+            t_next[a]  = FLT_MAX;
+            t_delta[a] = FLT_MAX;
+        }
+    }
+
+    float t = t_begin;
+    while (t <= t_end) {
+        int   axis    = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+        float t_leave = std::min(t_next[axis], t_end);
+        if (t_leave >= t && visit(cell, t, t_leave)) {
+            return true;
+        }
+        cell[axis] += step[axis];
+        if (step[axis] == 0 || cell[axis] < lo[axis] || cell[axis] > hi[axis]) {
+            break;
+        }
+        t = std::max(t, t_next[axis]);
+        t_next[axis] += t_delta[axis];
+    }
+    return false;
+}
+
+// ray parameters inside [lo, hi], empty when enter > exit
+void clip_to_box(const ray & r, const glm::vec3 & lo, const glm::vec3 & hi, float & enter, float & exit) {
+    for (int a = 0; a < 3; ++a) {
+        if (r.direction[a] == 0.0f) {
+            if (r.origin[a] < lo[a] || r.origin[a] > hi[a]) {
+                enter = FLT_MAX;
+                exit  = -FLT_MAX;
+                return;
+            }
+            continue;
+        }
+        float inv = 1.0f / r.direction[a];
+        float t0  = (lo[a] - r.origin[a]) * inv;
+        float t1  = (hi[a] - r.origin[a]) * inv;
+        enter     = std::max(enter, std::min(t0, t1));
+        exit      = std::min(exit, std::max(t0, t1));
+    }
+}
+
+glm::vec3 window_to_ndc(const glm::vec2 & cursor, const glm::vec2 & viewport) {
+    return { cursor.x / viewport.x * 2.0f - 1.0f, 1.0f - cursor.y / viewport.y * 2.0f, 0.0f };
+}
+
+glm::vec3 unproject_ndc(const glm::mat4x4 & inverse_view_proj, glm::vec3 ndc) {
+    glm::vec4 p = inverse_view_proj * glm::vec4(ndc, 1.0f);
+    return glm::vec3(p) / p.w;
+}
+
+}  // namespace
+
+ray ray::transformed(const glm::mat4x4 & m) const {
+    return { glm::vec3(m * glm::vec4(origin, 1.0f)), glm::mat3(m) * direction };
+}
+
+ray cursor_ray(const glm::mat4x4 & view_mat,
+               const glm::mat4x4 & proj_mat,
+               const glm::vec2 &   cursor,
+               const glm::vec2 &   viewport,
+               bool                homogeneous_depth) {
+    glm::mat4x4 inverse = glm::inverse(proj_mat * view_mat);
+    glm::vec3   ndc     = window_to_ndc(cursor, viewport);
+
+    ndc.z                = homogeneous_depth ? -1.0f : 0.0f;
+    glm::vec3 near_point = unproject_ndc(inverse, ndc);
+    ndc.z                = 1.0f;
+    return { near_point, unproject_ndc(inverse, ndc) - near_point };
+}
+
+ray cursor_ray(const view & v, const glm::vec2 & cursor, const glm::vec2 & viewport) {
+    return cursor_ray(v.view_matrix(), v.projection(), cursor, viewport, v.homogeneous_clip_depth());
+}
+
+glm::vec3 unproject(const glm::mat4x4 & view_mat,
+                    const glm::mat4x4 & proj_mat,
+                    const glm::vec2 &   cursor,
+                    const glm::vec2 &   viewport,
+                    float               depth,
+                    bool                homogeneous_depth) {
+    glm::vec3 ndc = window_to_ndc(cursor, viewport);
+    ndc.z         = homogeneous_depth ? depth * 2.0f - 1.0f : depth;
+    return unproject_ndc(glm::inverse(proj_mat * view_mat), ndc);
+}
+
+minmax_bricks::minmax_bricks(const velm_DR::ndarray<float, 3> & volume, velm::job_system & jobs) {
+    // a single sample layer still gets one brick so lookups stay in range
+    for (int a = 0; a < 3; ++a) {
+        std::size_t cells = std::max<std::size_t>(volume.dims[a], 2) - 1;
+        dims[a]           = (cells + edge - 1) / edge;
+    }
+    mins.assign(dims[0] * dims[1] * dims[2], FLT_MAX);
+    maxs.assign(dims[0] * dims[1] * dims[2], -FLT_MAX);
+    if (volume.total_elements() == 0) {
+        return;
+    }
+
+    // brick b covers samples [b * edge, b * edge + edge], the rows of a brick row are read front to back
+    auto last_sample = [&](int a, std::size_t b) { return std::min(b * edge + edge, volume.dims[a] - 1); };
+    velm::parallel_for(
+        0, dims[0], 1,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t bi = first; bi < last; ++bi) {
+                for (std::size_t bj = 0; bj < dims[1]; ++bj) {
+                    float * lo = &mins[index(bi, bj, 0)];
+                    float * hi = &maxs[index(bi, bj, 0)];
+                    for (std::size_t i = bi * edge; i <= last_sample(0, bi); ++i) {
+                        for (std::size_t j = bj * edge; j <= last_sample(1, bj); ++j) {
+                            const float * row = &volume(i, j, std::size_t(0));
+                            for (std::size_t bk = 0; bk < dims[2]; ++bk) {
+                                for (std::size_t k = bk * edge; k <= last_sample(2, bk); ++k) {
+                                    lo[bk] = std::min(lo[bk], row[k]);
+                                    hi[bk] = std::max(hi[bk], row[k]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        },
+        jobs);
+}
+
+grid_hit pick_isovalue(const grid_probe & grid, const ray & world_ray, float threshold, float t_max) {
+    const velm_DR::ndarray<float, 3> & volume = grid.volume;
+    grid_hit                           result;
+    if (volume.dims[0] < 2 || volume.dims[1] < 2 || volume.dims[2] < 2) {
+        return result;
+    }
+    ray       r = world_ray.transformed(glm::inverse(grid.index_to_world));
+    glm::vec3 last_sample(float(volume.dims[0] - 1), float(volume.dims[1] - 1), float(volume.dims[2] - 1));
+    float     enter = 0.0f;
+    float     exit  = t_max;
+    clip_to_box(r, glm::vec3(0.0f), last_sample, enter, exit);
+    if (enter > exit) {
+        return result;
+    }
+
+    auto value_at = [&](float t) { return velm_DR::sample_at(volume, r.at(t)); };
+    auto finish   = [&](float t) {
+        glm::vec3 p     = r.at(t);
+        result.hit      = true;
+        result.t        = t;
+        result.value    = velm_DR::sample_at(volume, p);
+        result.position = glm::vec3(grid.index_to_world * glm::vec4(p, 1.0f));
+        for (int a = 0; a < 3; ++a) {
+            result.cell[a] = std::min(std::size_t(std::max(p[a], 0.0f)), volume.dims[a] - 2);
+        }
+        return true;
+    };
+
+    // already inside the region where the ray enters the grid
+    if (value_at(enter) >= threshold) {
+        finish(enter);
+        return result;
+    }
+
+    const std::int64_t cell_hi[3]  = { std::int64_t(volume.dims[0]) - 2, std::int64_t(volume.dims[1]) - 2,
+                                       std::int64_t(volume.dims[2]) - 2 };
+    const std::int64_t brick_lo[3] = { 0, 0, 0 };
+    const std::int64_t brick_hi[3] = { std::int64_t(grid.bricks.dims[0]) - 1, std::int64_t(grid.bricks.dims[1]) - 1,
+                                       std::int64_t(grid.bricks.dims[2]) - 1 };
+    const float        edge        = float(minmax_bricks::edge);
+
+    auto visit_cell = [&](const std::int64_t (&c)[3], float t0, float t1) {
+        float highest = -FLT_MAX;
+        for (int corner = 0; corner < 8; ++corner) {
+            std::size_t i = std::size_t(c[0] + (corner >> 2));
+            std::size_t j = std::size_t(c[1] + (corner >> 1 & 1));
+            std::size_t k = std::size_t(c[2] + (corner & 1));
+            highest       = std::max(highest, volume(i, j, k));
+        }
+        if (highest < threshold) {
+            return false;
+        }
+        // first of four points on the segment at or above the threshold, then bisect towards the crossing
+        float below = t0;
+        for (int s = 1; s <= 3; ++s) {
+            float t = t0 + (t1 - t0) * float(s) / 3.0f;
+            if (value_at(t) >= threshold) {
+                float above = t;
+                for (int iteration = 0; iteration < 16; ++iteration) {
+                    float mid = 0.5f * (below + above);
+                    (value_at(mid) >= threshold ? above : below) = mid;
+                }
+                return finish(above);
+            }
+            below = t;
+        }
+        return false;
+    };
+
+    auto visit_brick = [&](const std::int64_t (&b)[3], float t0, float t1) {
+        if (grid.bricks.max(std::size_t(b[0]), std::size_t(b[1]), std::size_t(b[2])) < threshold) {
+            return false;
+        }
+        std::int64_t lo[3];
+        std::int64_t hi[3];
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = b[a] * std::int64_t(minmax_bricks::edge);
+            hi[a] = std::min(lo[a] + std::int64_t(minmax_bricks::edge) - 1, cell_hi[a]);
+        }
+        return walk_cells(r, 1.0f, lo, hi, t0, t1, visit_cell);
+    };
+
+    walk_cells(r, edge, brick_lo, brick_hi, enter, exit, visit_brick);
+    return result;
+}
+
+grid_hit probe_position(const grid_probe & grid, const glm::vec3 & position) {
+    const velm_DR::ndarray<float, 3> & volume = grid.volume;
+    grid_hit                           result;
+    glm::vec3                          p = glm::vec3(glm::inverse(grid.index_to_world) * glm::vec4(position, 1.0f));
+    for (int a = 0; a < 3; ++a) {
+        if (!(p[a] >= 0.0f && p[a] <= float(volume.dims[a]) - 1.0f)) {
+            return result;
+        }
+        result.cell[a] = std::min(std::size_t(p[a]), std::max<std::size_t>(volume.dims[a], 2) - 2);
+    }
+    result.hit      = true;
+    result.position = position;
+    result.value    = velm_DR::sample_at(volume, p);
+    return result;
+}
+
+object_hit pick_object(velm::Scene & scene, const ray & world_ray, const object_test & exact, float t_max) {
+    (void) scene.update_transforms();
+    object_hit                    result;
+    std::span<const bvh::node>    nodes = scene.acceleration().nodes();
+    std::span<const std::uint8_t> flags = scene.render_flag_pool();
+    std::span<const glm::mat4x4>  world = scene.world_transform_pool();
+    if (nodes.empty()) {
+        return result;
+    }
+    glm::vec3 inv  = 1.0f / world_ray.direction;
+    float     best = t_max;
+
+    struct entry {
+        std::uint32_t node;
+        float         t;
+    };
+
+    std::vector<entry> stack{ { 0, 0.0f } };
+    while (!stack.empty()) {
+        entry e = stack.back();
+        stack.pop_back();
+        if (e.t >= best) {
+            continue;
+        }
+        const bvh::node & n = nodes[e.node];
+
+        // slab test of the eight lanes, hits ordered nearest first
+        entry         hits[bvh::width];
+        std::uint32_t hit_count = 0;
+        for (std::uint32_t lane = 0; lane < bvh::width; ++lane) {
+            if (n.child[lane] == bvh::empty) {
+                continue;
+            }
+            float tx0   = (n.min_x[lane] - world_ray.origin.x) * inv.x;
+            float tx1   = (n.max_x[lane] - world_ray.origin.x) * inv.x;
+            float ty0   = (n.min_y[lane] - world_ray.origin.y) * inv.y;
+            float ty1   = (n.max_y[lane] - world_ray.origin.y) * inv.y;
+            float tz0   = (n.min_z[lane] - world_ray.origin.z) * inv.z;
+            float tz1   = (n.max_z[lane] - world_ray.origin.z) * inv.z;
+            float enter = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), 0.0f });
+            float exit  = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1) });
+            if (enter <= exit && enter < best) {
+                // insertion into the sorted hits, at most eight of them
+                std::uint32_t h = hit_count++;
+                for (; h > 0 && hits[h - 1].t > enter; --h) {
+                    hits[h] = hits[h - 1];
+                }
+                hits[h] = { n.child[lane], enter };
+            }
+        }
+
+        for (std::uint32_t h = 0; h < hit_count; ++h) {
+            if (!(hits[h].node & bvh::leaf_flag) || hits[h].t >= best) {
+                continue;
+            }
+            std::uint32_t slot = hits[h].node & ~bvh::leaf_flag;
+            if (!(flags[slot] & RENDER_PICKABLE)) {
+                continue;
+            }
+            float t = hits[h].t;
+            if (exact) {
+                t = best;
+                if (!exact(slot, world_ray.transformed(glm::inverse(world[slot])), t) || t >= best) {
+                    continue;
+                }
+            }
+            best          = t;
+            result.hit    = true;
+            result.handle = scene.handle_of(slot);
+            result.t      = t;
+        }
+        // farthest pushed first so the nearest subtree is visited next
+        for (std::uint32_t h = hit_count; h-- > 0;) {
+            if (!(hits[h].node & bvh::leaf_flag) && hits[h].t < best) {
+                stack.push_back(hits[h]);
+            }
+        }
+    }
+    if (result.hit) {
+        result.position = world_ray.at(result.t);
+    }
+    return result;
+}
+
+bool intersect_triangles(const velm_dr::mesh_data & mesh, const ray & r, float & t) {
+    bool hit = false;
+    for (std::size_t tri = 0; tri + 2 < mesh.indices.size(); tri += 3) {
+        const float * v0 = &mesh.vertices[std::size_t(mesh.indices[tri]) * mesh.vertex_stride];
+        const float * v1 = &mesh.vertices[std::size_t(mesh.indices[tri + 1]) * mesh.vertex_stride];
+        const float * v2 = &mesh.vertices[std::size_t(mesh.indices[tri + 2]) * mesh.vertex_stride];
+        glm::vec3     a(v0[0], v0[1], v0[2]);
+        glm::vec3     e1 = glm::vec3(v1[0], v1[1], v1[2]) - a;
+        glm::vec3     e2 = glm::vec3(v2[0], v2[1], v2[2]) - a;
+
+        glm::vec3 p   = glm::cross(r.direction, e2);
+        float     det = glm::dot(e1, p);
+        if (std::fabs(det) < 1e-12f) {
+            continue;
+        }
+        float     inv_det = 1.0f / det;
+        glm::vec3 s       = r.origin - a;
+        float     u       = glm::dot(s, p) * inv_det;
+        if (u < 0.0f || u > 1.0f) {
+            continue;
+        }
+        glm::vec3 q = glm::cross(s, e1);
+        float     v = glm::dot(r.direction, q) * inv_det;
+        if (v < 0.0f || u + v > 1.0f) {
+            continue;
+        }
+        float distance = glm::dot(e2, q) * inv_det;
+        if (distance >= 0.0f && distance < t) {
+            t   = distance;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+}  // namespace velm_render
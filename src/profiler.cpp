@@ -0,0 +1,272 @@
+#include "velm/profiler.h"
+#ifdef VELM_ENABLE_PROFILER
+
+#    include "bgfx/bgfx.h"
+
+#    include <algorithm>
+#    include <array>
+#    include <atomic>
+#    include <chrono>
+#    include <deque>
+#    include <fstream>
+#    include <memory>
+#    include <mutex>
+#    include <string>
+#    include <unordered_map>
+
+namespace velm_profiler {
+
+namespace {
+
+// single producer (owning thread), single consumer (end_frame)
+struct thread_buffer {
+    static constexpr std::size_t capacity = std::size_t(1) << 14;
+    static constexpr std::size_t mask     = capacity - 1;
+
+    std::array<zone_event, capacity> events;
+    alignas(64) std::atomic<std::uint64_t> head{ 0 };
+    alignas(64) std::atomic<std::uint64_t> tail{ 0 };
+    std::atomic<std::uint64_t>             dropped{ 0 };
+    std::uint32_t                          thread_id = 0;
+
+    void push(const zone_event & event) noexcept {
+        std::uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[h & mask] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    template <typename Fn> void drain(Fn && fn) {
+        std::uint64_t t = tail.load(std::memory_order_relaxed);
+        std::uint64_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            fn(events[t & mask]);
+        }
+        tail.store(h, std::memory_order_release);
+    }
+};
+
+struct profiler_state {
+    // guards the buffer list, taken once per thread on first zone and by the collector
+    std::mutex                                  registry_mutex;
+    std::vector<std::shared_ptr<thread_buffer>> buffers;
+    std::uint32_t                               next_thread_id = 0;
+
+    // guards everything below
+    std::mutex                history_mutex;
+    std::deque<zone_event>    zones;
+    std::deque<frame_stats>   frames;
+    std::vector<zone_summary> last_summary;
+    std::size_t               max_zones  = std::size_t(1) << 20;
+    std::size_t               max_frames = 1024;
+    frame_stats               current{};
+};
+
+profiler_state & state() {
+    static profiler_state s;
+    return s;
+}
+
+thread_buffer & local_buffer() {
+    thread_local std::shared_ptr<thread_buffer> buffer = [] {
+        auto              b = std::make_shared<thread_buffer>();
+        profiler_state &  s = state();
+        const std::scoped_lock lock(s.registry_mutex);
+        b->thread_id = s.next_thread_id++;
+        s.buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+double ticks_to_ms(std::int64_t ticks, std::int64_t freq) {
+    return freq > 0 ? 1000.0 * double(ticks) / double(freq) : 0.0;
+}
+
+void write_escaped(std::ofstream & out, const char * s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            out << '\\';
+        }
+        out << *s;
+    }
+}
+
+}  // namespace
+
+std::uint64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+scoped_zone::scoped_zone(const char * name) noexcept : name_(name), begin_ns_(now_ns()) {}
+
+scoped_zone::~scoped_zone() noexcept {
+    thread_buffer & buffer = local_buffer();
+    buffer.push({ name_, begin_ns_, now_ns(), buffer.thread_id });
+}
+
+void sample_bgfx_stats() {
+    const bgfx::Stats * stats = bgfx::getStats();
+    if (!stats) {
+        return;
+    }
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    s.current.cpu_frame_ms    = ticks_to_ms(stats->cpuTimeFrame, stats->cpuTimerFreq);
+    s.current.cpu_submit_ms   = ticks_to_ms(stats->cpuTimeEnd - stats->cpuTimeBegin, stats->cpuTimerFreq);
+    s.current.gpu_ms          = ticks_to_ms(stats->gpuTimeEnd - stats->gpuTimeBegin, stats->gpuTimerFreq);
+    s.current.wait_render_ms  = ticks_to_ms(stats->waitRender, stats->cpuTimerFreq);
+    s.current.wait_submit_ms  = ticks_to_ms(stats->waitSubmit, stats->cpuTimerFreq);
+    s.current.draw_calls      = stats->numDraw;
+    s.current.compute_calls   = stats->numCompute;
+    s.current.blit_calls      = stats->numBlit;
+    s.current.gpu_memory_used = stats->gpuMemoryUsed;
+}
+
+void end_frame() {
+    profiler_state & s   = state();
+    std::uint64_t    end = now_ns();
+
+    std::vector<zone_event> drained;
+    std::uint64_t           dropped = 0;
+    {
+        const std::scoped_lock lock(s.registry_mutex);
+        for (auto & buffer : s.buffers) {
+            buffer->drain([&](const zone_event & e) { drained.push_back(e); });
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        }
+        // buffers of exited threads are only referenced by the registry
+        std::erase_if(s.buffers, [](const std::shared_ptr<thread_buffer> & b) {
+            return b.use_count() == 1 && b->head.load() == b->tail.load();
+        });
+    }
+
+    std::unordered_map<const char *, zone_summary> totals;
+    for (const auto & e : drained) {
+        auto & t = totals.try_emplace(e.name, zone_summary{ e.name, 0, 0 }).first->second;
+        t.total_ns += e.end_ns - e.begin_ns;
+        t.count++;
+    }
+
+    const std::scoped_lock lock(s.history_mutex);
+    s.zones.insert(s.zones.end(), drained.begin(), drained.end());
+    while (s.zones.size() > s.max_zones) {
+        s.zones.pop_front();
+    }
+
+    s.last_summary.clear();
+    for (const auto & [name, t] : totals) {
+        s.last_summary.push_back(t);
+    }
+    std::sort(s.last_summary.begin(), s.last_summary.end(),
+              [](const zone_summary & a, const zone_summary & b) { return a.total_ns > b.total_ns; });
+
+    s.current.end_ns        = end;
+    s.current.dropped_zones = dropped;
+    s.frames.push_back(s.current);
+    while (s.frames.size() > s.max_frames) {
+        s.frames.pop_front();
+    }
+
+    std::uint64_t next_index = s.current.frame_index + 1;
+    s.current                = frame_stats{};
+    s.current.frame_index    = next_index;
+    s.current.begin_ns       = end;
+}
+
+void set_history_limit(std::size_t max_events, std::size_t max_frames) {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    s.max_zones  = max_events;
+    s.max_frames = max_frames;
+}
+
+void clear() {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    s.zones.clear();
+    s.frames.clear();
+    s.last_summary.clear();
+}
+
+std::vector<zone_event> recorded_zones() {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    return { s.zones.begin(), s.zones.end() };
+}
+
+std::vector<frame_stats> recorded_frames() {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    return { s.frames.begin(), s.frames.end() };
+}
+
+std::vector<zone_summary> last_frame_summary() {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    return s.last_summary;
+}
+
+bool write_chrome_trace(std::string_view path) {
+    std::vector<zone_event>  zones  = recorded_zones();
+    std::vector<frame_stats> frames = recorded_frames();
+
+    std::ofstream out{ std::string(path) };
+    if (!out) {
+        return false;
+    }
+
+    // chrome://tracing and perfetto expect microseconds
+    std::uint64_t origin = zones.empty() ? 0 : zones.front().begin_ns;
+    for (const auto & z : zones) {
+        origin = std::min(origin, z.begin_ns);
+    }
+    for (const auto & f : frames) {
+        origin = std::min(origin, f.begin_ns);
+    }
+    auto us = [origin](std::uint64_t ns) { return double(ns - origin) / 1000.0; };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto & z : zones) {
+        out << (first ? "" : ",\n") << "{\"name\":\"";
+        write_escaped(out, z.name);
+        out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << z.thread_id << ",\"ts\":" << us(z.begin_ns)
+            << ",\"dur\":" << double(z.end_ns - z.begin_ns) / 1000.0 << "}";
+        first = false;
+    }
+    for (const auto & f : frames) {
+        out << (first ? "" : ",\n") << "{\"name\":\"frame\",\"ph\":\"C\",\"pid\":0,\"ts\":" << us(f.end_ns)
+            << ",\"args\":{\"cpu_ms\":" << f.cpu_frame_ms << ",\"submit_ms\":" << f.cpu_submit_ms
+            << ",\"gpu_ms\":" << f.gpu_ms << ",\"draws\":" << f.draw_calls << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
+
+void draw_overlay(std::uint16_t x, std::uint16_t y) {
+    profiler_state &       s = state();
+    const std::scoped_lock lock(s.history_mutex);
+    if (s.frames.empty()) {
+        return;
+    }
+    const frame_stats & f = s.frames.back();
+    bgfx::dbgTextPrintf(x, y++, 0x0f, "frame %-6llu cpu %6.2f ms  submit %6.2f ms  gpu %6.2f ms",
+                        static_cast<unsigned long long>(f.frame_index), f.cpu_frame_ms, f.cpu_submit_ms, f.gpu_ms);
+    bgfx::dbgTextPrintf(x, y++, 0x0f, "draws %-5u compute %-5u blits %-5u gpu mem %lld MiB", f.draw_calls,
+                        f.compute_calls, f.blit_calls, static_cast<long long>(f.gpu_memory_used >> 20));
+    std::size_t shown = std::min<std::size_t>(s.last_summary.size(), 8);
+    for (std::size_t i = 0; i < shown; ++i) {
+        const zone_summary & z = s.last_summary[i];
+        bgfx::dbgTextPrintf(x, y++, 0x07, "%-32.32s %8.3f ms %6u", z.name, double(z.total_ns) / 1e6, z.count);
+    }
+}
+
+}  // namespace velm_profiler
+#endif
@@ -0,0 +1,37 @@
+#include "velm/pyramid.h"
+
+#ifdef VELM_ENABLE_HDF5
+#    include "velm/hdf5.h"
+
+#    include <numeric>
+#    include <stdexcept>
+#    include <string>
+
+namespace velm_dr {
+
+pyramid<float> build_pyramid(const velm::hdf5_file & file,
+                             std::string_view        dataset,
+                             std::size_t             slab_planes,
+                             const pyramid_options & options,
+                             velm::job_system &      jobs) {
+    std::vector<std::size_t> shape = file.get_dataset_shape(dataset);
+    if (shape.size() != 3) {
+        throw std::invalid_argument("build_pyramid: " + std::string(dataset) + " is not a 3D dataset");
+    }
+    // whole chunks along dim 0 per slab, so no chunk is decompressed twice; the block rounding of the generic
+    // overload then keeps the slabs as they are
+    const std::size_t        dims[3]  = { shape[0], shape[1], shape[2] };
+    std::vector<std::size_t> chunk    = file.get_chunk_shape(dataset);
+    std::size_t              multiple = detail::slab_block(dims, options);
+    if (!chunk.empty() && chunk[0] > 0) {
+        multiple = std::lcm(multiple, chunk[0]);
+    }
+    slab_planes = std::max<std::size_t>((slab_planes + multiple - 1) / multiple, 1) * multiple;
+
+    plane_reader<float> read = [&](std::size_t first, std::size_t count, float * out) {
+        file.load_hyperslab(out, dataset, { first, 0, 0 }, { count, dims[1], dims[2] });
+    };
+    return build_pyramid(dims, read, slab_planes, options, jobs);
+}
+}  // namespace velm_dr
+#endif
@@ -0,0 +1,305 @@
+#include "velm/raycaster.h"
+
+#include "velm/profiler.h"
+#include "velm/sampling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace velm_render {
+
+namespace {
+
+constexpr std::size_t packet_size = 8;
+constexpr std::size_t packet_cols = 4;  // a packet covers 4 x 2 pixels, neighbouring rays touch the same cache lines
+constexpr std::size_t packet_rows = 2;
+
+struct ray_state {
+    glm::vec3    origin;     // index space
+    glm::vec3    direction;  // index space per unit of world distance from the near plane
+    std::int64_t step;       // the ray is at t = step * dt
+    std::int64_t checked;    // last step known not to be inside an empty brick
+    float        t_end;
+    std::size_t  front;  // table entry of the previous sample
+    bool         has_front;
+    bool         live;
+    glm::vec4    color;
+    float        first_hit;
+    std::size_t  pixel;
+};
+
+// everything a tile needs, shared read-only by the workers
+struct march_context {
+    const velm_DR::ndarray<float, 3> & volume;
+    const minmax_bricks &              bricks;
+    const raycast_options &            options;
+    std::span<const glm::vec4>         table;  // pre-integrated, row front, column back
+    std::size_t                        resolution;
+    float                              entry_scale;  // scalar value to table entry
+    float                              dt;
+    std::vector<std::uint8_t>          empty;  // per brick, in minmax_bricks order
+
+    // nearest entry like transfer_function::lookup, without its rounding call
+    [[nodiscard]] std::size_t entry(float value) const {
+        float e = std::clamp((value - options.value_lo) * entry_scale, 0.0f, float(resolution - 1));
+        return std::size_t(e + 0.5f);
+    }
+
+    [[nodiscard]] std::size_t brick_of(const glm::vec3 & p, std::size_t (&b)[3]) const {
+        for (int a = 0; a < 3; ++a) {
+            b[a] = std::min(std::size_t(std::max(p[a], 0.0f) / float(minmax_bricks::edge)), bricks.dims[a] - 1);
+        }
+        return (b[0] * bricks.dims[1] + b[1]) * bricks.dims[2] + b[2];
+    }
+};
+
+// no entry of the table between normalized values a and b has any opacity, allowing for the nearest entry rounding
+bool transparent_between(const transfer_function & tf, float a, float b) {
+    float half = 0.5f / float(tf.resolution() - 1);
+    a          = std::clamp(a - half, 0.0f, 1.0f);
+    b          = std::clamp(b + half, 0.0f, 1.0f);
+    if (tf.classify(a).w > 0.0f || tf.classify(b).w > 0.0f) {
+        return false;
+    }
+    return std::none_of(tf.points().begin(), tf.points().end(),
+                        [&](const tf_point & p) { return p.value > a && p.value < b && p.rgba.w > 0.0f; });
+}
+
+// ray parameter where the ray leaves brick b
+float brick_exit(const ray_state & r, const std::size_t (&b)[3]) {
+    float exit = FLT_MAX;
+    for (int a = 0; a < 3; ++a) {
+        float lo = float(b[a] * minmax_bricks::edge);
+        if (r.direction[a] > 0.0f) {
+            exit = std::min(exit, (lo + float(minmax_bricks::edge) - r.origin[a]) / r.direction[a]);
+        } else if (r.direction[a] < 0.0f) {
+            exit = std::min(exit, (lo - r.origin[a]) / r.direction[a]);
+        }
+    }
+    return exit;
+}
+
+// moves the ray past bricks it would only cross with transparent segments, or ends it
+void skip_empty(const march_context & ctx, ray_state & r) {
+    std::size_t b[3];
+    std::size_t other[3];
+    while (r.step > r.checked) {
+        float       t     = float(r.step) * ctx.dt;
+        std::size_t brick = ctx.brick_of(r.origin + t * r.direction, b);
+        // the last lattice point inside the brick
+        auto last = std::int64_t(std::floor(std::min(brick_exit(r, b), r.t_end) / ctx.dt));
+        if (!ctx.empty[brick]) {
+            r.checked = std::max(last, r.step);
+            return;
+        }
+        // the segments before and after this sample have to stay inside the brick for its range to bound their
+        // values: one arriving from another brick crosses the face and is taken first
+        if (last <= r.step || ctx.brick_of(r.origin + (t + ctx.dt) * r.direction, other) != brick ||
+            (r.has_front && ctx.brick_of(r.origin + (t - ctx.dt) * r.direction, other) != brick)) {
+            r.checked = r.step;
+            return;
+        }
+        // which becomes the front sample of the segment leaving it
+        r.step      = last;
+        r.checked   = last;
+        r.has_front = false;
+        if (float(r.step) * ctx.dt > r.t_end) {
+            r.live = false;
+        }
+    }
+}
+
+void march_packet(const march_context & ctx, std::span<ray_state> rays) {
+    glm::vec3   positions[packet_size];
+    float       values[packet_size];
+    ray_state * lanes[packet_size];
+    while (true) {
+        std::size_t count = 0;
+        for (ray_state & r : rays) {
+            if (r.live && ctx.options.skip_empty) {
+                skip_empty(ctx, r);
+            }
+            if (r.live) {
+                lanes[count]     = &r;
+                positions[count] = r.origin + float(r.step) * ctx.dt * r.direction;
+                ++count;
+            }
+        }
+        if (count == 0) {
+            return;
+        }
+        // full packets keep the gather path, the padding lanes are ignored
+        std::fill(positions + count, positions + packet_size, positions[0]);
+        velm_DR::sample(ctx.volume, std::span<const glm::vec3>(positions), std::span<float>(values));
+
+        for (std::size_t l = 0; l < count; ++l) {
+            ray_state & r    = *lanes[l];
+            std::size_t back = ctx.entry(values[l]);
+            if (r.has_front) {
+                const glm::vec4 & segment = ctx.table[r.front * ctx.resolution + back];
+                if (segment.w > 0.0f) {
+                    r.first_hit = std::min(r.first_hit, float(r.step - 1) * ctx.dt);
+                    r.color += (1.0f - r.color.w) * segment;
+                }
+            }
+            r.front     = back;
+            r.has_front = true;
+            ++r.step;
+            r.live = float(r.step) * ctx.dt <= r.t_end && r.color.w < ctx.options.opacity_cutoff;
+        }
+    }
+}
+
+glm::vec3 unproject_ndc(const glm::mat4x4 & inverse_view_proj, glm::vec3 ndc) {
+    glm::vec4 p = inverse_view_proj * glm::vec4(ndc, 1.0f);
+    return glm::vec3(p) / p.w;
+}
+
+}  // namespace
+
+void raycast_volume(const glm::mat4x4 &       view_mat,
+                    const glm::mat4x4 &       proj_mat,
+                    bool                      homogeneous_depth,
+                    const grid_probe &        grid,
+                    const transfer_function & tf,
+                    composite_image &         image,
+                    const raycast_options &   options,
+                    velm::job_system &        jobs) {
+    VELM_PROFILE_FUNCTION();
+    image.clear(image.width, image.height);
+    const velm_DR::ndarray<float, 3> & volume = grid.volume;
+    if (volume.dims[0] < 2 || volume.dims[1] < 2 || volume.dims[2] < 2 || image.pixel_count() == 0) {
+        return;
+    }
+
+    // rays are parametrized by world distance from the near plane and step by tf.step() on a lattice starting there,
+    // so neighbouring rays and the bricks of a distributed render sample at consistent depths
+    float         range = options.value_hi - options.value_lo;
+    float         scale = range > 0.0f ? 1.0f / range : 0.0f;
+    float         dt    = std::max(tf.step(), 1e-6f);
+    float         entry = scale * float(tf.resolution() - 1);
+    march_context ctx{ volume, grid.bricks, options, tf.table(), tf.resolution(), entry, dt, {} };
+    const auto &  bricks = grid.bricks;
+    ctx.empty.resize(bricks.dims[0] * bricks.dims[1] * bricks.dims[2]);
+    for (std::size_t i = 0; i < bricks.dims[0]; ++i) {
+        for (std::size_t j = 0; j < bricks.dims[1]; ++j) {
+            for (std::size_t k = 0; k < bricks.dims[2]; ++k) {
+                float lo = (bricks.min(i, j, k) - options.value_lo) * scale;
+                float hi = (bricks.max(i, j, k) - options.value_lo) * scale;
+                ctx.empty[(i * bricks.dims[1] + j) * bricks.dims[2] + k] =
+                    transparent_between(tf, std::min(lo, hi), std::max(lo, hi)) ? 1 : 0;
+            }
+        }
+    }
+
+    glm::mat4x4 inverse_view_proj = glm::inverse(proj_mat * view_mat);
+    glm::mat4x4 world_to_index    = glm::inverse(grid.index_to_world);
+    glm::vec3   last_sample(float(volume.dims[0] - 1), float(volume.dims[1] - 1), float(volume.dims[2] - 1));
+    float       near_z  = homogeneous_depth ? -1.0f : 0.0f;
+    auto        width   = std::size_t(image.width);
+    auto        height  = std::size_t(image.height);
+    std::size_t tile    = std::max<std::uint32_t>(options.tile, 1);
+    std::size_t tiles_x = (width + tile - 1) / tile;
+    std::size_t tiles_y = (height + tile - 1) / tile;
+
+    // a ray through the centre of pixel (x, y), false when it misses the grid
+    auto make_ray = [&](std::size_t x, std::size_t y, ray_state & r) {
+        float     u          = (float(x) + 0.5f) / float(width) * 2.0f - 1.0f;
+        float     v          = 1.0f - (float(y) + 0.5f) / float(height) * 2.0f;
+        glm::vec3 near_point = unproject_ndc(inverse_view_proj, glm::vec3(u, v, near_z));
+        glm::vec3 far_point  = unproject_ndc(inverse_view_proj, glm::vec3(u, v, 1.0f));
+        ray       world{ near_point, far_point - near_point };
+        float     length = glm::length(world.direction);
+        ray       local  = world.transformed(world_to_index);
+
+        // ray parameters inside the box of samples
+        float enter = 0.0f;
+        float exit  = 1.0f;
+        for (int a = 0; a < 3; ++a) {
+            if (local.direction[a] == 0.0f) {
+                if (local.origin[a] < 0.0f || local.origin[a] > last_sample[a]) {
+                    return false;
+                }
+                continue;
+            }
+            float t0 = -local.origin[a] / local.direction[a];
+            float t1 = (last_sample[a] - local.origin[a]) / local.direction[a];
+            enter    = std::max(enter, std::min(t0, t1));
+            exit     = std::min(exit, std::max(t0, t1));
+        }
+        if (enter > exit || length == 0.0f) {
+            return false;
+        }
+        r.origin    = local.origin;
+        r.direction = local.direction / length;
+        r.step      = std::int64_t(std::ceil(enter * length / ctx.dt));
+        r.t_end     = exit * length;
+        r.checked   = -1;
+        r.front     = 0;
+        r.has_front = false;
+        r.live      = float(r.step) * ctx.dt <= r.t_end;
+        r.color     = glm::vec4(0.0f);
+        r.first_hit = FLT_MAX;
+        r.pixel     = y * width + x;
+        return true;
+    };
+
+    velm::parallel_for(
+        0, tiles_x * tiles_y, 1,
+        [&](std::size_t first, std::size_t last) {
+            ray_state rays[packet_size];
+            for (std::size_t t = first; t < last; ++t) {
+                std::size_t x0 = t % tiles_x * tile;
+                std::size_t y0 = t / tiles_x * tile;
+                std::size_t x1 = std::min(x0 + tile, width);
+                std::size_t y1 = std::min(y0 + tile, height);
+                for (std::size_t py = y0; py < y1; py += packet_rows) {
+                    for (std::size_t px = x0; px < x1; px += packet_cols) {
+                        std::size_t count = 0;
+                        for (std::size_t y = py; y < std::min(py + packet_rows, y1); ++y) {
+                            for (std::size_t x = px; x < std::min(px + packet_cols, x1); ++x) {
+                                count += make_ray(x, y, rays[count]) ? 1 : 0;
+                            }
+                        }
+                        march_packet(ctx, std::span<ray_state>(rays, count));
+                        for (std::size_t r = 0; r < count; ++r) {
+                            image.color[rays[r].pixel] = rays[r].color;
+                            if (rays[r].first_hit != FLT_MAX) {
+                                image.depth[rays[r].pixel] = rays[r].first_hit;
+                            }
+                        }
+                    }
+                }
+            }
+        },
+        jobs);
+}
+
+void raycast_volume(const view &              v,
+                    const grid_probe &        grid,
+                    const transfer_function & tf,
+                    composite_image &         image,
+                    const raycast_options &   options,
+                    velm::job_system &        jobs) {
+    raycast_volume(v.view_matrix(), v.projection(), v.homogeneous_clip_depth(), grid, tf, image, options, jobs);
+}
+
+void write_ppm(const composite_image & image, const std::filesystem::path & file, const glm::vec3 & background) {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+    std::vector<std::uint8_t> row(std::size_t(image.width) * 3);
+    for (std::size_t y = 0; y < image.height; ++y) {
+        for (std::size_t x = 0; x < image.width; ++x) {
+            to_rgb8(image.color[y * image.width + x], background, &row[x * 3]);
+        }
+        out.write(reinterpret_cast<const char *>(row.data()), std::streamsize(row.size()));
+    }
+    if (!out) {
+        throw std::runtime_error("write_ppm: cannot write " + file.string());
+    }
+}
+}  // namespace velm_render
@@ -0,0 +1,118 @@
+#include "velm/sampling.h"
+
+#include <algorithm>
+#include <climits>
+
+#ifdef __AVX2__
+#    include <immintrin.h>
+#endif
+
+namespace velm_DR {
+
+namespace {
+
+#ifdef __AVX2__
+/*
+ * Trilinear CLAMP / ZERO sampling of positions [0, count) with count a multiple of 8. Coordinates are clamped in
+ * float before the index conversion: [0, n - 1] gives exactly the clamp-to-edge result, [-1, n] keeps every ZERO
+ * tap that can carry weight. Indices are then always in range, so the gathers need no mask; ZERO taps outside the
+ * array just get weight 0.
+ */
+void sample_trilinear_avx2(const ndarray<float, 3> & volume,
+                           const glm::vec3 *         positions,
+                           float *                   out,
+                           std::size_t               count,
+                           bool                      zero_boundary) {
+    const __m256i lane_offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256  one          = _mm256_set1_ps(1.0f);
+
+    __m256i stride[3] = { _mm256_set1_epi32(int(volume.strides[0])), _mm256_set1_epi32(int(volume.strides[1])),
+                          _mm256_set1_epi32(1) };
+    __m256  lo[3];
+    __m256  hi[3];
+    __m256i last[3];
+    for (int a = 0; a < 3; ++a) {
+        float n = float(volume.dims[a]);
+        lo[a]   = _mm256_set1_ps(zero_boundary ? -1.0f : 0.0f);
+        hi[a]   = _mm256_set1_ps(zero_boundary ? n : n - 1.0f);
+        last[a] = _mm256_set1_epi32(int(volume.dims[a]) - 1);
+    }
+
+    for (std::size_t p = 0; p < count; p += 8) {
+        const float * xyz = &positions[p].x;
+        __m256i       i0[3];
+        __m256i       i1[3];
+        __m256        w0[3];
+        __m256        w1[3];
+        __m256        finite = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int a = 0; a < 3; ++a) {
+            __m256 x = _mm256_i32gather_ps(xyz + a, lane_offsets, 4);
+            // x - x is 0 unless x is inf or NaN
+            finite = _mm256_and_ps(finite, _mm256_cmp_ps(_mm256_sub_ps(x, x), _mm256_setzero_ps(), _CMP_EQ_OQ));
+            x      = _mm256_min_ps(_mm256_max_ps(x, lo[a]), hi[a]);
+
+            __m256  base = _mm256_floor_ps(x);
+            __m256  t    = _mm256_sub_ps(x, base);
+            __m256i i    = _mm256_cvttps_epi32(base);
+            __m256i next = _mm256_add_epi32(i, _mm256_set1_epi32(1));
+            w0[a]        = _mm256_sub_ps(one, t);
+            w1[a]        = t;
+            if (zero_boundary) {
+                // taps at -1 or n carry no weight
+                __m256i outside0 = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), i),
+                                                   _mm256_cmpgt_epi32(i, last[a]));
+                __m256i outside1 = _mm256_cmpgt_epi32(next, last[a]);
+                w0[a]            = _mm256_andnot_ps(_mm256_castsi256_ps(outside0), w0[a]);
+                w1[a]            = _mm256_andnot_ps(_mm256_castsi256_ps(outside1), w1[a]);
+            }
+            i0[a] = _mm256_min_epi32(_mm256_max_epi32(i, _mm256_setzero_si256()), last[a]);
+            i1[a] = _mm256_min_epi32(_mm256_max_epi32(next, _mm256_setzero_si256()), last[a]);
+            i0[a] = _mm256_mullo_epi32(i0[a], stride[a]);
+            i1[a] = _mm256_mullo_epi32(i1[a], stride[a]);
+        }
+
+        __m256 result = _mm256_setzero_ps();
+        for (int c = 0; c < 8; ++c) {
+            __m256i offset = _mm256_add_epi32(_mm256_add_epi32(c & 4 ? i1[0] : i0[0], c & 2 ? i1[1] : i0[1]),
+                                              c & 1 ? i1[2] : i0[2]);
+            __m256  weight = _mm256_mul_ps(_mm256_mul_ps(c & 4 ? w1[0] : w0[0], c & 2 ? w1[1] : w0[1]),
+                                           c & 1 ? w1[2] : w0[2]);
+            __m256  value  = _mm256_i32gather_ps(volume.data, offset, 4);
+            result         = _mm256_add_ps(result, _mm256_mul_ps(weight, value));
+        }
+        // non-finite positions give 0 like sample_at
+        _mm256_storeu_ps(out + p, _mm256_and_ps(result, finite));
+    }
+}
+#endif
+
+}  // namespace
+
+void sample(const ndarray<float, 3> &  volume,
+            std::span<const glm::vec3> positions,
+            std::span<float>           out,
+            const sample_options &     options) {
+    if (out.size() < positions.size()) {
+        abort();
+    }
+    if (volume.total_elements() == 0) {
+        std::fill_n(out.begin(), positions.size(), 0.0f);
+        return;
+    }
+    std::size_t done = 0;
+#ifdef __AVX2__
+    // gather offsets are 32 bit
+    bool vectorizable = options.allow_simd && options.filter == sample_filter::TRILINEAR &&
+                        options.boundary != sample_boundary::PERIODIC && volume.total_elements() > 0 &&
+                        volume.total_elements() <= std::size_t(INT_MAX);
+    if (vectorizable) {
+        done = positions.size() / 8 * 8;
+        sample_trilinear_avx2(volume, positions.data(), out.data(), done,
+                              options.boundary == sample_boundary::ZERO);
+    }
+#endif
+    for (std::size_t i = done; i < positions.size(); ++i) {
+        out[i] = sample_at(volume, positions[i], options);
+    }
+}
+}  // namespace velm_DR
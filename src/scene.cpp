@@ -1,9 +1,435 @@
 #include "velm/scene.h"
 
-velm::Scene::Scene() {}
+#include "shader_system.h"
+#include "velm/culling.h"
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+velm_render::view::view() :
+    view_mat(1.0f),
+    proj_mat(1.0f),
+    view_id(0),
+    render_target(BGFX_INVALID_HANDLE),
+    depth_buffer_target(BGFX_INVALID_HANDLE),
+    programs{ BGFX_INVALID_HANDLE, BGFX_INVALID_HANDLE },
+    draw_programs{ BGFX_INVALID_HANDLE, BGFX_INVALID_HANDLE },
+    dequantize(BGFX_INVALID_HANDLE) {}
+
+velm_render::view::~view() {}
+
+velm_render::view::view(view &&) noexcept = default;
+
+velm_render::view & velm_render::view::operator=(view &&) noexcept = default;
+
+void velm_render::view::set_camera(const glm::mat4x4 & view_matrix, const glm::mat4x4 & projection) {
+    view_mat = view_matrix;
+    proj_mat = projection;
+    revision_++;
+}
+
+void velm_render::view::set_view_id(bgfx::ViewId id) {
+    view_id = id;
+    revision_++;
+}
+
+void velm_render::view::set_program(bgfx::ProgramHandle handle, vertex_format format) {
+    programs[static_cast<std::size_t>(format)] = handle;
+    revision_++;
+}
+
+void velm_render::view::set_lod_error(std::uint16_t height, float max_pixel_error) {
+    viewport_height = height;
+    lod_pixel_error = max_pixel_error;
+    revision_++;
+}
+
+bool velm_render::view::needs_redraw() const {
+    return std::any_of(view_components.begin(), view_components.end(),
+                       [](const view_component * component) { return component->needs_redraw(); });
+}
+
+void velm_render::view::enable_occlusion_culling(std::uint32_t width, std::uint32_t height) {
+    revision_++;
+    if (width == 0 || height == 0) {
+        occlusion.reset();
+        return;
+    }
+    occlusion = std::make_unique<occlusion_buffer>(width, height);
+}
+
+void velm_render::view::render(velm::Scene & scene) {
+    VELM_PROFILE_FUNCTION();
+    (void) scene.update_transforms();
+    prepare();
+
+    bgfx::Encoder * encoder = bgfx::begin();
+    record(scene, *encoder);
+    bgfx::end(encoder);
+}
+
+void velm_render::view::prepare() {
+    const bgfx::Caps * caps = bgfx::getCaps();
+    homogeneous_depth       = caps != nullptr && caps->homogeneousDepth;
+
+    // looked up here on the api thread, record() may run anywhere
+    const char * vertex_shaders[2] = { "vs_mesh", "vs_mesh_packed" };
+    for (std::size_t f = 0; f < 2; ++f) {
+        draw_programs[f] =
+            bgfx::isValid(programs[f]) ? programs[f] : velm_shadersys::program(vertex_shaders[f], "fs_mesh");
+    }
+    if (bgfx::isValid(draw_programs[static_cast<std::size_t>(vertex_format::PACKED)])) {
+        dequantize = dequantize_uniform();
+    }
+
+    bgfx::setViewTransform(view_id, &view_mat[0][0], &proj_mat[0][0]);
+    for (view_component * component : view_components) {
+        component->prepare();
+    }
+}
+
+void velm_render::view::record(const velm::Scene & scene, bgfx::Encoder & encoder) {
+    VELM_PROFILE_FUNCTION();
+    glm::mat4x4 view_proj = proj_mat * view_mat;
+
+    visible_slots.clear();
+    scene.acceleration().cull(frustum::from_view_proj(view_proj, homogeneous_depth), scene.render_flag_pool(),
+                              visible_slots, occlusion.get(), &view_proj, homogeneous_depth);
+    encoder.touch(view_id);
+
+    // without a viewport height every mesh draws its finest level
+    glm::vec3 eye(glm::inverse(view_mat)[3]);
+    float     pixels_per_unit = proj_mat[1][1] * float(viewport_height) * 0.5f;
+    auto      meshes          = scene.mesh_pool();
+    auto      transforms      = scene.world_transform_pool();
+    auto      bounds          = scene.world_bound_pool();
+    for (std::uint32_t slot : visible_slots) {
+        const mesh * m = meshes[slot];
+        if (m == nullptr || m->lods.empty()) {
+            continue;
+        }
+        bgfx::ProgramHandle program = draw_programs[static_cast<std::size_t>(m->format)];
+        if (!bgfx::isValid(program)) {
+            continue;
+        }
+        // distance to the closest point of the bounds, zero when the camera is inside
+        glm::vec3   closest = glm::clamp(eye, bounds[slot].min, bounds[slot].max);
+        std::size_t level   = viewport_height == 0
+                                  ? 0
+                                  : m->select_lod(glm::length(closest - eye), pixels_per_unit,
+                                                  lod_pixel_error * lod_error_scale);
+        const mesh::lod & l = m->lods[level];
+
+        encoder.setTransform(&transforms[slot][0][0]);
+        if (m->format == vertex_format::PACKED) {
+            glm::vec4 dequantize_box[2] = { glm::vec4(m->box.center, 0.0f), glm::vec4(m->box.scale, 0.0f) };
+            encoder.setUniform(dequantize, dequantize_box, 2);
+        }
+        encoder.setVertexBuffer(0, l.vertex_buffer);
+        encoder.setIndexBuffer(l.index_buffer, 0, l.index_count);
+        encoder.setState(BGFX_STATE_DEFAULT);
+        encoder.submit(view_id, program);
+    }
+
+    for (view_component * component : view_components) {
+        component->submit(encoder, view_id);
+    }
+}
+
+void velm_render::view::add_component(view_component & component) {
+    view_components.push_back(&component);
+    revision_++;
+}
+
+void velm_render::view::remove_component(view_component & component) {
+    std::erase(view_components, &component);
+    revision_++;
+}
+
+velm_render::aabb velm_render::aabb::transformed(const glm::mat4x4 & m) const {
+    // Arvo: transform the center, extents pick up the absolute value of the linear part
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+
+    glm::vec3 new_center = glm::vec3(m * glm::vec4(center, 1.0f));
+    glm::vec3 new_extent(0.0f);
+    for (int row = 0; row < 3; ++row) {
+        new_extent[row] = std::abs(m[0][row]) * extent.x + std::abs(m[1][row]) * extent.y +
+                          std::abs(m[2][row]) * extent.z;
+    }
+    return { new_center - new_extent, new_center + new_extent };
+}
+
+velm::Scene::Scene() : accel(std::make_unique<velm_render::bvh>()) {}
 
 velm::Scene::~Scene() {}
 
-void velm::Scene::add_mesh() {}
+namespace {
+std::uint32_t checked_slot(const velm::Scene & scene, velm::scene_handle handle) {
+    if (!scene.is_valid(handle)) {
+        abort();
+    }
+    return handle.index;
+}
+}  // namespace
+
+velm::scene_handle velm::Scene::add_mesh(velm_render::mesh *       mesh,
+                                         const velm_render::aabb & bounds,
+                                         scene_handle              parent,
+                                         std::uint8_t              object_flags) {
+    std::uint32_t parent_slot = parent.valid() ? checked_slot(*this, parent) : scene_handle::invalid_index;
+
+    std::uint32_t slot = 0;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(alive.size());
+        local_transforms.emplace_back(1.0f);
+        world_transforms.emplace_back(1.0f);
+        local_bounds.emplace_back();
+        world_bounds.emplace_back();
+        flags.push_back(0);
+        dirty.push_back(0);
+        alive.push_back(0);
+        parents.push_back(scene_handle::invalid_index);
+        first_children.push_back(scene_handle::invalid_index);
+        next_siblings.push_back(scene_handle::invalid_index);
+        prev_siblings.push_back(scene_handle::invalid_index);
+        generations.push_back(1);
+        meshes.push_back(nullptr);
+    }
+
+    local_transforms[slot] = glm::mat4x4(1.0f);
+    local_bounds[slot]     = bounds;
+    flags[slot]            = object_flags;
+    dirty[slot]            = 1;
+    alive[slot]            = 1;
+    meshes[slot]           = mesh;
+    link_child(slot, parent_slot);
+    order_dirty            = true;
+    topology_version_++;
+
+    return { slot, generations[slot] };
+}
+
+void velm::Scene::remove(scene_handle handle) {
+    if (!is_valid(handle)) {
+        return;
+    }
+    std::uint32_t slot = handle.index;
+
+    // children are reattached to the root, keeping their current world transform; world_transforms may be stale
+    // when something in the chain changed since the last update
+    glm::mat4x4 world = resolve_world(slot);
+    while (first_children[slot] != scene_handle::invalid_index) {
+        std::uint32_t child     = first_children[slot];
+        local_transforms[child] = world * local_transforms[child];
+        dirty[child]            = 1;
+        unlink_child(child);
+        link_child(child, scene_handle::invalid_index);
+    }
+    unlink_child(slot);
+
+    alive[slot]  = 0;
+    flags[slot]  = 0;
+    dirty[slot]  = 0;
+    meshes[slot] = nullptr;
+    generations[slot]++;
+    free_slots.push_back(slot);
+    order_dirty = true;
+    topology_version_++;
+}
+
+bool velm::Scene::is_valid(scene_handle handle) const {
+    return handle.index < alive.size() && alive[handle.index] && generations[handle.index] == handle.generation;
+}
+
+velm_render::view & velm::Scene::add_view() {
+    revision_++;
+    return views.emplace_back();
+}
+
+void velm::Scene::set_parent(scene_handle handle, scene_handle parent) {
+    std::uint32_t slot        = checked_slot(*this, handle);
+    std::uint32_t parent_slot = parent.valid() ? checked_slot(*this, parent) : scene_handle::invalid_index;
+
+    // reject cycles
+    for (std::uint32_t p = parent_slot; p != scene_handle::invalid_index; p = parents[p]) {
+        if (p == slot) {
+            abort();
+        }
+    }
+    unlink_child(slot);
+    link_child(slot, parent_slot);
+    dirty[slot] = 1;
+    order_dirty = true;
+    revision_++;
+}
+
+void velm::Scene::set_transform(scene_handle handle, const glm::mat4x4 & transform) {
+    std::uint32_t slot     = checked_slot(*this, handle);
+    local_transforms[slot] = transform;
+    dirty[slot]            = 1;
+    revision_++;
+}
+
+void velm::Scene::set_bounds(scene_handle handle, const velm_render::aabb & bounds) {
+    std::uint32_t slot = checked_slot(*this, handle);
+    local_bounds[slot] = bounds;
+    dirty[slot]        = 1;
+    revision_++;
+}
+
+void velm::Scene::set_render_flags(scene_handle handle, std::uint8_t object_flags) {
+    flags[checked_slot(*this, handle)] = object_flags;
+    revision_++;
+}
+
+std::uint64_t velm::Scene::revision() const {
+    // views count their own changes, the sum only grows
+    std::uint64_t total = revision_ + topology_version_;
+    for (const velm_render::view & v : views) {
+        total += v.revision();
+    }
+    return total;
+}
+
+const glm::mat4x4 & velm::Scene::local_transform(scene_handle handle) const {
+    return local_transforms[checked_slot(*this, handle)];
+}
+
+const glm::mat4x4 & velm::Scene::world_transform(scene_handle handle) const {
+    return world_transforms[checked_slot(*this, handle)];
+}
+
+const velm_render::aabb & velm::Scene::world_bound(scene_handle handle) const {
+    return world_bounds[checked_slot(*this, handle)];
+}
+
+std::uint8_t velm::Scene::render_flags(scene_handle handle) const {
+    return flags[checked_slot(*this, handle)];
+}
+
+velm_render::mesh * velm::Scene::mesh_of(scene_handle handle) const {
+    return meshes[checked_slot(*this, handle)];
+}
+
+velm::scene_handle velm::Scene::handle_of(std::uint32_t slot) const {
+    if (slot >= alive.size() || !alive[slot]) {
+        return {};
+    }
+    return { slot, generations[slot] };
+}
+
+void velm::Scene::link_child(std::uint32_t slot, std::uint32_t parent) {
+    parents[slot]       = parent;
+    prev_siblings[slot] = scene_handle::invalid_index;
+    next_siblings[slot] = scene_handle::invalid_index;
+    if (parent == scene_handle::invalid_index) {
+        return;
+    }
+    std::uint32_t head = first_children[parent];
+    if (head != scene_handle::invalid_index) {
+        prev_siblings[head] = slot;
+    }
+    next_siblings[slot]    = head;
+    first_children[parent] = slot;
+}
+
+void velm::Scene::unlink_child(std::uint32_t slot) {
+    std::uint32_t parent = parents[slot];
+    std::uint32_t prev   = prev_siblings[slot];
+    std::uint32_t next   = next_siblings[slot];
+    if (prev != scene_handle::invalid_index) {
+        next_siblings[prev] = next;
+    } else if (parent != scene_handle::invalid_index) {
+        first_children[parent] = next;
+    }
+    if (next != scene_handle::invalid_index) {
+        prev_siblings[next] = prev;
+    }
+    parents[slot]       = scene_handle::invalid_index;
+    prev_siblings[slot] = scene_handle::invalid_index;
+    next_siblings[slot] = scene_handle::invalid_index;
+}
+
+glm::mat4x4 velm::Scene::resolve_world(std::uint32_t slot) const {
+    glm::mat4x4 world = local_transforms[slot];
+    for (std::uint32_t p = parents[slot]; p != scene_handle::invalid_index; p = parents[p]) {
+        world = local_transforms[p] * world;
+    }
+    return world;
+}
+
+void velm::Scene::rebuild_update_order() {
+    // depth of every alive slot, resolved iteratively so deep hierarchies can't overflow the stack
+    constexpr std::uint32_t    unknown = UINT32_MAX;
+    std::vector<std::uint32_t> depth(alive.size(), unknown);
+    std::vector<std::uint32_t> chain;
+    std::uint32_t              levels = 0;
+
+    for (std::uint32_t i = 0; i < alive.size(); ++i) {
+        if (!alive[i] || depth[i] != unknown) {
+            continue;
+        }
+        chain.clear();
+        std::uint32_t s = i;
+        while (s != scene_handle::invalid_index && depth[s] == unknown) {
+            chain.push_back(s);
+            s = parents[s];
+        }
+        std::uint32_t d = s == scene_handle::invalid_index ? 0 : depth[s] + 1;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            depth[*it] = d++;
+        }
+        levels = std::max(levels, d);
+    }
+
+    // counting sort by depth keeps slot order within a level, which keeps the pass mostly sequential in memory
+    std::vector<std::uint32_t> level_start(levels + 1, 0);
+    for (std::uint32_t i = 0; i < alive.size(); ++i) {
+        if (alive[i]) {
+            level_start[depth[i] + 1]++;
+        }
+    }
+    for (std::uint32_t l = 1; l <= levels; ++l) {
+        level_start[l] += level_start[l - 1];
+    }
+    update_order.resize(level_start[levels]);
+    for (std::uint32_t i = 0; i < alive.size(); ++i) {
+        if (alive[i]) {
+            update_order[level_start[depth[i]]++] = i;
+        }
+    }
+    order_dirty = false;
+}
+
+std::span<const std::uint32_t> velm::Scene::update_transforms() {
+    if (order_dirty) {
+        rebuild_update_order();
+    }
 
-void velm::Scene::add_view() {}
+    changed.clear();
+    for (std::uint32_t slot : update_order) {
+        std::uint32_t parent = parents[slot];
+        if (parent != scene_handle::invalid_index && dirty[parent]) {
+            dirty[slot] = 1;
+        }
+        if (!dirty[slot]) {
+            continue;
+        }
+        world_transforms[slot] = parent == scene_handle::invalid_index ?
+                                     local_transforms[slot] :
+                                     world_transforms[parent] * local_transforms[slot];
+        world_bounds[slot] = local_bounds[slot].transformed(world_transforms[slot]);
+        changed.push_back(slot);
+    }
+    for (std::uint32_t slot : changed) {
+        dirty[slot] = 0;
+    }
+    accel->refit(*this, changed);
+    return changed;
+}
@@ -2,12 +2,14 @@
 
 #include "bgfx/bgfx.h"
 #include "bx/file.h"
+#include "velm/profiler.h"
 
 #include <filesystem>
 #include <iostream>
 #include <string_view>
 
 void velm_shadersys::load_all() {
+    VELM_PROFILE_FUNCTION();
     const char * shaderPath = "";
 
     switch (bgfx::getRendererType()) {
@@ -67,11 +69,27 @@ void velm_shadersys::load_all() {
     }
 }
 
+namespace {
+struct program_entry {
+    std::string         vertex;
+    std::string         fragment;
+    bgfx::ProgramHandle handle;
+};
+
+std::vector<program_entry> programs;
+}  // namespace
+
 void velm_shadersys::destroy_all() {
+    // programs keep their shaders, they go first
+    for (const program_entry & entry : programs) {
+        bgfx::destroy(entry.handle);
+    }
+    programs.clear();
     for (int i = 0; i < shaders.size(); i++) {
         std::cout << "velm_shadersys: Destroying shader " << shaders[i].first << "\n";
         bgfx::destroy(shaders[i].second);
     }
+    shaders.clear();
 }
 
 bgfx::ShaderHandle velm_shadersys::retrieve(std::string_view name) {
@@ -80,5 +98,24 @@ bgfx::ShaderHandle velm_shadersys::retrieve(std::string_view name) {
             return shaders[i].second;
         }
     }
-    return bgfx::ShaderHandle();
+    return BGFX_INVALID_HANDLE;
+}
+
+bgfx::ProgramHandle velm_shadersys::program(std::string_view vertex, std::string_view fragment) {
+    for (const program_entry & entry : programs) {
+        if (entry.vertex == vertex && entry.fragment == fragment) {
+            return entry.handle;
+        }
+    }
+    bgfx::ShaderHandle vs = retrieve(vertex);
+    bgfx::ShaderHandle fs = retrieve(fragment);
+    if (!bgfx::isValid(vs) || !bgfx::isValid(fs)) {
+        return BGFX_INVALID_HANDLE;
+    }
+    // the shaders are shared between programs and destroyed with the rest in destroy_all()
+    bgfx::ProgramHandle handle = bgfx::createProgram(vs, fs, false);
+    if (bgfx::isValid(handle)) {
+        programs.push_back({ std::string(vertex), std::string(fragment), handle });
+    }
+    return handle;
 }
@@ -10,6 +10,10 @@ void destroy_all();
 
 [[nodiscard]] bgfx::ShaderHandle retrieve(std::string_view);
 
+// program of a loaded vertex / fragment shader pair, created on first use and destroyed by destroy_all(); invalid
+// when either shader was not loaded. Api thread only.
+[[nodiscard]] bgfx::ProgramHandle program(std::string_view vertex, std::string_view fragment);
+
 namespace {
 std::vector<std::pair<std::string, bgfx::ShaderHandle>> shaders;
 }
@@ -0,0 +1,235 @@
+#include "velm/slice_plane.h"
+
+#include "shader_system.h"
+#include "velm/profiler.h"
+
+#include <cstdlib>
+
+namespace velm_render {
+
+namespace {
+
+struct slice_vertex {
+    float position[3];
+    float texcoord[2];
+};
+
+const bgfx::VertexLayout & slice_layout() {
+    static const bgfx::VertexLayout layout = [] {
+        bgfx::VertexLayout l;
+        l.begin()
+            .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+            .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
+            .end();
+        return l;
+    }();
+    return layout;
+}
+
+constexpr std::size_t lut_size = 256;
+
+template <typename H> void destroy_if_valid(H & handle) {
+    if (bgfx::isValid(handle)) {
+        bgfx::destroy(handle);
+        handle = BGFX_INVALID_HANDLE;
+    }
+}
+
+}  // namespace
+
+slice_plane::slice_plane() = default;
+
+slice_plane::~slice_plane() {
+    destroy_if_valid(slice_texture);
+    destroy_if_valid(lut_texture);
+    destroy_if_valid(quad);
+    destroy_if_valid(slice_sampler);
+    destroy_if_valid(lut_sampler);
+    destroy_if_valid(range_uniform);
+}
+
+void slice_plane::set_volume(const velm_DR::ndarray<float, 3> * source) {
+    volume         = source;
+    index          = 0;
+    data_dirty     = true;
+    geometry_dirty = true;
+    uniforms_dirty = true;
+}
+
+void slice_plane::set_axis_slice(std::size_t slice_axis, std::size_t slice_index) {
+    if (slice_axis > 2) {
+        abort();
+    }
+    oblique        = false;
+    axis           = slice_axis;
+    index          = slice_index;
+    data_dirty     = true;
+    geometry_dirty = true;
+}
+
+void slice_plane::set_oblique_slice(const glm::vec3 & corner,
+                                    const glm::vec3 & step_u,
+                                    const glm::vec3 & step_v,
+                                    std::size_t       texels_u,
+                                    std::size_t       texels_v) {
+    oblique        = true;
+    origin         = corner;
+    u              = step_u;
+    v              = step_v;
+    width          = texels_u;
+    height         = texels_v;
+    data_dirty     = true;
+    geometry_dirty = true;
+}
+
+void slice_plane::set_value_range(float lo, float hi) {
+    range          = glm::vec4(lo, hi != lo ? 1.0f / (hi - lo) : 0.0f, 0.0f, 0.0f);
+    uniforms_dirty = true;
+}
+
+void slice_plane::set_colormap(std::span<const std::uint32_t> colors) {
+    lut.assign(lut_size, 0xffffffffu);
+    if (!colors.empty()) {
+        for (std::size_t i = 0; i < lut_size; ++i) {
+            float         t    = float(i) / float(lut_size - 1) * float(colors.size() - 1);
+            std::size_t   a    = std::min(static_cast<std::size_t>(t), colors.size() - 1);
+            std::size_t   b    = std::min(a + 1, colors.size() - 1);
+            float         f    = t - float(a);
+            std::uint32_t rgba = 0;
+            for (int c = 0; c < 32; c += 8) {
+                float ca = float((colors[a] >> c) & 0xff);
+                float cb = float((colors[b] >> c) & 0xff);
+                rgba |= std::uint32_t(std::lround(ca + (cb - ca) * f)) << c;
+            }
+            lut[i] = rgba;
+        }
+    }
+    lut_dirty = true;
+}
+
+void slice_plane::upload_slice() {
+    VELM_PROFILE_FUNCTION();
+    if (!oblique) {
+        index               = std::min(index, volume->dims[axis] - 1);
+        slice_extent extent = slice_extent_of(*volume, axis);
+        width               = extent.width;
+        height              = extent.height;
+    }
+    if (width == 0 || height == 0 || width > UINT16_MAX || height > UINT16_MAX) {
+        abort();
+    }
+    staging.resize(width * height);
+    if (oblique) {
+        extract_oblique_slice(*volume, origin, u, v, width, height, staging);
+    } else {
+        (void) extract_slice(*volume, axis, index, staging);
+    }
+
+    auto w = static_cast<std::uint16_t>(width);
+    auto h = static_cast<std::uint16_t>(height);
+    if (!bgfx::isValid(slice_texture) || texture_width != w || texture_height != h) {
+        destroy_if_valid(slice_texture);
+        slice_texture  = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::R32F,
+                                               BGFX_SAMPLER_UVW_CLAMP | BGFX_SAMPLER_POINT);
+        texture_width  = w;
+        texture_height = h;
+        slice_memory.resize(std::size_t(w) * h * sizeof(float));
+    }
+    upload_bytes = staging.size() * sizeof(float);
+    bgfx::updateTexture2D(slice_texture, 0, 0, 0, 0, w, h,
+                          bgfx::copy(staging.data(), static_cast<std::uint32_t>(upload_bytes)));
+    data_dirty = false;
+}
+
+void slice_plane::upload_quad() {
+    // axis-aligned slices are expressed as an oblique slice along two index axes
+    glm::vec3 corner = origin;
+    glm::vec3 step_u = u;
+    glm::vec3 step_v = v;
+    if (!oblique) {
+        std::size_t row = axis == 0 ? 1 : 0;
+        std::size_t col = axis == 2 ? 1 : 2;
+        corner            = glm::vec3(0.0f);
+        step_u            = glm::vec3(0.0f);
+        step_v            = glm::vec3(0.0f);
+        corner[int(axis)] = float(index);
+        step_u[int(col)]  = 1.0f;
+        step_v[int(row)]  = 1.0f;
+    }
+
+    // the quad reaches half a texel past the outermost samples so texel centers land on the sample positions
+    glm::vec3    lo = corner - 0.5f * step_u - 0.5f * step_v;
+    glm::vec3    du = float(width) * step_u;
+    glm::vec3    dv = float(height) * step_v;
+    slice_vertex vertices[4];
+    for (int i = 0; i < 4; ++i) {
+        float     s = float(i & 1);
+        float     t = float(i >> 1);
+        glm::vec3 p = lo + s * du + t * dv;
+        vertices[i] = { { p.x, p.y, p.z }, { s, t } };
+    }
+
+    if (!bgfx::isValid(quad)) {
+        quad = bgfx::createDynamicVertexBuffer(4, slice_layout());
+    }
+    bgfx::update(quad, 0, bgfx::copy(vertices, sizeof(vertices)));
+    geometry_dirty = false;
+}
+
+void slice_plane::upload_lut() {
+    if (lut.empty()) {
+        // grey ramp until a colormap is set
+        lut.resize(lut_size);
+        for (std::size_t i = 0; i < lut_size; ++i) {
+            auto g = static_cast<std::uint32_t>(i);
+            lut[i] = 0xff000000u | (g << 16) | (g << 8) | g;
+        }
+    }
+    if (!bgfx::isValid(lut_texture)) {
+        lut_texture = bgfx::createTexture2D(std::uint16_t(lut_size), 1, false, 1, bgfx::TextureFormat::RGBA8,
+                                            BGFX_SAMPLER_UVW_CLAMP);
+        lut_memory.resize(lut_size * sizeof(std::uint32_t));
+    }
+    bgfx::updateTexture2D(lut_texture, 0, 0, 0, 0, std::uint16_t(lut_size), 1,
+                          bgfx::copy(lut.data(), std::uint32_t(lut.size() * sizeof(std::uint32_t))));
+    lut_dirty = false;
+}
+
+void slice_plane::prepare() {
+    upload_bytes   = 0;
+    uniforms_dirty = false;
+    if (volume == nullptr) {
+        return;
+    }
+    draw_program = bgfx::isValid(program) ? program : velm_shadersys::program("vs_slice", "fs_slice");
+    if (!bgfx::isValid(range_uniform)) {
+        slice_sampler = bgfx::createUniform("s_slice", bgfx::UniformType::Sampler);
+        lut_sampler   = bgfx::createUniform("s_colormap", bgfx::UniformType::Sampler);
+        range_uniform = bgfx::createUniform("u_sliceRange", bgfx::UniformType::Vec4);
+    }
+    // the slice upload clamps the index, so it runs before the quad is rebuilt
+    if (data_dirty) {
+        upload_slice();
+    }
+    if (geometry_dirty) {
+        upload_quad();
+    }
+    if (lut_dirty) {
+        upload_lut();
+    }
+}
+
+void slice_plane::submit(bgfx::Encoder & encoder, bgfx::ViewId view_id) {
+    if (volume == nullptr || !bgfx::isValid(draw_program) || !bgfx::isValid(quad)) {
+        return;
+    }
+    encoder.setTransform(&transform[0][0]);
+    encoder.setVertexBuffer(0, quad);
+    encoder.setTexture(0, slice_sampler, slice_texture);
+    encoder.setTexture(1, lut_sampler, lut_texture);
+    encoder.setUniform(range_uniform, &range[0]);
+    encoder.setState(BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A | BGFX_STATE_WRITE_Z | BGFX_STATE_DEPTH_TEST_LESS |
+                     BGFX_STATE_MSAA | BGFX_STATE_PT_TRISTRIP);
+    encoder.submit(view_id, draw_program);
+}
+}  // namespace velm_render
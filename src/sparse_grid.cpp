@@ -0,0 +1,45 @@
+#include "velm/sparse_grid.h"
+
+#ifdef VELM_ENABLE_HDF5
+#    include "velm/hdf5.h"
+#    include "velm/memory_budget.h"
+
+#    include <numeric>
+#    include <stdexcept>
+#    include <string>
+
+namespace velm_DR {
+
+sparse_grid<float> load_sparse_grid(const velm::hdf5_file & file,
+                                    std::string_view        dataset,
+                                    float                   background,
+                                    float                   tolerance,
+                                    std::size_t             slab_planes,
+                                    velm::job_system &      jobs) {
+    std::vector<std::size_t> shape = file.get_dataset_shape(dataset);
+    if (shape.size() != 3) {
+        throw std::invalid_argument("load_sparse_grid: " + std::string(dataset) + " is not a 3D dataset");
+    }
+    // slabs start on leaf boundaries so no leaf is split between two of them, and on chunk boundaries so no chunk
+    // is decompressed twice
+    std::size_t              step  = sparse_grid<float>::leaf_edge;
+    std::vector<std::size_t> chunk = file.get_chunk_shape(dataset);
+    if (!chunk.empty() && chunk[0] > 0) {
+        step = std::lcm(step, chunk[0]);
+    }
+    slab_planes = std::max<std::size_t>((slab_planes + step - 1) / step, 1) * step;
+
+    sparse_grid<float>  result(background);
+    std::vector<float>  buffer(std::min(slab_planes, shape[0]) * shape[1] * shape[2]);
+    velm::memory_charge buffer_memory(velm::memory_category::IO_BUFFERS, buffer.size() * sizeof(float));
+    for (std::size_t first = 0; first < shape[0]; first += slab_planes) {
+        std::size_t planes = std::min(slab_planes, shape[0] - first);
+        file.load_hyperslab(buffer.data(), dataset, { first, 0, 0 }, { planes, shape[1], shape[2] });
+        ndarray<float, 3>  slab      = ndarray<float, 3>::wrap(buffer.data(), planes, shape[1], shape[2]);
+        const std::int32_t origin[3] = { std::int32_t(first), 0, 0 };
+        result.insert_dense(slab, origin, tolerance, jobs);
+    }
+    return result;
+}
+}  // namespace velm_DR
+#endif
@@ -0,0 +1,182 @@
+#include "velm/transfer_function.h"
+
+#include "velm/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace velm_render {
+
+void transfer_function::entry_range::merge(const entry_range & other) {
+    if (other.empty()) {
+        return;
+    }
+    if (empty()) {
+        *this = other;
+        return;
+    }
+    lo = std::min(lo, other.lo);
+    hi = std::max(hi, other.hi);
+}
+
+transfer_function::transfer_function(std::size_t resolution) :
+    size(resolution), samples(resolution), integrals(resolution), table_(resolution * resolution) {
+    if (resolution < 2 || resolution * sizeof(glm::vec4) > UINT16_MAX) {
+        abort();
+    }
+    compute_range = { 0, size - 1 };
+}
+
+transfer_function::~transfer_function() {
+    if (bgfx::isValid(texture_)) {
+        bgfx::destroy(texture_);
+    }
+}
+
+void transfer_function::set_points(std::span<const tf_point> points) {
+    points_.assign(points.begin(), points.end());
+    compute_range = { 0, size - 1 };
+}
+
+void transfer_function::edit_points(std::size_t first, std::span<const tf_point> points) {
+    std::size_t last = first + points.size();
+    if (last > points_.size()) {
+        abort();
+    }
+    // interpolation reaches from the previous to the next unchanged point, the clamped ends to 0 and 1
+    float lo = first == 0 ? 0.0f : points_[first - 1].value;
+    float hi = last == points_.size() ? 1.0f : points_[last].value;
+    std::copy(points.begin(), points.end(), points_.begin() + std::ptrdiff_t(first));
+    mark(lo, hi);
+}
+
+void transfer_function::set_step(float length) {
+    step_         = length;
+    compute_range = { 0, size - 1 };
+}
+
+void transfer_function::mark(float lo, float hi) {
+    auto last  = float(size - 1);
+    auto first = std::size_t(std::clamp(std::floor(lo * last), 0.0f, last));
+    auto end   = std::size_t(std::clamp(std::ceil(hi * last), 0.0f, last));
+    compute_range.merge({ first, end });
+}
+
+glm::vec4 transfer_function::classify(float value) const {
+    if (points_.empty()) {
+        return glm::vec4(0.0f);
+    }
+    auto next = std::upper_bound(points_.begin(), points_.end(), value,
+                                 [](float v, const tf_point & p) { return v < p.value; });
+    if (next == points_.begin()) {
+        return points_.front().rgba;
+    }
+    if (next == points_.end()) {
+        return points_.back().rgba;
+    }
+    const tf_point & prev  = *(next - 1);
+    float            width = next->value - prev.value;
+    float            t     = width > 0.0f ? (value - prev.value) / width : 1.0f;
+    return prev.rgba + t * (next->rgba - prev.rgba);
+}
+
+glm::vec4 transfer_function::integrate(std::size_t front, std::size_t back) const {
+    // average extinction and extinction weighted color of the segment, in units of the sample spacing
+    float     extinction = samples[front].w;
+    glm::vec3 color(samples[front]);
+    if (front != back) {
+        const std::array<double, 4> & f     = integrals[front];
+        const std::array<double, 4> & b     = integrals[back];
+        double                        delta = b[0] - f[0];
+        extinction                          = float(delta / (double(back) - double(front)));
+        if (std::abs(delta) > 1e-12) {
+            color = glm::vec3(float((b[1] - f[1]) / delta), float((b[2] - f[2]) / delta), float((b[3] - f[3]) / delta));
+        } else {
+            color = 0.5f * (glm::vec3(samples[front]) + glm::vec3(samples[back]));
+        }
+    }
+    float alpha = 1.0f - std::exp(-std::max(extinction, 0.0f) * step_);
+    return glm::vec4(color * alpha, alpha);
+}
+
+std::size_t transfer_function::update(velm::job_system & jobs) {
+    VELM_PROFILE_FUNCTION();
+    if (compute_range.empty()) {
+        return 0;
+    }
+    std::size_t lo = compute_range.lo;
+    std::size_t hi = compute_range.hi;
+    for (std::size_t i = lo; i <= hi; ++i) {
+        samples[i] = classify(float(i) / float(size - 1));
+    }
+    // trapezoid rule; entries before lo keep their values, the ones after it shift
+    for (std::size_t i = std::max<std::size_t>(lo, 1); i < size; ++i) {
+        const glm::vec4 & s0 = samples[i - 1];
+        const glm::vec4 & s1 = samples[i];
+        integrals[i][0]      = integrals[i - 1][0] + 0.5 * (double(s0.w) + double(s1.w));
+        for (int c = 0; c < 3; ++c) {
+            integrals[i][c + 1] = integrals[i - 1][c + 1] + 0.5 * (double(s0.w * s0[c]) + double(s1.w * s1[c]));
+        }
+    }
+
+    // a segment changes when it overlaps [lo, hi]: rows before lo from column lo on, rows after hi up to column hi
+    velm::parallel_for(
+        0, size, 16,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t front = begin; front < end; ++front) {
+                std::size_t first = front < lo ? lo : 0;
+                std::size_t last  = front > hi ? hi + 1 : size;
+                glm::vec4 * row   = table_.data() + front * size;
+                for (std::size_t back = first; back < last; ++back) {
+                    row[back] = integrate(front, back);
+                }
+            }
+        },
+        jobs);
+
+    upload_range.merge(compute_range);
+    compute_range = {};
+    return size * size - lo * lo - (size - 1 - hi) * (size - 1 - hi);
+}
+
+glm::vec4 transfer_function::lookup(float front, float back) const {
+    auto last = float(size - 1);
+    auto f    = std::size_t(std::lround(std::clamp(front, 0.0f, 1.0f) * last));
+    auto b    = std::size_t(std::lround(std::clamp(back, 0.0f, 1.0f) * last));
+    return table_[f * size + b];
+}
+
+void transfer_function::upload(std::uint64_t flags) {
+    upload_bytes = 0;
+    (void) update();
+    auto extent = static_cast<std::uint16_t>(size);
+    if (!bgfx::isValid(texture_)) {
+        texture_     = bgfx::createTexture2D(extent, extent, false, 1, bgfx::TextureFormat::RGBA32F, flags);
+        upload_range = { 0, size - 1 };
+        texture_memory.resize(size * size * sizeof(glm::vec4));
+    }
+    if (upload_range.empty()) {
+        return;
+    }
+
+    // the changed entries form at most three rectangles, each sent with the row pitch of the whole table
+    auto pitch = static_cast<std::uint16_t>(size * sizeof(glm::vec4));
+    auto send  = [&](std::size_t x0, std::size_t x1, std::size_t y0, std::size_t y1) {
+        if (x0 >= x1 || y0 >= y1) {
+            return;
+        }
+        std::size_t bytes = ((y1 - y0 - 1) * size + (x1 - x0)) * sizeof(glm::vec4);
+        bgfx::updateTexture2D(texture_, 0, 0, std::uint16_t(x0), std::uint16_t(y0), std::uint16_t(x1 - x0),
+                              std::uint16_t(y1 - y0),
+                              bgfx::copy(table_.data() + y0 * size + x0, static_cast<std::uint32_t>(bytes)), pitch);
+        upload_bytes += (x1 - x0) * (y1 - y0) * sizeof(glm::vec4);
+    };
+    std::size_t lo = upload_range.lo;
+    std::size_t hi = upload_range.hi;
+    send(lo, size, 0, lo);
+    send(0, size, lo, hi + 1);
+    send(0, hi + 1, hi + 1, size);
+    upload_range = {};
+}
+}  // namespace velm_render
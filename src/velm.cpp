@@ -3,8 +3,13 @@
 #include "bgfx/bgfx.h"
 #include "bx/platform.h"
 #include "shader_system.h"
+#include "velm/profiler.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <memory>
+#include <thread>
 
 #if BX_PLATFORM_LINUX
 #    define GLFW_EXPOSE_NATIVE_X11
@@ -21,54 +26,253 @@
 #include "velm/scene.h"
 
 velm::Velm::Velm() {
+    VELM_PROFILE_ZONE("velm_init");
     glfwInit();
-    GLFWwindow * window = glfwCreateWindow(800, 600, "debug_view", nullptr, nullptr);
-    if (!window) {
+    GLFWwindow * handle = glfwCreateWindow(int(width), int(height), "debug_view", nullptr, nullptr);
+    if (!handle) {
         glfwTerminate();
         return;
     }
 
-    glfwMakeContextCurrent(window);  // required for OpenGL backend
+    glfwMakeContextCurrent(handle);  // required for OpenGL backend
+    window = handle;
+
+    // input may change what update() does next, so it wakes an idle api thread; exposing the window needs a frame
+    glfwSetWindowUserPointer(handle, this);
+    auto on_input   = [](GLFWwindow * w, auto...) { static_cast<Velm *>(glfwGetWindowUserPointer(w))->wake(); };
+    auto on_refresh = [](GLFWwindow * w) { static_cast<Velm *>(glfwGetWindowUserPointer(w))->request_redraw(); };
+    glfwSetCursorPosCallback(handle, on_input);
+    glfwSetMouseButtonCallback(handle, on_input);
+    glfwSetScrollCallback(handle, on_input);
+    glfwSetKeyCallback(handle, on_input);
+    glfwSetWindowRefreshCallback(handle, on_refresh);
+}
+
+velm::Velm::~Velm() {
+    if (window) {
+        glfwDestroyWindow(static_cast<GLFWwindow *>(window));
+    }
+    glfwTerminate();
+}
+
+bool velm::Velm::init_bgfx() {
+    GLFWwindow * handle = static_cast<GLFWwindow *>(window);
 
     bgfx::Init init;
     init.type = bgfx::RendererType::Count;
 
 #if BX_PLATFORM_LINUX
-    init.platformData.nwh = (void *) (uintptr_t) glfwGetX11Window(window);
+    init.platformData.nwh = (void *) (uintptr_t) glfwGetX11Window(handle);
     init.platformData.ndt = glfwGetX11Display();
 #elif BX_PLATFORM_BSD
-    init.platformData.nwh = glfwGetX11Window(window);
+    init.platformData.nwh = glfwGetX11Window(handle);
     init.platformData.ndt = glfwGetX11Display();
 #elif BX_PLATFORM_OSX
-    init.platformData.nwh = glfwGetCocoaWindow(window);
+    init.platformData.nwh = glfwGetCocoaWindow(handle);
 #elif BX_PLATFORM_WINDOWS
-    init.platformData.nwh = glfwGetWin32Window(window);
+    init.platformData.nwh = glfwGetWin32Window(handle);
 #else
     abort();
 #endif
 
-    init.resolution.width  = 800;
-    init.resolution.height = 600;
+    init.resolution.width  = width;
+    init.resolution.height = height;
+    // every thread that can pick up a recording job needs its own encoder
+    init.limits.maxEncoders = std::uint16_t(std::max<std::size_t>(init.limits.maxEncoders, jobs.concurrency()));
 
     if (!bgfx::init(init)) {
         printf("BGFX Init failed.\n");
-        glfwDestroyWindow(window);
-        glfwTerminate();
-        return;
+        return false;
     }
+#ifdef VELM_ENABLE_PROFILER
+    bgfx::setDebug(BGFX_DEBUG_TEXT);
+#endif
 
     velm_shadersys::load_all();
-    auto vert = velm_shadersys::retrieve("vs_basic.sc");
-    auto frag = velm_shadersys::retrieve("fs_basic.sc");
+    // the default programs of views and slice planes, created up front so the first frame does not stall on them
+    (void) velm_shadersys::program("vs_mesh", "fs_mesh");
+    (void) velm_shadersys::program("vs_mesh_packed", "fs_mesh");
+    (void) velm_shadersys::program("vs_slice", "fs_slice");
+    return true;
 }
 
-velm::Velm::~Velm() {
-    velm_shadersys::destroy_all();
-    bgfx::shutdown();
+void velm::Velm::run(const std::function<void(Velm &)> & update) {
+    if (!window) {
+        return;
+    }
+    GLFWwindow * handle = static_cast<GLFWwindow *>(window);
+
+    // calling renderFrame() before init makes this thread the render thread instead of one spawned by bgfx
+    bgfx::renderFrame();
+    quit = false;
+
+    std::atomic<std::uint32_t> framebuffer_width{ width };
+    std::atomic<std::uint32_t> framebuffer_height{ height };
+
+    std::thread api([&] {
+        api_thread = std::this_thread::get_id();
+        if (!init_bgfx()) {
+            quit = true;
+            return;
+        }
+        std::uint64_t drawn_revision = 0;
+        while (!quit) {
+            if (framebuffer_width != width || framebuffer_height != height) {
+                width  = framebuffer_width;
+                height = framebuffer_height;
+                bgfx::reset(width, height);
+                governor_.reset();
+                redraw = true;
+            }
+            if (update) {
+                update(*this);
+            }
+
+            // a scene that went away has to disappear from the next frame
+            bool                                pending   = false;
+            std::vector<std::shared_ptr<Scene>> live      = live_scenes(pending);
+            std::uint64_t                       revision  = scene_revision(live, pending);
+            bool                                requested = redraw.exchange(false);
+            bool                                moving    = requested || pending || revision != drawn_revision;
+            if (mode_ == render_mode::ON_DEMAND && !moving && !governor_.refining()) {
+                // not holding on to the scenes while idle, they may be dropped meanwhile
+                live.clear();
+                wait_for_wake();
+                continue;
+            }
+
+            for (const std::shared_ptr<Scene> & scene : live) {
+                for (velm_render::view & v : scene->view_pool()) {
+                    v.set_lod_error_scale(governor_.lod_error_scale());
+                }
+            }
+            auto start = std::chrono::steady_clock::now();
+            render_frame(live);
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            governor_.frame_done(elapsed.count(), moving);
+            drawn_revision = revision;
+        }
+        velm_shadersys::destroy_all();
+        velm_render::destroy_vertex_formats();
+        bgfx::shutdown();
+    });
+
+    while (!quit) {
+        // an idle api thread submits nothing, so block on events instead; it posts an empty event when it resumes
+        if (api_idle) {
+            glfwWaitEventsTimeout(0.5);
+        } else {
+            glfwPollEvents();
+        }
+        int w = 0;
+        int h = 0;
+        glfwGetFramebufferSize(handle, &w, &h);
+        if (w > 0 && h > 0 && (std::uint32_t(w) != framebuffer_width || std::uint32_t(h) != framebuffer_height)) {
+            framebuffer_width  = std::uint32_t(w);
+            framebuffer_height = std::uint32_t(h);
+            wake();
+        }
+        if (glfwWindowShouldClose(handle)) {
+            quit = true;
+            wake();
+        }
+        // bounded wait, the api thread may go idle without submitting another frame
+        bgfx::renderFrame(100);
+    }
+    // keep serving the api thread until bgfx::shutdown() has released the context
+    while (bgfx::renderFrame() != bgfx::RenderFrame::NoContext) {
+    }
+    api.join();
+}
+
+void velm::Velm::render_frame() {
+    bool dropped = false;
+    render_frame(live_scenes(dropped));
+}
+
+void velm::Velm::render_frame(const std::vector<std::shared_ptr<Scene>> & live) {
+    VELM_PROFILE_FUNCTION();
+    std::vector<std::pair<const Scene *, velm_render::view *>> work;
+    for (const std::shared_ptr<Scene> & scene : live) {
+        // scenes are only modified here, recording below reads them from several threads at once
+        (void) scene->update_transforms();
+        for (velm_render::view & v : scene->view_pool()) {
+            v.prepare();
+            work.emplace_back(scene.get(), &v);
+        }
+    }
+
+    {
+        VELM_PROFILE_ZONE("record_views");
+        task_group group(jobs);
+        for (auto [scene, v] : work) {
+            group.run([this, scene, v] {
+                bgfx::Encoder * encoder = bgfx::begin(std::this_thread::get_id() != api_thread);
+                if (encoder == nullptr) {
+                    abort();
+                }
+                v->record(*scene, *encoder);
+                bgfx::end(encoder);
+            });
+        }
+        group.wait();
+    }
+
+    bgfx::frame();
+    VELM_PROFILE_FRAME();
+}
+
+void velm::Velm::request_redraw() {
+    redraw = true;
+    wake();
+}
+
+void velm::Velm::wake() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        woken = true;
+    }
+    wake_cv.notify_one();
+}
+
+void velm::Velm::wait_for_wake() {
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    api_idle = true;
+    wake_cv.wait(lock, [this] { return woken || quit; });
+    woken    = false;
+    api_idle = false;
+    lock.unlock();
+    glfwPostEmptyEvent();
+}
+
+std::vector<std::shared_ptr<velm::Scene>> velm::Velm::live_scenes(bool & dropped) {
+    std::vector<std::shared_ptr<Scene>> live;
+    std::lock_guard<std::mutex>         lock(scenes_mutex);
+    dropped = std::erase_if(scenes, [](const std::weak_ptr<Scene> & scene) { return scene.expired(); }) > 0;
+    live.reserve(scenes.size());
+    for (const std::weak_ptr<Scene> & weak : scenes) {
+        // may still expire between the erase and here
+        if (std::shared_ptr<Scene> scene = weak.lock()) {
+            live.push_back(std::move(scene));
+        }
+    }
+    return live;
+}
+
+std::uint64_t velm::Velm::scene_revision(const std::vector<std::shared_ptr<Scene>> & live, bool & pending) {
+    std::uint64_t revision = 0;
+    for (const std::shared_ptr<Scene> & scene : live) {
+        revision += scene->revision();
+        for (const velm_render::view & v : scene->view_pool()) {
+            pending = pending || v.needs_redraw();
+        }
+    }
+    return revision;
 }
 
 std::shared_ptr<velm::Scene> velm::Velm::create_scene() {
-    auto scene = std::make_shared<velm::Scene>();
+    auto                        scene = std::make_shared<velm::Scene>();
+    std::lock_guard<std::mutex> lock(scenes_mutex);
     scenes.push_back(std::weak_ptr<velm::Scene>(scene));
     return scene;
 }
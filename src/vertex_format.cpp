@@ -0,0 +1,160 @@
+#include "velm/vertex_format.h"
+
+#include "velm/scene.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace velm_render {
+
+namespace {
+
+bgfx::UniformHandle dequantize = BGFX_INVALID_HANDLE;
+
+std::int16_t to_snorm16(float v) {
+    return static_cast<std::int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+std::uint8_t to_unorm8(float v) {
+    return static_cast<std::uint8_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+template <typename T> void append(std::vector<std::uint8_t> & bytes, const T & value) {
+    std::size_t at = bytes.size();
+    bytes.resize(at + sizeof(T));
+    std::memcpy(bytes.data() + at, &value, sizeof(T));
+}
+
+}  // namespace
+
+quantization quantization::from_bounds(const aabb & bounds) {
+    quantization q;
+    q.center = (bounds.min + bounds.max) * 0.5f;
+    // a flat axis still needs a non-zero scale to stay invertible
+    q.scale = glm::max((bounds.max - bounds.min) * 0.5f, glm::vec3(1e-20f));
+    return q;
+}
+
+quantization quantization::from_vertices(const velm_dr::mesh_data & data) {
+    aabb bounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (std::size_t v = 0; v < data.vertex_count(); ++v) {
+        const float * p = data.vertices.data() + v * data.vertex_stride;
+        bounds.min      = glm::min(bounds.min, glm::vec3(p[0], p[1], p[2]));
+        bounds.max      = glm::max(bounds.max, glm::vec3(p[0], p[1], p[2]));
+    }
+    return from_bounds(bounds);
+}
+
+glm::vec3 quantization::decode(const std::int16_t position[3]) const {
+    glm::vec3 q(std::max(float(position[0]) / 32767.0f, -1.0f), std::max(float(position[1]) / 32767.0f, -1.0f),
+                std::max(float(position[2]) / 32767.0f, -1.0f));
+    return center + q * scale;
+}
+
+glm::vec2 octahedral_encode(const glm::vec3 & normal) {
+    float     l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 e  = l1 > 0.0f ? glm::vec2(normal.x, normal.y) / l1 : glm::vec2(0.0f);
+    if (normal.z < 0.0f) {
+        // fold the lower hemisphere over the diagonals
+        e = glm::vec2((1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+glm::vec3 octahedral_decode(const glm::vec2 & encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float     t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+const bgfx::VertexLayout & float_layout() {
+    static const bgfx::VertexLayout layout = [] {
+        bgfx::VertexLayout l;
+        l.begin()
+            .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+            .add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float)
+            .add(bgfx::Attrib::TexCoord0, 1, bgfx::AttribType::Float)
+            .end();
+        return l;
+    }();
+    return layout;
+}
+
+const bgfx::VertexLayout & packed_layout() {
+    static const bgfx::VertexLayout layout = [] {
+        bgfx::VertexLayout l;
+        l.begin()
+            .add(bgfx::Attrib::Position, 4, bgfx::AttribType::Int16, true)
+            .add(bgfx::Attrib::TexCoord1, 2, bgfx::AttribType::Int16, true)
+            .add(bgfx::Attrib::TexCoord0, 4, bgfx::AttribType::Uint8, true)
+            .end();
+        return l;
+    }();
+    return layout;
+}
+
+gpu_geometry encode(const velm_dr::mesh_data & data,
+                    const vertex_attributes &  attributes,
+                    vertex_format              format,
+                    const quantization &       box) {
+    gpu_geometry out;
+    std::size_t  count = data.vertex_count();
+    float        range = attributes.scalar_max - attributes.scalar_min;
+
+    out.vertices.reserve(count * (format == vertex_format::PACKED ? sizeof(packed_vertex) : sizeof(float_vertex)));
+    for (std::size_t v = 0; v < count; ++v) {
+        const float * src = data.vertices.data() + v * data.vertex_stride;
+        glm::vec3     normal(0.0f, 0.0f, 1.0f);
+        float         scalar = 0.0f;
+        if (attributes.normal_offset >= 0) {
+            const float * n = src + 3 + attributes.normal_offset;
+            normal          = glm::vec3(n[0], n[1], n[2]);
+        }
+        if (attributes.scalar_offset >= 0) {
+            scalar = range != 0.0f ? (src[3 + attributes.scalar_offset] - attributes.scalar_min) / range : 0.0f;
+        }
+
+        if (format == vertex_format::FLOAT) {
+            float_vertex fv{ { src[0], src[1], src[2] }, { normal.x, normal.y, normal.z }, scalar };
+            append(out.vertices, fv);
+            continue;
+        }
+        glm::vec3     q = (glm::vec3(src[0], src[1], src[2]) - box.center) / box.scale;
+        glm::vec2     e = octahedral_encode(normal);
+        packed_vertex pv{ { to_snorm16(q.x), to_snorm16(q.y), to_snorm16(q.z), 0 },
+                          { to_snorm16(e.x), to_snorm16(e.y) },
+                          { to_unorm8(scalar), 0, 0, 0 } };
+        append(out.vertices, pv);
+    }
+
+    out.index32 = count > 0xffff;
+    out.indices.reserve(data.indices.size() * (out.index32 ? 4 : 2));
+    for (std::uint32_t index : data.indices) {
+        if (out.index32) {
+            append(out.indices, index);
+        } else {
+            append(out.indices, static_cast<std::uint16_t>(index));
+        }
+    }
+    return out;
+}
+
+bgfx::UniformHandle dequantize_uniform() {
+    if (!bgfx::isValid(dequantize)) {
+        dequantize = bgfx::createUniform("u_dequantize", bgfx::UniformType::Vec4, 2);
+    }
+    return dequantize;
+}
+
+void destroy_vertex_formats() {
+    if (bgfx::isValid(dequantize)) {
+        bgfx::destroy(dequantize);
+        dequantize = BGFX_INVALID_HANDLE;
+    }
+}
+}  // namespace velm_render
@@ -0,0 +1,158 @@
+#include "velm/amr.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+using velm_DR::amr_box;
+using velm_DR::amr_hierarchy;
+using velm_DR::amr_patch;
+using velm_DR::ndarray;
+
+namespace {
+
+amr_patch make_patch(std::size_t level, std::int64_t lo, std::int64_t hi) {
+    amr_patch patch;
+    patch.level = level;
+    patch.box   = { { lo, lo, lo }, { hi, hi, hi } };
+    return patch;
+}
+
+// encodes level and cell so every sample tells where it came from
+float cell_value(std::size_t level, std::int64_t i, std::int64_t j, std::int64_t k) {
+    return float((level + 1) * 1000 + i * 100 + j * 10 + k);
+}
+
+amr_hierarchy::patch_loader counting_loader(std::atomic<int> & loads) {
+    return [&loads](const amr_patch & patch, ndarray<float, 3> & out) {
+        ++loads;
+        for (std::size_t i = 0; i < out.dims[0]; ++i) {
+            for (std::size_t j = 0; j < out.dims[1]; ++j) {
+                for (std::size_t k = 0; k < out.dims[2]; ++k) {
+                    out(i, j, k) = cell_value(patch.level, patch.box.lo[0] + std::int64_t(i),
+                                              patch.box.lo[1] + std::int64_t(j), patch.box.lo[2] + std::int64_t(k));
+                }
+            }
+        }
+    };
+}
+
+}  // namespace
+
+TEST(AmrTest, BoxArithmetic) {
+    amr_box box{ { -3, 0, 1 }, { 5, 4, 7 } };
+    EXPECT_EQ(box.cells(), 8 * 4 * 6);
+
+    amr_box inner = box.coarsened_inner(2);
+    EXPECT_EQ(inner.lo[0], -1);
+    EXPECT_EQ(inner.hi[0], 2);
+    EXPECT_EQ(inner.lo[2], 1);
+    EXPECT_EQ(inner.hi[2], 3);
+
+    amr_box outer = box.coarsened_outer(2);
+    EXPECT_EQ(outer.lo[0], -2);
+    EXPECT_EQ(outer.hi[0], 3);
+    EXPECT_EQ(outer.lo[2], 0);
+    EXPECT_EQ(outer.hi[2], 4);
+
+    EXPECT_TRUE(box.intersection(amr_box{ { 5, 0, 0 }, { 6, 1, 1 } }).empty());
+    EXPECT_EQ(box.refined(2).hi[1], 8);
+}
+
+TEST(AmrTest, CoverageAndSelection) {
+    std::atomic<int>          loads{ 0 };
+    std::vector<std::int64_t> ratios  = { 1, 2 };
+    std::vector<amr_patch>    partial = { make_patch(0, 0, 4), make_patch(1, 2, 6) };
+    amr_hierarchy             amr(partial, ratios, counting_loader(loads));
+
+    ASSERT_EQ(amr.level_count(), 2u);
+    EXPECT_EQ(amr.level(1).to_base, 2);
+    ASSERT_EQ(amr.patch(0).covered.size(), 1u);
+    EXPECT_EQ(amr.patch(0).covered[0].cells(), 8);
+
+    amr_box whole{ { 0, 0, 0 }, { 4, 4, 4 } };
+    EXPECT_EQ(amr.select(whole, 1), (std::vector<std::size_t>{ 0, 1 }));
+    EXPECT_EQ(amr.select(whole, 0), (std::vector<std::size_t>{ 0 }));
+    // everything of the coarse patch inside this region lies under the fine one
+    EXPECT_EQ(amr.select(amr_box{ { 1, 1, 1 }, { 3, 3, 3 } }, 1), (std::vector<std::size_t>{ 1 }));
+
+    std::vector<std::int64_t> deep_ratios = { 1, 2, 4 };
+    std::vector<amr_patch>    full        = { make_patch(0, 0, 4), make_patch(1, 0, 8), make_patch(2, 8, 16) };
+    amr_hierarchy             covered(full, deep_ratios, counting_loader(loads));
+    EXPECT_EQ(covered.level(2).to_base, 8);
+    EXPECT_EQ(covered.select(whole, 2), (std::vector<std::size_t>{ 1, 2 }));
+    EXPECT_EQ(covered.level_for_cell_size(1.0f), 0u);
+    EXPECT_EQ(covered.level_for_cell_size(0.3f), 2u);
+    EXPECT_EQ(covered.level_for_cell_size(0.01f), 2u);
+    EXPECT_EQ(loads.load(), 0);
+}
+
+TEST(AmrTest, FindAndSampleFinestLevel) {
+    std::atomic<int>          loads{ 0 };
+    std::vector<std::int64_t> ratios = { 1, 2 };
+    amr_hierarchy             amr({ make_patch(0, 0, 4), make_patch(1, 2, 6) }, ratios, counting_loader(loads));
+
+    EXPECT_EQ(amr.find(glm::vec3(1.25f), 1), 1u);
+    EXPECT_EQ(amr.find(glm::vec3(0.5f), 1), 0u);
+    EXPECT_EQ(amr.find(glm::vec3(1.25f), 0), 0u);
+    EXPECT_EQ(amr.find(glm::vec3(-0.5f), 1), amr_hierarchy::npos);
+
+    EXPECT_FLOAT_EQ(amr.sample(glm::vec3(1.25f), 1), cell_value(1, 2, 2, 2));
+    EXPECT_FLOAT_EQ(amr.sample(glm::vec3(1.25f), 0), cell_value(0, 1, 1, 1));
+    EXPECT_FLOAT_EQ(amr.sample(glm::vec3(5.0f), 1, -1.0f), -1.0f);
+}
+
+TEST(AmrTest, ResampleComposite) {
+    std::atomic<int>          loads{ 0 };
+    std::vector<std::int64_t> ratios = { 1, 2 };
+    amr_hierarchy             amr({ make_patch(0, 0, 4), make_patch(1, 2, 6) }, ratios, counting_loader(loads));
+
+    // two samples per level 0 cell, so sample s lies in level 1 cell s
+    ndarray<float, 3> out(8, 8, 8);
+    amr.resample(out, amr_box{ { 0, 0, 0 }, { 4, 4, 4 } }, 1);
+    for (std::int64_t i = 0; i < 8; ++i) {
+        for (std::int64_t j = 0; j < 8; ++j) {
+            for (std::int64_t k = 0; k < 8; ++k) {
+                bool  fine     = i >= 2 && i < 6 && j >= 2 && j < 6 && k >= 2 && k < 6;
+                float expected = fine ? cell_value(1, i, j, k) : cell_value(0, i / 2, j / 2, k / 2);
+                ASSERT_FLOAT_EQ(out(std::size_t(i), std::size_t(j), std::size_t(k)), expected) << i << j << k;
+            }
+        }
+    }
+
+    // one sample per level 0 cell, half of them outside the patches
+    ndarray<float, 3> shifted(4, 4, 4);
+    amr.resample(shifted, amr_box{ { 2, 2, 2 }, { 6, 6, 6 } }, 0, -1.0f);
+    EXPECT_FLOAT_EQ(shifted(0, 0, 0), cell_value(0, 2, 2, 2));
+    EXPECT_FLOAT_EQ(shifted(1, 1, 0), cell_value(0, 3, 3, 2));
+    EXPECT_FLOAT_EQ(shifted(2, 0, 0), -1.0f);
+    EXPECT_FLOAT_EQ(shifted(3, 3, 3), -1.0f);
+}
+
+TEST(AmrTest, LoadsPatchesLazily) {
+    std::atomic<int>          loads{ 0 };
+    std::vector<std::int64_t> ratios  = { 1, 2 };
+    std::vector<amr_patch>    patches = { make_patch(0, 0, 4), make_patch(1, 0, 8), make_patch(1, 8, 10) };
+    amr_hierarchy             amr(patches, ratios, counting_loader(loads));
+    EXPECT_EQ(amr.loaded_count(), 0u);
+
+    // the coarse patch is completely refined, only the fine one holding the region is read
+    ndarray<float, 3> out(4, 4, 4);
+    amr.resample(out, amr_box{ { 0, 0, 0 }, { 2, 2, 2 } }, 1);
+    EXPECT_EQ(loads.load(), 1);
+    EXPECT_EQ(amr.loaded_count(), 1u);
+    EXPECT_FLOAT_EQ(out(3, 2, 1), cell_value(1, 3, 2, 1));
+
+    auto first  = amr.data(1);
+    auto second = amr.data(1);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(loads.load(), 1);
+
+    amr.unload(1);
+    EXPECT_EQ(amr.loaded_count(), 0u);
+    // arrays handed out before stay valid
+    EXPECT_FLOAT_EQ((*first)(0, 0, 0), cell_value(1, 0, 0, 0));
+    (void) amr.data(1);
+    EXPECT_EQ(loads.load(), 2);
+}
@@ -0,0 +1,230 @@
+#include "velm/compositing.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+#include <thread>
+
+using velm_render::composite_image;
+using velm_render::composite_mode;
+using velm_render::composite_options;
+using velm_render::composite_transport;
+using velm_render::domain_decomposition;
+
+namespace {
+
+// a layer per rank, about half of the pixels covered, at distinct depths
+std::vector<composite_image> make_layers(std::size_t ranks, std::uint32_t width, std::uint32_t height) {
+    std::mt19937                          rng(std::uint32_t(ranks * 131 + width));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<composite_image>          layers(ranks);
+    for (composite_image & layer : layers) {
+        layer.clear(width, height);
+        for (std::size_t i = 0; i < layer.pixel_count(); ++i) {
+            if (unit(rng) < 0.5f) {
+                float a        = unit(rng);
+                layer.color[i] = glm::vec4(unit(rng) * a, unit(rng) * a, unit(rng) * a, a);
+                layer.depth[i] = 1.0f + unit(rng) * 100.0f;
+            }
+        }
+    }
+    return layers;
+}
+
+// front to back over the layers in order, or the nearest one, on one thread
+composite_image reference(const std::vector<composite_image> & layers,
+                          const std::vector<std::size_t> &     order,
+                          composite_mode                       mode) {
+    composite_image result;
+    result.clear(layers[0].width, layers[0].height);
+    for (std::size_t r : order) {
+        const composite_image & layer = layers[r];
+        if (mode == composite_mode::OVER) {
+            velm_render::blend_over(result.color, result.depth, layer.color, layer.depth);
+            continue;
+        }
+        for (std::size_t i = 0; i < result.pixel_count(); ++i) {
+            if (layer.depth[i] < result.depth[i]) {
+                result.color[i] = layer.color[i];
+                result.depth[i] = layer.depth[i];
+            }
+        }
+    }
+    return result;
+}
+
+void composite_on_threads(std::vector<composite_image> &                      images,
+                          std::vector<std::unique_ptr<composite_transport>> & group,
+                          const composite_options &                           options) {
+    std::vector<std::thread> threads;
+    for (std::size_t r = 0; r < group.size(); ++r) {
+        threads.emplace_back([&, r] { (void) velm_render::composite_binary_swap(images[r], *group[r], options); });
+    }
+    for (std::thread & t : threads) {
+        t.join();
+    }
+}
+
+void expect_near(const composite_image & a, const composite_image & b) {
+    ASSERT_EQ(a.pixel_count(), b.pixel_count());
+    for (std::size_t i = 0; i < a.pixel_count(); ++i) {
+        for (int c = 0; c < 4; ++c) {
+            ASSERT_NEAR(a.color[i][c], b.color[i][c], 1e-5f) << "pixel " << i;
+        }
+        ASSERT_EQ(a.depth[i], b.depth[i]) << "pixel " << i;
+    }
+}
+
+}  // namespace
+
+TEST(CompositingTest, BinarySwapMatchesSerialBlend) {
+    for (std::size_t ranks : { 1, 2, 3, 4, 5, 7, 8 }) {
+        SCOPED_TRACE(ranks);
+        // odd sizes so the halves are uneven
+        std::vector<composite_image> layers = make_layers(ranks, 37, 23);
+
+        // reversed visibility order, composited on the last rank
+        std::vector<std::size_t> order(ranks);
+        std::iota(order.rbegin(), order.rend(), std::size_t(0));
+        composite_options over;
+        over.order = order;
+        over.root  = ranks - 1;
+
+        std::vector<composite_image> images = layers;
+        auto                         group  = velm_render::make_local_group(ranks);
+        composite_on_threads(images, group, over);
+        expect_near(images[over.root], reference(layers, order, composite_mode::OVER));
+
+        composite_options depth;
+        depth.mode = composite_mode::DEPTH;
+        images     = layers;
+        composite_on_threads(images, group, depth);
+        expect_near(images[0], reference(layers, order, composite_mode::DEPTH));
+    }
+}
+
+TEST(CompositingTest, EveryRankSendsAboutOneImage) {
+    constexpr std::size_t        ranks  = 8;
+    std::vector<composite_image> images = make_layers(ranks, 64, 64);
+    auto                         group  = velm_render::make_local_group(ranks);
+    std::vector<std::size_t>     sent(ranks);
+    std::vector<std::thread>     threads;
+    for (std::size_t r = 0; r < ranks; ++r) {
+        threads.emplace_back([&, r] {
+            velm_render::composite_stats stats = velm_render::composite_binary_swap(images[r], *group[r]);
+            EXPECT_EQ(stats.rounds, 3u);
+            sent[r] = stats.bytes_sent;
+        });
+    }
+    for (std::thread & t : threads) {
+        t.join();
+    }
+    // 1/2 + 1/4 + 1/8 in the swaps and 1/8 to the root
+    std::size_t image_bytes = 64 * 64 * (sizeof(glm::vec4) + sizeof(float));
+    EXPECT_EQ(sent[0], image_bytes * 7 / 8);
+    for (std::size_t r = 1; r < ranks; ++r) {
+        EXPECT_EQ(sent[r], image_bytes);
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(CompositingTest, SocketTransportSwapsLargeBuffers) {
+    // far beyond the socket buffers: a send then receive on both sides would deadlock
+    std::vector<std::vector<int>> fds = velm_render::socket_transport::connect_local(2);
+    velm_render::socket_transport a(0, fds[0]);
+    velm_render::socket_transport b(1, fds[1]);
+
+    std::vector<std::byte> out_a(8 << 20, std::byte{ 1 });
+    std::vector<std::byte> out_b(8 << 20, std::byte{ 2 });
+    std::vector<std::byte> in_a(out_b.size());
+    std::vector<std::byte> in_b(out_a.size());
+    std::thread            peer([&] { b.exchange(0, out_b, in_b); });
+    a.exchange(1, out_a, in_a);
+    peer.join();
+    EXPECT_EQ(in_a, out_b);
+    EXPECT_EQ(in_b, out_a);
+
+    // and the compositor over sockets
+    constexpr std::size_t                             ranks  = 3;
+    std::vector<composite_image>                      layers = make_layers(ranks, 300, 200);
+    std::vector<composite_image>                      images = layers;
+    std::vector<std::vector<int>>                     mesh   = velm_render::socket_transport::connect_local(ranks);
+    std::vector<std::unique_ptr<composite_transport>> group;
+    for (std::size_t r = 0; r < ranks; ++r) {
+        group.push_back(std::make_unique<velm_render::socket_transport>(r, mesh[r]));
+    }
+    composite_on_threads(images, group, {});
+    expect_near(images[0], reference(layers, { 0, 1, 2 }, composite_mode::OVER));
+}
+#endif
+
+TEST(CompositingTest, DecompositionCoversTheGridInVisibilityOrder) {
+    const std::size_t dims[3] = { 40, 17, 9 };
+    for (std::size_t ranks : { 1, 3, 6, 8 }) {
+        SCOPED_TRACE(ranks);
+        domain_decomposition decomposition(dims, ranks);
+        auto                 bricks = decomposition.bricks();
+        ASSERT_EQ(bricks.size(), ranks);
+
+        // every sample in exactly one brick, volumes balanced
+        std::vector<int> owners(dims[0] * dims[1] * dims[2]);
+        std::size_t      smallest = owners.size();
+        std::size_t      largest  = 0;
+        for (const auto & b : bricks) {
+            std::size_t volume = 1;
+            for (int a = 0; a < 3; ++a) {
+                volume *= b.hi[a] - b.lo[a];
+            }
+            smallest = std::min(smallest, volume);
+            largest  = std::max(largest, volume);
+            for (std::size_t i = b.lo[0]; i < b.hi[0]; ++i) {
+                for (std::size_t j = b.lo[1]; j < b.hi[1]; ++j) {
+                    for (std::size_t k = b.lo[2]; k < b.hi[2]; ++k) {
+                        ++owners[(i * dims[1] + j) * dims[2] + k];
+                    }
+                }
+            }
+        }
+        EXPECT_TRUE(std::all_of(owners.begin(), owners.end(), [](int n) { return n == 1; }));
+        EXPECT_LE(double(largest), double(smallest) * 1.5);
+
+        // a brick listed later never has the eye in front of it on every axis that separates it from an earlier one
+        std::vector<glm::vec3> eyes = { { -50.0f, 8.0f, 4.0f }, { 60.0f, -20.0f, 30.0f }, { 13.2f, 9.7f, 2.1f } };
+        for (const glm::vec3 & eye : eyes) {
+            std::vector<std::size_t> order = decomposition.visibility_order(eye);
+            ASSERT_EQ(order.size(), ranks);
+            for (std::size_t x = 0; x < ranks; ++x) {
+                for (std::size_t y = x + 1; y < ranks; ++y) {
+                    const auto & front     = bricks[order[x]];
+                    const auto & back      = bricks[order[y]];
+                    bool         separated = false;
+                    bool         in_front  = false;
+                    for (int a = 0; a < 3; ++a) {
+                        if (front.hi[a] <= back.lo[a] || back.hi[a] <= front.lo[a]) {
+                            separated = true;
+                            // the face of the back brick that looks at the front one
+                            bool  back_high = front.hi[a] <= back.lo[a];
+                            float face      = float(back_high ? back.lo[a] : back.hi[a]);
+                            in_front |= back_high ? eye[a] < face : eye[a] > face;
+                        }
+                    }
+                    EXPECT_TRUE(separated);
+                    EXPECT_TRUE(in_front) << order[x] << " before " << order[y];
+                }
+            }
+        }
+    }
+}
+
+TEST(CompositingTest, EyeJustBelowTheSplitIsInTheLowBrick) {
+    // the bricks meet at sample 20 where the low one's extra layer ends, not half a sample before it
+    const std::size_t    dims[3] = { 40, 4, 4 };
+    domain_decomposition decomposition(dims, 2);
+    auto                 bricks = decomposition.bricks();
+    std::size_t          low    = bricks[0].lo[0] == 0 ? 0 : 1;
+    ASSERT_EQ(bricks[low].hi[0], 20u);
+
+    EXPECT_EQ(decomposition.visibility_order(glm::vec3(19.7f, 2.0f, 2.0f)), (std::vector<std::size_t>{ low, 1 - low }));
+    EXPECT_EQ(decomposition.visibility_order(glm::vec3(20.2f, 2.0f, 2.0f)), (std::vector<std::size_t>{ 1 - low, low }));
+}
@@ -0,0 +1,148 @@
+#include "velm/culling.h"
+#include "velm/scene.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <span>
+#include <vector>
+
+using velm::Scene;
+using velm::scene_handle;
+using velm_render::aabb;
+using velm_render::bvh;
+using velm_render::frustum;
+using velm_render::occlusion_buffer;
+
+namespace {
+
+bool reference_visible(const frustum & f, const aabb & b) {
+    for (const glm::vec4 & p : f.planes) {
+        glm::vec3 far_corner(p.x > 0.0f ? b.max.x : b.min.x, p.y > 0.0f ? b.max.y : b.min.y,
+                             p.z > 0.0f ? b.max.z : b.min.z);
+        if (p.x * far_corner.x + p.y * far_corner.y + p.z * far_corner.z + p.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+glm::mat4x4 camera(const glm::vec3 & eye, const glm::vec3 & target) {
+    glm::mat4x4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    return proj * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// grid of unit boxes centered around the origin
+std::vector<scene_handle> fill_grid(Scene & scene, int n) {
+    std::vector<scene_handle> handles;
+    for (int x = 0; x < n; ++x) {
+        for (int y = 0; y < n; ++y) {
+            for (int z = 0; z < n; ++z) {
+                glm::vec3 lo(float(x - n / 2) * 2.0f, float(y - n / 2) * 2.0f, float(z - n / 2) * 2.0f);
+                handles.push_back(scene.add_mesh(nullptr, { lo, lo + glm::vec3(1.0f) }));
+            }
+        }
+    }
+    (void) scene.update_transforms();
+    return handles;
+}
+
+std::vector<std::uint32_t> brute_force(const Scene & scene, const frustum & f) {
+    std::vector<std::uint32_t> result;
+    for (std::uint32_t slot = 0; slot < scene.slot_count(); ++slot) {
+        if (scene.handle_of(slot).valid() && reference_visible(f, scene.world_bound_pool()[slot])) {
+            result.push_back(slot);
+        }
+    }
+    return result;
+}
+
+std::vector<std::uint32_t> bvh_cull(const Scene & scene, const frustum & f) {
+    std::vector<std::uint32_t> result;
+    scene.acceleration().cull(f, scene.render_flag_pool(), result);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}  // namespace
+
+TEST(CullingTest, FrustumPlanesContainCameraTarget) {
+    frustum f = frustum::from_view_proj(camera(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f)), true);
+    EXPECT_TRUE(reference_visible(f, { glm::vec3(-0.5f), glm::vec3(0.5f) }));
+    EXPECT_FALSE(reference_visible(f, { glm::vec3(-0.5f, -0.5f, 20.0f), glm::vec3(0.5f, 0.5f, 21.0f) }));
+}
+
+TEST(CullingTest, BvhMatchesBruteForce) {
+    Scene scene;
+    fill_grid(scene, 12);
+
+    for (const glm::vec3 & eye : { glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(25.0f, 3.0f, -4.0f),
+                                   glm::vec3(1.0f, 1.0f, 1.0f) }) {
+        frustum f = frustum::from_view_proj(camera(eye, glm::vec3(0.0f)), true);
+        EXPECT_EQ(bvh_cull(scene, f), brute_force(scene, f));
+    }
+}
+
+TEST(CullingTest, RefitFollowsMovedObjects) {
+    Scene scene;
+    auto  handles = fill_grid(scene, 6);
+    auto  built   = scene.acceleration().built_version();
+
+    // move one box behind the camera and another into view
+    glm::mat4x4 far_away(1.0f);
+    far_away[3] = glm::vec4(0.0f, 0.0f, 500.0f, 1.0f);
+    scene.set_transform(handles[0], far_away);
+    (void) scene.update_transforms();
+    EXPECT_EQ(scene.acceleration().built_version(), built);
+
+    frustum f = frustum::from_view_proj(camera(glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(0.0f)), true);
+    auto    visible = bvh_cull(scene, f);
+    EXPECT_EQ(visible, brute_force(scene, f));
+    EXPECT_EQ(std::count(visible.begin(), visible.end(), handles[0].index), 0);
+
+    // adding objects forces a rebuild
+    scene.add_mesh(nullptr, { glm::vec3(0.0f), glm::vec3(1.0f) });
+    (void) scene.update_transforms();
+    EXPECT_NE(scene.acceleration().built_version(), built);
+    EXPECT_EQ(bvh_cull(scene, f), brute_force(scene, f));
+}
+
+TEST(CullingTest, HiddenObjectsAreSkipped) {
+    Scene        scene;
+    scene_handle shown  = scene.add_mesh(nullptr, { glm::vec3(-0.5f), glm::vec3(0.5f) });
+    scene_handle hidden = scene.add_mesh(nullptr, { glm::vec3(-0.5f), glm::vec3(0.5f) }, {}, 0);
+    (void) scene.update_transforms();
+
+    frustum f       = frustum::from_view_proj(camera(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f)), true);
+    auto    visible = bvh_cull(scene, f);
+    ASSERT_EQ(visible.size(), 1);
+    EXPECT_EQ(visible[0], shown.index);
+    EXPECT_TRUE(scene.is_valid(hidden));
+}
+
+TEST(CullingTest, OcclusionBufferRejectsBoxesBehindDepth) {
+    glm::mat4x4      view_proj = camera(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f));
+    occlusion_buffer occlusion(16, 16);
+
+    aabb box{ glm::vec3(-0.5f), glm::vec3(0.5f) };
+    EXPECT_FALSE(occlusion.is_occluded(box, view_proj, true));
+
+    // a wall right in front of the camera covers the whole screen
+    std::vector<float> depth(64 * 64, 0.1f);
+    occlusion.load_depth(depth, 64, 64);
+    EXPECT_TRUE(occlusion.is_occluded(box, view_proj, true));
+
+    // one far pixel inside the box footprint keeps it visible
+    depth[32 * 64 + 32] = 1.0f;
+    occlusion.load_depth(depth, 64, 64);
+    EXPECT_FALSE(occlusion.is_occluded(box, view_proj, true));
+
+    // an empty source clears, one smaller than its size is rejected
+    depth.assign(64 * 64, 0.1f);
+    occlusion.load_depth(depth, 64, 64);
+    occlusion.load_depth({}, 0, 0);
+    EXPECT_FALSE(occlusion.is_occluded(box, view_proj, true));
+    EXPECT_DEATH(occlusion.load_depth(std::span<const float>(depth).first(100), 64, 64), ".*");
+}
@@ -0,0 +1,156 @@
+#include "velm/decimate.h"
+#include "velm/scene.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using velm_dr::mesh_data;
+
+namespace {
+
+// latitude/longitude sphere with welded poles and seam
+mesh_data make_sphere(int rings, int segments, float radius) {
+    mesh_data result;
+    for (int r = 0; r <= rings; ++r) {
+        float theta = float(M_PI) * float(r) / float(rings);
+        for (int s = 0; s < segments; ++s) {
+            float phi = 2.0f * float(M_PI) * float(s) / float(segments);
+            bool  pole = r == 0 || r == rings;
+            result.vertices.push_back(pole ? 0.0f : radius * std::sin(theta) * std::cos(phi));
+            result.vertices.push_back(radius * std::cos(theta));
+            result.vertices.push_back(pole ? 0.0f : radius * std::sin(theta) * std::sin(phi));
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            auto a = std::uint32_t(r * segments + s);
+            auto b = std::uint32_t(r * segments + (s + 1) % segments);
+            auto c = std::uint32_t((r + 1) * segments + s);
+            auto d = std::uint32_t((r + 1) * segments + (s + 1) % segments);
+            result.indices.insert(result.indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    return result;
+}
+
+// flat n x n quad grid in the xz plane
+mesh_data make_grid(int n) {
+    mesh_data result;
+    for (int z = 0; z <= n; ++z) {
+        for (int x = 0; x <= n; ++x) {
+            result.vertices.insert(result.vertices.end(), { float(x), 0.0f, float(z) });
+        }
+    }
+    for (int z = 0; z < n; ++z) {
+        for (int x = 0; x < n; ++x) {
+            auto a = std::uint32_t(z * (n + 1) + x);
+            auto b = a + 1;
+            auto c = a + std::uint32_t(n + 1);
+            auto d = c + 1;
+            result.indices.insert(result.indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    return result;
+}
+
+float max_radius_deviation(const mesh_data & m, float radius) {
+    float worst = 0.0f;
+    for (std::size_t v = 0; v < m.vertex_count(); ++v) {
+        const float * p = m.vertices.data() + v * 3;
+        worst           = std::max(worst, std::abs(std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) - radius));
+    }
+    return worst;
+}
+
+}  // namespace
+
+TEST(DecimateTest, SphereKeepsShape) {
+    mesh_data sphere = make_sphere(48, 64, 1.0f);
+
+    velm_dr::decimate_options options;
+    options.target_ratio   = 0.25f;
+    options.cells_per_axis = 2;
+    mesh_data reduced      = velm_dr::decimate(sphere.view(), 3, options);
+
+    EXPECT_LT(reduced.triangle_count(), sphere.triangle_count() / 2);
+    EXPECT_GT(reduced.triangle_count(), 0);
+    EXPECT_LT(max_radius_deviation(reduced, 1.0f), 0.05f);
+    EXPECT_GT(reduced.geometric_error, 0.0f);
+    EXPECT_LT(reduced.geometric_error, 0.05f);
+
+    for (std::uint32_t index : reduced.indices) {
+        EXPECT_LT(index, reduced.vertex_count());
+    }
+}
+
+TEST(DecimateTest, GridBoundaryIsPreserved) {
+    mesh_data grid = make_grid(32);
+
+    velm_dr::decimate_options options;
+    options.target_ratio = 0.1f;
+    mesh_data reduced    = velm_dr::decimate(grid.view(), 3, options);
+
+    // a flat grid collapses without error, but its outline must stay in place
+    EXPECT_LT(reduced.triangle_count(), grid.triangle_count() / 4);
+    EXPECT_FLOAT_EQ(reduced.geometric_error, 0.0f);
+    for (int corner = 0; corner < 4; ++corner) {
+        float x     = corner & 1 ? 32.0f : 0.0f;
+        float z     = corner & 2 ? 32.0f : 0.0f;
+        bool  found = false;
+        for (std::size_t v = 0; v < reduced.vertex_count(); ++v) {
+            found |= reduced.vertices[v * 3] == x && reduced.vertices[v * 3 + 2] == z;
+        }
+        EXPECT_TRUE(found);
+    }
+}
+
+TEST(DecimateTest, MaxErrorStopsCollapses) {
+    mesh_data sphere = make_sphere(24, 32, 1.0f);
+
+    velm_dr::decimate_options options;
+    options.target_ratio = 0.0f;
+    options.max_error    = 1e-6f;
+    mesh_data reduced    = velm_dr::decimate(sphere.view(), 3, options);
+
+    EXPECT_LE(reduced.geometric_error, 1e-6f);
+    EXPECT_GT(reduced.triangle_count(), sphere.triangle_count() / 2);
+}
+
+TEST(DecimateTest, LodChainShrinksAndSelects) {
+    mesh_data sphere = make_sphere(64, 96, 1.0f);
+
+    velm_dr::lod_options options;
+    options.min_triangles = 200;
+    auto chain            = velm_dr::build_lod_chain(sphere.view(), 3, options);
+
+    ASSERT_GE(chain.size(), 3);
+    for (std::size_t i = 1; i < chain.size(); ++i) {
+        EXPECT_LT(chain[i].triangle_count(), chain[i - 1].triangle_count());
+        EXPECT_GE(chain[i].geometric_error, chain[i - 1].geometric_error);
+    }
+
+    velm_render::mesh m;
+    for (const mesh_data & level : chain) {
+        m.lods.push_back({ BGFX_INVALID_HANDLE, BGFX_INVALID_HANDLE, 0, level.geometric_error });
+    }
+    EXPECT_EQ(m.select_lod(0.0f, 1000.0f, 1.0f), 0);
+    EXPECT_EQ(m.select_lod(1e9f, 1000.0f, 1.0f), chain.size() - 1);
+
+    // farther away never picks a finer level
+    std::size_t previous = 0;
+    for (float distance = 1.0f; distance < 1000.0f; distance *= 2.0f) {
+        std::size_t level = m.select_lod(distance, 1000.0f, 1.0f);
+        EXPECT_GE(level, previous);
+        previous = level;
+    }
+
+    // buffers have one owner
+    static_assert(!std::is_copy_constructible_v<velm_render::mesh>);
+    velm_render::mesh moved(std::move(m));
+    EXPECT_EQ(moved.lods.size(), chain.size());
+    EXPECT_TRUE(m.lods.empty());
+}
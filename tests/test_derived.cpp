@@ -0,0 +1,121 @@
+#include "velm/derived.h"
+#include "velm/isosurface.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using velm_DR::ndarray;
+using velm_dr::derived_quantity;
+
+namespace {
+
+struct velocity_arrays {
+    ndarray<float, 3> u;
+    ndarray<float, 3> v;
+    ndarray<float, 3> w;
+
+    velocity_arrays(std::size_t n0, std::size_t n1, std::size_t n2) : u(n0, n1, n2), v(n0, n1, n2), w(n0, n1, n2) {}
+
+    [[nodiscard]] velm_dr::velocity_field field() const { return { u, v, w }; }
+
+    template <typename Fn> void fill(const glm::vec3 & spacing, Fn && fn) {
+        for (std::size_t i = 0; i < u.dims[0]; ++i) {
+            for (std::size_t j = 0; j < u.dims[1]; ++j) {
+                for (std::size_t k = 0; k < u.dims[2]; ++k) {
+                    glm::vec3 value = fn(glm::vec3(float(i), float(j), float(k)) * spacing);
+                    u(i, j, k)      = value.x;
+                    v(i, j, k)      = value.y;
+                    w(i, j, k)      = value.z;
+                }
+            }
+        }
+    }
+};
+
+velm_dr::stencil_options small_tiles(const glm::vec3 & spacing) {
+    velm_dr::stencil_options options;
+    options.spacing     = spacing;
+    options.tile_rows   = 3;
+    options.tile_width  = 8;
+    options.slab_planes = 3;
+    return options;
+}
+
+// linear fields have exact differences everywhere, faces included
+void expect_everywhere(const velocity_arrays &          velocity,
+                       derived_quantity                 quantity,
+                       const velm_dr::stencil_options & options,
+                       float                            expected) {
+    velm::job_system  jobs(3);
+    ndarray<float, 3> out(velocity.u.dims[0], velocity.u.dims[1], velocity.u.dims[2]);
+    velm_dr::compute_derived(velocity.field(), quantity, out, options, jobs);
+    for (std::size_t n = 0; n < out.total_elements(); ++n) {
+        ASSERT_NEAR(out.data[n], expected, 1e-4f) << int(quantity) << " at " << n;
+    }
+}
+
+}  // namespace
+
+TEST(DerivedTest, SolidBodyRotation) {
+    // rotation about dim 2 at rate 1.5: vorticity 3 along dim 2, pure rotation so Q = 1.5^2 and lambda2 = -1.5^2
+    glm::vec3       spacing(0.5f, 0.25f, 1.0f);
+    velocity_arrays velocity(5, 7, 19);
+    velocity.fill(spacing, [](const glm::vec3 & p) { return glm::vec3(-1.5f * p.y, 1.5f * p.x, 0.0f); });
+    velm_dr::stencil_options options = small_tiles(spacing);
+
+    expect_everywhere(velocity, derived_quantity::VORTICITY_MAGNITUDE, options, 3.0f);
+    expect_everywhere(velocity, derived_quantity::DIVERGENCE, options, 0.0f);
+    expect_everywhere(velocity, derived_quantity::Q_CRITERION, options, 2.25f);
+    expect_everywhere(velocity, derived_quantity::LAMBDA2, options, -2.25f);
+
+    ndarray<float, 4> curl(5, 7, 19, 3);
+    velm_dr::compute_vorticity(velocity.field(), curl, options);
+    EXPECT_NEAR(curl(2, 3, 4, 0), 0.0f, 1e-5f);
+    EXPECT_NEAR(curl(2, 3, 4, 1), 0.0f, 1e-5f);
+    EXPECT_NEAR(curl(4, 6, 18, 2), 3.0f, 1e-5f);
+}
+
+TEST(DerivedTest, StrainAndExpansion) {
+    glm::vec3                spacing(1.0f);
+    velm_dr::stencil_options options = small_tiles(spacing);
+
+    // plane strain: no rotation, Q = -|S|^2 / 2 = -a^2, S^2 = diag(a^2, a^2, 0)
+    velocity_arrays strain(6, 6, 10);
+    strain.fill(spacing, [](const glm::vec3 & p) { return glm::vec3(2.0f * p.x, -2.0f * p.y, 0.0f); });
+    expect_everywhere(strain, derived_quantity::DIVERGENCE, options, 0.0f);
+    expect_everywhere(strain, derived_quantity::VORTICITY_MAGNITUDE, options, 0.0f);
+    expect_everywhere(strain, derived_quantity::Q_CRITERION, options, -4.0f);
+    expect_everywhere(strain, derived_quantity::LAMBDA2, options, 4.0f);
+
+    velocity_arrays expansion(6, 6, 10);
+    expansion.fill(spacing, [](const glm::vec3 & p) { return glm::vec3(p.x, 2.0f * p.y, 3.0f * p.z); });
+    expect_everywhere(expansion, derived_quantity::DIVERGENCE, options, 6.0f);
+}
+
+TEST(DerivedTest, FusedIsosurfaceMatchesMaterializedField) {
+    // a vortex tube along dim 0 whose core strength varies, so Q > 0 is a closed-off tube
+    glm::vec3       spacing(0.25f, 0.2f, 0.2f);
+    velocity_arrays velocity(13, 20, 21);
+    velocity.fill(spacing, [](const glm::vec3 & p) {
+        float y     = p.y - 2.0f;
+        float z     = p.z - 2.0f;
+        float swirl = std::exp(-(y * y + z * z)) * (1.0f + std::sin(p.x));
+        return glm::vec3(0.3f * z, -swirl * z, swirl * y);
+    });
+    velm_dr::stencil_options options = small_tiles(spacing);
+    velm::job_system         jobs(3);
+
+    for (derived_quantity quantity : { derived_quantity::Q_CRITERION, derived_quantity::LAMBDA2 }) {
+        float             iso = quantity == derived_quantity::Q_CRITERION ? 0.2f : -0.2f;
+        ndarray<float, 3> field(13, 20, 21);
+        velm_dr::compute_derived(velocity.field(), quantity, field, options, jobs);
+        velm_dr::mesh_data materialized = velm_dr::extract_isosurface(field, iso, spacing, jobs);
+        velm_dr::mesh_data fused =
+            velm_dr::extract_derived_isosurface(velocity.field(), quantity, iso, options, jobs);
+
+        ASSERT_GT(materialized.triangle_count(), 0u);
+        EXPECT_EQ(fused.indices, materialized.indices);
+        EXPECT_EQ(fused.vertices, materialized.vertices);
+    }
+}
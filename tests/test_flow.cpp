@@ -0,0 +1,200 @@
+#include "velm/flow.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+using velm_DR::ndarray;
+using velm_dr::vector_field;
+
+namespace {
+
+// rigid rotation about the dim 2 axis through the grid center: circles around (c, c)
+vector_field make_vortex(std::size_t n) {
+    ndarray<float, 3> u(n, n, 4);
+    ndarray<float, 3> v(n, n, 4);
+    ndarray<float, 3> w(n, n, 4);
+    float             c = float(n - 1) * 0.5f;
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t k = 0; k < 4; ++k) {
+                u(i, j, k) = -(float(j) - c);
+                v(i, j, k) = float(i) - c;
+            }
+        }
+    }
+    return vector_field(std::move(u), std::move(v), std::move(w));
+}
+
+vector_field make_uniform(std::size_t n, const glm::vec3 & velocity) {
+    ndarray<float, 3> u(n, n, n);
+    ndarray<float, 3> v(n, n, n);
+    ndarray<float, 3> w(n, n, n);
+    u.fill(velocity.x);
+    v.fill(velocity.y);
+    w.fill(velocity.z);
+    return vector_field(std::move(u), std::move(v), std::move(w));
+}
+
+glm::vec3 point(const velm_dr::mesh_data & lines, std::size_t index) {
+    const float * p = lines.vertices.data() + index * lines.vertex_stride;
+    return { p[0], p[1], p[2] };
+}
+
+}  // namespace
+
+TEST(FlowTest, SampleIsTrilinear) {
+    vector_field field = make_vortex(9);
+    field.spacing      = glm::vec3(2.0f);
+    glm::vec3 velocity;
+
+    ASSERT_TRUE(field.sample(glm::vec3(3.0f, 5.0f, 1.0f), velocity));
+    // index space (1.5, 2.5), the field is linear so interpolation is exact
+    EXPECT_FLOAT_EQ(velocity.x, -(2.5f - 4.0f));
+    EXPECT_FLOAT_EQ(velocity.y, 1.5f - 4.0f);
+    EXPECT_FALSE(field.sample(glm::vec3(-0.1f, 0.0f, 0.0f), velocity));
+    EXPECT_FALSE(field.sample(glm::vec3(0.0f, 16.5f, 0.0f), velocity));
+}
+
+TEST(FlowTest, BatchedSampleMatchesScalar) {
+    vector_field field = make_vortex(9);
+    field.origin       = glm::vec3(-1.0f, 0.0f, 0.5f);
+    field.spacing      = glm::vec3(0.75f);
+
+    // more than one internal chunk, with points just outside every face
+    std::vector<glm::vec3> positions;
+    for (int i = 0; i < 150; ++i) {
+        positions.emplace_back(-1.2f + 0.05f * float(i), 0.037f * float(i % 50) - 0.1f, 0.5f + 0.04f * float(i % 7));
+    }
+    positions.emplace_back(5.0f, 6.0f, 6.6f);
+    std::vector<glm::vec3>    velocities(positions.size());
+    std::vector<std::uint8_t> inside(positions.size());
+    field.sample(positions, velocities, inside);
+
+    std::size_t outside = 0;
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        glm::vec3 expected;
+        bool      in = field.sample(positions[i], expected);
+        ASSERT_EQ(inside[i] != 0, in) << i;
+        outside += !in;
+        if (in) {
+            EXPECT_NEAR(velocities[i].x, expected.x, 1e-5f) << i;
+            EXPECT_NEAR(velocities[i].y, expected.y, 1e-5f) << i;
+            EXPECT_NEAR(velocities[i].z, expected.z, 1e-5f) << i;
+        } else {
+            EXPECT_EQ(velocities[i], glm::vec3(0.0f));
+        }
+    }
+    EXPECT_GT(outside, 0u);
+    EXPECT_LT(outside, positions.size());
+}
+
+TEST(FlowTest, StreamlinesCircleTheVortex) {
+    vector_field field = make_vortex(33);
+
+    for (velm_dr::integrator method : { velm_dr::integrator::RK4, velm_dr::integrator::RK45 }) {
+        velm_dr::streamline_options options;
+        options.method     = method;
+        options.step       = 0.25f;
+        options.max_length = 2.0f * float(M_PI) * 8.0f;
+        options.max_steps  = 100000;
+
+        std::vector<glm::vec3> seeds = { { 24.0f, 16.0f, 1.0f } };
+        velm_dr::mesh_data     lines = velm_dr::trace_streamlines(field, seeds, options);
+        ASSERT_GT(lines.vertex_count(), 10);
+        EXPECT_EQ(lines.vertex_stride, velm_dr::line_vertex_stride);
+        EXPECT_EQ(lines.indices.size(), 2 * (lines.vertex_count() - 1));
+
+        for (std::size_t p = 0; p < lines.vertex_count(); ++p) {
+            glm::vec3 q = point(lines, p);
+            EXPECT_NEAR(std::hypot(q.x - 16.0f, q.y - 16.0f), 8.0f, 1e-2f);
+        }
+        // one full turn ends where it started
+        glm::vec3 last = point(lines, lines.vertex_count() - 1);
+        EXPECT_NEAR(last.x, 24.0f, 0.05f);
+        EXPECT_NEAR(last.y, 16.0f, 0.05f);
+    }
+}
+
+TEST(FlowTest, StreamlinesStopAtTheBoundary) {
+    vector_field field = make_uniform(11, glm::vec3(1.0f, 0.0f, 0.0f));
+
+    velm_dr::streamline_options options;
+    options.both_directions = true;
+    options.min_step        = 0.001f;
+
+    std::vector<glm::vec3> seeds = { { 5.0f, 5.0f, 5.0f }, { 20.0f, 0.0f, 0.0f } };
+    velm_dr::mesh_data     lines = velm_dr::trace_streamlines(field, seeds, options);
+
+    // the seed outside the field yields no line, the other one spans the grid along x
+    ASSERT_GT(lines.vertex_count(), 2);
+    EXPECT_NEAR(point(lines, 0).x, 0.0f, 0.01f);
+    EXPECT_NEAR(point(lines, lines.vertex_count() - 1).x, 10.0f, 0.01f);
+    for (std::size_t p = 1; p < lines.vertex_count(); ++p) {
+        EXPECT_GT(point(lines, p).x, point(lines, p - 1).x);
+    }
+}
+
+TEST(FlowTest, ManySeedsInParallel) {
+    vector_field     field = make_vortex(33);
+    velm::job_system jobs(3);
+
+    std::vector<glm::vec3> seeds;
+    for (int s = 0; s < 200; ++s) {
+        seeds.emplace_back(16.5f + float(s % 14), 16.0f, 1.0f + float(s % 3) * 0.5f);
+    }
+    velm_dr::streamline_options options;
+    options.max_length = 20.0f;
+    velm_dr::mesh_data lines = velm_dr::trace_streamlines(field, seeds, options, jobs);
+
+    std::size_t starts = 0;
+    for (std::size_t p = 0; p < lines.vertex_count(); ++p) {
+        starts += lines.vertices[p * lines.vertex_stride + 4] == 0.0f;
+    }
+    EXPECT_EQ(starts, seeds.size());
+
+    // seeds advance in lockstep within a job but do not affect each other; gathered and scalar taps round a little
+    // differently, so agreement is to the integration tolerance
+    options.seeds_per_job         = 1;
+    options.both_directions       = true;
+    velm_dr::mesh_data one_by_one = velm_dr::trace_streamlines(field, seeds, options, jobs);
+    options.seeds_per_job         = 32;
+    velm_dr::mesh_data thirty_two = velm_dr::trace_streamlines(field, seeds, options, jobs);
+    ASSERT_EQ(one_by_one.vertex_count(), thirty_two.vertex_count());
+    EXPECT_EQ(one_by_one.indices, thirty_two.indices);
+    for (std::size_t i = 0; i < one_by_one.vertices.size(); ++i) {
+        ASSERT_NEAR(one_by_one.vertices[i], thirty_two.vertices[i], options.tolerance) << i;
+    }
+}
+
+TEST(FlowTest, PathlinesInterpolateBetweenSteps) {
+    // velocity (t, 0, 0) at step time t: x(t) = x0 + t^2 / 2
+    std::vector<double>                     times = { 0.0, 1.0, 2.0, 3.0 };
+    std::atomic<int>                        loads{ 0 };
+    velm::timestep_prefetcher<vector_field> steps(times.size(), [&](std::size_t step) {
+        loads++;
+        return make_uniform(16, glm::vec3(float(step), 0.0f, 0.0f));
+    });
+
+    velm_dr::streamline_options options;
+    options.method = velm_dr::integrator::RK4;
+    options.step   = 0.1f;
+
+    std::vector<glm::vec4> seeds = { { 1.0f, 2.0f, 3.0f, 0.0f }, { 1.0f, 5.0f, 5.0f, 1.5f } };
+    velm_dr::mesh_data     lines = velm_dr::trace_pathlines({ times, steps }, seeds, options);
+
+    EXPECT_EQ(loads.load(), 4);
+    ASSERT_GE(lines.vertex_count(), 4);
+    // the first line ends where the time column drops back to the second release time
+    auto        time      = [&lines](std::size_t p) { return lines.vertices[p * lines.vertex_stride + 4]; };
+    std::size_t end_first = 0;
+    while (time(end_first + 1) > time(end_first)) {
+        ++end_first;
+    }
+    EXPECT_NEAR(point(lines, end_first).x, 1.0f + 4.5f, 1e-3f);
+    EXPECT_FLOAT_EQ(time(end_first), 3.0f);
+    // released at 1.5: x = 1 + (9 - 2.25) / 2
+    EXPECT_NEAR(point(lines, lines.vertex_count() - 1).x, 1.0f + 3.375f, 1e-3f);
+}
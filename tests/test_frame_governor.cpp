@@ -0,0 +1,50 @@
+#include "velm/frame_governor.h"
+
+#include <gtest/gtest.h>
+
+using velm::frame_governor;
+
+TEST(FrameGovernorTest, LowersQualityToHitTarget) {
+    frame_governor governor({ .target_ms = 10.0f, .min_quality = 0.125f, .smoothing = 1.0f, .refine_factor = 2.0f });
+    EXPECT_FLOAT_EQ(governor.quality(), 1.0f);
+
+    // a full quality frame costs 40 ms, so a quarter of it fits the target
+    governor.frame_done(40.0f, true);
+    EXPECT_FLOAT_EQ(governor.quality(), 0.25f);
+    EXPECT_TRUE(governor.refining());
+
+    // the cheaper frame confirms the estimate
+    governor.frame_done(10.0f, true);
+    EXPECT_FLOAT_EQ(governor.quality(), 0.25f);
+    EXPECT_FLOAT_EQ(governor.render_scale(), 0.5f);
+    EXPECT_FLOAT_EQ(governor.lod_error_scale(), 4.0f);
+    EXPECT_EQ(governor.raymarch_steps(256), 64u);
+    EXPECT_EQ(governor.raymarch_steps(16), 8u);
+
+    // never below min_quality, however slow
+    governor.frame_done(1000.0f, true);
+    EXPECT_FLOAT_EQ(governor.quality(), 0.125f);
+
+    // fast frames go back to full quality
+    governor.frame_done(0.5f, true);
+    EXPECT_FLOAT_EQ(governor.quality(), 1.0f);
+    EXPECT_FALSE(governor.refining());
+}
+
+TEST(FrameGovernorTest, RefinesOnceMotionStops) {
+    frame_governor governor({ .target_ms = 10.0f, .min_quality = 0.125f, .smoothing = 1.0f, .refine_factor = 2.0f });
+    governor.frame_done(80.0f, true);
+    EXPECT_FLOAT_EQ(governor.quality(), 0.125f);
+
+    int frames = 0;
+    while (governor.refining()) {
+        governor.frame_done(10.0f, false);
+        ++frames;
+    }
+    EXPECT_EQ(frames, 3);
+    EXPECT_FLOAT_EQ(governor.quality(), 1.0f);
+
+    governor.frame_done(80.0f, true);
+    governor.reset();
+    EXPECT_FLOAT_EQ(governor.quality(), 1.0f);
+}
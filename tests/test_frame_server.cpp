@@ -0,0 +1,230 @@
+#include "velm/frame_server.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using velm_render::frame_client;
+using velm_render::frame_server;
+using velm_render::frame_server_options;
+using velm_render::input_event;
+using velm_render::input_type;
+using velm_render::rgba_frame;
+
+namespace {
+
+constexpr std::chrono::milliseconds wait_long{ 5000 };
+constexpr std::chrono::milliseconds wait_short{ 100 };
+
+// smooth colors with a repeating pattern, compresses well
+rgba_frame make_frame(std::uint32_t width, std::uint32_t height) {
+    rgba_frame frame{ width, height, {} };
+    frame.pixels.resize(frame.pixel_count() * 4);
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            std::uint8_t * p = &frame.pixels[(y * width + x) * 4];
+            p[0]             = std::uint8_t(x * 3);
+            p[1]             = std::uint8_t(y * 5);
+            p[2]             = std::uint8_t((x / 8 + y / 8) % 2 * 200);
+            p[3]             = 255;
+        }
+    }
+    return frame;
+}
+
+void fill_rect(rgba_frame & frame, std::size_t x0, std::size_t y0, std::size_t w, std::size_t h, std::uint8_t v) {
+    for (std::size_t y = y0; y < y0 + h; ++y) {
+        for (std::size_t x = x0; x < x0 + w; ++x) {
+            for (std::size_t c = 0; c < 3; ++c) {
+                frame.pixels[(y * frame.width + x) * 4 + c] = v;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST(FrameServerTest, KeyFrameThenChangedTiles) {
+    frame_server_options options;
+    options.tile = 16;
+    frame_server server(options);
+    rgba_frame   frame = make_frame(100, 70);
+    server.submit(frame);
+    server.flush();
+
+    // a late viewer gets the last frame right away
+    frame_client client("127.0.0.1", server.port());
+    ASSERT_TRUE(client.receive(wait_long));
+    EXPECT_TRUE(client.last_was_key());
+    EXPECT_EQ(client.frame_number(), 1u);
+    EXPECT_EQ(client.frame().width, 100u);
+    EXPECT_EQ(client.frame().height, 70u);
+    EXPECT_EQ(client.frame().pixels, frame.pixels);
+
+    // touches tiles (1, 1), (2, 1) and the partial column tile (6, 4) of the 7 x 5 grid
+    fill_rect(frame, 20, 20, 20, 5, 9);
+    fill_rect(frame, 98, 68, 2, 2, 77);
+    server.submit(frame);
+    ASSERT_TRUE(client.receive(wait_long));
+    EXPECT_FALSE(client.last_was_key());
+    EXPECT_EQ(client.frame_number(), 2u);
+    EXPECT_EQ(client.last_tiles(), 3u);
+    EXPECT_EQ(client.frame().pixels, frame.pixels);
+    EXPECT_LT(client.last_bytes(), 2000u);
+
+    // an unchanged frame sends nothing
+    server.submit(frame);
+    server.flush();
+    EXPECT_FALSE(client.receive(wait_short));
+
+    // a new size starts over with a key frame
+    rgba_frame smaller = make_frame(33, 17);
+    server.submit(smaller);
+    ASSERT_TRUE(client.receive(wait_long));
+    EXPECT_TRUE(client.last_was_key());
+    EXPECT_EQ(client.frame().width, 33u);
+    EXPECT_EQ(client.frame().pixels, smaller.pixels);
+
+    server.flush();
+    velm_render::frame_server_stats stats = server.stats();
+    EXPECT_EQ(stats.submitted, 4u);
+    EXPECT_EQ(stats.encoded + stats.dropped, 4u);
+    EXPECT_EQ(stats.viewers, 1u);
+}
+
+TEST(FrameServerTest, LossyNoiseAndLatestFrameWins) {
+    frame_server_options options;
+    options.tile      = 24;
+    options.drop_bits = 3;
+    frame_server server(options);
+    frame_client first("127.0.0.1", server.port());
+    frame_client second("127.0.0.1", server.port());
+    for (auto deadline = std::chrono::steady_clock::now() + wait_long;
+         server.stats().viewers < 2 && std::chrono::steady_clock::now() < deadline;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::mt19937                       rng(7);
+    std::uniform_int_distribution<int> byte(0, 255);
+    rgba_frame                         frame = make_frame(64, 48);
+    for (int f = 0; f < 20; ++f) {
+        for (std::size_t i = std::size_t(f) * 97; i < frame.pixels.size(); i += 13) {
+            frame.pixels[i] = std::uint8_t(byte(rng));
+        }
+        server.submit(frame);
+    }
+    server.flush();
+
+    // both viewers end up at the last frame, rounded to multiples of 8
+    for (frame_client * client : { &first, &second }) {
+        while (client->receive(wait_short)) {
+        }
+        ASSERT_EQ(client->frame().pixels.size(), frame.pixels.size());
+        for (std::size_t i = 0; i < frame.pixels.size(); ++i) {
+            int expected = std::min(frame.pixels[i] + 4, 255) & 0xf8;
+            ASSERT_EQ(client->frame().pixels[i], expected) << i;
+        }
+    }
+    velm_render::frame_server_stats stats = server.stats();
+    EXPECT_EQ(stats.submitted, 20u);
+    EXPECT_EQ(stats.encoded + stats.dropped, 20u);
+    EXPECT_EQ(stats.viewers, 2u);
+}
+
+TEST(FrameServerTest, InputAndCompositeImages) {
+    frame_server server;
+    frame_client client("127.0.0.1", server.port());
+
+    input_event press;
+    press.type   = input_type::POINTER_BUTTON;
+    press.code   = 1;
+    press.action = 1;
+    press.x      = 12.5f;
+    press.y      = 3.0f;
+    input_event key;
+    key.type = input_type::KEY;
+    key.code = 'W';
+    client.send(press);
+    client.send(key);
+
+    std::vector<input_event> events;
+    for (auto deadline = std::chrono::steady_clock::now() + wait_long;
+         events.size() < 2 && std::chrono::steady_clock::now() < deadline;) {
+        std::vector<input_event> more = server.poll_input();
+        events.insert(events.end(), more.begin(), more.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, input_type::POINTER_BUTTON);
+    EXPECT_EQ(events[0].action, 1);
+    EXPECT_EQ(events[0].x, 12.5f);
+    EXPECT_EQ(events[1].type, input_type::KEY);
+    EXPECT_EQ(events[1].code, 'W');
+
+    // premultiplied half red over a white background
+    velm_render::composite_image image;
+    image.clear(5, 4);
+    image.color[6] = glm::vec4(0.5f, 0.0f, 0.0f, 0.5f);
+    server.submit(image, glm::vec3(1.0f));
+    ASSERT_TRUE(client.receive(wait_long));
+    const std::vector<std::uint8_t> & pixels = client.frame().pixels;
+    EXPECT_EQ(pixels[0], 255);
+    EXPECT_EQ(pixels[6 * 4 + 0], 255);
+    EXPECT_EQ(pixels[6 * 4 + 1], 128);
+    EXPECT_EQ(pixels[6 * 4 + 3], 255);
+}
+
+TEST(FrameServerTest, SlowViewerIsDroppedWithoutStallingOthers) {
+    frame_server_options options;
+    options.send_timeout = std::chrono::milliseconds(200);
+    frame_server server(options);
+    frame_client fast("127.0.0.1", server.port());
+    frame_client stalled("127.0.0.1", server.port());  // connected, never reads
+    for (auto deadline = std::chrono::steady_clock::now() + wait_long;
+         server.stats().viewers < 2 && std::chrono::steady_clock::now() < deadline;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(server.stats().viewers, 2u);
+
+    std::atomic<bool> done{ false };
+    std::thread       reader([&] {
+        while (!done.load()) {
+            (void) fast.receive(std::chrono::milliseconds(10));
+        }
+        while (fast.receive(wait_short)) {
+        }
+    });
+
+    // noise does not compress, every frame is a megabyte until the stalled viewer's socket buffers are full
+    std::mt19937                       rng(3);
+    std::uniform_int_distribution<int> byte(0, 255);
+    rgba_frame                         frame = make_frame(512, 512);
+    auto                               start = std::chrono::steady_clock::now();
+    std::chrono::duration<double>      slowest{ 0.0 };
+    while (server.stats().viewers > 1 && std::chrono::steady_clock::now() - start < wait_long) {
+        for (std::uint8_t & value : frame.pixels) {
+            value = std::uint8_t(byte(rng));
+        }
+        auto before = std::chrono::steady_clock::now();
+        server.submit(frame);
+        server.flush();
+        slowest = std::max<std::chrono::duration<double>>(slowest, std::chrono::steady_clock::now() - before);
+    }
+    EXPECT_EQ(server.stats().viewers, 1u);
+    // a frame waits for the stalled viewer for the send timeout at most
+    EXPECT_LT(slowest.count(), 1.0);
+
+    // the remaining viewer keeps up with every frame
+    fill_rect(frame, 0, 0, 64, 64, 200);
+    server.submit(frame);
+    server.flush();
+    std::uint64_t last = server.stats().encoded;
+    done.store(true);
+    reader.join();
+    EXPECT_EQ(fast.frame_number(), last);
+    EXPECT_EQ(fast.frame().pixels, frame.pixels);
+}
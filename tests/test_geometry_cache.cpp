@@ -0,0 +1,136 @@
+#include "velm/geometry_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using velm_render::cached_geometry;
+using velm_render::geometry_cache;
+using velm_render::geometry_key;
+
+namespace {
+
+// a fan of triangles around the origin, count + 1 vertices
+velm_dr::mesh_data make_fan(std::size_t count, float error) {
+    velm_dr::mesh_data mesh;
+    mesh.vertex_stride   = 6;
+    mesh.geometric_error = error;
+    mesh.vertices.insert(mesh.vertices.end(), { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f });
+    for (std::size_t i = 0; i < count; ++i) {
+        float a = float(i) * 0.1f;
+        mesh.vertices.insert(mesh.vertices.end(), { std::cos(a) * 3.0f, std::sin(a), 0.5f, 0.0f, 0.0f, 1.0f });
+        if (i > 0) {
+            mesh.indices.insert(mesh.indices.end(), { 0, std::uint32_t(i), std::uint32_t(i + 1) });
+        }
+    }
+    return mesh;
+}
+
+std::span<const std::byte> bytes_of(const std::vector<std::uint8_t> & v) {
+    return std::as_bytes(std::span(v));
+}
+
+class GeometryCacheTest : public ::testing::Test {
+  protected:
+    fs::path dir = fs::temp_directory_path() / "velm_geometry_cache_test";
+
+    void SetUp() override { fs::remove_all(dir); }
+
+    void TearDown() override { fs::remove_all(dir); }
+
+    static geometry_key key(const std::string & parameters) {
+        return { "/data/run.h5", 1234, "velocity", parameters };
+    }
+};
+
+}  // namespace
+
+TEST_F(GeometryCacheTest, StoredChainMapsBackUnchanged) {
+    std::vector<velm_dr::mesh_data> chain = { make_fan(40, 0.0f), make_fan(10, 0.25f) };
+    velm_render::vertex_attributes  attributes;
+    attributes.normal_offset = 0;
+
+    {
+        geometry_cache cache(dir, 0);
+        EXPECT_EQ(cache.load(key("iso=0.5")), nullptr);
+        EXPECT_NE(cache.store(key("iso=0.5"), chain, attributes), nullptr);
+    }
+
+    // a later session
+    geometry_cache                         cache(dir, 0);
+    std::shared_ptr<const cached_geometry> geometry = cache.load(key("iso=0.5"));
+    ASSERT_NE(geometry, nullptr);
+    EXPECT_EQ(cache.load(key("iso=0.6")), nullptr);
+    EXPECT_EQ(cache.load({ "/data/run.h5", 1235, "velocity", "iso=0.5" }), nullptr);
+    EXPECT_EQ(cache.disk_bytes(), geometry->file_bytes());
+
+    velm_render::quantization box = velm_render::quantization::from_vertices(chain[0]);
+    EXPECT_EQ(geometry->format(), velm_render::vertex_format::PACKED);
+    EXPECT_EQ(geometry->box().center.x, box.center.x);
+    EXPECT_EQ(geometry->box().scale.y, box.scale.y);
+    ASSERT_EQ(geometry->lods().size(), 2u);
+    for (std::size_t l = 0; l < 2; ++l) {
+        velm_render::gpu_geometry expected =
+            velm_render::encode(chain[l], attributes, velm_render::vertex_format::PACKED, box);
+        const cached_geometry::lod & lod = geometry->lods()[l];
+        ASSERT_EQ(lod.vertices.size(), expected.vertices.size());
+        ASSERT_EQ(lod.indices.size(), expected.indices.size());
+        EXPECT_EQ(std::memcmp(lod.vertices.data(), bytes_of(expected.vertices).data(), lod.vertices.size()), 0);
+        EXPECT_EQ(std::memcmp(lod.indices.data(), bytes_of(expected.indices).data(), lod.indices.size()), 0);
+        EXPECT_EQ(lod.index32, expected.index32);
+        EXPECT_EQ(lod.index_count(), expected.index_count());
+        EXPECT_EQ(lod.geometric_error, chain[l].geometric_error);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(lod.vertices.data()) % 16, 0u);
+    }
+}
+
+TEST_F(GeometryCacheTest, EvictsLeastRecentlyUsedPastTheCap) {
+    std::vector<velm_dr::mesh_data> chain = { make_fan(200, 0.0f) };
+    geometry_cache                  cache(dir, 0);
+    auto                            first = cache.store(key("a"), chain, {});
+    (void) cache.store(key("b"), chain, {});
+    std::uint64_t entry = first->file_bytes();
+
+    // make the order unambiguous: a was used before b, then reading a makes it the most recent
+    auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(cache.file_of(key("a")), now - std::chrono::hours(2));
+    fs::last_write_time(cache.file_of(key("b")), now - std::chrono::hours(1));
+    EXPECT_NE(cache.load(key("a")), nullptr);
+
+    cache.set_max_bytes(2 * entry + entry / 2);
+    EXPECT_EQ(cache.disk_bytes(), 2 * entry);
+    (void) cache.store(key("c"), chain, {});
+    EXPECT_EQ(cache.disk_bytes(), 2 * entry);
+    EXPECT_NE(cache.load(key("a")), nullptr);
+    EXPECT_EQ(cache.load(key("b")), nullptr);
+    EXPECT_NE(cache.load(key("c")), nullptr);
+
+    // still mapped after its file is gone
+    cache.set_max_bytes(entry);
+    EXPECT_FALSE(fs::exists(cache.file_of(key("a"))));
+    EXPECT_EQ(first->lods()[0].index_count(), 597u);
+}
+
+TEST_F(GeometryCacheTest, DamagedEntriesAreMisses) {
+    std::vector<velm_dr::mesh_data> chain = { make_fan(20, 0.0f) };
+    geometry_cache                  cache(dir, 0);
+    std::uint64_t                   size = cache.store(key("x"), chain, {})->file_bytes();
+
+    fs::resize_file(cache.file_of(key("x")), size - 8);
+    EXPECT_EQ(cache.load(key("x")), nullptr);
+    EXPECT_FALSE(fs::exists(cache.file_of(key("x"))));
+
+    std::ofstream(cache.file_of(key("y")), std::ios::binary) << "not a cache file";
+    EXPECT_EQ(cache.load(key("y")), nullptr);
+
+    // the key text guards against collisions: another key's file under this name is not accepted
+    (void) cache.store(key("z"), chain, {});
+    fs::copy_file(cache.file_of(key("z")), cache.file_of(key("w")));
+    EXPECT_EQ(cache.load(key("w")), nullptr);
+    EXPECT_NE(cache.load(key("z")), nullptr);
+}
@@ -0,0 +1,45 @@
+#include "velm/gpu_upload.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+using velm_DR::ndarray;
+using velm_render::upload_fence;
+
+TEST(GpuUploadTest, PinKeepsStorageAliveUntilReleased) {
+    upload_fence                           fence;
+    auto                                   array = std::make_shared<const ndarray<float, 3>>(4, 4, 4);
+    std::weak_ptr<const ndarray<float, 3>> watch = array;
+
+    velm_render::upload_pin * pin = velm_render::pin_upload(std::move(array), &fence);
+    EXPECT_EQ(fence.pending(), 1u);
+    EXPECT_FALSE(fence.idle());
+    EXPECT_FALSE(watch.expired());
+
+    // what bgfx does on the render thread once the memory is consumed
+    velm_render::release_upload(nullptr, pin);
+    EXPECT_TRUE(fence.idle());
+    EXPECT_TRUE(watch.expired());
+}
+
+TEST(GpuUploadTest, WaitReturnsOnceEveryUploadIsReleased) {
+    upload_fence              fence;
+    auto                      owner     = std::make_shared<const int>(0);
+    velm_render::upload_pin * first     = velm_render::pin_upload(owner, &fence);
+    velm_render::upload_pin * second    = velm_render::pin_upload(owner, &fence);
+    velm_render::upload_pin * untracked = velm_render::pin_upload(owner, nullptr);
+    EXPECT_EQ(fence.pending(), 2u);
+    EXPECT_EQ(owner.use_count(), 4);
+
+    std::thread render([&] {
+        velm_render::release_upload(nullptr, first);
+        velm_render::release_upload(nullptr, untracked);
+        velm_render::release_upload(nullptr, second);
+    });
+    fence.wait();
+    EXPECT_TRUE(fence.idle());
+    render.join();
+    EXPECT_EQ(owner.use_count(), 1);
+}
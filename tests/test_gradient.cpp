@@ -0,0 +1,118 @@
+#include "velm/gradient.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using velm_DR::ndarray;
+
+namespace {
+
+float reference_derivative(const ndarray<float, 3> & f, std::size_t i, std::size_t j, std::size_t k, int axis,
+                           float spacing) {
+    std::size_t idx[3] = { i, j, k };
+    std::size_t lo[3]  = { i, j, k };
+    std::size_t hi[3]  = { i, j, k };
+    lo[axis]           = idx[axis] > 0 ? idx[axis] - 1 : idx[axis];
+    hi[axis]           = idx[axis] + 1 < f.dims[axis] ? idx[axis] + 1 : idx[axis];
+    if (hi[axis] == lo[axis]) {
+        return 0.0f;
+    }
+    return (f(hi[0], hi[1], hi[2]) - f(lo[0], lo[1], lo[2])) / (float(hi[axis] - lo[axis]) * spacing);
+}
+
+ndarray<float, 3> make_field(std::size_t n0, std::size_t n1, std::size_t n2) {
+    ndarray<float, 3> f(n0, n1, n2);
+    for (std::size_t i = 0; i < n0; ++i) {
+        for (std::size_t j = 0; j < n1; ++j) {
+            for (std::size_t k = 0; k < n2; ++k) {
+                f(i, j, k) = std::sin(0.3f * float(i)) * std::cos(0.2f * float(j)) + 0.05f * float(k * k);
+            }
+        }
+    }
+    return f;
+}
+
+}  // namespace
+
+TEST(GradientTest, MatchesReferenceAcrossTiles) {
+    ndarray<float, 3> field = make_field(7, 13, 37);
+    ndarray<float, 4> out(7, 13, 37, 3);
+
+    velm_dr::gradient_options options;
+    options.spacing    = glm::vec3(0.5f, 2.0f, 1.5f);
+    options.tile_rows  = 4;
+    options.tile_width = 16;
+    velm::job_system jobs(3);
+    velm_dr::compute_gradient(field, out, options, jobs);
+
+    for (std::size_t i = 0; i < 7; ++i) {
+        for (std::size_t j = 0; j < 13; ++j) {
+            for (std::size_t k = 0; k < 37; ++k) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    float expected = reference_derivative(field, i, j, k, axis, options.spacing[axis]);
+                    ASSERT_NEAR(out(i, j, k, axis), expected, 1e-4f) << i << " " << j << " " << k << " " << axis;
+                }
+            }
+        }
+    }
+}
+
+TEST(GradientTest, LinearFieldIsExactOnFaces) {
+    ndarray<float, 3> field(4, 5, 6);
+    for (std::size_t i = 0; i < 4; ++i) {
+        for (std::size_t j = 0; j < 5; ++j) {
+            for (std::size_t k = 0; k < 6; ++k) {
+                field(i, j, k) = 2.0f * float(i) - 3.0f * float(j) + 0.5f * float(k);
+            }
+        }
+    }
+    ndarray<float, 4> out(4, 5, 6, 3);
+    velm_dr::compute_gradient(field, out);
+
+    for (std::size_t v = 0; v < field.total_elements(); ++v) {
+        EXPECT_FLOAT_EQ(out.data[3 * v], 2.0f);
+        EXPECT_FLOAT_EQ(out.data[3 * v + 1], -3.0f);
+        EXPECT_FLOAT_EQ(out.data[3 * v + 2], 0.5f);
+    }
+}
+
+TEST(GradientTest, FlatAxesHaveZeroDerivative) {
+    ndarray<float, 3> field(1, 3, 1);
+    field(0, 0, 0) = 1.0f;
+    field(0, 1, 0) = 2.0f;
+    field(0, 2, 0) = 4.0f;
+    ndarray<float, 4> out(1, 3, 1, 3);
+    velm_dr::compute_gradient(field, out);
+
+    EXPECT_FLOAT_EQ(out(0, 1, 0, 0), 0.0f);
+    EXPECT_FLOAT_EQ(out(0, 1, 0, 1), 1.5f);
+    EXPECT_FLOAT_EQ(out(0, 1, 0, 2), 0.0f);
+    EXPECT_FLOAT_EQ(out(0, 2, 0, 1), 2.0f);
+}
+
+TEST(GradientTest, PackedNormalsEncodeDirectionAndMagnitude) {
+    ndarray<float, 3> field(3, 3, 20);
+    for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+            for (std::size_t k = 0; k < 20; ++k) {
+                field(i, j, k) = float(k);
+            }
+        }
+    }
+    std::vector<std::uint32_t> packed(field.total_elements());
+    velm_dr::compute_packed_normals(field, packed, 2.0f);
+
+    // gradient (0, 0, 1): rgb (128, 128, 255), alpha 1 / 2
+    for (std::uint32_t texel : packed) {
+        EXPECT_EQ(texel & 0xff, 128u);
+        EXPECT_EQ(texel >> 8 & 0xff, 128u);
+        EXPECT_EQ(texel >> 16 & 0xff, 255u);
+        EXPECT_EQ(texel >> 24, 128u);
+    }
+
+    field.fill(3.0f);
+    velm_dr::compute_packed_normals(field, packed, 2.0f);
+    EXPECT_EQ(packed[17], 0x00808080u);
+}
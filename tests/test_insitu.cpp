@@ -0,0 +1,105 @@
+#if defined(__unix__) || defined(__APPLE__)
+#    include "velm/insitu.h"
+
+#    include <gtest/gtest.h>
+
+#    include <chrono>
+#    include <string>
+#    include <thread>
+#    include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+std::string segment_name(const char * test) {
+    return "/velm_test_" + std::string(test) + "_" + std::to_string(getpid());
+}
+
+void fill(float * frame, std::size_t count, float offset) {
+    for (std::size_t i = 0; i < count; ++i) {
+        frame[i] = offset + float(i);
+    }
+}
+
+}  // namespace
+
+TEST(InsituTest, PublishedFrameIsMappedZeroCopy) {
+    std::string           name    = segment_name("mapped");
+    std::uint64_t         dims[3] = { 4, 5, 6 };
+    velm_insitu::producer ring(name, dims);
+    velm::insitu_source   source(name);
+
+    EXPECT_FALSE(source.latest().has_value());
+
+    float * data = ring.acquire();
+    fill(data, 4 * 5 * 6, 100.0f);
+    ring.publish(7, 0.5);
+
+    auto frame = source.latest();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->sequence, 2u);
+    EXPECT_EQ(frame->step, 7u);
+    EXPECT_DOUBLE_EQ(frame->time, 0.5);
+    EXPECT_EQ(frame->field.dims[0], 4u);
+    EXPECT_EQ(frame->field.dims[2], 6u);
+    EXPECT_FALSE(frame->field.owns_data);
+    EXPECT_FLOAT_EQ(frame->field(1, 2, 3), 100.0f + float(1 * 30 + 2 * 6 + 3));
+    EXPECT_TRUE(source.still_valid(*frame));
+}
+
+TEST(InsituTest, WaitTimesOutAndWakesOnPublish) {
+    std::string           name    = segment_name("wait");
+    std::uint64_t         dims[3] = { 2, 2, 2 };
+    velm_insitu::producer ring(name, dims);
+    velm::insitu_source   source(name);
+
+    EXPECT_FALSE(source.wait(0, 10ms));
+
+    std::thread solver([&] {
+        std::this_thread::sleep_for(20ms);
+        fill(ring.acquire(), 8, 0.0f);
+        ring.publish(1, 1.0);
+    });
+    EXPECT_TRUE(source.wait(0, 5s));
+    solver.join();
+
+    auto frame = source.latest();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_FALSE(source.wait(frame->sequence, 10ms));
+}
+
+TEST(InsituTest, RecycledSlotInvalidatesFrame) {
+    std::string           name    = segment_name("recycle");
+    std::uint64_t         dims[3] = { 1, 1, 8 };
+    velm_insitu::producer ring(name, dims, 2);
+    velm::insitu_source   source(name);
+
+    fill(ring.acquire(), 8, 0.0f);
+    ring.publish(1, 0.0);
+    auto first = source.latest();
+    ASSERT_TRUE(first.has_value());
+
+    // frame 2 goes to the other slot, frame 3 reuses the slot of frame 1
+    fill(ring.acquire(), 8, 10.0f);
+    ring.publish(2, 0.0);
+    EXPECT_TRUE(source.still_valid(*first));
+    ring.acquire();
+    EXPECT_FALSE(source.still_valid(*first));
+    ring.publish(3, 0.0);
+    EXPECT_FALSE(source.still_valid(*first));
+    EXPECT_EQ(source.latest()->step, 3u);
+}
+
+TEST(InsituTest, MissingSegmentThrows) {
+    EXPECT_THROW(velm::insitu_source(segment_name("missing")), std::runtime_error);
+}
+#else
+#    include "velm/insitu.h"
+
+#    include <gtest/gtest.h>
+
+TEST(InsituTest, UnsupportedPlatformThrows) {
+    EXPECT_THROW(velm::insitu_source("/velm_test_unsupported"), std::runtime_error);
+}
+#endif
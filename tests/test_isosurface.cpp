@@ -0,0 +1,164 @@
+#include "velm/isosurface.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using velm_DR::ndarray;
+
+namespace {
+
+const glm::vec3 center(7.3f, 8.1f, 7.7f);
+
+ndarray<float, 3> distance_field(std::size_t n) {
+    ndarray<float, 3> f(n, n, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t k = 0; k < n; ++k) {
+                f(i, j, k) = glm::length(glm::vec3(float(i), float(j), float(k)) - center);
+            }
+        }
+    }
+    return f;
+}
+
+glm::vec3 vertex(const velm_dr::mesh_data & mesh, std::uint32_t index) {
+    const float * p = mesh.vertices.data() + index * mesh.vertex_stride;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+}  // namespace
+
+TEST(IsosurfaceTest, SphereIsClosedAndFacesInward) {
+    ndarray<float, 3>  field = distance_field(16);
+    velm::job_system   jobs(3);
+    velm_dr::mesh_data mesh = velm_dr::extract_isosurface(field, 5.0f, glm::vec3(1.0f), jobs);
+    ASSERT_GT(mesh.triangle_count(), 100u);
+
+    for (std::size_t v = 0; v < mesh.vertex_count(); ++v) {
+        EXPECT_NEAR(glm::length(vertex(mesh, std::uint32_t(v)) - center), 5.0f, 0.15f);
+    }
+
+    // every edge of a closed, consistently oriented surface is used once in each direction
+    std::map<std::pair<std::uint32_t, std::uint32_t>, int> directed;
+    for (std::size_t t = 0; t < mesh.triangle_count(); ++t) {
+        const std::uint32_t * tri = mesh.indices.data() + 3 * t;
+        for (int e = 0; e < 3; ++e) {
+            ++directed[{ tri[e], tri[(e + 1) % 3] }];
+        }
+
+        glm::vec3 a      = vertex(mesh, tri[0]);
+        glm::vec3 normal = glm::cross(vertex(mesh, tri[1]) - a, vertex(mesh, tri[2]) - a);
+        EXPECT_LE(glm::dot(normal, a - center), 1e-6f) << t;
+    }
+    for (const auto & [edge, count] : directed) {
+        ASSERT_EQ(count, 1);
+        ASSERT_EQ(directed.count({ edge.second, edge.first }), 1u);
+    }
+}
+
+TEST(IsosurfaceTest, StreamedPlanesMatchAndIgnoreThreadCount) {
+    ndarray<float, 3> field = distance_field(16);
+    glm::vec3         spacing(0.5f, 1.0f, 2.0f);
+    velm::job_system  one(1);
+    velm::job_system  three(3);
+
+    velm_dr::mesh_data whole = velm_dr::extract_isosurface(field, 4.0f, spacing, three);
+
+    velm_dr::isosurface_builder builder(16, 16, 4.0f, spacing);
+    for (std::size_t i = 0; i < 16; ++i) {
+        std::vector<float> copy(field.data + i * 256, field.data + (i + 1) * 256);
+        builder.add_plane(copy, one);
+    }
+    EXPECT_EQ(builder.planes(), 16u);
+    velm_dr::mesh_data streamed = builder.finish();
+    EXPECT_EQ(builder.planes(), 0u);
+
+    EXPECT_EQ(streamed.indices, whole.indices);
+    EXPECT_EQ(streamed.vertices, whole.vertices);
+    float max_x = 0.0f;
+    for (std::size_t v = 0; v < whole.vertex_count(); ++v) {
+        max_x = std::max(max_x, whole.vertices[v * 3]);
+    }
+    EXPECT_NEAR(max_x, (center.x + 4.0f) * 0.5f, 0.1f);
+}
+
+TEST(IsosurfaceTest, SparseGridMatchesDense) {
+    // the distance saturates at the background just above the level, so only leaves near the sphere are allocated
+    // and cells on some leaf faces have their lower corners in unallocated blocks
+    ndarray<float, 3> field = distance_field(40);
+    for (std::size_t v = 0; v < field.total_elements(); ++v) {
+        field.data[v] = std::min(field.data[v], 5.3f);
+    }
+    velm::job_system   jobs(3);
+    velm_dr::mesh_data dense = velm_dr::extract_isosurface(field, 5.0f, glm::vec3(1.0f), jobs);
+
+    auto grid = velm_DR::sparse_grid<float>::from_dense(field, 5.3f, 0.0f, jobs);
+    ASSERT_LT(grid.leaf_count(), 25u);
+    velm_dr::mesh_data sparse = velm_dr::extract_isosurface(grid, 5.0f, glm::vec3(1.0f), jobs);
+
+    // same triangles in another order: compare them as position triples starting at their smallest vertex
+    auto triangles = [](const velm_dr::mesh_data & mesh) {
+        std::vector<std::array<float, 9>> result;
+        for (std::size_t t = 0; t < mesh.triangle_count(); ++t) {
+            const std::uint32_t * tri  = mesh.indices.data() + 3 * t;
+            auto                  less = [&](std::uint32_t a, std::uint32_t b) {
+                glm::vec3 pa = vertex(mesh, a);
+                glm::vec3 pb = vertex(mesh, b);
+                return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+            };
+            int first = less(tri[1], tri[0]) ? (less(tri[2], tri[1]) ? 2 : 1) : (less(tri[2], tri[0]) ? 2 : 0);
+            std::array<float, 9> key;
+            for (int c = 0; c < 3; ++c) {
+                glm::vec3 p = vertex(mesh, tri[(first + c) % 3]);
+                std::copy(&p.x, &p.x + 3, key.begin() + 3 * c);
+            }
+            result.push_back(key);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    ASSERT_GT(dense.triangle_count(), 100u);
+    EXPECT_EQ(sparse.vertex_count(), dense.vertex_count());
+    EXPECT_EQ(triangles(sparse), triangles(dense));
+
+    // a grid at negative indices gives the same surface, moved
+    const std::int32_t          origin[3] = { -37, 5, -12 };
+    velm_DR::sparse_grid<float> moved(5.3f);
+    moved.insert_dense(field, origin, 0.0f, jobs);
+    velm_dr::mesh_data shifted = velm_dr::extract_isosurface(moved, 5.0f, glm::vec3(1.0f), jobs);
+    EXPECT_EQ(shifted.triangle_count(), dense.triangle_count());
+    EXPECT_EQ(shifted.vertex_count(), dense.vertex_count());
+    glm::vec3 dense_sum(0.0f);
+    glm::vec3 shifted_sum(0.0f);
+    for (std::size_t v = 0; v < dense.vertex_count(); ++v) {
+        dense_sum += vertex(dense, std::uint32_t(v));
+        shifted_sum += vertex(shifted, std::uint32_t(v));
+    }
+    glm::vec3 offset = (shifted_sum - dense_sum) / float(dense.vertex_count());
+    EXPECT_NEAR(offset.x, float(origin[0]), 1e-3f);
+    EXPECT_NEAR(offset.y, float(origin[1]), 1e-3f);
+    EXPECT_NEAR(offset.z, float(origin[2]), 1e-3f);
+    // vertices are shared across leaves: every edge is used once in each direction
+    std::map<std::pair<std::uint32_t, std::uint32_t>, int> directed;
+    for (std::size_t t = 0; t < shifted.triangle_count(); ++t) {
+        const std::uint32_t * tri = shifted.indices.data() + 3 * t;
+        for (int e = 0; e < 3; ++e) {
+            ++directed[{ tri[e], tri[(e + 1) % 3] }];
+        }
+    }
+    for (const auto & [edge, count] : directed) {
+        ASSERT_EQ(count, 1);
+        ASSERT_EQ(directed.count({ edge.second, edge.first }), 1u);
+    }
+
+    // nothing but background
+    velm_DR::sparse_grid<float> empty(5.3f);
+    EXPECT_EQ(velm_dr::extract_isosurface(empty, 5.0f).vertex_count(), 0u);
+}
@@ -0,0 +1,85 @@
+#include "velm/job_system.h"
+#include "velm/timestep_prefetcher.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+TEST(JobSystemTest, ParallelForCoversRange) {
+    velm::job_system jobs(3);
+    std::vector<int> hits(1000, 0);
+    std::atomic<int> chunks{ 0 };
+    velm::parallel_for(0, hits.size(), 7, [&](std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+            hits[i]++;
+        }
+        chunks++;
+    }, jobs);
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+    EXPECT_EQ(chunks.load(), 143);
+}
+
+TEST(JobSystemTest, NestedTaskGroupsFinish) {
+    velm::job_system jobs(2);
+    std::atomic<int> total{ 0 };
+    velm::parallel_for(0, 8, 1, [&](std::size_t, std::size_t) {
+        velm::parallel_for(0, 8, 1, [&](std::size_t, std::size_t) { total++; }, jobs);
+    }, jobs);
+    EXPECT_EQ(total.load(), 64);
+}
+
+TEST(JobSystemTest, ThrowingJobsReachTheWaiter) {
+    velm::job_system jobs(2);
+    std::atomic<int> finished{ 0 };
+    {
+        velm::task_group group(jobs);
+        for (int i = 0; i < 16; ++i) {
+            group.run([&, i] {
+                if (i % 4 == 0) {
+                    throw std::runtime_error("job failed");
+                }
+                finished++;
+            });
+        }
+        EXPECT_THROW(group.wait(), std::runtime_error);
+        EXPECT_EQ(finished.load(), 12);
+
+        // rethrown once, the group is usable again
+        group.run([&] { finished++; });
+        EXPECT_NO_THROW(group.wait());
+    }
+    EXPECT_EQ(finished.load(), 13);
+
+    // the destructor still waits for a failed group nobody waited on
+    {
+        velm::task_group group(jobs);
+        group.run([] { throw std::runtime_error("dropped"); });
+    }
+
+    EXPECT_THROW(velm::parallel_for(0, 64, 1, [](std::size_t b, std::size_t) {
+        if (b == 33) {
+            throw std::out_of_range("chunk failed");
+        }
+    }, jobs), std::out_of_range);
+}
+
+TEST(JobSystemTest, PrefetcherLoadsAheadAndEvicts) {
+    velm::job_system               jobs(1);
+    velm::timestep_prefetcher<int> steps(5, [](std::size_t step) { return int(step) * 10; }, 2, jobs);
+
+    EXPECT_EQ(*steps.get(0), 0);
+    EXPECT_EQ(steps.loads(), 3u);
+    std::shared_ptr<const int> kept = steps.get(1);
+    EXPECT_EQ(*steps.get(3), 30);
+    EXPECT_EQ(*kept, 10);
+    // 4 was the last step, nothing past it is requested
+    EXPECT_EQ(*steps.get(4), 40);
+    EXPECT_EQ(steps.loads(), 5u);
+    // steps before the previous one were dropped and load again
+    EXPECT_EQ(*steps.get(0), 0);
+    EXPECT_EQ(steps.loads(), 8u);
+}
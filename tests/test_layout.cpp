@@ -0,0 +1,99 @@
+#include "velm/layout.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using velm_DR::brick_array;
+using velm_DR::morton_array;
+using velm_DR::ndarray;
+
+namespace {
+
+ndarray<int, 3> make_indexed(std::size_t n0, std::size_t n1, std::size_t n2) {
+    ndarray<int, 3> source(n0, n1, n2);
+    for (std::size_t e = 0; e < source.total_elements(); ++e) {
+        source.data[e] = int(e);
+    }
+    return source;
+}
+
+// every element has its own storage slot inside the storage
+template <typename Array> void expect_bijection(const Array & a) {
+    std::vector<bool> used(a.storage_size(), false);
+    for (std::size_t i = 0; i < a.dims[0]; ++i) {
+        for (std::size_t j = 0; j < a.dims[1]; ++j) {
+            for (std::size_t k = 0; k < a.dims[2]; ++k) {
+                std::size_t offset = a.offset_of_index(i, j, k);
+                ASSERT_LT(offset, used.size());
+                EXPECT_FALSE(used[offset]);
+                used[offset] = true;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST(LayoutTest, MortonOffsets) {
+    morton_array<float> a(4, 4, 4);
+    EXPECT_EQ(a.storage_size(), 64u);
+    EXPECT_EQ(a.offset_of_index(0, 0, 1), 1u);
+    EXPECT_EQ(a.offset_of_index(0, 1, 0), 2u);
+    EXPECT_EQ(a.offset_of_index(1, 0, 0), 4u);
+    EXPECT_EQ(a.offset_of_index(1, 1, 1), 7u);
+    EXPECT_EQ(a.offset_of_index(0, 0, 2), 8u);
+    EXPECT_EQ(a.offset_of_index(3, 3, 3), 63u);
+
+    // the short axis runs out of bits, the other two keep interleaving
+    morton_array<float> flat(2, 8, 8);
+    EXPECT_EQ(flat.storage_size(), 128u);
+    EXPECT_EQ(flat.offset_of_index(0, 0, 2), 8u);
+    EXPECT_EQ(flat.offset_of_index(0, 2, 0), 16u);
+    EXPECT_EQ(flat.offset_of_index(0, 4, 4), 96u);
+    expect_bijection(flat);
+}
+
+TEST(LayoutTest, BrickOffsets) {
+    brick_array<float> a(10, 9, 17);
+    EXPECT_EQ(a.storage_size(), 2u * 2u * 3u * 512u);
+    EXPECT_EQ(a.offset_of_index(0, 0, 1), 1u);
+    EXPECT_EQ(a.offset_of_index(0, 1, 0), 8u);
+    EXPECT_EQ(a.offset_of_index(1, 0, 0), 64u);
+    EXPECT_EQ(a.offset_of_index(0, 0, 8), 512u);
+    EXPECT_EQ(a.offset_of_index(0, 8, 0), 3u * 512u);
+    EXPECT_EQ(a.offset_of_index(8, 0, 0), 6u * 512u);
+    expect_bijection(a);
+}
+
+TEST(LayoutTest, RoundTrip) {
+    ndarray<int, 3> source = make_indexed(7, 13, 5);
+
+    auto morton = morton_array<int>::from_row_major(source);
+    auto brick  = brick_array<int>::from_row_major(source);
+    expect_bijection(morton);
+    EXPECT_EQ(morton(6, 12, 4), source(6, 12, 4));
+    EXPECT_EQ(brick.at(3, 9, 2), source(3, 9, 2));
+
+    ndarray<int, 3> back(7, 13, 5);
+    morton.to_row_major(back);
+    for (std::size_t e = 0; e < source.total_elements(); ++e) {
+        ASSERT_EQ(back.data[e], source.data[e]);
+    }
+    back.fill(-1);
+    brick.to_row_major(back);
+    for (std::size_t e = 0; e < source.total_elements(); ++e) {
+        ASSERT_EQ(back.data[e], source.data[e]);
+    }
+}
+
+TEST(LayoutTest, WritesThroughAccessor) {
+    brick_array<float> a(3, 3, 20);
+    a.fill(1.0f);
+    a(2, 1, 19) = 5.0f;
+
+    ndarray<float, 3> out(3, 3, 20);
+    a.to_row_major(out);
+    EXPECT_FLOAT_EQ(out(2, 1, 19), 5.0f);
+    EXPECT_FLOAT_EQ(out(2, 1, 18), 1.0f);
+}
@@ -0,0 +1,176 @@
+#include "velm/amr.h"
+#include "velm/compositing.h"
+#include "velm/memory_budget.h"
+#include "velm/mesh.h"
+#include "velm/ndarray.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using velm::memory_budget;
+using velm::memory_category;
+using velm::memory_charge;
+
+TEST(MemoryBudgetTest, ChargesByCategory) {
+    memory_budget budget;
+    {
+        memory_charge textures(memory_category::GPU_TEXTURES, 1000, budget);
+        memory_charge buffers(memory_category::IO_BUFFERS, 24, budget);
+        EXPECT_EQ(budget.used(), 1024u);
+        EXPECT_EQ(budget.used(memory_category::GPU_TEXTURES), 1000u);
+
+        textures.resize(400);
+        EXPECT_EQ(budget.used(memory_category::GPU_TEXTURES), 400u);
+        EXPECT_EQ(budget.used(), 424u);
+    }
+    velm::memory_stats stats = budget.stats();
+    EXPECT_EQ(stats.total, 0u);
+    EXPECT_EQ(stats.peak, 1024u);
+    EXPECT_EQ(stats.limit, 0u);
+    EXPECT_EQ(stats.overruns, 0u);
+    EXPECT_STREQ(velm::category_name(memory_category::IO_BUFFERS), "io buffers");
+}
+
+TEST(MemoryBudgetTest, ChargesFollowCopiesAndMoves) {
+    memory_budget budget;
+    {
+        memory_charge mesh(memory_category::MESHES, 100, budget);
+        memory_charge copy(mesh);
+        EXPECT_EQ(budget.used(memory_category::MESHES), 200u);
+
+        memory_charge moved(std::move(copy));
+        EXPECT_EQ(budget.used(memory_category::MESHES), 200u);
+        EXPECT_EQ(moved.bytes(), 100u);
+
+        memory_charge image(memory_category::IMAGES, 50, budget);
+        image = mesh;
+        EXPECT_EQ(budget.used(memory_category::IMAGES), 0u);
+        EXPECT_EQ(budget.used(memory_category::MESHES), 300u);
+
+        image = std::move(moved);
+        EXPECT_EQ(budget.used(memory_category::MESHES), 200u);
+    }
+    EXPECT_EQ(budget.used(), 0u);
+}
+
+TEST(MemoryBudgetTest, MeshesAndImagesReportTheirStorage) {
+    memory_budget & budget = memory_budget::global();
+    std::size_t     meshes = budget.used(memory_category::MESHES);
+    std::size_t     images = budget.used(memory_category::IMAGES);
+    {
+        velm_dr::mesh_data mesh;
+        mesh.vertices.assign(9, 0.0f);
+        mesh.indices.assign(3, 0u);
+        mesh.charge_memory();
+        std::size_t mesh_bytes = mesh.vertices.capacity() * sizeof(float) + mesh.indices.capacity() * 4;
+        EXPECT_EQ(budget.used(memory_category::MESHES), meshes + mesh_bytes);
+
+        std::vector<velm_dr::mesh_data> chain;
+        chain.push_back(std::move(mesh));
+        EXPECT_EQ(budget.used(memory_category::MESHES), meshes + mesh_bytes);
+
+        velm_render::composite_image image;
+        image.clear(4, 2);
+        EXPECT_GE(budget.used(memory_category::IMAGES), images + 8 * (sizeof(glm::vec4) + sizeof(float)));
+    }
+    EXPECT_EQ(budget.used(memory_category::MESHES), meshes);
+    EXPECT_EQ(budget.used(memory_category::IMAGES), images);
+}
+
+TEST(MemoryBudgetTest, EvictsByPriorityUntilEnoughIsFreed) {
+    memory_budget            budget;
+    std::vector<std::string> calls;
+    memory_charge            cache(memory_category::CACHES, 0, budget);
+
+    (void) budget.add_evictor(
+        "second",
+        [&](std::size_t) {
+            calls.emplace_back("second");
+            return std::size_t(0);
+        },
+        1);
+    std::size_t first = budget.add_evictor("first", [&](std::size_t bytes) {
+        calls.emplace_back("first");
+        std::size_t freed = std::min(bytes, cache.bytes());
+        cache.resize(cache.bytes() - freed);
+        return freed;
+    });
+
+    cache.resize(800);
+    budget.set_limit(1000);
+    EXPECT_TRUE(calls.empty());
+
+    // 300 over the limit, the first evictor covers it and the second is never asked
+    memory_charge texture(memory_category::GPU_TEXTURES, 500, budget);
+    EXPECT_EQ(calls, (std::vector<std::string>{ "first" }));
+    EXPECT_EQ(budget.used(), 1000u);
+    EXPECT_EQ(cache.bytes(), 500u);
+
+    // nothing left to take from the cache, both run and the total stays over
+    calls.clear();
+    cache.resize(0);
+    texture.resize(1200);
+    EXPECT_EQ(calls, (std::vector<std::string>{ "first", "second" }));
+    EXPECT_EQ(budget.used(), 1200u);
+
+    velm::memory_stats stats = budget.stats();
+    EXPECT_EQ(stats.overruns, 2u);
+    EXPECT_EQ(stats.evicted_bytes, 300u);
+
+    calls.clear();
+    budget.remove_evictor(first);
+    EXPECT_EQ(budget.reclaim(100), 0u);
+    EXPECT_EQ(calls, (std::vector<std::string>{ "second" }));
+}
+
+TEST(MemoryBudgetTest, ArraysReportTheirStorage) {
+    memory_budget & budget = memory_budget::global();
+    std::size_t     before = budget.used(memory_category::ARRAYS);
+    {
+        velm_DR::ndarray<float, 3> a(4, 4, 4);
+        EXPECT_EQ(budget.used(memory_category::ARRAYS), before + 64 * sizeof(float));
+
+        a.resize(2, 2, 2);
+        EXPECT_EQ(budget.used(memory_category::ARRAYS), before + 8 * sizeof(float));
+
+        velm_DR::ndarray<float, 3> b(a);
+        EXPECT_EQ(budget.used(memory_category::ARRAYS), before + 16 * sizeof(float));
+
+        // views do not own their memory
+        float                      external[8] = {};
+        velm_DR::ndarray<float, 3> view        = velm_DR::ndarray<float, 3>::wrap(external, 2, 2, 2);
+        EXPECT_EQ(budget.used(memory_category::ARRAYS), before + 16 * sizeof(float));
+
+        (void) (a = std::move(b));  // suppress [[nodiscard]]
+        EXPECT_EQ(budget.used(memory_category::ARRAYS), before + 8 * sizeof(float));
+    }
+    EXPECT_EQ(budget.used(memory_category::ARRAYS), before);
+}
+
+TEST(MemoryBudgetTest, AmrDropsUnreferencedPatches) {
+    using velm_DR::amr_patch;
+
+    std::vector<amr_patch> patches(3);
+    for (std::size_t p = 0; p < patches.size(); ++p) {
+        auto lo        = std::int64_t(p) * 8;
+        patches[p].box = { { lo, 0, 0 }, { lo + 8, 8, 8 } };
+    }
+    std::vector<std::int64_t> ratios = { 1 };
+    velm_DR::amr_hierarchy    amr(patches, ratios, [](const amr_patch &, velm_DR::ndarray<float, 3> &) {});
+
+    memory_budget & budget = memory_budget::global();
+    std::size_t     patch  = 512 * sizeof(float);
+
+    auto held = amr.data(0);
+    (void) amr.data(1);
+    ASSERT_EQ(amr.loaded_count(), 2u);
+
+    // loading the third patch goes over: patch 1 is the only one nobody holds
+    budget.set_limit(budget.used() + patch / 2);
+    (void) amr.data(2);
+    EXPECT_EQ(amr.loaded_count(), 2u);
+    EXPECT_EQ(amr.data(0), held);
+    budget.set_limit(0);
+}
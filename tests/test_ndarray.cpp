@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <iostream>
+#include <vector>
 
 using velm_DR::ndarray;
 
@@ -459,3 +460,41 @@ TEST(NdArrayTest, ResizeEdgeCases) {
         }
     }
 }
+
+TEST(NdArrayTest, WrapIsNonOwningView) {
+    std::vector<float> external(2 * 3 * 4);
+    for (std::size_t i = 0; i < external.size(); ++i) {
+        external[i] = float(i);
+    }
+
+    {
+        auto view = ndarray<float, 3>::wrap(external.data(), 2, 3, 4);
+        EXPECT_FALSE(view.owns_data);
+        EXPECT_EQ(view.data, external.data());
+        EXPECT_EQ(view(1, 2, 3), 23.0f);
+
+        // writes go straight to the external memory
+        view(0, 1, 2) = -1.0f;
+        EXPECT_EQ(external[6], -1.0f);
+
+        // copies are owning and independent
+        ndarray<float, 3> copy(view);
+        EXPECT_TRUE(copy.owns_data);
+        copy(0, 0, 0) = 100.0f;
+        EXPECT_EQ(external[0], 0.0f);
+
+        // moving a view keeps it a view
+        ndarray<float, 3> moved(std::move(view));
+        EXPECT_FALSE(moved.owns_data);
+        EXPECT_EQ(moved.data, external.data());
+    }
+    // the views went out of scope without freeing the vector's memory
+    EXPECT_EQ(external[23], 23.0f);
+
+    // resizing a view detaches it
+    auto view = ndarray<float, 3>::wrap(external.data(), 2, 3, 4);
+    view.resize(2, 3, 5);
+    EXPECT_TRUE(view.owns_data);
+    EXPECT_NE(view.data, external.data());
+    EXPECT_EQ(view(1, 2, 3), 23.0f);
+}
@@ -0,0 +1,172 @@
+#include "velm/picking.h"
+#include "velm/sampling.h"
+#include "velm/scene.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+using velm::Scene;
+using velm::scene_handle;
+using velm_DR::ndarray;
+using velm_render::grid_probe;
+using velm_render::minmax_bricks;
+using velm_render::ray;
+
+namespace {
+
+// negative distance to the centre, so value >= -radius is a ball
+ndarray<float, 3> make_ball(std::size_t n, const glm::vec3 & centre) {
+    ndarray<float, 3> volume(n, n, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t k = 0; k < n; ++k) {
+                volume(i, j, k) = -glm::length(glm::vec3(float(i), float(j), float(k)) - centre);
+            }
+        }
+    }
+    return volume;
+}
+
+// first parameter where the field reaches threshold, by small fixed steps
+float march(const ndarray<float, 3> & volume, const ray & r, float threshold) {
+    glm::vec3 last(float(volume.dims[0] - 1), float(volume.dims[1] - 1), float(volume.dims[2] - 1));
+    for (float t = 0.0f; t < 4.0f; t += 1e-4f) {
+        glm::vec3 p = r.at(t);
+        bool      inside = true;
+        for (int a = 0; a < 3; ++a) {
+            inside = inside && p[a] >= 0.0f && p[a] <= last[a];
+        }
+        if (inside && velm_DR::sample_at(volume, p) >= threshold) {
+            return t;
+        }
+    }
+    return -1.0f;
+}
+
+}  // namespace
+
+TEST(PickingTest, CursorRayAndUnproject) {
+    glm::mat4x4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4x4 proj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    glm::vec2   viewport(200.0f, 200.0f);
+
+    // glm's default projection maps depth to [-1, 1]
+    ray r = velm_render::cursor_ray(view, proj, glm::vec2(100.0f, 100.0f), viewport, true);
+    EXPECT_NEAR(r.origin.z, 4.9f, 1e-4f);
+    EXPECT_NEAR(r.at(1.0f).z, -95.0f, 1e-2f);
+    EXPECT_NEAR(r.direction.x, 0.0f, 1e-4f);
+
+    // upper half of the window looks up
+    ray up = velm_render::cursor_ray(view, proj, glm::vec2(100.0f, 10.0f), viewport, true);
+    EXPECT_GT(up.direction.y, 0.0f);
+
+    glm::vec3 p = velm_render::unproject(view, proj, glm::vec2(100.0f, 100.0f), viewport, 0.0f, true);
+    EXPECT_NEAR(p.z, 4.9f, 1e-4f);
+}
+
+TEST(PickingTest, IsovalueAlongAxis) {
+    ndarray<float, 3> volume = make_ball(64, glm::vec3(32.0f));
+    minmax_bricks     bricks(volume);
+    grid_probe        grid{ volume, bricks };
+
+    ray                   r{ glm::vec3(-5.0f, 32.0f, 32.0f), glm::vec3(1.0f, 0.0f, 0.0f) };
+    velm_render::grid_hit hit = velm_render::pick_isovalue(grid, r, -10.5f);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_NEAR(hit.t, 26.5f, 1e-2f);
+    EXPECT_NEAR(hit.position.x, 21.5f, 1e-2f);
+    EXPECT_NEAR(hit.value, -10.5f, 1e-2f);
+    EXPECT_EQ(hit.cell[0], 21u);
+
+    ray miss{ glm::vec3(-5.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f) };
+    EXPECT_FALSE(velm_render::pick_isovalue(grid, miss, -10.5f).hit);
+    EXPECT_FALSE(velm_render::pick_isovalue(grid, r, -10.5f, 20.0f).hit);
+
+    // placed in the world with spacing 0.5 and an offset
+    grid_probe placed{ volume, bricks,
+                       glm::scale(glm::translate(glm::mat4x4(1.0f), glm::vec3(100.0f, 0.0f, 0.0f)), glm::vec3(0.5f)) };
+    ray        world{ glm::vec3(90.0f, 16.0f, 16.0f), glm::vec3(1.0f, 0.0f, 0.0f) };
+    hit = velm_render::pick_isovalue(placed, world, -10.0f);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_NEAR(hit.position.x, 111.0f, 1e-2f);
+}
+
+TEST(PickingTest, IsovalueMatchesMarching) {
+    ndarray<float, 3> volume = make_ball(40, glm::vec3(17.0f, 21.0f, 19.0f));
+    minmax_bricks     bricks(volume);
+    grid_probe        grid{ volume, bricks };
+
+    std::mt19937                          rng(11);
+    std::uniform_real_distribution<float> coordinate(-10.0f, 50.0f);
+    int                                   hits = 0;
+    for (int n = 0; n < 40; ++n) {
+        glm::vec3 from(coordinate(rng), coordinate(rng), coordinate(rng));
+        glm::vec3 to(coordinate(rng) * 0.3f + 12.0f, coordinate(rng) * 0.3f + 12.0f, coordinate(rng) * 0.3f + 12.0f);
+        ray       r{ from, (to - from) * 2.0f };
+
+        float expected = march(volume, r, -8.0f);
+        auto  hit      = velm_render::pick_isovalue(grid, r, -8.0f);
+        ASSERT_EQ(hit.hit, expected >= 0.0f) << n;
+        if (hit.hit) {
+            EXPECT_NEAR(hit.t, expected, 2e-4f) << n;
+            ++hits;
+        }
+    }
+    EXPECT_GT(hits, 10);
+}
+
+TEST(PickingTest, ProbePosition) {
+    ndarray<float, 3> volume = make_ball(16, glm::vec3(0.0f));
+    minmax_bricks     bricks(volume);
+    grid_probe        grid{ volume, bricks, glm::scale(glm::mat4x4(1.0f), glm::vec3(2.0f)) };
+
+    auto inside = velm_render::probe_position(grid, glm::vec3(6.0f, 0.0f, 0.0f));
+    ASSERT_TRUE(inside.hit);
+    EXPECT_NEAR(inside.value, -3.0f, 1e-5f);
+    EXPECT_EQ(inside.cell[0], 3u);
+    EXPECT_FALSE(velm_render::probe_position(grid, glm::vec3(-1.0f, 0.0f, 0.0f)).hit);
+}
+
+TEST(PickingTest, ClosestPickableObject) {
+    Scene        scene;
+    std::uint8_t pickable = velm_render::RENDER_VISIBLE | velm_render::RENDER_PICKABLE;
+    scene_handle front    = scene.add_mesh(nullptr, { glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 5.0f) });
+    scene_handle middle   = scene.add_mesh(nullptr, { glm::vec3(-1.0f, -1.0f, 2.0f), glm::vec3(1.0f, 1.0f, 3.0f) }, {},
+                                           pickable);
+    scene_handle back     = scene.add_mesh(nullptr, { glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f) }, {},
+                                           pickable);
+    for (int n = 0; n < 20; ++n) {
+        scene.add_mesh(nullptr, { glm::vec3(float(n) * 3.0f + 5.0f), glm::vec3(float(n) * 3.0f + 6.0f) }, {}, pickable);
+    }
+    (void) scene.update_transforms();
+
+    ray  r{ glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+    auto hit = velm_render::pick_object(scene, r);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_EQ(hit.handle, middle);
+    EXPECT_FLOAT_EQ(hit.t, 7.0f);
+    EXPECT_NE(hit.handle, front);
+
+    // the exact test only accepts the back object, through a triangle at z = 0.5 in its local space
+    velm_dr::mesh_data triangle;
+    triangle.vertices = { -1.0f, -1.0f, 0.5f, 1.0f, -1.0f, 0.5f, 0.0f, 1.0f, 0.5f };
+    triangle.indices  = { 0, 1, 2 };
+    auto exact        = [&](std::uint32_t slot, const ray & local, float & t) {
+        return slot == back.index && velm_render::intersect_triangles(triangle, local, t);
+    };
+    hit = velm_render::pick_object(scene, r, exact);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_EQ(hit.handle, back);
+    EXPECT_NEAR(hit.t, 9.5f, 1e-5f);
+    EXPECT_NEAR(hit.position.z, 0.5f, 1e-5f);
+
+    // moved out of the way without an update_transforms() in between
+    scene.set_transform(middle, glm::translate(glm::mat4x4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f)));
+    hit = velm_render::pick_object(scene, r);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_EQ(hit.handle, back);
+    EXPECT_FLOAT_EQ(hit.t, 9.0f);
+}
@@ -0,0 +1,87 @@
+#ifdef VELM_ENABLE_PROFILER
+#    include "velm/profiler.h"
+
+#    include <gtest/gtest.h>
+
+#    include <filesystem>
+#    include <fstream>
+#    include <sstream>
+#    include <string>
+#    include <thread>
+#    include <vector>
+
+namespace fs = std::filesystem;
+
+class ProfilerTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // drop zones left over from other tests
+        velm_profiler::end_frame();
+        velm_profiler::clear();
+    }
+};
+
+TEST_F(ProfilerTest, ZonesAreCollectedAtFrameEnd) {
+    {
+        VELM_PROFILE_ZONE("outer");
+        VELM_PROFILE_ZONE("inner");
+    }
+    EXPECT_TRUE(velm_profiler::recorded_zones().empty());
+
+    velm_profiler::end_frame();
+
+    auto zones = velm_profiler::recorded_zones();
+    ASSERT_EQ(zones.size(), 2);
+    // inner closes first
+    EXPECT_STREQ(zones[0].name, "inner");
+    EXPECT_STREQ(zones[1].name, "outer");
+    EXPECT_LE(zones[1].begin_ns, zones[0].begin_ns);
+    EXPECT_GE(zones[1].end_ns, zones[0].end_ns);
+
+    auto frames = velm_profiler::recorded_frames();
+    ASSERT_EQ(frames.size(), 1);
+    EXPECT_EQ(frames[0].dropped_zones, 0);
+}
+
+TEST_F(ProfilerTest, ZonesFromMultipleThreads) {
+    constexpr int            thread_count = 4;
+    constexpr int            zone_count   = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < zone_count; ++i) {
+                VELM_PROFILE_ZONE("worker");
+            }
+        });
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+    velm_profiler::end_frame();
+
+    auto summary = velm_profiler::last_frame_summary();
+    ASSERT_EQ(summary.size(), 1);
+    EXPECT_STREQ(summary[0].name, "worker");
+    EXPECT_EQ(summary[0].count, thread_count * zone_count);
+}
+
+TEST_F(ProfilerTest, ChromeTraceExport) {
+    {
+        VELM_PROFILE_ZONE("exported \"zone\"");
+    }
+    velm_profiler::end_frame();
+
+    std::string path = (fs::temp_directory_path() / "velm_profiler_trace.json").string();
+    ASSERT_TRUE(velm_profiler::write_chrome_trace(path));
+
+    std::ifstream     in(path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string json = contents.str();
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("exported \\\"zone\\\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"C\""), std::string::npos);
+    fs::remove(path);
+}
+#endif
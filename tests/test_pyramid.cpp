@@ -0,0 +1,132 @@
+#include "velm/pyramid.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using velm_DR::ndarray;
+using velm_dr::pyramid_filter;
+
+namespace {
+
+ndarray<float, 3> make_field(std::size_t n0, std::size_t n1, std::size_t n2) {
+    ndarray<float, 3> f(n0, n1, n2);
+    for (std::size_t i = 0; i < n0; ++i) {
+        for (std::size_t j = 0; j < n1; ++j) {
+            for (std::size_t k = 0; k < n2; ++k) {
+                f(i, j, k) = float((i * 7 + j * 13 + k * 29) % 31) - 15.0f;
+            }
+        }
+    }
+    return f;
+}
+
+// straightforward halving of one level for comparison
+ndarray<float, 3> halve(const ndarray<float, 3> & src, pyramid_filter filter) {
+    ndarray<float, 3> dst((src.dims[0] + 1) / 2, (src.dims[1] + 1) / 2, (src.dims[2] + 1) / 2);
+    for (std::size_t i = 0; i < dst.dims[0]; ++i) {
+        for (std::size_t j = 0; j < dst.dims[1]; ++j) {
+            for (std::size_t k = 0; k < dst.dims[2]; ++k) {
+                double sum   = 0.0;
+                float  lo    = 1e30f;
+                float  hi    = -1e30f;
+                int    count = 0;
+                for (std::size_t a = 2 * i; a < std::min(2 * i + 2, src.dims[0]); ++a) {
+                    for (std::size_t b = 2 * j; b < std::min(2 * j + 2, src.dims[1]); ++b) {
+                        for (std::size_t c = 2 * k; c < std::min(2 * k + 2, src.dims[2]); ++c) {
+                            sum += src(a, b, c);
+                            lo = std::min(lo, src(a, b, c));
+                            hi = std::max(hi, src(a, b, c));
+                            ++count;
+                        }
+                    }
+                }
+                dst(i, j, k) = filter == pyramid_filter::BOX ? float(sum / count)
+                                                             : (filter == pyramid_filter::MIN ? lo : hi);
+            }
+        }
+    }
+    return dst;
+}
+
+}  // namespace
+
+TEST(PyramidTest, LevelsMatchStepwiseHalving) {
+    ndarray<float, 3> field = make_field(37, 20, 9);
+    velm::job_system  jobs(2);
+
+    for (pyramid_filter filter : { pyramid_filter::BOX, pyramid_filter::MIN, pyramid_filter::MAX }) {
+        velm_dr::pyramid_options options;
+        options.filter       = filter;
+        options.block_levels = 2;
+        auto levels          = velm_dr::build_pyramid(field, options, jobs);
+
+        // 37 -> 19 -> 10 -> 5 -> 3 -> 2 -> 1
+        ASSERT_EQ(levels.levels.size(), 6u);
+        std::vector<ndarray<float, 3>> expected;
+        expected.push_back(halve(field, filter));
+        while (expected.size() < levels.levels.size()) {
+            expected.push_back(halve(expected.back(), filter));
+        }
+        for (std::size_t l = 0; l < levels.levels.size(); ++l) {
+            ndarray<float, 3> level = levels.level(l);
+            ASSERT_EQ(level.total_elements(), expected[l].total_elements());
+            for (std::size_t v = 0; v < level.total_elements(); ++v) {
+                ASSERT_NEAR(level.data[v], expected[l].data[v], 1e-5f) << "level " << l << " element " << v;
+            }
+        }
+    }
+}
+
+TEST(PyramidTest, LevelsAreContiguous) {
+    ndarray<float, 3> field = make_field(8, 4, 2);
+    auto              p     = velm_dr::build_pyramid(field);
+
+    ASSERT_EQ(p.levels.size(), 3u);
+    std::size_t offset = 0;
+    for (const velm_dr::pyramid_level & l : p.levels) {
+        EXPECT_EQ(l.offset, offset);
+        offset += l.dims[0] * l.dims[1] * l.dims[2];
+    }
+    EXPECT_EQ(p.values.size(), offset);
+    EXPECT_EQ(p.levels.back().dims[0], 1u);
+    EXPECT_EQ(p.levels.back().dims[2], 1u);
+}
+
+TEST(PyramidTest, StreamingMatchesInMemory) {
+    ndarray<float, 3> field = make_field(45, 11, 17);
+
+    velm_dr::pyramid_options options;
+    options.block_levels = 3;
+    auto in_memory       = velm_dr::build_pyramid(field, options);
+
+    std::size_t                  dims[3]   = { 45, 11, 17 };
+    std::size_t                  max_count = 0;
+    velm_dr::plane_reader<float> read      = [&](std::size_t first, std::size_t count, float * out) {
+        max_count = std::max(max_count, count);
+        std::memcpy(out, field.data + first * field.strides[0], count * field.strides[0] * sizeof(float));
+    };
+    auto streamed = velm_dr::build_pyramid(dims, read, 5, options);
+
+    // 5 planes round up to one 8 plane block
+    EXPECT_EQ(max_count, 8u);
+    EXPECT_EQ(velm_dr::detail::slab_block(dims, options), 8u);
+    // a source with only two levels caps the block
+    std::size_t small[3] = { 3, 1, 1 };
+    EXPECT_EQ(velm_dr::detail::slab_block(small, options), 4u);
+    ASSERT_EQ(streamed.values.size(), in_memory.values.size());
+    for (std::size_t v = 0; v < streamed.values.size(); ++v) {
+        ASSERT_FLOAT_EQ(streamed.values[v], in_memory.values[v]) << v;
+    }
+}
+
+TEST(PyramidTest, IntegerAverageRounds) {
+    ndarray<std::uint8_t, 3> field(2, 2, 2);
+    field(0, 0, 0) = 3;
+    field(1, 1, 1) = 2;
+    auto p         = velm_dr::build_pyramid(field);
+    ASSERT_EQ(p.values.size(), 1u);
+    EXPECT_EQ(p.values[0], 1);
+}
@@ -0,0 +1,231 @@
+#include "velm/raycaster.h"
+#include "velm/sampling.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+
+using velm_DR::ndarray;
+using velm_render::composite_image;
+using velm_render::grid_probe;
+using velm_render::minmax_bricks;
+using velm_render::raycast_options;
+using velm_render::transfer_function;
+
+namespace {
+
+// 1 at the centre falling to 0 at radius 14, zero in the corners so whole bricks are empty
+ndarray<float, 3> make_blob(std::size_t n) {
+    ndarray<float, 3> volume(n, n, n);
+    glm::vec3         centre(float(n) * 0.5f);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            for (std::size_t k = 0; k < n; ++k) {
+                float r         = glm::length(glm::vec3(float(i), float(j), float(k)) - centre);
+                volume(i, j, k) = std::max(0.0f, 1.0f - r / 14.0f);
+            }
+        }
+    }
+    return volume;
+}
+
+// transparent below 0.3, a shell of color above
+void set_shell(transfer_function & tf, float extinction) {
+    std::vector<velm_render::tf_point> points = { { 0.0f, glm::vec4(0.0f) },
+                                                  { 0.3f, glm::vec4(0.0f) },
+                                                  { 0.5f, glm::vec4(1.0f, 0.5f, 0.0f, extinction) },
+                                                  { 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, extinction * 2.0f) } };
+    tf.set_points(points);
+    tf.set_step(0.5f);
+    (void) tf.update();
+}
+
+struct camera {
+    glm::mat4x4 view = glm::lookAt(glm::vec3(20.0f, 26.0f, -40.0f), glm::vec3(20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4x4 proj = glm::perspective(glm::radians(40.0f), 1.5f, 0.5f, 200.0f);
+};
+
+}  // namespace
+
+TEST(RaycasterTest, MatchesSerialMarch) {
+    ndarray<float, 3> volume = make_blob(40);
+    minmax_bricks     bricks(volume);
+    grid_probe        grid{ volume, bricks };
+    transfer_function tf(128);
+    set_shell(tf, 0.2f);
+    camera cam;
+
+    // no skipping and no early termination: every ray takes every step
+    composite_image image;
+    image.clear(45, 30);
+    raycast_options options;
+    options.opacity_cutoff = 2.0f;
+    options.skip_empty     = false;
+    options.tile           = 7;
+    velm_render::raycast_volume(cam.view, cam.proj, true, grid, tf, image, options);
+
+    glm::vec3 last(39.0f);
+    for (std::size_t y = 0; y < image.height; y += 3) {
+        for (std::size_t x = 0; x < image.width; x += 2) {
+            glm::vec2        pixel(float(x) + 0.5f, float(y) + 0.5f);
+            velm_render::ray r      = velm_render::cursor_ray(cam.view, cam.proj, pixel, glm::vec2(45.0f, 30.0f), true);
+            float            length = glm::length(r.direction);
+            float            enter  = 0.0f;
+            float            exit   = 1.0f;
+            for (int a = 0; a < 3; ++a) {
+                float t0 = -r.origin[a] / r.direction[a];
+                float t1 = (last[a] - r.origin[a]) / r.direction[a];
+                enter    = std::max(enter, std::min(t0, t1));
+                exit     = std::min(exit, std::max(t0, t1));
+            }
+            glm::vec4 color(0.0f);
+            float     depth = std::numeric_limits<float>::infinity();
+            float     front = -1.0f;
+            for (auto s = std::int64_t(std::ceil(enter * length / 0.5f)); enter <= exit && s * 0.5f <= exit * length;
+                 ++s) {
+                float back = velm_DR::sample_at(volume, r.at(float(s) * 0.5f / length));
+                if (front >= 0.0f) {
+                    glm::vec4 segment = tf.lookup(front, back);
+                    if (segment.w > 0.0f) {
+                        depth = std::min(depth, float(s - 1) * 0.5f);
+                        color += (1.0f - color.w) * segment;
+                    }
+                }
+                front = back;
+            }
+            std::size_t p = y * image.width + x;
+            for (int c = 0; c < 4; ++c) {
+                ASSERT_NEAR(image.color[p][c], color[c], 1e-4f) << x << ", " << y;
+            }
+            if (std::isinf(depth)) {
+                ASSERT_TRUE(std::isinf(image.depth[p])) << x << ", " << y;
+            } else {
+                ASSERT_NEAR(image.depth[p], depth, 1e-3f) << x << ", " << y;
+            }
+        }
+    }
+    // the blob is in view and the corners of the image miss it
+    EXPECT_GT(image.color[15 * 45 + 22].w, 0.5f);
+    EXPECT_EQ(image.color[0].w, 0.0f);
+}
+
+TEST(RaycasterTest, SkippingAndTilesKeepTheImage) {
+    ndarray<float, 3> volume = make_blob(48);
+    minmax_bricks     bricks(volume);
+    // placed off the origin with a spacing of 0.75
+    glm::mat4x4       placement = glm::translate(glm::mat4x4(1.0f), glm::vec3(2.0f, 0.0f, 1.0f));
+    grid_probe        grid{ volume, bricks, glm::scale(placement, glm::vec3(0.75f)) };
+    transfer_function tf(256);
+    set_shell(tf, 0.3f);
+    camera cam;
+
+    raycast_options full;
+    full.opacity_cutoff = 2.0f;
+    full.skip_empty     = false;
+    composite_image reference;
+    reference.clear(61, 43);
+    velm_render::raycast_volume(cam.view, cam.proj, true, grid, tf, reference, full);
+
+    raycast_options skipping = full;
+    skipping.skip_empty      = true;
+    skipping.tile            = 5;
+    composite_image image;
+    image.clear(61, 43);
+    velm::job_system jobs(3);
+    velm_render::raycast_volume(cam.view, cam.proj, true, grid, tf, image, skipping, jobs);
+    for (std::size_t p = 0; p < image.pixel_count(); ++p) {
+        for (int c = 0; c < 4; ++c) {
+            ASSERT_NEAR(image.color[p][c], reference.color[p][c], 1e-5f) << p;
+        }
+        ASSERT_EQ(image.depth[p], reference.depth[p]) << p;
+    }
+
+    // early termination stops just past the cutoff
+    set_shell(tf, 50.0f);
+    raycast_options early;
+    early.opacity_cutoff = 0.9f;
+    velm_render::raycast_volume(cam.view, cam.proj, true, grid, tf, image, early);
+    float centre = image.color[21 * 61 + 30].w;
+    EXPECT_GE(centre, 0.9f);
+    EXPECT_LT(centre, 1.0f);
+}
+
+TEST(RaycasterTest, SkippingKeepsSegmentsAcrossBrickFaces) {
+    // a sharp slab whose last plane is the last sample of its bricks, the bricks beyond it are empty
+    ndarray<float, 3> volume(48, 48, 48);
+    volume.fill(0.0f);
+    for (std::size_t i = 10; i <= 15; ++i) {
+        for (std::size_t j = 0; j < 48; ++j) {
+            for (std::size_t k = 0; k < 48; ++k) {
+                volume(i, j, k) = 1.0f;
+            }
+        }
+    }
+    minmax_bricks     bricks(volume);
+    grid_probe        grid{ volume, bricks };
+    transfer_function tf(256);
+    set_shell(tf, 0.3f);
+    glm::mat4x4 proj = glm::perspective(glm::radians(30.0f), 1.0f, 0.5f, 200.0f);
+
+    // rays leave the slab into the empty bricks on one side and enter it from them on the other
+    for (float side : { -1.0f, 1.0f }) {
+        glm::vec3   eye(24.0f + side * 60.0f, 27.0f, 21.0f);
+        glm::mat4x4 view = glm::lookAt(eye, glm::vec3(24.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        raycast_options full;
+        full.opacity_cutoff = 2.0f;
+        full.skip_empty     = false;
+        composite_image reference;
+        reference.clear(32, 32);
+        velm_render::raycast_volume(view, proj, true, grid, tf, reference, full);
+
+        raycast_options skipping = full;
+        skipping.skip_empty      = true;
+        composite_image image;
+        image.clear(32, 32);
+        velm_render::raycast_volume(view, proj, true, grid, tf, image, skipping);
+        EXPECT_GT(reference.color[16 * 32 + 16].w, 0.1f);
+        for (std::size_t p = 0; p < image.pixel_count(); ++p) {
+            for (int c = 0; c < 4; ++c) {
+                ASSERT_NEAR(image.color[p][c], reference.color[p][c], 1e-5f) << side << ", " << p;
+            }
+            ASSERT_EQ(image.depth[p], reference.depth[p]) << side << ", " << p;
+        }
+    }
+}
+
+TEST(RaycasterTest, WritesPpm) {
+    composite_image image;
+    image.clear(3, 2);
+    image.color[1] = glm::vec4(0.5f, 0.0f, 0.0f, 0.5f);
+    image.color[5] = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "velm_raycaster_test.ppm";
+    velm_render::write_ppm(image, file, glm::vec3(0.0f, 1.0f, 0.0f));
+    std::ifstream in(file, std::ios::binary);
+    std::string   magic;
+    int           width  = 0;
+    int           height = 0;
+    int           depth  = 0;
+    in >> magic >> width >> height >> depth;
+    in.get();
+    std::vector<unsigned char> pixels(18);
+    in.read(reinterpret_cast<char *>(pixels.data()), 18);
+    EXPECT_EQ(magic, "P6");
+    EXPECT_EQ(width, 3);
+    EXPECT_EQ(height, 2);
+    EXPECT_EQ(depth, 255);
+    EXPECT_TRUE(in);
+    // background, half red over it, and blue
+    EXPECT_EQ(pixels[0], 0);
+    EXPECT_EQ(pixels[1], 255);
+    EXPECT_EQ(pixels[3], 128);
+    EXPECT_EQ(pixels[4], 128);
+    EXPECT_EQ(pixels[15], 0);
+    EXPECT_EQ(pixels[17], 255);
+    std::filesystem::remove(file);
+}
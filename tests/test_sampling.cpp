@@ -0,0 +1,111 @@
+#include "velm/sampling.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using velm_DR::ndarray;
+using velm_DR::sample_boundary;
+using velm_DR::sample_filter;
+using velm_DR::sample_options;
+
+namespace {
+
+// f(i, j, k) = i + 10 j + 100 k is reproduced exactly by every filter inside the array
+ndarray<float, 3> make_linear(std::size_t n0, std::size_t n1, std::size_t n2) {
+    ndarray<float, 3> volume(n0, n1, n2);
+    for (std::size_t i = 0; i < n0; ++i) {
+        for (std::size_t j = 0; j < n1; ++j) {
+            for (std::size_t k = 0; k < n2; ++k) {
+                volume(i, j, k) = float(i) + 10.0f * float(j) + 100.0f * float(k);
+            }
+        }
+    }
+    return volume;
+}
+
+}  // namespace
+
+TEST(SamplingTest, FiltersReproduceLinearField) {
+    ndarray<float, 3> volume = make_linear(6, 7, 8);
+    glm::vec3         p(2.25f, 3.5f, 4.75f);
+    float             expected = 2.25f + 35.0f + 475.0f;
+
+    EXPECT_NEAR(velm_DR::sample_at(volume, p, { sample_filter::TRILINEAR }), expected, 1e-3f);
+    EXPECT_NEAR(velm_DR::sample_at(volume, p, { sample_filter::TRICUBIC }), expected, 1e-3f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, p, { sample_filter::NEAREST }), 2.0f + 40.0f + 500.0f);
+}
+
+TEST(SamplingTest, BoundaryModes) {
+    ndarray<float, 3> volume = make_linear(4, 1, 1);
+    glm::vec3         before(-1.0f, 0.0f, 0.0f);
+    glm::vec3         edge(-0.5f, 0.0f, 0.0f);
+
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, before, { sample_filter::TRILINEAR, sample_boundary::CLAMP }), 0.0f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, edge, { sample_filter::TRILINEAR, sample_boundary::ZERO }), 0.0f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, before, { sample_filter::NEAREST, sample_boundary::PERIODIC }), 3.0f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, edge, { sample_filter::TRILINEAR, sample_boundary::PERIODIC }), 1.5f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, glm::vec3(3.5f, 0.0f, 0.0f),
+                                       { sample_filter::TRILINEAR, sample_boundary::ZERO }),
+                    1.5f);
+    EXPECT_FLOAT_EQ(velm_DR::sample_at(volume, glm::vec3(std::nanf(""), 0.0f, 0.0f)), 0.0f);
+}
+
+TEST(SamplingTest, EmptyVolumesSampleZero) {
+    float             storage = 1.0f;
+    ndarray<float, 3> volume  = ndarray<float, 3>::wrap(&storage, 4, 0, 4);
+    glm::vec3         p(1.0f, 0.5f, 1.0f);
+    for (sample_boundary boundary : { sample_boundary::CLAMP, sample_boundary::ZERO, sample_boundary::PERIODIC }) {
+        EXPECT_EQ(velm_DR::sample_at(volume, p, { sample_filter::TRICUBIC, boundary }), 0.0f);
+    }
+
+    std::vector<glm::vec3> positions(11, p);
+    std::vector<float>     out(positions.size(), 1.0f);
+    velm_DR::sample(volume, positions, out, { sample_filter::TRILINEAR, sample_boundary::PERIODIC });
+    EXPECT_EQ(out, std::vector<float>(positions.size(), 0.0f));
+}
+
+TEST(SamplingTest, BatchedMatchesScalar) {
+    ndarray<float, 3>                     volume(9, 10, 11);
+    std::mt19937                          rng(7);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    for (float & v : volume) {
+        v = value(rng);
+    }
+
+    std::uniform_real_distribution<float> coordinate(-2.0f, 12.0f);
+    std::vector<glm::vec3>                positions(203);
+    for (glm::vec3 & p : positions) {
+        p = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+    }
+    positions[5]  = glm::vec3(8.0f, 9.0f, 10.0f);
+    positions[6]  = glm::vec3(9.0f, 10.0f, 11.0f);
+    positions[7]  = glm::vec3(std::numeric_limits<float>::infinity(), 1.0f, 1.0f);
+    positions[20] = glm::vec3(0.0f, std::nanf(""), 0.0f);
+
+    for (sample_filter filter : { sample_filter::NEAREST, sample_filter::TRILINEAR, sample_filter::TRICUBIC }) {
+        for (sample_boundary boundary :
+             { sample_boundary::CLAMP, sample_boundary::ZERO, sample_boundary::PERIODIC }) {
+            sample_options     options{ filter, boundary };
+            std::vector<float> out(positions.size());
+            velm_DR::sample(volume, positions, out, options);
+            for (std::size_t i = 0; i < positions.size(); ++i) {
+                ASSERT_NEAR(out[i], velm_DR::sample_at(volume, positions[i], options), 1e-5f) << i;
+            }
+        }
+    }
+}
+
+TEST(SamplingTest, IntegerVolumes) {
+    ndarray<std::uint8_t, 3> volume(2, 2, 2);
+    volume(1, 1, 1) = 200;
+
+    std::vector<glm::vec3> positions = { glm::vec3(0.5f), glm::vec3(1.0f) };
+    std::vector<float>     out(2);
+    velm_DR::sample(volume, positions, out);
+    EXPECT_FLOAT_EQ(out[0], 25.0f);
+    EXPECT_FLOAT_EQ(out[1], 200.0f);
+}
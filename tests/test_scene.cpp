@@ -0,0 +1,175 @@
+#include "velm/scene.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <vector>
+
+using velm::Scene;
+using velm::scene_handle;
+using velm_render::aabb;
+
+namespace {
+glm::mat4x4 translation(float x, float y, float z) {
+    glm::mat4x4 m(1.0f);
+    m[3] = glm::vec4(x, y, z, 1.0f);
+    return m;
+}
+
+bool contains(std::span<const std::uint32_t> slots, scene_handle handle) {
+    return std::find(slots.begin(), slots.end(), handle.index) != slots.end();
+}
+}  // namespace
+
+TEST(SceneTest, HandlesAreGenerational) {
+    Scene        scene;
+    scene_handle a = scene.add_mesh(nullptr, {});
+    EXPECT_TRUE(scene.is_valid(a));
+
+    scene.remove(a);
+    EXPECT_FALSE(scene.is_valid(a));
+
+    // the slot is recycled, the stale handle must not alias the new object
+    scene_handle b = scene.add_mesh(nullptr, {});
+    EXPECT_EQ(a.index, b.index);
+    EXPECT_NE(a.generation, b.generation);
+    EXPECT_FALSE(scene.is_valid(a));
+    EXPECT_TRUE(scene.is_valid(b));
+    EXPECT_EQ(scene.slot_count(), 1);
+
+    EXPECT_DEATH((void) scene.world_transform(a), ".*");
+}
+
+TEST(SceneTest, WorldTransformsFollowHierarchy) {
+    Scene        scene;
+    scene_handle root  = scene.add_mesh(nullptr, { glm::vec3(-1.0f), glm::vec3(1.0f) });
+    scene_handle child = scene.add_mesh(nullptr, { glm::vec3(-1.0f), glm::vec3(1.0f) }, root);
+    scene_handle leaf  = scene.add_mesh(nullptr, { glm::vec3(0.0f), glm::vec3(1.0f) }, child);
+
+    scene.set_transform(root, translation(10.0f, 0.0f, 0.0f));
+    scene.set_transform(child, translation(0.0f, 5.0f, 0.0f));
+    EXPECT_EQ(scene.update_transforms().size(), 3);
+
+    EXPECT_EQ(scene.world_transform(leaf)[3], glm::vec4(10.0f, 5.0f, 0.0f, 1.0f));
+    EXPECT_EQ(scene.world_bound(leaf).min, glm::vec3(10.0f, 5.0f, 0.0f));
+    EXPECT_EQ(scene.world_bound(leaf).max, glm::vec3(11.0f, 6.0f, 1.0f));
+
+    // nothing dirty, nothing recomputed
+    EXPECT_TRUE(scene.update_transforms().empty());
+
+    // only the moved subtree is recomputed
+    scene.set_transform(child, translation(0.0f, 7.0f, 0.0f));
+    auto changed = scene.update_transforms();
+    EXPECT_EQ(changed.size(), 2);
+    EXPECT_TRUE(contains(changed, child));
+    EXPECT_TRUE(contains(changed, leaf));
+    EXPECT_FALSE(contains(changed, root));
+    EXPECT_EQ(scene.world_transform(leaf)[3], glm::vec4(10.0f, 7.0f, 0.0f, 1.0f));
+}
+
+TEST(SceneTest, ParentsAddedAfterChildrenUpdateFirst) {
+    Scene        scene;
+    scene_handle child  = scene.add_mesh(nullptr, {});
+    scene_handle parent = scene.add_mesh(nullptr, {});
+    scene.set_parent(child, parent);
+    scene.set_transform(parent, translation(1.0f, 2.0f, 3.0f));
+    (void) scene.update_transforms();
+    EXPECT_EQ(scene.world_transform(child)[3], glm::vec4(1.0f, 2.0f, 3.0f, 1.0f));
+
+    EXPECT_DEATH(scene.set_parent(parent, child), ".*");
+}
+
+TEST(SceneTest, RemovingParentKeepsChildWorldTransform) {
+    Scene        scene;
+    scene_handle parent = scene.add_mesh(nullptr, {});
+    scene_handle child  = scene.add_mesh(nullptr, {}, parent);
+    scene.set_transform(parent, translation(4.0f, 0.0f, 0.0f));
+    (void) scene.update_transforms();
+
+    scene.remove(parent);
+    (void) scene.update_transforms();
+    EXPECT_TRUE(scene.is_valid(child));
+    EXPECT_EQ(scene.world_transform(child)[3], glm::vec4(4.0f, 0.0f, 0.0f, 1.0f));
+    EXPECT_EQ(scene.render_flag_pool()[parent.index], 0);
+}
+
+TEST(SceneTest, RemovingParentUsesTransformsNotYetUpdated) {
+    Scene        scene;
+    scene_handle root   = scene.add_mesh(nullptr, {});
+    scene_handle parent = scene.add_mesh(nullptr, {}, root);
+    scene_handle child  = scene.add_mesh(nullptr, {}, parent);
+    (void) scene.update_transforms();
+
+    // none of these reached world_transforms yet
+    scene.set_transform(root, translation(1.0f, 0.0f, 0.0f));
+    scene.set_transform(parent, translation(0.0f, 2.0f, 0.0f));
+    scene.set_transform(child, translation(0.0f, 0.0f, 3.0f));
+    scene.remove(parent);
+    (void) scene.update_transforms();
+    EXPECT_EQ(scene.world_transform(child)[3], glm::vec4(1.0f, 2.0f, 3.0f, 1.0f));
+}
+
+TEST(SceneTest, RemovingParentOnlyDetachesItsOwnChildren) {
+    Scene        scene;
+    scene_handle parent = scene.add_mesh(nullptr, {});
+    scene_handle other  = scene.add_mesh(nullptr, {});
+    scene_handle a      = scene.add_mesh(nullptr, {}, parent);
+    scene_handle b      = scene.add_mesh(nullptr, {}, parent);
+    scene_handle c      = scene.add_mesh(nullptr, {}, parent);
+    scene_handle moved  = scene.add_mesh(nullptr, {}, parent);
+    scene.set_parent(moved, other);
+    scene.set_transform(other, translation(0.0f, 3.0f, 0.0f));
+    scene.set_transform(parent, translation(2.0f, 0.0f, 0.0f));
+    (void) scene.update_transforms();
+
+    // b is in the middle of the child list
+    scene.remove(b);
+    scene.remove(parent);
+    scene.set_transform(other, translation(0.0f, 6.0f, 0.0f));
+    (void) scene.update_transforms();
+    EXPECT_EQ(scene.world_transform(a)[3], glm::vec4(2.0f, 0.0f, 0.0f, 1.0f));
+    EXPECT_EQ(scene.world_transform(c)[3], glm::vec4(2.0f, 0.0f, 0.0f, 1.0f));
+    EXPECT_EQ(scene.world_transform(moved)[3], glm::vec4(0.0f, 6.0f, 0.0f, 1.0f));
+
+    // recycled slots start without children
+    scene_handle reused = scene.add_mesh(nullptr, {});
+    scene.remove(reused);
+    EXPECT_TRUE(scene.is_valid(moved));
+    EXPECT_EQ(scene.local_transform(a)[3], glm::vec4(2.0f, 0.0f, 0.0f, 1.0f));
+}
+
+TEST(SceneTest, ViewsKeepTheirAddress) {
+    Scene                     scene;
+    velm_render::view &       first = scene.add_view();
+    const velm_render::view * where = &first;
+    for (int i = 0; i < 64; ++i) {
+        (void) scene.add_view();
+    }
+    EXPECT_EQ(&scene.view_pool().front(), where);
+    first.set_lod_error(720, 2.0f);
+    EXPECT_GT(scene.view_pool().front().revision(), 0u);
+}
+
+TEST(SceneTest, RevisionTracksVisibleChanges) {
+    Scene        scene;
+    scene_handle object = scene.add_mesh(nullptr, {});
+    auto &       view   = scene.add_view();
+
+    std::uint64_t revision = scene.revision();
+    (void) scene.update_transforms();
+    view.set_lod_error_scale(4.0f);
+    EXPECT_EQ(scene.revision(), revision);
+    EXPECT_FALSE(view.needs_redraw());
+
+    scene.set_transform(object, translation(1.0f, 0.0f, 0.0f));
+    EXPECT_GT(scene.revision(), revision);
+    revision = scene.revision();
+
+    view.set_camera(translation(0.0f, 0.0f, -5.0f), glm::mat4x4(1.0f));
+    EXPECT_GT(scene.revision(), revision);
+    revision = scene.revision();
+
+    scene.remove(object);
+    EXPECT_GT(scene.revision(), revision);
+}
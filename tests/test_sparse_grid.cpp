@@ -0,0 +1,127 @@
+#include "velm/sparse_grid.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using velm_DR::ndarray;
+using velm_DR::sparse_grid;
+
+namespace {
+
+// background 0 with a blob of values around a corner shared by eight leaves
+ndarray<float, 3> make_blob(std::size_t n) {
+    ndarray<float, 3> dense(n, n, n);
+    for (std::size_t i = 5; i < 11; ++i) {
+        for (std::size_t j = 6; j < 10; ++j) {
+            for (std::size_t k = 7; k < 9; ++k) {
+                dense(i, j, k) = float(i * 100 + j * 10 + k);
+            }
+        }
+    }
+    return dense;
+}
+
+}  // namespace
+
+TEST(SparseGridTest, SetGetAndBackground) {
+    sparse_grid<float> grid(-1.0f);
+    EXPECT_FLOAT_EQ(grid.get(3, 4, 5), -1.0f);
+    EXPECT_FALSE(grid.is_active(3, 4, 5));
+
+    grid.set(3, 4, 5, 2.0f);
+    grid.set(-200, 7, -1, 3.0f);
+    EXPECT_FLOAT_EQ(grid.get(3, 4, 5), 2.0f);
+    EXPECT_FLOAT_EQ(grid.get(-200, 7, -1), 3.0f);
+    EXPECT_FLOAT_EQ(grid.get(3, 4, 6), -1.0f);
+    EXPECT_TRUE(grid.is_active(-200, 7, -1));
+    EXPECT_EQ(grid.leaf_count(), 2u);
+    EXPECT_EQ(grid.active_count(), 2u);
+
+    grid.deactivate(3, 4, 5);
+    EXPECT_FLOAT_EQ(grid.get(3, 4, 5), -1.0f);
+    EXPECT_FALSE(grid.is_active(3, 4, 5));
+    EXPECT_EQ(grid.active_count(), 1u);
+}
+
+TEST(SparseGridTest, DenseRoundTrip) {
+    ndarray<float, 3>  dense = make_blob(20);
+    sparse_grid<float> grid  = sparse_grid<float>::from_dense(dense);
+    EXPECT_EQ(grid.active_count(), 6u * 4u * 2u);
+    EXPECT_EQ(grid.leaf_count(), 8u);
+
+    ndarray<float, 3> back(20, 20, 20);
+    grid.to_dense(back);
+    for (std::size_t e = 0; e < dense.total_elements(); ++e) {
+        ASSERT_FLOAT_EQ(back.data[e], dense.data[e]);
+    }
+}
+
+TEST(SparseGridTest, InsertAtOriginWithTolerance) {
+    ndarray<float, 3> dense(4, 4, 4);
+    dense.fill(1.0f);
+    dense(1, 2, 3) = 1.05f;
+    dense(3, 3, 3) = 5.0f;
+
+    sparse_grid<float> grid(1.0f);
+    const std::int32_t origin[3] = { -2, 6, 30 };
+    grid.insert_dense(dense, origin, 0.1f);
+    EXPECT_EQ(grid.active_count(), 1u);
+    EXPECT_FLOAT_EQ(grid.get(1, 9, 33), 5.0f);
+    EXPECT_FLOAT_EQ(grid.get(-1, 8, 33), 1.0f);
+}
+
+TEST(SparseGridTest, AccessorMatchesGet) {
+    ndarray<float, 3>  dense = make_blob(24);
+    sparse_grid<float> grid  = sparse_grid<float>::from_dense(dense);
+
+    sparse_grid<float>::accessor       access(grid);
+    std::mt19937                       rng(3);
+    std::uniform_int_distribution<int> coordinate(-2, 25);
+    for (int n = 0; n < 2000; ++n) {
+        int i = coordinate(rng);
+        int j = coordinate(rng);
+        int k = coordinate(rng);
+        ASSERT_FLOAT_EQ(access.get(i, j, k), grid.get(i, j, k));
+        ASSERT_EQ(access.is_active(i, j, k), grid.is_active(i, j, k));
+    }
+}
+
+TEST(SparseGridTest, ActiveIterationAndReduction) {
+    ndarray<float, 3>  dense = make_blob(16);
+    sparse_grid<float> grid  = sparse_grid<float>::from_dense(dense);
+
+    double      expected = 0.0;
+    std::size_t visited  = 0;
+    grid.for_each_active([&](std::int32_t i, std::int32_t j, std::int32_t k, float value) {
+        EXPECT_FLOAT_EQ(value, dense(std::size_t(i), std::size_t(j), std::size_t(k)));
+        expected += value;
+        ++visited;
+    });
+    EXPECT_EQ(visited, grid.active_count());
+
+    double sum = velm_DR::reduce_active(
+        grid, 0.0, [](double acc, float value) { return acc + value; }, [](double a, double b) { return a + b; });
+    EXPECT_DOUBLE_EQ(sum, expected);
+    float top = velm_DR::reduce_active(
+        grid, 0.0f, [](float acc, float value) { return std::max(acc, value); },
+        [](float a, float b) { return std::max(a, b); });
+    EXPECT_FLOAT_EQ(top, 1098.0f);
+}
+
+TEST(SparseGridTest, ThinFrontUsesLittleMemory) {
+    // a shock front two planes thick through a 128^3 box
+    ndarray<float, 3> dense(128, 128, 128);
+    for (std::size_t i = 64; i < 66; ++i) {
+        for (std::size_t j = 0; j < 128; ++j) {
+            for (std::size_t k = 0; k < 128; ++k) {
+                dense(i, j, k) = 1.0f;
+            }
+        }
+    }
+    sparse_grid<float> grid = sparse_grid<float>::from_dense(dense);
+    EXPECT_EQ(grid.active_count(), 2u * 128u * 128u);
+    EXPECT_LT(grid.memory_bytes() * 10, dense.total_elements() * sizeof(float));
+}
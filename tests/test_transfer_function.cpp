@@ -0,0 +1,90 @@
+#include "velm/transfer_function.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using velm_render::tf_point;
+using velm_render::transfer_function;
+
+namespace {
+
+// transparent everywhere except a narrow extinction peak around 0.5
+std::vector<tf_point> spike() {
+    return { { 0.0f, glm::vec4(0.0f) },
+             { 0.49f, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) },
+             { 0.5f, glm::vec4(1.0f, 0.0f, 0.0f, 40.0f) },
+             { 0.51f, glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) },
+             { 1.0f, glm::vec4(0.0f) } };
+}
+
+}  // namespace
+
+TEST(TransferFunctionTest, ClassifyInterpolatesAndClamps) {
+    transfer_function     tf(64);
+    std::vector<tf_point> points = { { 0.25f, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) },
+                                     { 0.75f, glm::vec4(1.0f, 0.5f, 0.0f, 3.0f) } };
+    tf.set_points(points);
+    EXPECT_FLOAT_EQ(tf.classify(0.0f).w, 1.0f);
+    EXPECT_FLOAT_EQ(tf.classify(0.5f).x, 0.5f);
+    EXPECT_FLOAT_EQ(tf.classify(0.5f).w, 2.0f);
+    EXPECT_FLOAT_EQ(tf.classify(1.0f).y, 0.5f);
+}
+
+TEST(TransferFunctionTest, DiagonalMatchesClassification) {
+    transfer_function     tf(32);
+    std::vector<tf_point> points = { { 0.0f, glm::vec4(0.2f, 0.4f, 0.6f, 0.5f) } };
+    tf.set_points(points);
+    tf.set_step(2.0f);
+    EXPECT_EQ(tf.update(), 32u * 32u);
+    EXPECT_EQ(tf.update(), 0u);
+
+    // constant classification: every segment is the same, premultiplied
+    float     alpha = 1.0f - std::exp(-1.0f);
+    glm::vec4 entry = tf.lookup(0.1f, 0.9f);
+    EXPECT_NEAR(entry.w, alpha, 1e-6f);
+    EXPECT_NEAR(entry.y, 0.4f * alpha, 1e-6f);
+    EXPECT_NEAR(tf.lookup(0.5f, 0.5f).x, 0.2f * alpha, 1e-6f);
+}
+
+TEST(TransferFunctionTest, SegmentsCrossingAPeakPickItUp) {
+    transfer_function tf(256);
+    tf.set_points(spike());
+    (void) tf.update();
+
+    // both ends are transparent, point sampling would miss the peak entirely
+    EXPECT_FLOAT_EQ(tf.classify(0.2f).w, 0.0f);
+    EXPECT_FLOAT_EQ(tf.classify(0.8f).w, 0.0f);
+    glm::vec4 across = tf.lookup(0.2f, 0.8f);
+    EXPECT_GT(across.w, 0.05f);
+    EXPECT_NEAR(across.x, across.w, 1e-3f);
+    EXPECT_NEAR(across.y, 0.0f, 1e-6f);
+    // the same segment in the other direction, and none that stays clear of the peak
+    EXPECT_NEAR(tf.lookup(0.8f, 0.2f).w, across.w, 1e-6f);
+    EXPECT_FLOAT_EQ(tf.lookup(0.1f, 0.4f).w, 0.0f);
+}
+
+TEST(TransferFunctionTest, EditsOnlyRecomputeCrossingSegments) {
+    transfer_function tf(128);
+    tf.set_points(spike());
+    (void) tf.update();
+
+    // raise the peak: only segments overlapping [0.49, 0.51] change
+    tf_point raised{ 0.5f, glm::vec4(0.0f, 1.0f, 0.0f, 80.0f) };
+    tf.edit_points(2, std::span<const tf_point>(&raised, 1));
+    std::size_t recomputed = tf.update();
+    EXPECT_GT(recomputed, 0u);
+    EXPECT_LT(recomputed, 128u * 128u * 3 / 4);
+
+    std::vector<tf_point> edited = spike();
+    edited[2]                    = raised;
+    transfer_function full(128);
+    full.set_points(edited);
+    (void) full.update();
+    for (std::size_t i = 0; i < full.table().size(); ++i) {
+        for (int c = 0; c < 4; ++c) {
+            ASSERT_NEAR(tf.table()[i][c], full.table()[i][c], 1e-5f) << i;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#include "velm/scene.h"
+#include "velm/vertex_format.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using velm_render::packed_vertex;
+using velm_render::quantization;
+using velm_render::vertex_format;
+
+namespace {
+
+// n x n grid of vertices with a position, a normal and a scalar each
+velm_dr::mesh_data make_patch(std::uint32_t n) {
+    velm_dr::mesh_data data;
+    data.vertex_stride = 7;
+    for (std::uint32_t y = 0; y < n; ++y) {
+        for (std::uint32_t x = 0; x < n; ++x) {
+            float     fx     = float(x) / float(n - 1);
+            float     fy     = float(y) / float(n - 1);
+            glm::vec3 normal = glm::normalize(glm::vec3(fx - 0.5f, fy - 0.5f, fx * fy - 0.3f));
+            data.vertices.insert(data.vertices.end(), { fx * 40.0f - 3.0f, fy * 0.5f, 100.0f + fx * fy, normal.x,
+                                                        normal.y, normal.z, fx * 10.0f });
+        }
+    }
+    for (std::uint32_t y = 0; y + 1 < n; ++y) {
+        for (std::uint32_t x = 0; x + 1 < n; ++x) {
+            std::uint32_t a = y * n + x;
+            data.indices.insert(data.indices.end(), { a, a + n, a + 1, a + 1, a + n, a + n + 1 });
+        }
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST(VertexFormatTest, OctahedralRoundTrip) {
+    for (int i = 0; i < 1000; ++i) {
+        float     theta = float(i) * 0.7f;
+        float     z     = std::fmod(float(i) * 0.013f, 2.0f) - 1.0f;
+        float     r     = std::sqrt(1.0f - z * z);
+        glm::vec3 n(r * std::cos(theta), r * std::sin(theta), z);
+
+        glm::vec2 e = velm_render::octahedral_encode(n);
+        EXPECT_LE(std::abs(e.x), 1.0f);
+        EXPECT_LE(std::abs(e.y), 1.0f);
+
+        // snorm16 storage of the encoding keeps the normal within a few hundredths of a degree
+        glm::vec2 stored(std::round(e.x * 32767.0f) / 32767.0f, std::round(e.y * 32767.0f) / 32767.0f);
+        EXPECT_GT(glm::dot(velm_render::octahedral_decode(stored), n), 0.99999f);
+    }
+}
+
+TEST(VertexFormatTest, LayoutsMatchVertexStructs) {
+    EXPECT_EQ(velm_render::packed_layout().getStride(), sizeof(packed_vertex));
+    EXPECT_EQ(velm_render::float_layout().getStride(), sizeof(velm_render::float_vertex));
+}
+
+TEST(VertexFormatTest, PackedPositionsStayWithinQuantizationStep) {
+    velm_dr::mesh_data data = make_patch(64);
+
+    velm_render::aabb bounds{ glm::vec3(-3.0f, 0.0f, 100.0f), glm::vec3(37.0f, 0.5f, 101.0f) };
+    quantization      box = quantization::from_bounds(bounds);
+
+    velm_render::vertex_attributes attributes;
+    attributes.normal_offset = 0;
+    attributes.scalar_offset = 3;
+    attributes.scalar_max    = 10.0f;
+    auto packed              = velm_render::encode(data, attributes, vertex_format::PACKED, box);
+    auto plain               = velm_render::encode(data, attributes, vertex_format::FLOAT, box);
+
+    ASSERT_EQ(packed.vertices.size(), data.vertex_count() * sizeof(packed_vertex));
+    EXPECT_LT(packed.vertices.size() * 1.7, plain.vertices.size());
+    for (std::size_t v = 0; v < data.vertex_count(); ++v) {
+        packed_vertex pv;
+        std::memcpy(&pv, packed.vertices.data() + v * sizeof(pv), sizeof(pv));
+        const float * src = data.vertices.data() + v * data.vertex_stride;
+
+        glm::vec3 p = box.decode(pv.position);
+        EXPECT_NEAR(p.x, src[0], box.scale.x / 32767.0f);
+        EXPECT_NEAR(p.y, src[1], box.scale.y / 32767.0f);
+        EXPECT_NEAR(p.z, src[2], box.scale.z / 32767.0f);
+        EXPECT_NEAR(float(pv.colormap[0]) / 255.0f, src[6] / 10.0f, 0.5f / 255.0f);
+    }
+}
+
+TEST(VertexFormatTest, IndexWidthFollowsVertexCount) {
+    velm_dr::mesh_data small  = make_patch(16);
+    auto               narrow = velm_render::encode(small, {}, vertex_format::PACKED);
+    EXPECT_FALSE(narrow.index32);
+    EXPECT_EQ(narrow.indices.size(), small.indices.size() * 2);
+    EXPECT_EQ(narrow.index_count(), small.indices.size());
+
+    velm_dr::mesh_data large = make_patch(300);
+    auto               wide  = velm_render::encode(large, {}, vertex_format::PACKED);
+    EXPECT_TRUE(wide.index32);
+    EXPECT_EQ(wide.index_count(), large.indices.size());
+}